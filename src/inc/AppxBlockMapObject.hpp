@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <string>
 #include <map>
+#include <memory>
 #include <vector>
 #include <iterator>
 
@@ -17,6 +18,8 @@
 #include "AppxFactory.hpp"
 #include "IXml.hpp"
 #include "BlockMapStream.hpp"
+#include "BlockCache.hpp"
+#include "ThreadPool.hpp"
 #include "Enumerators.hpp"
 
 // internal interface
@@ -33,6 +36,10 @@ public:
     virtual std::vector<std::string> GetFileNames() = 0;
     virtual std::vector<MSIX::Block> GetBlocks(const std::string& fileName) = 0;
     virtual MSIX::ComPtr<IAppxBlockMapFile> GetFile(const std::string& fileName) = 0;
+    // Null unless MSIX_FACTORY_EXTENSION_BLOCK_CACHE asks for one.
+    virtual std::shared_ptr<MSIX::BlockCache> GetBlockCache() = 0;
+    // Threads of the package, for work on several blocks at once.
+    virtual std::shared_ptr<MSIX::ThreadPool> GetThreadPool() = 0;
 };
 MSIX_INTERFACE(IAppxBlockMapInternal, 0x67fed21a,0x70ef,0x4175,0x8f,0x12,0x41,0x5b,0x21,0x3a,0xb6,0xd2);
 
@@ -166,6 +173,8 @@ namespace MSIX {
         std::vector<std::string>        GetFileNames() override;
         std::vector<Block>              GetBlocks(const std::string& fileName) override;
         MSIX::ComPtr<IAppxBlockMapFile> GetFile(const std::string& fileName) override;
+        std::shared_ptr<BlockCache>     GetBlockCache() override { return m_blockCache; }
+        std::shared_ptr<ThreadPool>     GetThreadPool() override { return m_threadPool; }
 
         // IAppxBlockMapReaderUtf8
         HRESULT STDMETHODCALLTYPE GetFile(LPCSTR filename, IAppxBlockMapFile **file) noexcept override;
@@ -173,6 +182,11 @@ namespace MSIX {
     protected:
         std::map<std::string, std::vector<Block>>        m_blockMap;
         std::map<std::string, ComPtr<IAppxBlockMapFile>> m_blockMapFiles;
+        // What validation streams are made from, shared with them. The position of a file is its number in the cache.
+        std::vector<std::shared_ptr<const std::vector<Block>>> m_blockTables;
+        std::map<std::string, std::size_t> m_blockTableIndex;
+        std::shared_ptr<BlockCache> m_blockCache;
+        std::shared_ptr<ThreadPool> m_threadPool = std::make_shared<ThreadPool>();
         IMsixFactory*   m_factory;
         ComPtr<IStream> m_stream;
     };
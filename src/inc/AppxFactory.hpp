@@ -71,6 +71,9 @@ namespace MSIX {
         MSIX_APPLICABILITY_OPTIONS m_applicabilityFlags;
         ComPtr<IMsixStreamFactory> m_streamFactory;
         ComPtr<IMsixApplicabilityLanguagesEnumerator> m_applicabilityLanguagesEnumerator;
+        ComPtr<IMsixRangedSource> m_rangedSource;
+        ComPtr<IMsixBlockCacheSettings> m_blockCacheSettings;
+        ComPtr<IMsixVerificationCacheSettings> m_verificationCacheSettings;
 
     private:
         template<typename T>
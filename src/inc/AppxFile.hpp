@@ -9,6 +9,8 @@
 #include <algorithm>
 #include <iostream>
 #include <limits>
+#include <functional>
+#include <mutex>
 
 #include "MSIXWindows.hpp"
 #include "AppxPackaging.hpp"
@@ -20,7 +22,7 @@
 #include "StreamBase.hpp"
 
 namespace MSIX {
-    class AppxFile : public ComClass<AppxFile, IAppxFile, IAppxFileUtf8>
+    class AppxFile : public ComClass<AppxFile, IAppxFile, IAppxFileUtf8, IMsixFileReader>
     {
     public:
         AppxFile(IMsixFactory* factory, const std::string& name, const ComPtr<IStream>& stream) : m_factory(factory), m_name(name), m_stream(stream)
@@ -29,24 +31,33 @@ namespace MSIX {
             ULARGE_INTEGER end = { 0 };
             ThrowHrIfFailed(m_stream->Seek(start, StreamBase::Reference::END, &end));
             ThrowHrIfFailed(m_stream->Seek(start, StreamBase::Reference::START, nullptr));
-            m_size = end.u.LowPart;
+            m_size = end.QuadPart;
+        }
+
+        // Makes its stream, and runs whatever checks that takes, the first time the stream is needed, so a file
+        // that isn't used costs nothing. Until then the file is known by its name and size. If making the stream
+        // fails, everything that needs it fails with the same error.
+        typedef std::function<ComPtr<IStream>()> StreamMaker;
+        AppxFile(IMsixFactory* factory, const std::string& name, std::uint64_t size, StreamMaker makeStream) :
+            m_factory(factory), m_name(name), m_size(size), m_makeStream(std::move(makeStream))
+        {
         }
 
         // IAppxFile methods
-        virtual HRESULT STDMETHODCALLTYPE GetCompressionOption(APPX_COMPRESSION_OPTION* compressionOption) noexcept override
+        virtual HRESULT STDMETHODCALLTYPE GetCompressionOption(APPX_COMPRESSION_OPTION* compressionOption) noexcept override try
         {
             if (compressionOption)
             {
                 *compressionOption = APPX_COMPRESSION_OPTION_NONE;
                 ComPtr<IStreamInternal> streamInt;
-                HRESULT hr = m_stream->QueryInterface(UuidOfImpl<IStreamInternal>::iid, reinterpret_cast<void**>(&streamInt));
+                HRESULT hr = GetFileStream()->QueryInterface(UuidOfImpl<IStreamInternal>::iid, reinterpret_cast<void**>(&streamInt));
                 if (SUCCEEDED(hr))
                 {
                     *compressionOption = streamInt->IsCompressed() ? APPX_COMPRESSION_OPTION_NORMAL : APPX_COMPRESSION_OPTION_NONE;
                 }
             }
             return static_cast<HRESULT>(Error::OK);
-        }
+        } CATCH_RETURN();
 
         virtual HRESULT STDMETHODCALLTYPE GetContentType(LPWSTR* contentType) noexcept override
         {
@@ -70,7 +81,7 @@ namespace MSIX {
         virtual HRESULT STDMETHODCALLTYPE GetStream(IStream** stream) noexcept override try
         {
             ThrowErrorIf(Error::InvalidParameter, (stream == nullptr || *stream != nullptr), "bad pointer");
-            *stream = m_stream.As<IStream>().Detach();
+            *stream = GetFileStream().As<IStream>().Detach();
             return static_cast<HRESULT>(Error::OK);
         } CATCH_RETURN();
 
@@ -85,10 +96,49 @@ namespace MSIX {
             return m_factory->MarshalOutStringUtf8(m_name, fileName);
         } CATCH_RETURN();
 
+        // IMsixFileReader
+        virtual HRESULT STDMETHODCALLTYPE ReadAll(UINT64 bufferSize, BYTE* buffer, UINT64* bytesRead) noexcept override try
+        {
+            ThrowErrorIf(Error::InvalidParameter, (buffer == nullptr || bufferSize < m_size), "buffer too small");
+            // 4 MB at a time, a whole number of 64 KB blocks, so every read starts on a block boundary and the
+            // compressed data of the blocks it inflates is never much more than a read.
+            const std::uint64_t chunk = 64 * 0x10000;
+            const auto& stream = GetFileStream();
+            LARGE_INTEGER start = { 0 };
+            ThrowHrIfFailed(stream->Seek(start, StreamBase::Reference::START, nullptr));
+            std::uint64_t total = 0;
+            while (total < m_size)
+            {
+                ULONG read = 0;
+                ThrowHrIfFailed(stream->Read(buffer + total, static_cast<ULONG>(std::min(chunk, m_size - total)), &read));
+                ThrowErrorIf(Error::FileRead, (read == 0), "file is shorter than its size");
+                total += read;
+            }
+            ThrowHrIfFailed(stream->Seek(start, StreamBase::Reference::START, nullptr));
+            if (bytesRead) { *bytesRead = total; }
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
     protected:
+        const ComPtr<IStream>& GetFileStream()
+        {
+            if (m_makeStream)
+            {
+                std::lock_guard<std::mutex> guard(m_lock);
+                if (!m_stream)
+                {
+                    m_stream = m_makeStream();
+                    ThrowErrorIfNot(Error::FileNotFound, m_stream, "file has no stream");
+                }
+            }
+            return m_stream;
+        }
+
         std::string m_name;
         ComPtr<IStream> m_stream;
         IMsixFactory* m_factory;
         std::uint64_t m_size;
+        StreamMaker m_makeStream;   // empty if the stream was given
+        std::mutex m_lock;          // for m_stream, while it can still be made
     };
 }
\ No newline at end of file
@@ -23,6 +23,8 @@
 #include "AppxFactory.hpp"
 #include "AppxPackageInfo.hpp"
 #include "AppxManifestObject.hpp"
+#include "FileNameIndex.hpp"
+#include "PackageVerifier.hpp"
 
 // internal interface
 // {51b2c456-aaa9-46d6-8ec9-298220559189}
@@ -37,6 +39,10 @@ class IPackage : public IUnknown
 public:
     virtual void Unpack(MSIX_PACKUNPACK_OPTION options, const MSIX::ComPtr<IStorageObject>& to) = 0;
     virtual std::vector<std::string>& GetFootprintFiles() = 0;
+    // Name, relative to the destination, that a file of the package is unpacked to.
+    virtual std::string GetTargetName(MSIX_PACKUNPACK_OPTION options, const std::string& fileName) = 0;
+    // Payload files as IMsixPackageVerifier checks them. For a bundle, those of its applicable packages.
+    virtual std::vector<MSIX::PackageVerifier::File> GetFilesToVerify() = 0;
 };
 MSIX_INTERFACE(IPackage, 0x51b2c456,0xaaa9,0x46d6,0x8e,0xc9,0x29,0x82,0x20,0x55,0x91,0x89);
 
@@ -44,10 +50,12 @@ namespace MSIX {
     // Storage object representing the entire AppxPackage
     // Note: This class has is own implmentation of QueryInterface, if a new interface is implemented
     // AppxPackageObject::QueryInterface must also be modified too.
-    class AppxPackageObject final : public ComClass<AppxPackageObject, IAppxPackageReader, IPackage, IStorageObject, IAppxBundleReader, IAppxPackageReaderUtf8, IAppxBundleReaderUtf8>
+    class AppxPackageObject final : public ComClass<AppxPackageObject, IAppxPackageReader, IPackage, IStorageObject, IAppxBundleReader, IAppxPackageReaderUtf8, IAppxBundleReaderUtf8, IMsixPackageVerifier, IMsixBlockCacheStatistics>
     {
     public:
-        AppxPackageObject(IMsixFactory* factory, MSIX_VALIDATION_OPTION validation, MSIX_APPLICABILITY_OPTIONS applicabilityOptions, const ComPtr<IStorageObject>& container);
+        // fileIdentity is the identity of the file the package is read from, if it has one, see IStreamInternal::GetFileIdentity.
+        AppxPackageObject(IMsixFactory* factory, MSIX_VALIDATION_OPTION validation, MSIX_APPLICABILITY_OPTIONS applicabilityOptions, const ComPtr<IStorageObject>& container,
+            const std::string& fileIdentity = std::string());
         ~AppxPackageObject() {}
 
         HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) noexcept override
@@ -81,6 +89,18 @@ namespace MSIX {
                 AddRef();
                 return S_OK;
             }
+            if (riid == UuidOfImpl<IMsixPackageVerifier>::iid)
+            {
+                *ppvObject = static_cast<void*>(static_cast<IMsixPackageVerifier*>(this));
+                AddRef();
+                return S_OK;
+            }
+            if (riid == UuidOfImpl<IMsixBlockCacheStatistics>::iid)
+            {
+                *ppvObject = static_cast<void*>(static_cast<IMsixBlockCacheStatistics*>(this));
+                AddRef();
+                return S_OK;
+            }
             #ifdef BUNDLE_SUPPORT
             if (riid == UuidOfImpl<IAppxBundleReader>::iid && m_isBundle)
             {
@@ -107,6 +127,8 @@ namespace MSIX {
         // internal IPackage methods
         void Unpack(MSIX_PACKUNPACK_OPTION options, const ComPtr<IStorageObject>& to) override;
         std::vector<std::string>& GetFootprintFiles() override { return m_footprintFiles; }
+        std::string GetTargetName(MSIX_PACKUNPACK_OPTION options, const std::string& fileName) override;
+        std::vector<PackageVerifier::File> GetFilesToVerify() override;
 
         // IAppxPackageReader
         HRESULT STDMETHODCALLTYPE GetBlockMap(IAppxBlockMapReader** blockMapReader) noexcept override;
@@ -136,12 +158,20 @@ namespace MSIX {
         // IAppxBundleReaderUtf8
         HRESULT STDMETHODCALLTYPE GetPayloadPackage(LPCSTR fileName, IAppxFile **payloadPackage) noexcept override;
 
+        // IMsixPackageVerifier
+        HRESULT STDMETHODCALLTYPE VerifyPackage(UINT32 threadCount, IMsixVerificationResults** results) noexcept override;
+
+        // IMsixBlockCacheStatistics
+        HRESULT STDMETHODCALLTYPE GetBlockCacheStatistics(UINT64* hits, UINT64* misses) noexcept override;
+
     protected:
         // Helper methods
-        void VerifyFile(const ComPtr<IStream>& stream, const std::string& fileName, const ComPtr<IAppxBlockMapInternal>& blockMapInternal);
+        static void VerifyFile(const ComPtr<IStream>& stream, const std::string& fileName, const ComPtr<IAppxBlockMapInternal>& blockMapInternal);
+        static ComPtr<IStream> OpenPayloadFile(const ComPtr<IStorageObject>& container, const ComPtr<IVerifierObject>& blockMap,
+            const std::string& fileName, const std::string& opcFileName);
         ComPtr<IAppxFile> GetAppxFile(const std::string& fileName);
 
-        std::map<std::string, ComPtr<IAppxFile>> m_files;
+        FileNameIndex m_files;
 
         MSIX_VALIDATION_OPTION      m_validation = MSIX_VALIDATION_OPTION::MSIX_VALIDATION_OPTION_FULL;
         ComPtr<IMsixFactory>        m_factory;
@@ -152,6 +182,7 @@ namespace MSIX {
         ComPtr<IStorageObject>      m_container;
         
         std::vector<std::string>    m_payloadFiles;
+        std::vector<std::string>    m_payloadBlockMapNames; // of m_payloadFiles, in the same order
         std::vector<std::string>    m_footprintFiles;
         std::vector<std::string>    m_applicablePackagesNames;
         std::vector<ComPtr<IAppxPackageReader>> m_applicablePackages;
@@ -1056,6 +1056,14 @@ interface IMsixElementEnumerator;
 interface IMsixFactoryOverrides;
 interface IMsixStreamFactory;
 interface IMsixApplicabilityLanguagesEnumerator;
+interface IMsixRangedSource;
+interface IMsixRangedReadCallback;
+interface IMsixFileReader;
+interface IMsixVerificationResults;
+interface IMsixPackageVerifier;
+interface IMsixBlockCacheSettings;
+interface IMsixBlockCacheStatistics;
+interface IMsixVerificationCacheSettings;
 
 #ifndef __IMsixDocumentElement_INTERFACE_DEFINED__
 #define __IMsixDocumentElement_INTERFACE_DEFINED__
@@ -1129,6 +1137,9 @@ interface IMsixApplicabilityLanguagesEnumerator;
     {
         MSIX_FACTORY_EXTENSION_STREAM_FACTORY = 0x1,
         MSIX_FACTORY_EXTENSION_APPLICABILITY_LANGUAGES = 0x2,
+        MSIX_FACTORY_EXTENSION_RANGED_SOURCE = 0x3,
+        MSIX_FACTORY_EXTENSION_BLOCK_CACHE = 0x4,
+        MSIX_FACTORY_EXTENSION_VERIFICATION_CACHE = 0x5,
     } 	MSIX_FACTORY_EXTENSION;
 
     // {0acedbdb-57cd-4aca-8cee-33fa52394316}
@@ -1164,6 +1175,172 @@ interface IMsixApplicabilityLanguagesEnumerator;
     };
 #endif  /* __IMsixStreamFactory_INTERFACE_DEFINED__ */
 
+#ifndef __IMsixRangedReadCallback_INTERFACE_DEFINED__
+#define __IMsixRangedReadCallback_INTERFACE_DEFINED__
+
+    // {a9080524-4568-426b-b662-9d0570c27cb4}
+    MSIX_INTERFACE(IMsixRangedReadCallback,0xa9080524,0x4568,0x426b,0xb6,0x62,0x9d,0x05,0x70,0xc2,0x7c,0xb4);
+    interface IMsixRangedReadCallback : public IUnknown
+    {
+    public:
+        // Called once for every successful IMsixRangedSource::ReadRange, from any thread and possibly
+        // before ReadRange returns. bytesRead is less than requested only at the end of the source.
+        virtual HRESULT STDMETHODCALLTYPE ReadCompleted(
+            /* [in] */ HRESULT result,
+            /* [in] */ UINT32 bytesRead) noexcept = 0;
+    };
+#endif  /* __IMsixRangedReadCallback_INTERFACE_DEFINED__ */
+
+#ifndef __IMsixRangedSource_INTERFACE_DEFINED__
+#define __IMsixRangedSource_INTERFACE_DEFINED__
+
+    // A package read with asynchronous ranged reads, like a blob on remote or high latency block storage.
+    // Specify it with MSIX_FACTORY_EXTENSION_RANGED_SOURCE and call CreatePackageReader or CreateBundleReader
+    // without an input stream. Neighbouring reads are coalesced and several ranges are kept in flight.
+    // {7b923c89-25c7-49a0-a6ee-adba6817a534}
+    MSIX_INTERFACE(IMsixRangedSource,0x7b923c89,0x25c7,0x49a0,0xa6,0xee,0xad,0xba,0x68,0x17,0xa5,0x34);
+    interface IMsixRangedSource : public IUnknown
+    {
+    public:
+        virtual HRESULT STDMETHODCALLTYPE GetSize(
+            /* [retval][out] */ UINT64* size) noexcept = 0;
+
+        // Starts reading size bytes at offset into buffer. The buffer stays valid until callback is called.
+        // If this fails the callback is not called.
+        virtual HRESULT STDMETHODCALLTYPE ReadRange(
+            /* [in] */ UINT64 offset,
+            /* [in] */ UINT32 size,
+            /* [in] */ BYTE* buffer,
+            /* [in] */ IMsixRangedReadCallback* callback) noexcept = 0;
+    };
+#endif  /* __IMsixRangedSource_INTERFACE_DEFINED__ */
+
+#ifndef __IMsixFileReader_INTERFACE_DEFINED__
+#define __IMsixFileReader_INTERFACE_DEFINED__
+
+    // Implemented by the IAppxFile objects of a package reader. Reads a whole payload file at once. The blocks
+    // of a compressed file are inflated on several threads, each straight into its place in the buffer, and
+    // checked against the block map as they are done.
+    // {f801e019-b06c-44f0-bca7-23b8456331e3}
+    MSIX_INTERFACE(IMsixFileReader,0xf801e019,0xb06c,0x44f0,0xbc,0xa7,0x23,0xb8,0x45,0x63,0x31,0xe3);
+    interface IMsixFileReader : public IUnknown
+    {
+    public:
+        // Reads the file into buffer, which has to be at least as big as the file (IAppxFile::GetSize).
+        virtual HRESULT STDMETHODCALLTYPE ReadAll(
+            /* [in] */ UINT64 bufferSize,
+            /* [size_is][out] */ BYTE* buffer,
+            /* [retval][out] */ UINT64* bytesRead) noexcept = 0;
+    };
+#endif  /* __IMsixFileReader_INTERFACE_DEFINED__ */
+
+#ifndef __IMsixVerificationResults_INTERFACE_DEFINED__
+#define __IMsixVerificationResults_INTERFACE_DEFINED__
+
+    // What IMsixPackageVerifier::VerifyPackage found, one entry for every payload file it checked.
+    // {810dae10-ea4d-4e1f-886a-b05611d1c230}
+    MSIX_INTERFACE(IMsixVerificationResults,0x810dae10,0xea4d,0x4e1f,0x88,0x6a,0xb0,0x56,0x11,0xd1,0xc2,0x30);
+    interface IMsixVerificationResults : public IUnknown
+    {
+    public:
+        virtual HRESULT STDMETHODCALLTYPE GetCount(
+            /* [retval][out] */ UINT32* count) noexcept = 0;
+
+        // Name of the file as in the block map. For a bundle it is prefixed with the name of its package and '/'.
+        virtual HRESULT STDMETHODCALLTYPE GetFileName(
+            /* [in] */ UINT32 index,
+            /* [retval][string][out] */ LPSTR* fileName) noexcept = 0;
+
+        // S_OK if every block of the file matches the block map, otherwise the error reading it would fail with.
+        virtual HRESULT STDMETHODCALLTYPE GetResult(
+            /* [in] */ UINT32 index,
+            /* [retval][out] */ HRESULT* result) noexcept = 0;
+    };
+#endif  /* __IMsixVerificationResults_INTERFACE_DEFINED__ */
+
+#ifndef __IMsixPackageVerifier_INTERFACE_DEFINED__
+#define __IMsixPackageVerifier_INTERFACE_DEFINED__
+
+    // Implemented by package readers. Checks every block of every payload file against the block map without
+    // writing the files anywhere. The blocks of all the files are shared out to a pool of threads, each of which
+    // reads them by their offsets in the package, inflates them if they are compressed and checks their hashes.
+    // For a bundle, the payload files of its applicable packages are checked.
+    // {a0fd5058-d24d-438f-87b0-ba366f146fb4}
+    MSIX_INTERFACE(IMsixPackageVerifier,0xa0fd5058,0xd24d,0x438f,0x87,0xb0,0xba,0x36,0x6f,0x14,0x6f,0xb4);
+    interface IMsixPackageVerifier : public IUnknown
+    {
+    public:
+        // threadCount is how many threads check blocks, 0 for one per core. Succeeds if the files could be
+        // checked, whether or not they are intact, results says which ones are.
+        virtual HRESULT STDMETHODCALLTYPE VerifyPackage(
+            /* [in] */ UINT32 threadCount,
+            /* [retval][out] */ IMsixVerificationResults** results) noexcept = 0;
+    };
+#endif  /* __IMsixPackageVerifier_INTERFACE_DEFINED__ */
+
+#ifndef __IMsixBlockCacheSettings_INTERFACE_DEFINED__
+#define __IMsixBlockCacheSettings_INTERFACE_DEFINED__
+
+    // Turns on a cache of the blocks of the payload files of a package, uncompressed and checked against the block
+    // map, which all the streams over the files share. Small reads of a cached block are copied from it instead of
+    // reading, inflating and hashing the whole block again. Specify it with MSIX_FACTORY_EXTENSION_BLOCK_CACHE
+    // before creating the package reader, every package read with the factory gets a cache of its own.
+    // {b7e5057e-36c7-44bb-9a27-540415b450a9}
+    MSIX_INTERFACE(IMsixBlockCacheSettings,0xb7e5057e,0x36c7,0x44bb,0x9a,0x27,0x54,0x04,0x15,0xb4,0x50,0xa9);
+    interface IMsixBlockCacheSettings : public IUnknown
+    {
+    public:
+        // Most bytes of blocks a package keeps. The least recently used blocks are dropped to stay under it.
+        // 0 turns the cache off.
+        virtual HRESULT STDMETHODCALLTYPE GetCapacity(
+            /* [retval][out] */ UINT64* bytes) noexcept = 0;
+    };
+#endif  /* __IMsixBlockCacheSettings_INTERFACE_DEFINED__ */
+
+#ifndef __IMsixBlockCacheStatistics_INTERFACE_DEFINED__
+#define __IMsixBlockCacheStatistics_INTERFACE_DEFINED__
+
+    // Implemented by package readers. How well the block cache does, to help pick its capacity. For a bundle,
+    // the sums for its applicable packages.
+    // {5d9a4bb9-0591-4dd5-81d9-a7105de61037}
+    MSIX_INTERFACE(IMsixBlockCacheStatistics,0x5d9a4bb9,0x0591,0x4dd5,0x81,0xd9,0xa7,0x10,0x5d,0xe6,0x10,0x37);
+    interface IMsixBlockCacheStatistics : public IUnknown
+    {
+    public:
+        // hits is how many times a read found its block in the cache, misses how many times it had to read the
+        // block. Both are 0 if the cache is off.
+        virtual HRESULT STDMETHODCALLTYPE GetBlockCacheStatistics(
+            /* [out] */ UINT64* hits,
+            /* [out] */ UINT64* misses) noexcept = 0;
+    };
+#endif  /* __IMsixBlockCacheStatistics_INTERFACE_DEFINED__ */
+
+#ifndef __IMsixVerificationCacheSettings_INTERFACE_DEFINED__
+#define __IMsixVerificationCacheSettings_INTERFACE_DEFINED__
+
+    // Turns on a cache, kept in a directory, of the signature checks of packages opened from files. Opening the
+    // same file again, unchanged, with the same AppxSignature.p7x and validation options reuses the results
+    // instead of checking the certificate chain and the signature again. The digests of the package's parts
+    // are still checked every time. Entries are signed with the key, an entry that doesn't match it is
+    // ignored and the package is checked in full. Specify it with MSIX_FACTORY_EXTENSION_VERIFICATION_CACHE
+    // before creating the package reader.
+    // {3f0c8a4e-7d52-4b8a-9e61-2c5d0b9f47a3}
+    MSIX_INTERFACE(IMsixVerificationCacheSettings,0x3f0c8a4e,0x7d52,0x4b8a,0x9e,0x61,0x2c,0x5d,0x0b,0x9f,0x47,0xa3);
+    interface IMsixVerificationCacheSettings : public IUnknown
+    {
+    public:
+        // Existing directory the entries are kept in. The string belongs to the settings object.
+        virtual HRESULT STDMETHODCALLTYPE GetDirectory(
+            /* [retval][string][out] */ LPCSTR* directory) noexcept = 0;
+
+        // Secret the entries are signed with, at least 16 bytes. Anyone who can write to the directory and
+        // knows it can make packages look checked. The bytes belong to the settings object.
+        virtual HRESULT STDMETHODCALLTYPE GetKey(
+            /* [out] */ UINT32* keySize,
+            /* [size_is][size_is][out] */ const BYTE** key) noexcept = 0;
+    };
+#endif  /* __IMsixVerificationCacheSettings_INTERFACE_DEFINED__ */
+
 #ifndef __IMsixApplicabilityLanguagesEnumerator_INTERFACE_DEFINED__
 #define __IMsixApplicabilityLanguagesEnumerator_INTERFACE_DEFINED__
 
@@ -1425,13 +1602,17 @@ enum MSIX_VALIDATION_OPTION
         MSIX_VALIDATION_OPTION_SKIPSIGNATURE               = 0x1,
         MSIX_VALIDATION_OPTION_ALLOWSIGNATUREORIGINUNKNOWN = 0x2,
         MSIX_VALIDATION_OPTION_SKIPAPPXMANIFEST            = 0x4,
+        MSIX_VALIDATION_OPTION_VERIFYCRC                   = 0x8,
+        MSIX_VALIDATION_OPTION_DEFERPAYLOADCHECKS          = 0x10,
     }   MSIX_VALIDATION_OPTION;
 
 typedef /* [v1_enum] */
 enum MSIX_PACKUNPACK_OPTION
     {
         MSIX_PACKUNPACK_OPTION_NONE                    = 0x0,
-        MSIX_PACKUNPACK_OPTION_CREATEPACKAGESUBFOLDER  = 0x1
+        MSIX_PACKUNPACK_OPTION_CREATEPACKAGESUBFOLDER  = 0x1,
+        MSIX_PACKUNPACK_OPTION_FORWARDONLY             = 0x2,
+        MSIX_PACKUNPACK_OPTION_MAPFILE                 = 0x4
     }   MSIX_PACKUNPACK_OPTION;
 
 typedef /* [v1_enum] */
@@ -1529,6 +1710,8 @@ MSIX_API HRESULT STDMETHODCALLTYPE CoCreateAppxBundleFactoryWithHeap(
     IAppxBundleFactory** appxBundleFactory) noexcept;
 
 // provided as a helper for platforms that do not have an implementation of SHCreateStreamOnFileEx
+// Files opened for read are read with positional reads, so a file that is truncated while it is read makes
+// the reads fail.
 MSIX_API HRESULT STDMETHODCALLTYPE CreateStreamOnFile(
     char* utf8File,
     bool forRead,
@@ -1539,6 +1722,15 @@ MSIX_API HRESULT STDMETHODCALLTYPE CreateStreamOnFileUTF16(
     bool forRead,
     IStream** stream) noexcept;
 
+// Opens a file for read mapped into memory, so package streams over it read without copies, on platforms
+// other than Windows. Only for files nothing truncates while the stream is in use: reading the part of a
+// mapped file that's gone raises SIGBUS instead of returning an error. Files that can't be mapped, or that
+// another user can write to, are opened the way CreateStreamOnFile opens them.
+// UnpackPackage and UnpackBundle open the package with it given MSIX_PACKUNPACK_OPTION_MAPFILE.
+MSIX_API HRESULT STDMETHODCALLTYPE CreateMappedStreamOnFile(
+    char* utf8File,
+    IStream** stream) noexcept;
+
 } // extern "C++"
 
 #endif //__appxpackaging_hpp__
\ No newline at end of file
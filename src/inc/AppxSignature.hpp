@@ -7,10 +7,13 @@
 #include "AppxPackaging.hpp"
 #include "VerifierObject.hpp"
 #include "StreamBase.hpp"
+#include "StorageObject.hpp"
 #include "AppxFactory.hpp"
 
 namespace MSIX {
 
+    class VerificationCache;
+
     enum class SignatureOrigin
     {
         Windows,    // chains to the Windows RCA
@@ -61,7 +64,11 @@ namespace MSIX {
     {
     public:
 
-        AppxSignatureObject(IMsixFactory* factory, MSIX_VALIDATION_OPTION validationOptions,const ComPtr<IStream>& stream);
+        // With a cache, a signature it has checked before isn't checked again, and one it hasn't is added to it.
+        // With the container the signature was read from, the parts of the archive its digests are of are checked
+        // against them.
+        AppxSignatureObject(IMsixFactory* factory, MSIX_VALIDATION_OPTION validationOptions,const ComPtr<IStream>& stream, VerificationCache* cache = nullptr,
+            const ComPtr<IStorageObject>& container = ComPtr<IStorageObject>());
 
         // IVerifierObject
         const std::string& GetPublisher() override  { return m_publisher; }
@@ -81,6 +88,8 @@ namespace MSIX {
         Digest& GetCodeIntegrityDigest()     { return m_CodeIntegrity; }
 
     protected:
+        void ValidateArchive(const ComPtr<IStorageObject>& container);
+
         bool                         m_hasDigests;
         Digest                       m_FileRecords;
         Digest                       m_CentralDirectory;
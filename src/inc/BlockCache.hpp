@@ -0,0 +1,60 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace MSIX {
+
+    // Blocks of the payload files of a package, uncompressed and checked against their hashes, shared by all the
+    // streams over the files. Blocks are found by the number the block map gave their file and their index in it.
+    // Once the blocks take more than the capacity the least recently used ones are dropped. Any thread can use it.
+    class BlockCache
+    {
+    public:
+        // A block stays valid for whoever holds it after it is dropped.
+        typedef std::shared_ptr<const std::vector<std::uint8_t>> Data;
+
+        explicit BlockCache(std::uint64_t capacity);
+
+        // Null if the block isn't cached.
+        Data Find(std::size_t file, std::size_t block);
+
+        // Only for blocks whose hash matched.
+        void Add(std::size_t file, std::size_t block, const Data& data);
+
+        void GetStatistics(std::uint64_t& hits, std::uint64_t& misses);
+
+    protected:
+        struct Key
+        {
+            std::size_t file;
+            std::size_t block;
+
+            bool operator==(const Key& other) const { return file == other.file && block == other.block; }
+        };
+
+        struct KeyHash
+        {
+            std::size_t operator()(const Key& key) const { return std::hash<std::uint64_t>()((static_cast<std::uint64_t>(key.file) << 32) ^ key.block); }
+        };
+
+        typedef std::list<std::pair<Key, Data>> Entries;
+
+        std::mutex m_lock;
+        std::uint64_t m_capacity;
+        std::uint64_t m_size = 0;
+        std::uint64_t m_hits = 0;
+        std::uint64_t m_misses = 0;
+        Entries m_entries; // most recently used first
+        std::unordered_map<Key, Entries::iterator, KeyHash> m_index;
+    };
+}
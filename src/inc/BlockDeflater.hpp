@@ -0,0 +1,31 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace MSIX {
+
+    // Compresses a payload file the way packages have it: every 64 KB block is compressed on its own and
+    // ended with a full flush, so it can be inflated by itself, and the deflate stream is ended after the last
+    // block with the two bytes 03 00 that AppxPackageObject::VerifyFile allows for. Blocks are compressed on
+    // several threads, and each one comes out the same whatever the number of threads.
+    class BlockDeflater
+    {
+    public:
+        // threads is how many threads compress blocks, 0 for one per core.
+        explicit BlockDeflater(std::size_t threads = 0);
+
+        // Compresses size bytes of data into compressed. blockSizes gets the compressed size of every block of
+        // the block map, which the block map has as the Size of the block. The hashes of the block map are of
+        // the uncompressed blocks, the caller has those.
+        void Deflate(const std::uint8_t* data, std::uint64_t size, std::vector<std::uint8_t>& compressed, std::vector<std::uint32_t>& blockSizes);
+
+    protected:
+        std::size_t m_threads;
+    };
+}
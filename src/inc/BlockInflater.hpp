@@ -0,0 +1,52 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#pragma once
+
+#include "MSIXWindows.hpp"
+#include "ComHelper.hpp"
+#include "ThreadPool.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace MSIX {
+
+    struct Block;
+
+    // Inflates runs of blocks of a compressed payload file, on several threads of the package at once for longer runs. Every
+    // block of the block map is compressed on its own, so each one is decompressed in one go straight into its
+    // place in the output and checked against its hash as soon as it is done.
+    class BlockInflater
+    {
+    public:
+        // compressed is a stream of its own over the compressed data of the file, blocks are the file's
+        // blocks from the block map and size is its uncompressed size. Without threads, every run is
+        // inflated on the calling thread.
+        BlockInflater(const ComPtr<IStream>& compressed, const std::vector<Block>& blocks, std::uint64_t size,
+            std::shared_ptr<ThreadPool> threads = nullptr);
+
+        // Inflates count blocks starting with block first into output, which has room for all of them.
+        // Returns how many bytes at the start of output are good. That is short of all of them if a block
+        // can't be inflated on its own or doesn't match its hash, the caller has to read the rest some other way.
+        std::uint64_t Inflate(std::size_t first, std::size_t count, std::uint8_t* output);
+
+        std::size_t GetBlockCount() const { return m_blocks.size(); }
+
+    protected:
+        struct BlockRange
+        {
+            std::uint64_t compressedOffset;
+            std::uint64_t compressedSize;
+            std::uint32_t size;
+            const std::vector<std::uint8_t>* hash;
+        };
+
+        ComPtr<IStream> m_compressed;
+        std::shared_ptr<ThreadPool> m_threadPool;
+        std::vector<BlockRange> m_blocks;
+        std::vector<std::uint8_t> m_buffer;
+    };
+}
@@ -1,27 +1,31 @@
 //
 //  Copyright (C) 2017 Microsoft.  All rights reserved.
 //  See LICENSE file in the project root for full license information.
-// 
+//
 #pragma once
 #define NOMINMAX /* windows.h, or more correctly windef.h, defines min as a macro... */
 #include "MSIXWindows.hpp"
 #include "Exceptions.hpp"
 #include "StreamBase.hpp"
-#include "RangeStream.hpp"
-#include "HashStream.hpp"
 #include "ComHelper.hpp"
 #include "SHA256.hpp"
 #include "AppxFactory.hpp"
+#include "BlockInflater.hpp"
+#include "BlockCache.hpp"
+#include "ThreadPool.hpp"
 
 #include <string>
 #include <map>
 #include <functional>
 #include <algorithm>
 #include <vector>
+#include <memory>
+#include <limits>
 
 namespace MSIX {
-  
+
     const std::uint64_t BLOCKMAP_BLOCK_SIZE = 65536; // 64KB
+    const std::size_t BLOCKMAP_HASH_GROUP = 16; // blocks hashed together by SHA256::ComputeHashes
 
     typedef struct Block
     {
@@ -30,61 +34,63 @@ namespace MSIX {
         std::vector<std::uint8_t> hash;
     } Block;
 
-    typedef struct BlockPlusStream : Block
-    {
-        std::uint64_t   size;
-        std::uint64_t   offset;         
-        ComPtr<IStream> stream;
-    } BlockPlusStream;
-
-    // This represents a subset of a Stream
+    // A payload file, checked against its blocks in the block map as it is read. Block i holds the bytes from
+    // i * BLOCKMAP_BLOCK_SIZE, so the block of any position is found by dividing, and nothing is made per block.
+    // Every byte handed out was hashed with its block: either in the read that got it from the file's stream, or
+    // before the block was kept, as the last block read in pieces or in the package's block cache. Nothing read
+    // from the file's stream is trusted because the same bytes matched before, the file could have changed since.
     class BlockMapStream final : public StreamBase
     {
     public:
-        BlockMapStream(IMsixFactory* factory, std::string decodedName, const ComPtr<IStream>& stream, std::vector<Block>& blocks)
-            : m_factory(factory), m_decodedName(decodedName), m_stream(stream)
+        // The stream shares the blocks with the block map, it can outlive it. file is the number of the file in
+        // cache, which can be null. Runs of blocks are only inflated on several threads with threads.
+        BlockMapStream(IMsixFactory* factory, std::string decodedName, const ComPtr<IStream>& stream, std::shared_ptr<const std::vector<Block>> blocks,
+            std::shared_ptr<BlockCache> cache = nullptr, std::size_t file = 0, std::shared_ptr<ThreadPool> threads = nullptr)
+            : m_factory(factory), m_decodedName(decodedName), m_stream(stream), m_blocks(std::move(blocks)), m_blockCache(std::move(cache)), m_file(file),
+              m_threadPool(std::move(threads))
         {
+            const auto& table = *m_blocks;
             // Determine overall stream size
             ULARGE_INTEGER uli;
             LARGE_INTEGER li;
             li.QuadPart = 0;
             ThrowHrIfFailed(stream->Seek(li, STREAM_SEEK_END, &uli));
-            
+
             m_streamSize = uli.QuadPart;
 
             // Reset seek position to beginning
             li.QuadPart = 0;
             ThrowHrIfFailed(stream->Seek(li, STREAM_SEEK_SET, nullptr));
 
-            // Build a vector of all HashStream->RangeStream's for the blocks in the blockmap
-            std::uint64_t offset = 0;
-            std::uint64_t sizeRemaining = m_streamSize;
-            for (auto block = blocks.begin(); ((sizeRemaining != 0) && (block != blocks.end())); block++)
+            // Compressed blocks are compressed on their own, so inflating can start at any of them. Streams
+            // that aren't inflating ignore this.
+            std::vector<SyncPoint> points;
+            std::uint64_t compressedOffset = 0;
+            for (std::size_t i = 0; i < table.size(); i++)
             {
-                auto rangeStream = ComPtr<IStream>::Make<RangeStream>(offset, std::min(sizeRemaining, BLOCKMAP_BLOCK_SIZE), stream);                
-                auto hashStream = ComPtr<IStream>::Make<HashStream>(rangeStream, block->hash);
-                std::uint64_t blockSize = std::min(sizeRemaining, BLOCKMAP_BLOCK_SIZE);
-
-                BlockPlusStream bs;
-                bs.offset = offset;
-                bs.size   = blockSize;
-                bs.stream = hashStream;
-                bs.hash   = block->hash;
-                m_blockStreams.emplace_back(std::move(bs));
-                
-                offset          += blockSize;
-                sizeRemaining   -= blockSize;
+                points.push_back({ i * BLOCKMAP_BLOCK_SIZE, compressedOffset });
+                compressedOffset += table[i].compressedSize;
             }
+            m_stream.As<IStreamInternal>()->SetSyncPoints(std::move(points));
 
-            // Reset seek position to beginning
-            ThrowHrIfFailed(stream->Seek(li, STREAM_SEEK_SET, nullptr));
-            ThrowHrIfFailed(Seek(li, STREAM_SEEK_SET, nullptr));
+            // Blocks past the end of the file aren't used. If the block map has too few, reads stop where they end.
+            m_blockCount = static_cast<std::size_t>(std::min(static_cast<std::uint64_t>(table.size()),
+                (m_streamSize + BLOCKMAP_BLOCK_SIZE - 1) / BLOCKMAP_BLOCK_SIZE));
+            m_relativePosition = 0;
         }
 
         // IStream
+        HRESULT STDMETHODCALLTYPE Clone(IStream** stream) noexcept override try
+        {   // The clone shares the block table, cache and threads and gets its own source stream.
+            ComPtr<IStream> source;
+            ThrowHrIfFailed(m_stream->Clone(&source));
+            auto clone = ComPtr<BlockMapStream>::Make<BlockMapStream>(m_factory, m_decodedName, source, m_blocks, m_blockCache, m_file, m_threadPool);
+            ReturnClone(clone.As<IStream>(), stream);
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
         HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER *newPosition) noexcept override try
         {
-            LARGE_INTEGER newPos = { 0 };
             switch (origin)
             {
                 case Reference::CURRENT:
@@ -99,8 +105,6 @@ namespace MSIX {
             }
             m_relativePosition = std::max((std::uint64_t)0, std::min(m_relativePosition, m_streamSize));
             if (newPosition) { newPosition->QuadPart = m_relativePosition; }
-
-            m_currentBlock = m_blockStreams.begin();
             return S_OK;
         } CATCH_RETURN();
 
@@ -109,39 +113,78 @@ namespace MSIX {
             std::uint32_t bytesRead = 0;
             if (m_relativePosition < m_streamSize)
             {
-                std::uint32_t bytesToRead = std::min(static_cast<std::uint32_t>(countBytes), static_cast<std::uint32_t>(m_streamSize - m_relativePosition));
-                while (m_currentBlock != m_blockStreams.end() && bytesToRead > 0)
+                std::uint32_t bytesToRead = static_cast<std::uint32_t>(std::min(static_cast<std::uint64_t>(countBytes), m_streamSize - m_relativePosition));
+                while (bytesToRead > 0)
                 {
-                    if ((m_currentBlock->offset + m_currentBlock->size) <= m_relativePosition)
-                    {
-                        m_currentBlock++;
-                    }
-                    else if (m_currentBlock->offset <= m_relativePosition)
-                    {
-                        std::uint64_t positionInBlock = m_relativePosition - m_currentBlock->offset;
-                        LARGE_INTEGER li{0};
-                        li.QuadPart = positionInBlock;
-                        ThrowHrIfFailed(m_currentBlock->stream->Seek(li, STREAM_SEEK_SET, nullptr));
-
-                        std::uint32_t count = std::min(bytesToRead, static_cast<std::uint32_t>(m_currentBlock->size - positionInBlock));
-                        ULONG actual = 0;
-                        ThrowHrIfFailed(m_currentBlock->stream->Read(buffer, count, &actual));
+                    auto first = static_cast<std::size_t>(m_relativePosition / BLOCKMAP_BLOCK_SIZE);
+                    if (first >= m_blockCount) { break; }
 
+                    // Whole blocks are inflated in one go each, straight into the buffer. Whatever that can't
+                    // do is read a block at a time below.
+                    std::uint64_t blockCount = WholeBlocks(bytesToRead);
+                    if (blockCount != 0 && GetInflater() && (first + blockCount <= m_inflater->GetBlockCount()))
+                    {
+                        auto actual = static_cast<std::uint32_t>(m_inflater->Inflate(first, static_cast<std::size_t>(blockCount), static_cast<std::uint8_t*>(buffer)));
+                        if (actual < std::min(static_cast<std::uint64_t>(bytesToRead), blockCount * BLOCKMAP_BLOCK_SIZE))
+                        {   // Blocks that depend on the ones before them have to go through the stream.
+                            m_inflater.reset();
+                        }
                         buffer = static_cast<std::uint8_t*>(buffer) + actual;
                         m_relativePosition += actual;
                         bytesToRead -= actual;
                         bytesRead += actual;
+                        continue;
                     }
-                    else
+                    if (blockCount != 0 && (first + blockCount <= m_blockCount))
                     {
-                        m_currentBlock = m_blockStreams.begin();
+                        auto actual = static_cast<std::uint32_t>(ReadBlocks(first, static_cast<std::size_t>(blockCount), static_cast<std::uint8_t*>(buffer)));
+                        buffer = static_cast<std::uint8_t*>(buffer) + actual;
+                        m_relativePosition += actual;
+                        bytesToRead -= actual;
+                        bytesRead += actual;
+                        continue;
                     }
+
+                    auto actual = ReadInBlock(first, static_cast<std::uint8_t*>(buffer), bytesToRead);
+                    buffer = static_cast<std::uint8_t*>(buffer) + actual;
+                    m_relativePosition += actual;
+                    bytesToRead -= actual;
+                    bytesRead += actual;
                 }
             }
             if (actualRead) { *actualRead = bytesRead; }
             return (countBytes == bytesRead) ? S_OK : S_FALSE;
         } CATCH_RETURN();
 
+        HRESULT STDMETHODCALLTYPE CopyTo(IStream* stream, ULARGE_INTEGER bytesCount, ULARGE_INTEGER* bytesRead, ULARGE_INTEGER* bytesWritten) noexcept override try
+        {   // Big chunks so compressed files are read many blocks at a time.
+            if (bytesRead) { bytesRead->QuadPart = 0; }
+            if (bytesWritten) { bytesWritten->QuadPart = 0; }
+            ThrowErrorIf(Error::InvalidParameter, (nullptr == stream), "invalid parameter.");
+
+            const std::uint64_t size = 64 * BLOCKMAP_BLOCK_SIZE;
+            std::uint64_t count = bytesCount.QuadPart;
+            std::vector<std::uint8_t> bytes(static_cast<std::size_t>(std::min(size, std::min(count, m_streamSize - m_relativePosition))));
+            std::uint64_t read = 0;
+            std::uint64_t written = 0;
+            while (read < count)
+            {
+                ULONG chunk = static_cast<ULONG>(std::min(static_cast<std::uint64_t>(bytes.size()), count - read));
+                ULONG length = 0;
+                ThrowHrIfFailed(Read(bytes.data(), chunk, &length));
+                if (length == 0) { break; }
+                read += length;
+                ULONG copy = 0;
+                ThrowHrIfFailed(stream->Write(bytes.data(), length, &copy));
+                written += copy;
+                ThrowErrorIf(Error::FileWrite, (copy != length), "Entire chunk wasn't written!");
+            }
+
+            if (bytesRead) { bytesRead->QuadPart = read; }
+            if (bytesWritten) { bytesWritten->QuadPart = written; }
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
         // IStreamInternal
         std::uint64_t GetSizeOnZip() override
         {   // The underlying ZipFileStream/InflateStream object knows, so go ask it.
@@ -157,14 +200,132 @@ namespace MSIX {
         {   // The underlying ZipFileStream/InflateStream object knows, so go ask it.
             return m_stream.As<IStreamInternal>()->GetName();
         }
-      
+
     protected:
-        std::vector<BlockPlusStream>::iterator m_currentBlock;
-        std::vector<BlockPlusStream> m_blockStreams;
+        std::uint64_t GetBlockSize(std::size_t index) const
+        {
+            return std::min(BLOCKMAP_BLOCK_SIZE, m_streamSize - index * BLOCKMAP_BLOCK_SIZE);
+        }
+
+        void CheckHash(std::size_t index, const std::vector<std::uint8_t>& hash)
+        {
+            const auto& expected = (*m_blocks)[index].hash;
+            ThrowErrorIfNot(Error::SignatureInvalid, expected.size() == hash.size(), "Signature is corrupt");
+            ThrowErrorIfNot(Error::SignatureInvalid, memcmp(expected.data(), hash.data(), expected.size()) == 0,
+                "Signature hash doesn't match digest hash");
+        }
+
+        // Reads size bytes of the file starting at position from the file's stream into buffer.
+        void ReadRange(std::uint64_t position, std::uint8_t* buffer, std::uint64_t size)
+        {
+            ThrowErrorIf(Error::FileRead, (size > std::numeric_limits<ULONG>::max()), "range too big");
+            LARGE_INTEGER li{0};
+            li.QuadPart = position;
+            ThrowHrIfFailed(m_stream->Seek(li, STREAM_SEEK_SET, nullptr));
+            ULONG actual = 0;
+            ThrowHrIfFailed(m_stream->Read(buffer, static_cast<ULONG>(size), &actual));
+            ThrowErrorIf(Error::FileRead, (actual != size), "blocks cut short");
+        }
+
+        // Number of whole blocks from the current position in the next count bytes, counting the last block
+        // of the file if it ends there. None if the position isn't at the start of a block.
+        std::uint64_t WholeBlocks(std::uint64_t count)
+        {
+            if (m_relativePosition % BLOCKMAP_BLOCK_SIZE != 0) { return 0; }
+            if (count >= m_streamSize - m_relativePosition) { return (m_streamSize - m_relativePosition + BLOCKMAP_BLOCK_SIZE - 1) / BLOCKMAP_BLOCK_SIZE; }
+            return count / BLOCKMAP_BLOCK_SIZE;
+        }
+
+        // Reads count whole blocks starting with block first straight from the file's stream into output, and
+        // checks their hashes a group at a time while the group is still in the cache. Returns the bytes read.
+        std::uint64_t ReadBlocks(std::size_t first, std::size_t count, std::uint8_t* output)
+        {
+            std::vector<SHA256::Buffer> buffers(BLOCKMAP_HASH_GROUP);
+            std::vector<std::size_t> indexes(BLOCKMAP_HASH_GROUP);
+            std::vector<std::vector<std::uint8_t>> hashes(BLOCKMAP_HASH_GROUP);
+            std::uint64_t done = 0;
+            for (std::size_t group = 0; group < count; group += BLOCKMAP_HASH_GROUP)
+            {
+                auto blocks = std::min(BLOCKMAP_HASH_GROUP, count - group);
+                std::uint64_t size = 0;
+                for (std::size_t i = 0; i < blocks; i++)
+                {
+                    auto index = first + group + i;
+                    indexes[i] = index;
+                    buffers[i] = { output + done + size, static_cast<std::size_t>(GetBlockSize(index)) };
+                    size += GetBlockSize(index);
+                }
+
+                ReadRange((first + group) * BLOCKMAP_BLOCK_SIZE, output + done, size);
+                SHA256::ComputeHashes(buffers.data(), blocks, hashes.data());
+                for (std::size_t i = 0; i < blocks; i++)
+                {
+                    CheckHash(indexes[i], hashes[i]);
+                }
+                done += size;
+            }
+            return done;
+        }
+
+        // Reads up to count bytes from the current position to the end of its block, block index. The block is
+        // read whole and checked first, and the bytes come from there while the stream holds on to it, so a run of
+        // small reads reads it once. With a block cache it is kept for the other streams over the file too.
+        std::uint32_t ReadInBlock(std::size_t index, std::uint8_t* buffer, std::uint32_t count)
+        {
+            auto blockOffset = index * BLOCKMAP_BLOCK_SIZE;
+            auto blockSize = GetBlockSize(index);
+            auto positionInBlock = m_relativePosition - blockOffset;
+            auto actual = static_cast<std::uint32_t>(std::min(static_cast<std::uint64_t>(count), blockSize - positionInBlock));
+
+            if (m_cachedBlock != index)
+            {   // Only blocks that matched are cached.
+                BlockCache::Data data = m_blockCache ? m_blockCache->Find(m_file, index) : nullptr;
+                if (!data)
+                {
+                    auto block = std::make_shared<std::vector<std::uint8_t>>(static_cast<std::size_t>(blockSize));
+                    ReadRange(blockOffset, block->data(), blockSize);
+                    std::vector<std::uint8_t> hash;
+                    ThrowErrorIfNot(Error::SignatureInvalid, SHA256::ComputeHash(block->data(), static_cast<std::uint32_t>(blockSize), hash), "Invalid signature");
+                    CheckHash(index, hash);
+                    data = std::move(block);
+                    if (m_blockCache) { m_blockCache->Add(m_file, index, data); }
+                }
+                m_block = std::move(data);
+                m_cachedBlock = index;
+            }
+
+            memcpy(buffer, m_block->data() + positionInBlock, actual);
+            return actual;
+        }
+
+        // Made the first time it is needed. Null if the file isn't compressed or can't be inflated in parallel.
+        BlockInflater* GetInflater()
+        {
+            if (!m_inflaterChecked)
+            {
+                m_inflaterChecked = true;
+                auto compressed = m_stream.As<IStreamInternal>()->GetCompressedStream();
+                if (compressed)
+                {
+                    m_inflater = std::make_unique<BlockInflater>(compressed, *m_blocks, m_streamSize, m_threadPool);
+                }
+            }
+            return m_inflater.get();
+        }
+
         std::uint64_t m_relativePosition;
         std::uint64_t m_streamSize;
         std::string m_decodedName;
         ComPtr<IStream> m_stream;
         IMsixFactory* m_factory;
+        std::shared_ptr<const std::vector<Block>> m_blocks;
+        std::size_t m_blockCount;
+        std::shared_ptr<BlockCache> m_blockCache;
+        std::size_t m_file;
+        std::shared_ptr<ThreadPool> m_threadPool;
+        BlockCache::Data m_block; // the last block read in pieces
+        std::size_t m_cachedBlock = std::numeric_limits<std::size_t>::max();
+        std::unique_ptr<BlockInflater> m_inflater;
+        bool m_inflaterChecked = false;
     };
 }
\ No newline at end of file
@@ -158,6 +158,15 @@ namespace MSIX {
             ThrowHrIfFailed(m_ptr->QueryInterface(UuidOfImpl<U>::iid, reinterpret_cast<void**>(&out)));
             return out;
         }
+
+        // Like As, but returns an empty ComPtr if the object doesn't implement U.
+        template <class U>
+        ComPtr<U> TryAs() const
+        {
+            ComPtr<U> out;
+            m_ptr->QueryInterface(UuidOfImpl<U>::iid, reinterpret_cast<void**>(&out));
+            return out;
+        }
     protected:
         T* m_ptr = nullptr;
 
@@ -0,0 +1,54 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#pragma once
+
+#include "Exceptions.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace MSIX {
+
+    // CRC-32 as used by the zip format (reflected, polynomial 0xEDB88320). Update uses the fastest kernel
+    // the processor supports.
+    class Crc32
+    {
+    public:
+        void Update(const std::uint8_t* buffer, std::size_t size) noexcept;
+
+        std::uint32_t Value() const noexcept { return ~m_value; }
+
+    protected:
+        std::uint32_t m_value = 0xFFFFFFFF;
+    };
+
+    // Checks the crc-32 of a file as its bytes are produced. Reads can come in any order and more than
+    // once; only the bytes that extend what was already checked from the start of the file count, so
+    // reading the file front to back checks all of it.
+    class Crc32Check
+    {
+    public:
+        Crc32Check(std::uint32_t expected, std::uint64_t size) : m_expected(expected), m_size(size) {}
+
+        void Update(std::uint64_t position, const void* buffer, std::size_t count)
+        {
+            if ((position <= m_checked) && (count > m_checked - position))
+            {
+                auto skip = static_cast<std::size_t>(m_checked - position);
+                m_crc.Update(static_cast<const std::uint8_t*>(buffer) + skip, count - skip);
+                m_checked += count - skip;
+            }
+            ThrowErrorIf(Error::ZipLocalFileHeader, ((m_checked == m_size) && (m_crc.Value() != m_expected)), "crc-32 of the file doesn't match");
+        }
+
+        std::uint32_t GetExpected() const noexcept { return m_expected; }
+
+    protected:
+        Crc32 m_crc;
+        std::uint32_t m_expected;
+        std::uint64_t m_size;
+        std::uint64_t m_checked = 0;
+    };
+}
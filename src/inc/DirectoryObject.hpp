@@ -28,6 +28,13 @@ namespace MSIX {
         ComPtr<IStream> OpenFile(const std::string& fileName, MSIX::FileStream::Mode mode) override;
         std::string GetFileName() override { return m_root; }
 
+        // Moves a file within the directory, creating the directories the target needs and replacing the
+        // target if it already exists. Names are relative to the root and separated by "/".
+        void Rename(const std::string& from, const std::string& to);
+
+        // Removes a file, or a directory if it is empty.
+        void Remove(const std::string& name);
+
     protected:
         std::string m_root;
 
@@ -0,0 +1,66 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#pragma once
+
+#include "AppxPackaging.hpp"
+#include "ComHelper.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace MSIX {
+
+    // Files of a package by name, built once when the package is opened. Every file is known by its name
+    // in the container, which is OPC encoded, by its name as in the block map, which is what callers ask
+    // for, and by the name it is unpacked to. All the names are interned in a single string and looked up
+    // with open addressing hash tables, so lookups don't allocate or transcode.
+    class FileNameIndex
+    {
+    public:
+        // Adds a file. A file with the same container name is replaced.
+        void Add(const std::string& containerName, const std::string& name, const ComPtr<IAppxFile>& file);
+
+        // Exact match of the name in the container.
+        ComPtr<IAppxFile> FindByContainerName(const std::string& containerName) const;
+
+        // Name as in the block map. '\\' and '/' both separate directories. If there is no exact match,
+        // the name is matched ignoring ASCII case, as OPC part names are case insensitive.
+        ComPtr<IAppxFile> FindByName(const char* name) const;
+
+        // Name to unpack the file to, the container name decoded. Null if the container name can't be decoded.
+        const std::string* GetTargetName(const std::string& containerName) const;
+
+    protected:
+        enum class Key { ContainerName, Name, FoldedName };
+
+        struct Entry
+        {
+            std::size_t containerName;
+            std::size_t containerNameLength;
+            std::size_t name;
+            std::size_t nameLength;
+            bool hasTargetName;
+            std::string targetName;
+            ComPtr<IAppxFile> file;
+        };
+
+        static const std::uint32_t Empty = 0xFFFFFFFF;
+
+        std::uint32_t Find(Key key, const char* name, std::size_t length) const;
+        void Insert(Key key, std::uint32_t id);
+        void Rehash(std::size_t capacity);
+        std::vector<std::uint32_t>& GetTable(Key key);
+        const std::vector<std::uint32_t>& GetTable(Key key) const;
+        void GetName(Key key, const Entry& entry, const char** name, std::size_t* length) const;
+
+        std::string m_strings;
+        std::vector<Entry> m_entries;
+        // Entry ids, or Empty. All three have the same power of two size.
+        std::vector<std::uint32_t> m_byContainerName;
+        std::vector<std::uint32_t> m_byName;
+        std::vector<std::uint32_t> m_byFoldedName;
+    };
+}
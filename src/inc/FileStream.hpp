@@ -7,6 +7,15 @@
 #include <iostream>
 #include <string>
 #include <cstdio>
+#include <limits>
+#include <algorithm>
+
+#ifndef WIN32
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#endif
 
 #include "Exceptions.hpp"
 #include "StreamBase.hpp"
@@ -18,7 +27,7 @@ namespace MSIX {
     public:
         enum Mode { READ = 0, WRITE, APPEND, READ_UPDATE, WRITE_UPDATE, APPEND_UPDATE };
 
-        FileStream(const std::string& name, Mode mode) : m_name(name)
+        FileStream(const std::string& name, Mode mode) : m_name(name), m_mode(mode)
         {
             static const char* modes[] = { "rb", "wb", "ab", "r+b", "w+b", "a+b" };
             #ifdef WIN32
@@ -36,10 +45,11 @@ namespace MSIX {
             ULARGE_INTEGER end = { 0 };
             ThrowHrIfFailed(Seek(start, StreamBase::Reference::END, &end));
             ThrowHrIfFailed(Seek(start, StreamBase::Reference::START, nullptr));
-            m_size = end.u.LowPart;
+            m_size = end.QuadPart;
+            InitializePositional();
         }
 
-        FileStream(const std::wstring& name, Mode mode)
+        FileStream(const std::wstring& name, Mode mode) : m_mode(mode)
         {
             m_name = wstring_to_utf8(name);
             #ifdef WIN32
@@ -58,7 +68,20 @@ namespace MSIX {
             ULARGE_INTEGER end = { 0 };
             ThrowHrIfFailed(Seek(start, StreamBase::Reference::END, &end));
             ThrowHrIfFailed(Seek(start, StreamBase::Reference::START, nullptr));
-            m_size = end.u.LowPart;
+            m_size = end.QuadPart;
+            InitializePositional();
+        }
+
+        // Clone of a read only file. Shares the file, and keeps it open, through owner.
+        FileStream(const FileStream& owner) :
+            m_offset(owner.m_offset),
+            m_size(owner.m_size),
+            m_name(owner.m_name),
+            m_mode(owner.m_mode),
+            m_positional(owner.m_positional),
+            m_file(owner.m_file),
+            m_owner(static_cast<IStream*>(const_cast<FileStream*>(&owner)))
+        {
         }
 
         virtual ~FileStream() override
@@ -68,7 +91,12 @@ namespace MSIX {
 
         void Close()
         {
-            if (m_file)
+            if (m_owner)
+            {   // the file belongs to the stream we were cloned from
+                m_file = nullptr;
+                m_owner = nullptr;
+            }
+            else if (m_file)
             {   // the most we would ever do w.r.t. a failure from fclose is *maybe* log something...
                 std::fclose(m_file);
                 m_file = nullptr;
@@ -76,9 +104,41 @@ namespace MSIX {
         }
 
         // IStream
+        HRESULT STDMETHODCALLTYPE Clone(IStream** stream) noexcept override try
+        {
+            ComPtr<IStream> clone;
+            if (m_positional)
+            {   // Reads don't use the seek pointer of the file, so the clone can share it.
+                clone = ComPtr<IStream>::Make<FileStream>(*this);
+            }
+            else
+            {   // Otherwise a read only file is opened again to get a seek pointer of its own.
+                ThrowErrorIf(Error::NotSupported, (m_mode != Mode::READ), "only files opened for read can be cloned");
+                #ifdef WIN32
+                clone = ComPtr<IStream>::Make<FileStream>(utf8_to_wstring(m_name), m_mode);
+                #else
+                clone = ComPtr<IStream>::Make<FileStream>(m_name, m_mode);
+                #endif
+            }
+            ReturnClone(clone, stream);
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
         HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER* newPosition) noexcept override try
         {
-            int rc = std::fseek(m_file, static_cast<long>(move.QuadPart), origin);
+            if (m_positional)
+            {   // The seek pointer of the file isn't used, see Read.
+                LONGLONG base = (origin == Reference::START) ? 0 : ((origin == Reference::CURRENT) ? m_offset : m_size);
+                ThrowErrorIf(Error::FileSeek, (base + move.QuadPart < 0), "seek failed");
+                m_offset = static_cast<std::uint64_t>(base + move.QuadPart);
+                if (newPosition) { newPosition->QuadPart = m_offset; }
+                return static_cast<HRESULT>(Error::OK);
+            }
+            #ifdef WIN32
+            int rc = _fseeki64(m_file, move.QuadPart, origin);
+            #else
+            int rc = fseeko(m_file, static_cast<off_t>(move.QuadPart), origin);
+            #endif
             ThrowErrorIfNot(Error::FileSeek, (rc == 0), "seek failed");
             m_offset = Ftell();
             if (newPosition) { newPosition->QuadPart = m_offset; }
@@ -88,6 +148,14 @@ namespace MSIX {
         HRESULT STDMETHODCALLTYPE Read(void* buffer, ULONG countBytes, ULONG* bytesRead) noexcept override try
         {
             if (bytesRead) { *bytesRead = 0; }
+            if (m_positional)
+            {   // Read at our own offset so clones sharing the file don't get in each other's way.
+                ULONG result = 0;
+                ReadAt(m_offset, buffer, countBytes, &result);
+                m_offset += result;
+                if (bytesRead) { *bytesRead = result; }
+                return static_cast<HRESULT>(Error::OK);
+            }
             ULONG result = static_cast<ULONG>(std::fread(buffer, sizeof(std::uint8_t), countBytes, m_file));
             ThrowErrorIfNot(Error::FileRead, (result == countBytes || Feof()), "read failed");
             m_offset = Ftell();
@@ -108,20 +176,77 @@ namespace MSIX {
         // IStreamInternal
         std::string GetName() override { return m_name; }
 
+        bool ReadAt(std::uint64_t position, void* buffer, ULONG countBytes, ULONG* bytesRead) override
+        {
+            #ifdef WIN32
+            return false;
+            #else
+            if (!m_positional) { return false; }
+            ThrowErrorIf(Error::FileSeekOutOfRange, (position > static_cast<std::uint64_t>(std::numeric_limits<off_t>::max())), "position out of range");
+            ULONG total = 0;
+            while (total < countBytes)
+            {
+                auto result = pread(fileno(m_file), reinterpret_cast<std::uint8_t*>(buffer) + total, countBytes - total, static_cast<off_t>(position + total));
+                if (result == -1 && errno == EINTR) { continue; }
+                ThrowErrorIf(Error::FileRead, (result == -1), "read failed");
+                if (result == 0) { break; }
+                total += static_cast<ULONG>(result);
+            }
+            if (bytesRead) { *bytesRead = total; }
+            return true;
+            #endif
+        }
+
+        void WillNeed(std::uint64_t position, std::uint64_t size) override
+        {
+            #if defined(POSIX_FADV_WILLNEED)
+            if (m_positional && position <= static_cast<std::uint64_t>(std::numeric_limits<off_t>::max()))
+            {
+                size = std::min(size, static_cast<std::uint64_t>(std::numeric_limits<off_t>::max()));
+                posix_fadvise(fileno(m_file), static_cast<off_t>(position), static_cast<off_t>(size), POSIX_FADV_WILLNEED);
+            }
+            #elif defined(F_RDADVISE)
+            if (m_positional && position <= static_cast<std::uint64_t>(std::numeric_limits<off_t>::max()))
+            {
+                struct radvisory advice;
+                advice.ra_offset = static_cast<off_t>(position);
+                advice.ra_count = static_cast<int>(std::min(size, static_cast<std::uint64_t>(std::numeric_limits<int>::max())));
+                fcntl(fileno(m_file), F_RDADVISE, &advice);
+            }
+            #endif
+        }
+
     protected:
+        // Writes may still be sitting in the FILE* buffer, so only files opened for read are read
+        // with pread.
+        void InitializePositional()
+        {
+            #ifndef WIN32
+            m_positional = (m_mode == Mode::READ);
+            #endif
+        }
+
         inline int Ferror() { return std::ferror(m_file); }
         inline bool Feof()  { return 0 != std::feof(m_file); }
         inline void Flush() { std::fflush(m_file); }
 
         inline std::uint64_t Ftell()
         {
-            auto result = std::ftell(m_file);
+            #ifdef WIN32
+            auto result = _ftelli64(m_file);
+            #else
+            auto result = ftello(m_file);
+            #endif
+            ThrowErrorIf(Error::FileSeek, (result < 0), "ftell failed");
             return static_cast<std::uint64_t>(result);
         }
 
         std::uint64_t m_offset = 0;
         std::uint64_t m_size = 0;
         std::string m_name;
+        Mode m_mode;
+        bool m_positional = false;
         FILE* m_file;
+        ComPtr<IStream> m_owner;
     };
 }
@@ -24,9 +24,12 @@ namespace MSIX {
         bool m_validated;
         ComPtr<IStream> m_stream;
         std::vector<std::uint8_t>& m_expectedHash;
-        std::unique_ptr<std::vector<std::uint8_t>> m_cacheBuffer;
+        std::shared_ptr<std::vector<std::uint8_t>> m_cacheBuffer;
+        // The bytes that were hashed, in the view of the stream or in the cache buffer. Reads are served from
+        // here once validated, never from the stream again.
+        const std::uint8_t* m_data = nullptr;
         std::uint64_t m_relativePosition;
-        size_t m_streamSize;
+        std::uint64_t m_streamSize;
 
     public:
         HashStream(const ComPtr<IStream>& stream, std::vector<std::uint8_t>& expectedHash) :
@@ -42,55 +45,108 @@ namespace MSIX {
             
             ThrowHrIfFailed(m_stream->Seek(li, StreamBase::Reference::END, &uli));
             ThrowHrIfFailed(m_stream->Seek(li, StreamBase::Reference::START, nullptr));
-            m_streamSize = static_cast<size_t>(uli.u.LowPart);
+            m_streamSize = uli.QuadPart;
         }
 
         void Validate()
         {
             if (m_validated) { return; }
 
-            // read stream into cache buffer
-            m_cacheBuffer = std::make_unique<std::vector<std::uint8_t>>(m_streamSize);
-            ULONG bytesRead = 0;
-            ThrowHrIfFailed(m_stream->Read(m_cacheBuffer->data(), static_cast<ULONG>(m_cacheBuffer->size()), &bytesRead));
-            ThrowErrorIfNot(MSIX::Error::SignatureInvalid, bytesRead == m_streamSize, "read failed");
+            // Hashed ranges are blocks or footprint files, anything bigger than a single read is bogus.
+            ThrowErrorIf(Error::SignatureInvalid, (m_streamSize > std::numeric_limits<ULONG>::max()), "stream too big to hash");
 
-            // compute digest and compare against expected digest
+            // hash the stream in place if it is memory backed, otherwise read it into the cache buffer
+            auto view = m_stream.TryAs<IStreamView>();
+            const std::uint8_t* data = view ? view->GetView(0, m_streamSize) : nullptr;
+            if (data == nullptr)
+            {
+                m_cacheBuffer = std::make_shared<std::vector<std::uint8_t>>(static_cast<std::size_t>(m_streamSize));
+                ReadAndValidate(m_cacheBuffer->data());
+                m_data = m_cacheBuffer->data();
+                m_validated = true;
+                return;
+            }
+
+            MSIX::SHA256 hasher;
+            hasher.Update(data, static_cast<std::size_t>(m_streamSize));
+            CheckHash(hasher);
+            m_data = data;
+            m_validated = true;
+        }
+
+        // Reads the whole stream into buffer, hashing each piece as soon as it is read, and validates it. Only
+        // buffer holds the bytes that were checked.
+        void ReadAndValidate(std::uint8_t* buffer)
+        {
+            // the whole stream is hashed, wherever our seek pointer is
+            LARGE_INTEGER start = { 0 };
+            ThrowHrIfFailed(m_stream->Seek(start, StreamBase::Reference::START, nullptr));
+
+            const std::uint64_t pieceSize = 64 * 1024;
+            MSIX::SHA256 hasher;
+            std::uint64_t position = 0;
+            while (position < m_streamSize)
+            {
+                ULONG count = static_cast<ULONG>(std::min(pieceSize, m_streamSize - position));
+                ULONG bytesRead = 0;
+                ThrowHrIfFailed(m_stream->Read(buffer + position, count, &bytesRead));
+                ThrowErrorIfNot(MSIX::Error::SignatureInvalid, bytesRead == count, "read failed");
+                hasher.Update(buffer + position, bytesRead);
+                position += bytesRead;
+            }
+            CheckHash(hasher);
+        }
+
+        // compute digest and compare against expected digest
+        void CheckHash(MSIX::SHA256& hasher)
+        {
             std::vector<std::uint8_t> hash;
-            ThrowErrorIfNot(MSIX::Error::SignatureInvalid, 
-                MSIX::SHA256::ComputeHash(m_cacheBuffer->data(), static_cast<uint32_t>(m_cacheBuffer->size()), hash), 
-                "Invalid signature");
+            hasher.Final(hash);
             ThrowErrorIfNot(MSIX::Error::SignatureInvalid, m_expectedHash.size() == hash.size(), "Signature is corrupt");
             ThrowErrorIfNot(
                 MSIX::Error::SignatureInvalid,
                 memcmp(m_expectedHash.data(), hash.data(), hash.size()) == 0,
                 "Signature hash doesn't match digest hash"); //TODO: better exception
-
-            m_validated = true;
         }
 
+        HRESULT STDMETHODCALLTYPE Clone(IStream** stream) noexcept override try
+        {   // The clone shares the validated bytes if they are cached. Bytes validated in the view of this stream
+            // are checked again in the view of the clone's.
+            ComPtr<IStream> source;
+            ThrowHrIfFailed(m_stream->Clone(&source));
+            auto clone = ComPtr<HashStream>::Make<HashStream>(source, m_expectedHash);
+            if (m_cacheBuffer)
+            {
+                clone->m_validated = m_validated;
+                clone->m_cacheBuffer = m_cacheBuffer;
+                clone->m_data = m_cacheBuffer->data();
+            }
+            ReturnClone(clone.As<IStream>(), stream);
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
         void CacheSeek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER *newPosition)
         {
             LARGE_INTEGER newPos = { 0 };
             switch (origin)
             {
                 case Reference::CURRENT:
-                    m_relativePosition += move.u.LowPart;
+                    m_relativePosition += move.QuadPart;
                     break;
                 case Reference::START:
-                    m_relativePosition = move.u.LowPart;
+                    m_relativePosition = move.QuadPart;
                     break;
                 case Reference::END:
                     m_relativePosition = m_streamSize;
                     break;
             }
-            m_relativePosition = std::max((std::uint64_t)0, std::min(m_relativePosition, static_cast<std::uint64_t>(m_streamSize)));
+            m_relativePosition = std::min(m_relativePosition, m_streamSize);
             if (newPosition) { newPosition->QuadPart = (std::uint64_t)m_relativePosition; }
         }        
 
         HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER *newPosition) noexcept override try
         {
-            if (m_cacheBuffer.get() == nullptr)
+            if (m_data == nullptr)
             {   ThrowHrIfFailed(m_stream->Seek(move, origin, newPosition));
             }
             // always call into cache seek to keep cache state aligned with the underlying stream state.
@@ -101,26 +157,33 @@ namespace MSIX {
         void CacheRead(void* buffer, ULONG countBytes, ULONG* actualRead)
         {
             ThrowErrorIf(Error::Stg_E_Invalidpointer, (buffer == nullptr), "bad input");
-            ULONG bytesToRead = std::min((std::uint32_t)countBytes, static_cast<std::uint32_t>((std::uint64_t)m_cacheBuffer->size() - m_relativePosition));
+            ULONG bytesToRead = static_cast<ULONG>(std::min(static_cast<std::uint64_t>(countBytes), m_streamSize - m_relativePosition));
             if (bytesToRead)
             {
-                memcpy(buffer, reinterpret_cast<BYTE*>(m_cacheBuffer->data()) + m_relativePosition, bytesToRead);
+                memcpy(buffer, m_data + m_relativePosition, bytesToRead);
             }
 
             m_relativePosition += bytesToRead;
-            if (m_streamSize == m_relativePosition) { m_cacheBuffer = nullptr; }
             if (actualRead) { *actualRead = bytesToRead; }
         }
 
         HRESULT STDMETHODCALLTYPE Read(void* buffer, ULONG countBytes, ULONG* actualRead) noexcept override try
         {
-            Validate();
-            if (m_cacheBuffer.get() == nullptr)
-            {   ThrowHrIfFailed(m_stream->Read(buffer, countBytes, actualRead));
+            if (!m_validated && (m_relativePosition == 0) && (countBytes >= m_streamSize) && (buffer != nullptr))
+            {   // All of it is wanted, so it is read and hashed straight into the caller's buffer instead of the cache.
+                // Nothing is kept, a later read validates the stream again.
+                ReadAndValidate(static_cast<std::uint8_t*>(buffer));
+                m_relativePosition = m_streamSize;
+                if (actualRead) { *actualRead = static_cast<ULONG>(m_streamSize); }
+                return static_cast<HRESULT>(Error::OK);
             }
-            else
-            {   CacheRead(buffer, countBytes, actualRead);
+            if (m_relativePosition >= m_streamSize)
+            {   // The end of it needs nothing validated.
+                if (actualRead) { *actualRead = 0; }
+                return static_cast<HRESULT>(Error::OK);
             }
+            Validate();
+            CacheRead(buffer, countBytes, actualRead);
             return static_cast<HRESULT>(Error::OK);
         } CATCH_RETURN();
     };
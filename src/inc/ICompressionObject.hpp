@@ -15,6 +15,14 @@ namespace MSIX {
         Deflate
     };
 
+    // What Deflate does once it has compressed all of its input.
+    enum class CompressionFlush
+    {
+        None,   // nothing, the compressor can keep some of it back
+        Full,   // writes out everything, ending at a byte boundary, and starts over without history
+        Finish  // writes out everything and ends the stream
+    };
+
     enum class CompressionStatus
     {
         Ok,
@@ -27,12 +35,21 @@ namespace MSIX {
     {
         public:
             virtual CompressionStatus Initialize(CompressionOperation operation) = 0;
+            // Starts over on a new stream, keeping what was allocated by Initialize.
+            virtual CompressionStatus Reset() = 0;
             virtual CompressionStatus Inflate() = 0;
+            // Compresses into raw deflate data. Needs Initialize with CompressionOperation::Deflate. When it
+            // returns with no destination space left it has to be called again with the same flush.
+            virtual CompressionStatus Deflate(CompressionFlush flush) = 0;
             virtual CompressionStatus Cleanup() = 0;
             virtual std::size_t GetAvailableSourceSize() = 0;
             virtual std::size_t GetAvailableDestinationSize() = 0;
             virtual void SetInput(std::uint8_t* buffer, std::size_t size) = 0;
             virtual void SetOutput(std::uint8_t* buffer, std::size_t size) = 0;
+            // Inflates all of source, which is raw deflate data, into destination in one go. Returns Ok once
+            // destination is full and Error if source is bad or runs out first. Needs no Initialize and
+            // leaves the streaming state alone.
+            virtual CompressionStatus DecompressBlock(const std::uint8_t* source, std::size_t sourceSize, std::uint8_t* destination, std::size_t destinationSize) = 0;
             virtual ~ICompressionObject() = default;
     };
 
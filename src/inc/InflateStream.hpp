@@ -7,6 +7,7 @@
 #include "StreamBase.hpp"
 #include "ComHelper.hpp"
 #include "ICompressionObject.hpp"
+#include "Crc32.hpp"
 
 #undef max
 #undef min
@@ -21,9 +22,10 @@ namespace MSIX {
     class InflateStream final : public StreamBase
     {
     public:
-        InflateStream(const ComPtr<IStream>& stream, std::uint64_t uncompressedSize);
+        InflateStream(const ComPtr<IStream>& stream, std::uint64_t uncompressedSize, std::unique_ptr<Crc32Check> crcCheck = nullptr);
         ~InflateStream();
 
+        HRESULT STDMETHODCALLTYPE Clone(IStream** stream) noexcept override;
         HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER *newPosition) noexcept override;
         HRESULT STDMETHODCALLTYPE Read(void* buffer, ULONG countBytes, ULONG* bytesRead) noexcept override;
         HRESULT STDMETHODCALLTYPE Write(void const *buffer, ULONG countBytes, ULONG *bytesWritten) noexcept override
@@ -46,7 +48,13 @@ namespace MSIX {
         {   // The underlying ZipFileStream object knows, so go ask it.
             return m_stream.As<IStreamInternal>()->GetName();
         }
+
+        void SetSyncPoints(std::vector<SyncPoint> points) override { m_syncPoints = std::move(points); }
+        ComPtr<IStream> GetCompressedStream() override;
+
         void Cleanup();
+        // Closest sync point at or before position.
+        SyncPoint GetSyncPoint(std::uint64_t position) const;
 
         enum class State : size_t
         {
@@ -67,13 +75,19 @@ namespace MSIX {
         ULONG           m_bytesRead = 0;
         std::uint8_t*   m_startCurrentBuffer = nullptr;
         ULONG           m_inflateWindowPosition = 0;
+        ULONG           m_inflateWindowSize = 0;
         ULONGLONG       m_fileCurrentWindowPositionEnd = 0;
         ULONGLONG       m_fileCurrentPosition = 0;
+        ULONGLONG       m_inflateStartPosition = 0;
 
         std::unique_ptr<ICompressionObject> m_compressionObject;
         CompressionStatus m_compressionStatus = CompressionStatus::Ok;
+        bool              m_compressionInitialized = false;
 
-        std::unique_ptr<std::vector<std::uint8_t>> m_compressedBuffer;
-        std::unique_ptr<std::vector<std::uint8_t>> m_inflateWindow;
+        // Allocated on the first read and kept for the life of the stream.
+        std::vector<std::uint8_t> m_compressedBuffer;
+        std::vector<std::uint8_t> m_inflateWindow;
+        std::unique_ptr<Crc32Check> m_crcCheck;
+        std::vector<SyncPoint> m_syncPoints;
     };
 }
@@ -0,0 +1,111 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+// 
+#pragma once
+
+#include <string>
+
+#include "Exceptions.hpp"
+#include "StreamBase.hpp"
+#include "ComHelper.hpp"
+
+namespace MSIX {
+
+    // Read only stream over a file mapped into memory. Reads are copies out of the mapping and
+    // GetView hands out pointers into it, so streams layered on top of this one don't need to
+    // seek and read. Only available where the PAL provides a mapping implementation.
+    class MappedFileStream final : public StreamBase
+    {
+    public:
+        // Maps the file. Returns an empty ComPtr if the file can't be mapped (doesn't exist, is
+        // empty, isn't a regular file, another user can write to it, etc) so the caller can fall
+        // back to FileStream. Truncating a mapped file while it is read ends the process with
+        // SIGBUS, instead of failing the read, which is why files others can change aren't mapped
+        // and only CreateMappedStreamOnFile, for callers that know the file stays as it is, maps.
+        static ComPtr<IStream> Create(const std::string& name);
+
+        MappedFileStream(std::string name, const std::uint8_t* data, std::uint64_t size, std::string identity = std::string()) :
+            m_name(std::move(name)), m_data(data), m_size(size), m_identity(std::move(identity))
+        {
+        }
+
+        // Clone. Shares the mapping, and keeps it alive, through owner.
+        MappedFileStream(const MappedFileStream& owner) :
+            m_name(owner.m_name),
+            m_data(owner.m_data),
+            m_size(owner.m_size),
+            m_identity(owner.m_identity),
+            m_owner(static_cast<IStream*>(const_cast<MappedFileStream*>(&owner)))
+        {
+        }
+
+        virtual ~MappedFileStream() override;
+
+        // IStream
+        HRESULT STDMETHODCALLTYPE Clone(IStream** stream) noexcept override try
+        {
+            ReturnClone(ComPtr<IStream>::Make<MappedFileStream>(*this), stream);
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
+        HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER* newPosition) noexcept override try
+        {
+            LARGE_INTEGER newPos = { 0 };
+            switch (origin)
+            {
+            case Reference::CURRENT:
+                newPos.QuadPart = m_offset + move.QuadPart;
+                break;
+            case Reference::START:
+                newPos.QuadPart = move.QuadPart;
+                break;
+            case Reference::END:
+                newPos.QuadPart = m_size + move.QuadPart;
+                break;
+            }
+            ThrowErrorIf(Error::FileSeek, (newPos.QuadPart < 0), "seek before the start of the file");
+            m_offset = static_cast<std::uint64_t>(newPos.QuadPart);
+            if (newPosition) { newPosition->QuadPart = m_offset; }
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
+        HRESULT STDMETHODCALLTYPE Read(void* buffer, ULONG countBytes, ULONG* bytesRead) noexcept override try
+        {
+            ULONG amountToRead = (m_offset < m_size) ? static_cast<ULONG>(std::min(static_cast<std::uint64_t>(countBytes), m_size - m_offset)) : 0;
+            if (amountToRead > 0) { memcpy(buffer, m_data + m_offset, amountToRead); }
+            m_offset += amountToRead;
+            if (bytesRead) { *bytesRead = amountToRead; }
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
+        // IStreamInternal
+        std::string GetName() override { return m_name; }
+
+        bool ReadAt(std::uint64_t position, void* buffer, ULONG countBytes, ULONG* bytesRead) override
+        {
+            ULONG amountToRead = (position < m_size) ? static_cast<ULONG>(std::min(static_cast<std::uint64_t>(countBytes), m_size - position)) : 0;
+            if (amountToRead > 0) { memcpy(buffer, m_data + position, amountToRead); }
+            if (bytesRead) { *bytesRead = amountToRead; }
+            return true;
+        }
+
+        void WillNeed(std::uint64_t position, std::uint64_t size) override;
+        std::string GetFileIdentity() override { return m_identity; }
+
+        // IStreamView
+        const std::uint8_t* GetView(std::uint64_t offset, std::uint64_t size) override
+        {
+            if (offset > m_size || size > m_size - offset) { return nullptr; }
+            return m_data + offset;
+        }
+
+    protected:
+        std::string m_name;
+        const std::uint8_t* m_data;
+        std::uint64_t m_size;
+        std::uint64_t m_offset = 0;
+        std::string m_identity; // from the file's status when it was mapped
+        ComPtr<IStream> m_owner;
+    };
+}
@@ -0,0 +1,89 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#pragma once
+
+#include "AppxPackaging.hpp"
+#include "MSIXWindows.hpp"
+#include "MSIXFactory.hpp"
+#include "Exceptions.hpp"
+#include "ComHelper.hpp"
+#include "BlockMapStream.hpp"
+#include "ThreadPool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace MSIX {
+
+    // Checks every block of whole payload files against the block map without handing their contents to anyone.
+    // The blocks of all the files are split in groups that the package's threads take in turn. Each group is read
+    // by its offset in the file's data in the container, so threads don't share a seek pointer, inflated block by
+    // block if the file is compressed and hashed together. A file whose data can't be read that way, or whose
+    // blocks can't be inflated on their own or don't match once they are, is read through its block map stream
+    // afterwards instead, which has the last word on them.
+    class PackageVerifier
+    {
+    public:
+        struct File
+        {
+            std::string name;
+            ComPtr<IStream> stream;     // the file in the container, as the container has it
+            ComPtr<IStream> checked;    // the file's block map stream, which checks the blocks as they are read
+            std::vector<Block> blocks;
+            std::uint64_t size;
+            HRESULT result = static_cast<HRESULT>(Error::OK); // failed if the file couldn't be opened, it isn't read
+        };
+
+        // threads is how many threads of pool check blocks, this one included, 0 for one per core.
+        explicit PackageVerifier(std::shared_ptr<ThreadPool> pool, std::size_t threads = 0);
+
+        // Returns a result for every file, in the same order. Errors that aren't about one file are thrown.
+        std::vector<HRESULT> Verify(const std::vector<File>& files);
+
+    protected:
+        std::shared_ptr<ThreadPool> m_threadPool;
+        std::size_t m_threads;
+    };
+
+    class VerificationResults final : public ComClass<VerificationResults, IMsixVerificationResults>
+    {
+    public:
+        VerificationResults(IMsixFactory* factory, std::vector<std::string> names, std::vector<HRESULT> results) :
+            m_factory(factory), m_names(std::move(names)), m_results(std::move(results))
+        {
+        }
+
+        // IMsixVerificationResults
+        HRESULT STDMETHODCALLTYPE GetCount(UINT32* count) noexcept override try
+        {
+            ThrowErrorIf(Error::InvalidParameter, (count == nullptr), "bad pointer");
+            *count = static_cast<UINT32>(m_results.size());
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
+        HRESULT STDMETHODCALLTYPE GetFileName(UINT32 index, LPSTR* fileName) noexcept override try
+        {
+            ThrowErrorIf(Error::InvalidParameter, (fileName == nullptr), "bad pointer");
+            ThrowErrorIf(Error::InvalidParameter, (index >= m_names.size()), "index out of range");
+            return m_factory->MarshalOutStringUtf8(m_names[index], fileName);
+        } CATCH_RETURN();
+
+        HRESULT STDMETHODCALLTYPE GetResult(UINT32 index, HRESULT* result) noexcept override try
+        {
+            ThrowErrorIf(Error::InvalidParameter, (result == nullptr), "bad pointer");
+            ThrowErrorIf(Error::InvalidParameter, (index >= m_results.size()), "index out of range");
+            *result = m_results[index];
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
+    protected:
+        ComPtr<IMsixFactory> m_factory;
+        std::vector<std::string> m_names;
+        std::vector<HRESULT> m_results;
+    };
+}
@@ -10,6 +10,7 @@
 #include <string>
 #include <map>
 #include <functional>
+#include <cstring>
 
 
 namespace MSIX {
@@ -21,10 +22,19 @@ namespace MSIX {
         RangeStream(std::uint64_t offset, std::uint64_t size, const ComPtr<IStream>& stream) :
             m_offset(offset),
             m_size(size),
-            m_stream(stream)
+            m_stream(stream),
+            m_view(stream.TryAs<IStreamView>()),
+            m_internal(stream.TryAs<IStreamInternal>())
         {
         }
 
+        // The clone reads the same stream, it doesn't use the seek pointer of this one.
+        HRESULT STDMETHODCALLTYPE Clone(IStream** stream) noexcept override try
+        {
+            ReturnClone(ComPtr<IStream>::Make<RangeStream>(m_offset, m_size, m_stream), stream);
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
         HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER *newPosition) noexcept override try
         {
             LARGE_INTEGER newPos = { 0 };
@@ -40,22 +50,24 @@ namespace MSIX {
                 newPos.QuadPart = m_offset + m_size + move.QuadPart;
                 break;
             }
-            //TODO: We need to constrain newPos so that it can't exceed the end of the stream
-            ULARGE_INTEGER pos = { 0 };
-            m_stream->Seek(newPos, Reference::START, &pos);
-            m_relativePosition = std::min(static_cast<std::uint64_t>(pos.QuadPart - m_offset), m_size);
+            // Only our own position moves, the underlying stream is positioned when it is read.
+            newPos.QuadPart = std::max(newPos.QuadPart, static_cast<LONGLONG>(m_offset));
+            m_relativePosition = std::min(static_cast<std::uint64_t>(newPos.QuadPart - m_offset), m_size);
             if (newPosition) { newPosition->QuadPart = m_relativePosition; }
             return static_cast<HRESULT>(Error::OK);
         } CATCH_RETURN();
 
         HRESULT STDMETHODCALLTYPE Read(void* buffer, ULONG countBytes, ULONG* bytesRead) noexcept override try
         {
-            LARGE_INTEGER offset = {0};
-            offset.QuadPart = m_relativePosition + m_offset;
-            ThrowHrIfFailed(m_stream->Seek(offset, StreamBase::START, nullptr));
-            ULONG amountToRead = std::min(countBytes, static_cast<ULONG>(m_size - m_relativePosition));
+            ULONG amountToRead = static_cast<ULONG>(std::min(static_cast<std::uint64_t>(countBytes), m_size - m_relativePosition));
             ULONG amountRead = 0;
-            ThrowHrIfFailed(m_stream->Read(buffer, amountToRead, &amountRead));
+            if (!ReadAt(m_relativePosition, buffer, amountToRead, &amountRead))
+            {   // The underlying stream can only be read at its seek pointer.
+                LARGE_INTEGER offset = {0};
+                offset.QuadPart = m_relativePosition + m_offset;
+                ThrowHrIfFailed(m_stream->Seek(offset, StreamBase::START, nullptr));
+                ThrowHrIfFailed(m_stream->Read(buffer, amountToRead, &amountRead));
+            }
             ThrowErrorIf(Error::FileRead, (amountToRead != amountRead), "Did not read as much as requesteed.");
             m_relativePosition += amountRead;
             if (bytesRead) { *bytesRead = amountRead; }
@@ -63,6 +75,32 @@ namespace MSIX {
             return static_cast<HRESULT>(Error::OK);
         } CATCH_RETURN();
 
+        // IStreamInternal
+        bool ReadAt(std::uint64_t position, void* buffer, ULONG countBytes, ULONG* bytesRead) override
+        {
+            ULONG amountToRead = (position < m_size) ? static_cast<ULONG>(std::min(static_cast<std::uint64_t>(countBytes), m_size - position)) : 0;
+            const std::uint8_t* data = m_view ? m_view->GetView(m_offset + position, amountToRead) : nullptr;
+            if (data != nullptr)
+            {
+                if (amountToRead > 0) { memcpy(buffer, data, amountToRead); }
+                if (bytesRead) { *bytesRead = amountToRead; }
+                return true;
+            }
+            return m_internal && m_internal->ReadAt(m_offset + position, buffer, amountToRead, bytesRead);
+        }
+
+        void WillNeed(std::uint64_t position, std::uint64_t size) override
+        {
+            if (m_internal && position < m_size) { m_internal->WillNeed(m_offset + position, std::min(size, m_size - position)); }
+        }
+
+        // IStreamView
+        const std::uint8_t* GetView(std::uint64_t offset, std::uint64_t size) override
+        {
+            if (!m_view || offset > m_size || size > m_size - offset) { return nullptr; }
+            return m_view->GetView(m_offset + offset, size);
+        }
+
         std::uint64_t Size() { return m_size; }
 
     protected:
@@ -70,5 +108,7 @@ namespace MSIX {
         std::uint64_t m_size;
         std::uint64_t m_relativePosition = 0;
         ComPtr<IStream> m_stream;
+        ComPtr<IStreamView> m_view;
+        ComPtr<IStreamInternal> m_internal;
     };
 }
\ No newline at end of file
@@ -0,0 +1,42 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#pragma once
+
+#include "AppxPackaging.hpp"
+#include "Exceptions.hpp"
+#include "StreamBase.hpp"
+#include "ComHelper.hpp"
+
+#include <memory>
+
+namespace MSIX {
+
+    // Reads a package out of an IMsixRangedSource. The source is read in aligned chunks that stay in a small
+    // cache, so the many small reads of a zip (end of central directory, local file headers, blocks) that
+    // are next to each other are served by one request. WillNeed hints, which ZipObject gives as it reads
+    // front to back, start chunks ahead of time with several requests in flight, so their latency overlaps
+    // with the reads in front of them.
+    class RangedSourceStream final : public StreamBase
+    {
+    public:
+        RangedSourceStream(const ComPtr<IMsixRangedSource>& source);
+
+        // IStream
+        HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER* newPosition) noexcept override;
+        HRESULT STDMETHODCALLTYPE Read(void* buffer, ULONG countBytes, ULONG* bytesRead) noexcept override;
+
+        // IStreamInternal
+        std::string GetName() override { return std::string(); }
+        bool ReadAt(std::uint64_t position, void* buffer, ULONG countBytes, ULONG* bytesRead) override;
+        void WillNeed(std::uint64_t position, std::uint64_t size) override;
+
+        // Shared with the requests in flight, which can complete after the stream is gone.
+        struct State;
+
+    protected:
+        std::shared_ptr<State> m_state;
+        std::uint64_t m_position = 0;
+    };
+}
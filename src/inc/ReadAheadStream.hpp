@@ -0,0 +1,101 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#pragma once
+#include "Exceptions.hpp"
+#include "StreamBase.hpp"
+#include "ComHelper.hpp"
+
+#include <algorithm>
+#include <mutex>
+
+namespace MSIX {
+
+    // Passes everything through to the stream under it and, as reads move forward, asks it to start
+    // fetching the next distance bytes. Reads are expected to go through the archive front to back,
+    // so by the time they get somewhere its pages should already be on their way. Nothing is hinted
+    // past end, which for a zip is where the file data stops and the central directory starts.
+    class ReadAheadStream final : public StreamBase
+    {
+    public:
+        ReadAheadStream(const ComPtr<IStream>& stream, std::uint64_t end, std::uint64_t distance) :
+            m_stream(stream),
+            m_view(stream.TryAs<IStreamView>()),
+            m_internal(stream.TryAs<IStreamInternal>()),
+            m_end(end),
+            m_distance(distance)
+        {
+        }
+
+        // IStream
+        HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER* newPosition) noexcept override try
+        {
+            ULARGE_INTEGER position = { 0 };
+            ThrowHrIfFailed(m_stream->Seek(move, origin, &position));
+            m_position = position.QuadPart;
+            if (newPosition) { newPosition->QuadPart = position.QuadPart; }
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
+        HRESULT STDMETHODCALLTYPE Read(void* buffer, ULONG countBytes, ULONG* bytesRead) noexcept override try
+        {
+            Touch(m_position, countBytes);
+            ULONG amountRead = 0;
+            ThrowHrIfFailed(m_stream->Read(buffer, countBytes, &amountRead));
+            m_position += amountRead;
+            if (bytesRead) { *bytesRead = amountRead; }
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
+        // IStreamInternal
+        std::string GetName() override { return m_internal ? m_internal->GetName() : std::string(); }
+
+        bool ReadAt(std::uint64_t position, void* buffer, ULONG countBytes, ULONG* bytesRead) override
+        {
+            if (!m_internal) { return false; }
+            Touch(position, countBytes);
+            return m_internal->ReadAt(position, buffer, countBytes, bytesRead);
+        }
+
+        void WillNeed(std::uint64_t position, std::uint64_t size) override
+        {
+            if (m_internal) { m_internal->WillNeed(position, size); }
+        }
+
+        // IStreamView
+        const std::uint8_t* GetView(std::uint64_t offset, std::uint64_t size) override
+        {
+            if (!m_view) { return nullptr; }
+            Touch(offset, size);
+            return m_view->GetView(offset, size);
+        }
+
+    protected:
+        // Streams of different files read through here, possibly from more than one thread.
+        void Touch(std::uint64_t position, std::uint64_t size)
+        {
+            if (!m_internal || m_distance == 0 || position >= m_end) { return; }
+            auto end = std::min(position + size, m_end);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            // Nothing to do while reads stay in what was hinted and aren't getting close to its end.
+            bool inside = (position >= m_hintStart) && (position <= m_hintEnd);
+            if (inside && ((m_hintEnd == m_end) || (end + m_distance / 2 <= m_hintEnd))) { return; }
+            // Moving forward only hints what is new. Jumping somewhere else starts over from there.
+            auto from = inside ? m_hintEnd : position;
+            if (!inside) { m_hintStart = position; }
+            m_hintEnd = std::max(from, std::min(end + m_distance, m_end));
+            if (m_hintEnd > from) { m_internal->WillNeed(from, m_hintEnd - from); }
+        }
+
+        ComPtr<IStream> m_stream;
+        ComPtr<IStreamView> m_view;
+        ComPtr<IStreamInternal> m_internal;
+        std::uint64_t m_end;
+        std::uint64_t m_distance;
+        std::uint64_t m_position = 0;
+        std::mutex m_mutex;
+        std::uint64_t m_hintStart = 0;
+        std::uint64_t m_hintEnd = 0;
+    };
+}
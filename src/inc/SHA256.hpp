@@ -4,6 +4,9 @@
 // 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 namespace MSIX {
@@ -11,6 +14,31 @@ namespace MSIX {
     class SHA256
     {
     public:
+        // A hash that is fed its data a piece at a time, so the data doesn't have to be in one buffer.
+        SHA256();
+        ~SHA256();
+
+        // Adds the next cbBuffer bytes of data to the hash.
+        void Update(const std::uint8_t* buffer, std::size_t cbBuffer);
+
+        // Gets the hash of everything added since construction or the last Final, and starts a new one.
+        void Final(std::vector<std::uint8_t>& hash);
+
         static bool ComputeHash(std::uint8_t *buffer, std::uint32_t cbBuffer, std::vector<uint8_t>& hash);
+
+        // One of the buffers ComputeHashes hashes.
+        struct Buffer
+        {
+            const std::uint8_t* data;
+            std::size_t size;
+        };
+
+        // Hashes count independent buffers into hashes[0] to hashes[count - 1]. Processors that can hash
+        // several buffers at once hash them together, so a batch is faster than a loop over ComputeHash.
+        static void ComputeHashes(const Buffer* buffers, std::size_t count, std::vector<std::uint8_t>* hashes);
+
+    protected:
+        struct State;
+        std::unique_ptr<State> m_state;
     };
-}
\ No newline at end of file
+}
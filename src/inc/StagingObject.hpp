@@ -0,0 +1,138 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+// 
+#pragma once
+
+#include "Exceptions.hpp"
+#include "ComHelper.hpp"
+#include "StreamBase.hpp"
+#include "StorageObject.hpp"
+#include "DirectoryObject.hpp"
+#include "AppxFactory.hpp"
+
+#include <string>
+#include <vector>
+#include <map>
+
+namespace MSIX {
+
+    // Payload file written to the staging directory. It reports the size and compression the file had in the
+    // package, which is what AppxPackageObject checks against the block map, and reads from the staged file
+    // only when asked to.
+    class StagedFileStream final : public StreamBase
+    {
+    public:
+        StagedFileStream(const ComPtr<DirectoryObject>& directory, std::string stagedName, std::string name,
+            std::uint64_t size, std::uint64_t sizeOnZip, bool isCompressed) :
+            m_directory(directory), m_stagedName(std::move(stagedName)), m_name(std::move(name)),
+            m_size(size), m_sizeOnZip(sizeOnZip), m_isCompressed(isCompressed)
+        {}
+
+        HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER* newPosition) noexcept override try
+        {
+            LONGLONG position = 0;
+            switch (origin)
+            {
+            case Reference::CURRENT:
+                position = static_cast<LONGLONG>(m_position) + move.QuadPart;
+                break;
+            case Reference::START:
+                position = move.QuadPart;
+                break;
+            case Reference::END:
+                position = static_cast<LONGLONG>(m_size) + move.QuadPart;
+                break;
+            }
+            m_position = std::min(static_cast<std::uint64_t>(std::max(position, static_cast<LONGLONG>(0))), m_size);
+            if (newPosition) { newPosition->QuadPart = m_position; }
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
+        HRESULT STDMETHODCALLTYPE Read(void* buffer, ULONG countBytes, ULONG* bytesRead) noexcept override try
+        {
+            if (!m_file)
+            {
+                m_file = m_directory->OpenFile(m_stagedName, FileStream::Mode::READ);
+            }
+            LARGE_INTEGER position = { 0 };
+            position.QuadPart = m_position;
+            ThrowHrIfFailed(m_file->Seek(position, Reference::START, nullptr));
+            ULONG actualRead = 0;
+            ThrowHrIfFailed(m_file->Read(buffer, countBytes, &actualRead));
+            m_position += actualRead;
+            if (bytesRead) { *bytesRead = actualRead; }
+            return (countBytes == actualRead) ? S_OK : S_FALSE;
+        } CATCH_RETURN();
+
+        // IStreamInternal
+        std::uint64_t GetSizeOnZip() override { return m_sizeOnZip; }
+        bool IsCompressed() override { return m_isCompressed; }
+        std::string GetName() override { return m_name; }
+
+    protected:
+        ComPtr<DirectoryObject> m_directory;
+        ComPtr<IStream>         m_file;
+        std::string             m_stagedName;
+        std::string             m_name;
+        std::uint64_t           m_position = 0;
+        std::uint64_t           m_size;
+        std::uint64_t           m_sizeOnZip;
+        bool                    m_isCompressed;
+    };
+
+    // Storage object over a package read front to back from a stream that doesn't need to seek, like a pipe or
+    // a download in progress. Footprint files are kept in memory. Payload files are written to a staging
+    // directory under the destination as they arrive, hashing each block on the way, because the block map
+    // comes after them. Once the whole package has been read, AppxPackageObject validates it as usual from
+    // this object, then Commit checks the block hashes and moves the payload into place. If anything fails
+    // before that, the staging directory is removed.
+    class StagingObject final : public ComClass<StagingObject, IStorageObject, IZipArchive>
+    {
+    public:
+        StagingObject(IMsixFactory* factory, const ComPtr<IStream>& stream, const std::string& destination);
+        ~StagingObject();
+
+        // Checks the payload against the block map of the package and writes the package to the destination
+        // the same way AppxPackageObject::Unpack does. If it fails, the files it put in the destination are taken
+        // out again. Files of the same names that were there before are replaced, not restored, and directories
+        // made for the files stay.
+        void Commit(const ComPtr<IAppxPackageReader>& package, MSIX_PACKUNPACK_OPTION options);
+
+        // Removes the staged files and the staging directory.
+        void Rollback() noexcept;
+
+        // IStorageObject methods
+        const char* GetPathSeparator() override { return "/"; }
+        std::vector<std::string> GetFileNames(FileNameOptions options) override;
+        ComPtr<IStream> GetFile(const std::string& fileName) override;
+        ComPtr<IStream> OpenFile(const std::string& fileName, MSIX::FileStream::Mode mode) override { NOTIMPLEMENTED; }
+        std::string GetFileName() override { return m_stream.As<IStreamInternal>()->GetName(); }
+
+        // IZipArchive methods, the digests are taken while the package is read.
+        std::vector<std::uint8_t> GetFileRecordsDigest(const std::string& lastFile) override;
+        std::vector<std::uint8_t> GetCentralDirectoryDigest(const std::string& lastFile) override;
+
+    protected:
+        struct StagedFile
+        {
+            std::string                             stagedName;
+            std::uint64_t                           size = 0;
+            std::uint64_t                           sizeOnZip = 0;
+            bool                                    isCompressed = false;
+            // SHA256 of each block of the file, in order.
+            std::vector<std::vector<std::uint8_t>>  blockHashes;
+        };
+
+        IMsixFactory*                                       m_factory;
+        ComPtr<IStream>                                     m_stream;
+        ComPtr<DirectoryObject>                             m_destination;
+        // File names in archive order.
+        std::vector<std::string>                            m_fileNames;
+        std::map<std::string, std::vector<std::uint8_t>>    m_footprintFiles;
+        std::map<std::string, StagedFile>                   m_payloadFiles;
+        bool                                                m_committed = false;
+        std::vector<std::uint8_t>                           m_fileRecordsDigest;
+        std::vector<std::uint8_t>                           m_centralDirectoryDigest;
+    };
+}
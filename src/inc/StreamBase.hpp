@@ -15,6 +15,15 @@
 #include "Exceptions.hpp"
 #include "ComHelper.hpp"
 
+namespace MSIX {
+    // A place in compressed data that can be decompressed from without what comes before it.
+    struct SyncPoint
+    {
+        std::uint64_t position;             // in the uncompressed data
+        std::uint64_t compressedPosition;   // in the compressed data
+    };
+}
+
 // {44d2a7a8-a165-4a6e-a56f-c7c24de7505c}
 #ifndef WIN32
 interface IStreamInternal : public IUnknown
@@ -28,11 +37,44 @@ public:
     virtual std::uint64_t GetSizeOnZip() = 0;
     virtual bool IsCompressed() = 0;
     virtual std::string GetName() = 0;
+    // Reads countBytes starting at position without using or moving the seek pointer, so readers of
+    // different ranges of the stream don't interfere with each other. Returns false, having read
+    // nothing, if the stream doesn't support positional reads.
+    virtual bool ReadAt(std::uint64_t position, void* buffer, ULONG countBytes, ULONG* bytesRead) = 0;
+    // Hint that size bytes starting at position are going to be read soon. Streams over files can
+    // start bringing them in from the device. Doesn't wait for it and does nothing if not supported.
+    virtual void WillNeed(std::uint64_t position, std::uint64_t size) = 0;
+    // Sync points of a compressed stream, in increasing order, so seeking can start decompressing at
+    // the closest one instead of at the start. Ignored by streams that don't decompress.
+    virtual void SetSyncPoints(std::vector<MSIX::SyncPoint> points) = 0;
+    // A stream of its own over the compressed data of a stream that decompresses, so parts of it can be
+    // decompressed elsewhere. Empty if the stream doesn't decompress, its data can't be read on its own or
+    // it checks the CRC of what it decompresses.
+    virtual MSIX::ComPtr<IStream> GetCompressedStream() = 0;
+    // Says which file, in which state, the stream reads: the same only while the file is the same file and
+    // hasn't been changed. Empty if the stream doesn't read a file or can't tell.
+    virtual std::string GetFileIdentity() = 0;
 };
 MSIX_INTERFACE(IStreamInternal, 0x44d2a7a8,0xa165,0x4a6e,0xa5,0x6f,0xc7,0xc2,0x4d,0xe7,0x50,0x5c);
 
+// Implemented by streams whose content is resident in memory (e.g. a mapped file), so callers can
+// read directly out of it instead of seeking and copying.
+// {035716b4-7f72-40a5-b3e0-c0455f68b50d}
+#ifndef WIN32
+interface IStreamView : public IUnknown
+#else
+class IStreamView : public IUnknown
+#endif
+{
+public:
+    // Returns a pointer to size bytes of the stream starting at offset, or nullptr if the range isn't
+    // resident in memory. The pointer is valid for as long as the stream is alive.
+    virtual const std::uint8_t* GetView(std::uint64_t offset, std::uint64_t size) = 0;
+};
+MSIX_INTERFACE(IStreamView, 0x035716b4,0x7f72,0x40a5,0xb3,0xe0,0xc0,0x45,0x5f,0x68,0xb5,0x0d);
+
 namespace MSIX {
-    class StreamBase : public MSIX::ComClass<StreamBase, IStream, IStreamInternal>
+    class StreamBase : public MSIX::ComClass<StreamBase, IStream, IStreamInternal, IStreamView>
     {
     public:
         // These are the same values as STREAM_SEEK. See 
@@ -116,7 +158,7 @@ namespace MSIX {
             ThrowHrIfFailed(Seek(start, StreamBase::Reference::END, &end));
             ThrowHrIfFailed(Seek(start, StreamBase::Reference::START, nullptr));
             statStg->type = STGTY_STREAM;
-            statStg->cbSize.QuadPart = end.u.LowPart;
+            statStg->cbSize.QuadPart = end.QuadPart;
             return static_cast<HRESULT>(Error::OK);
         } CATCH_RETURN();
 
@@ -133,6 +175,14 @@ namespace MSIX {
         virtual std::uint64_t GetSizeOnZip() override { NOTIMPLEMENTED; }
         virtual bool IsCompressed() override { NOTIMPLEMENTED; }
         virtual std::string GetName() override { NOTIMPLEMENTED; }
+        virtual bool ReadAt(std::uint64_t, void*, ULONG, ULONG*) override { return false; }
+        virtual void WillNeed(std::uint64_t, std::uint64_t) override {}
+        virtual void SetSyncPoints(std::vector<SyncPoint>) override {}
+        virtual ComPtr<IStream> GetCompressedStream() override { return ComPtr<IStream>(); }
+        virtual std::string GetFileIdentity() override { return std::string(); }
+
+        // IStreamView
+        virtual const std::uint8_t* GetView(std::uint64_t, std::uint64_t) override { return nullptr; }
 
         template <class T>
         static ULONG Read(const ComPtr<IStream>& stream, T* value)
@@ -150,5 +200,18 @@ namespace MSIX {
             ThrowHrIfFailed(stream->Write(value, static_cast<ULONG>(sizeof(T)), nullptr));
             ThrowErrorIf(Error::FileWrite, (result != sizeof(T)), "Entire object wasn't written!");
         }
+
+    protected:
+        // Hands clone out through stream with its seek pointer where ours is, as IStream::Clone requires.
+        void ReturnClone(const ComPtr<IStream>& clone, IStream** stream)
+        {
+            ThrowErrorIf(Error::InvalidParameter, (stream == nullptr || *stream != nullptr), "bad pointer");
+            LARGE_INTEGER move = { 0 };
+            ULARGE_INTEGER position = { 0 };
+            ThrowHrIfFailed(Seek(move, Reference::CURRENT, &position));
+            move.QuadPart = position.QuadPart;
+            ThrowHrIfFailed(clone->Seek(move, Reference::START, nullptr));
+            *stream = ComPtr<IStream>(clone).Detach();
+        }
     };
 }
\ No newline at end of file
@@ -8,10 +8,26 @@
 #include "Exceptions.hpp"
 
 #include <utility>
+#include <limits>
+#include <algorithm>
 
 namespace MSIX {
     namespace Helper {
 
+        // Reads size bytes from the stream, in as many reads as it takes as a single read is limited to 4 GB.
+        inline void ReadAll(const ComPtr<IStream>& stream, std::uint8_t* buffer, std::uint64_t size)
+        {
+            while (size > 0)
+            {
+                ULONG toRead = static_cast<ULONG>(std::min(size, static_cast<std::uint64_t>(std::numeric_limits<ULONG>::max())));
+                ULONG actualRead = 0;
+                ThrowHrIfFailed(stream->Read(buffer, toRead, &actualRead));
+                ThrowErrorIf(Error::FileRead, (actualRead != toRead), "read error");
+                buffer += actualRead;
+                size -= actualRead;
+            }
+        }
+
         inline std::vector<std::uint8_t> CreateBufferFromStream(const ComPtr<IStream>& stream)
         {
             // Create buffer from stream
@@ -20,11 +36,9 @@ namespace MSIX {
             ThrowHrIfFailed(stream->Seek(start, StreamBase::Reference::END, &end));
             ThrowHrIfFailed(stream->Seek(start, StreamBase::Reference::START, nullptr));
             
-            std::uint32_t streamSize = end.u.LowPart;
-            std::vector<std::uint8_t> buffer(streamSize);
-            ULONG actualRead = 0;
-            ThrowHrIfFailed(stream->Read(buffer.data(), streamSize, &actualRead));
-            ThrowErrorIf(Error::FileRead, (actualRead != streamSize), "read error");
+            ThrowErrorIf(Error::FileRead, (end.QuadPart > std::numeric_limits<std::size_t>::max()), "stream too big");
+            std::vector<std::uint8_t> buffer(static_cast<std::size_t>(end.QuadPart));
+            ReadAll(stream, buffer.data(), end.QuadPart);
 
             // move the underlying stream back to the beginning.
             ThrowHrIfFailed(stream->Seek(start, StreamBase::Reference::START, nullptr));
@@ -39,11 +53,10 @@ namespace MSIX {
             ThrowHrIfFailed(stream->Seek(start, StreamBase::Reference::END, &end));
             ThrowHrIfFailed(stream->Seek(start, StreamBase::Reference::START, nullptr));
             
-            std::uint32_t streamSize = end.u.LowPart;
+            ThrowErrorIf(Error::FileRead, (end.QuadPart > std::numeric_limits<std::uint32_t>::max()), "stream too big");
+            std::uint32_t streamSize = static_cast<std::uint32_t>(end.QuadPart);
             std::unique_ptr<std::uint8_t[]> buffer = std::make_unique<std::uint8_t[]>(streamSize);
-            ULONG actualRead = 0;
-            ThrowHrIfFailed(stream->Read(buffer.get(), streamSize, &actualRead));
-            ThrowErrorIf(Error::FileRead, (actualRead != streamSize), "read error");
+            ReadAll(stream, buffer.get(), streamSize);
 
             // move the underlying stream back to the beginning.
             ThrowHrIfFailed(stream->Seek(start, StreamBase::Reference::START, nullptr));
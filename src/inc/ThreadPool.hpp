@@ -0,0 +1,51 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace MSIX {
+
+    // Threads of a package that stay around from one run of blocks to the next, shared by the streams over its
+    // payload files and the package verifier. Threads are only started when a run first needs them and are joined
+    // when the last owner lets go of the pool. Any thread can use it.
+    class ThreadPool
+    {
+    public:
+        ThreadPool() = default;
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Runs job on this thread and on up to count - 1 threads of the pool at the same time, and returns once
+        // every one of them is done. Pool threads that are busy elsewhere don't join in, so job has to take its
+        // work from something shared until there is none left, however many threads run it. job must not throw.
+        void Run(std::size_t count, const std::function<void()>& job);
+
+    protected:
+        struct Job
+        {
+            const std::function<void()>* run;
+            std::size_t wanted;     // pool threads that can still join in
+            std::size_t running;    // pool threads running it
+        };
+
+        void Work();
+
+        std::mutex m_lock;
+        std::condition_variable m_wake;     // a job wants threads or the pool is going away
+        std::condition_variable m_done;     // a pool thread finished a job
+        std::list<Job*> m_jobs;             // jobs that want threads, oldest first
+        std::vector<std::thread> m_threads;
+        bool m_stop = false;
+    };
+}
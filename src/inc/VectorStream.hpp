@@ -16,9 +16,15 @@ namespace MSIX {
     public:
         VectorStream(std::vector<std::uint8_t>* data) : m_data(data) {}
 
+        HRESULT STDMETHODCALLTYPE Clone(IStream** stream) noexcept override try
+        {
+            ReturnClone(ComPtr<IStream>::Make<VectorStream>(m_data), stream);
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
         HRESULT STDMETHODCALLTYPE Read(void* buffer, ULONG countBytes, ULONG* bytesRead) noexcept override try
         {
-            ULONG amountToRead = std::min(countBytes, static_cast<ULONG>(m_data->size() - m_offset));
+            ULONG amountToRead = static_cast<ULONG>(std::min(static_cast<std::uint64_t>(countBytes), static_cast<std::uint64_t>(m_data->size() - m_offset)));
             if (amountToRead > 0) { memcpy(buffer, &(m_data->at(m_offset)), amountToRead); }                
             m_offset += amountToRead;
             if (bytesRead) { *bytesRead = amountToRead; }
@@ -40,13 +46,14 @@ namespace MSIX {
                 newPos.QuadPart = static_cast<std::uint64_t>(m_data->size()) + move.QuadPart;
                 break;
             }
-            m_offset = std::min(newPos.u.LowPart, static_cast<ULONG>(m_data->size()));
+            ThrowErrorIf(Error::FileSeek, (newPos.QuadPart < 0), "seek before the start of the stream");
+            m_offset = static_cast<std::size_t>(std::min(static_cast<std::uint64_t>(newPos.QuadPart), static_cast<std::uint64_t>(m_data->size())));
             if (newPosition) { newPosition->QuadPart = newPos.QuadPart; }
             return static_cast<HRESULT>(Error::OK);
         } CATCH_RETURN();
 
     protected:
-        ULONG m_offset = 0;
+        std::size_t m_offset = 0;
         std::vector<std::uint8_t>* m_data;
     };
 } // namespace MSIX
\ No newline at end of file
@@ -0,0 +1,67 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#pragma once
+
+#include "AppxPackaging.hpp"
+#include "MSIXFactory.hpp"
+#include "AppxSignature.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace MSIX {
+
+    // What the checks of a package's signature found, kept in a directory so the package can be opened again
+    // without checking its certificate chain and signature. An entry is for one file, as its identity says, one
+    // AppxSignature.p7x, by its hash, and one set of validation options. Entries are signed with a key only the
+    // caller knows, one that doesn't match is ignored as if it wasn't there. Nothing in an entry is trusted that
+    // the package can be checked against instead: the digests it holds are still compared with the parts they
+    // are for. Entries aren't removed, the directory can be emptied at any time.
+    class VerificationCache
+    {
+    public:
+        // Checks an entry says passed.
+        enum Check : std::uint32_t
+        {
+            Signature = 0x1,    // certificate chain, signature and the digests in it
+        };
+
+        struct Entry
+        {
+            std::uint32_t checks = 0;
+            bool hasDigests = false;
+            AppxSignatureObject::Digest fileRecords;
+            AppxSignatureObject::Digest centralDirectory;
+            AppxSignatureObject::Digest contentTypes;
+            AppxSignatureObject::Digest blockMap;
+            AppxSignatureObject::Digest codeIntegrity;
+            SignatureOrigin origin = SignatureOrigin::Unsigned;
+            std::string publisher;
+        };
+
+        // Null if the factory has no verification cache, the signature isn't checked or the package isn't read
+        // from a file that can be told apart from others.
+        static std::unique_ptr<VerificationCache> Create(IMsixFactory* factory, MSIX_VALIDATION_OPTION options, const std::string& fileIdentity);
+
+        VerificationCache(std::string directory, std::vector<std::uint8_t> key, MSIX_VALIDATION_OPTION options, std::string fileIdentity);
+
+        // signature is the hash of AppxSignature.p7x. False if there's no entry for it or it isn't one of ours.
+        bool Find(const std::vector<std::uint8_t>& signature, Entry& entry) noexcept;
+
+        // The entry just isn't kept if it can't be written.
+        void Add(const std::vector<std::uint8_t>& signature, const Entry& entry) noexcept;
+
+    protected:
+        std::vector<std::uint8_t> GetMac(const std::vector<std::uint8_t>& data);
+        std::string GetPath(const std::vector<std::uint8_t>& signature);
+
+        std::string m_directory;
+        std::vector<std::uint8_t> m_key;
+        MSIX_VALIDATION_OPTION m_options;
+        std::string m_fileIdentity;
+    };
+}
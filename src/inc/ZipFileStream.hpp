@@ -8,7 +8,9 @@
 #include "StreamBase.hpp"
 #include "RangeStream.hpp"
 #include "AppxFactory.hpp"
+#include "Crc32.hpp"
 
+#include <memory>
 #include <string>
 
 namespace MSIX {
@@ -25,11 +27,51 @@ namespace MSIX {
             bool isCompressed,
             std::uint64_t offset,
             std::uint64_t size,
-            const ComPtr<IStream>& stream
-        ) : m_isCompressed(isCompressed), RangeStream(offset, size, stream), m_name(name), m_contentType(contentType), m_factory(factory), m_compressedSize(size)
+            const ComPtr<IStream>& stream,
+            std::unique_ptr<Crc32Check> crcCheck = nullptr
+        ) : m_isCompressed(isCompressed), RangeStream(offset, size, stream), m_name(name), m_contentType(contentType), m_factory(factory), m_compressedSize(size),
+            m_crcCheck(std::move(crcCheck))
         {
         }
 
+        // The clone starts from what this stream already checked, which is still valid.
+        HRESULT STDMETHODCALLTYPE Clone(IStream** stream) noexcept override try
+        {
+            ReturnClone(ComPtr<IStream>::Make<ZipFileStream>(m_name, m_contentType, m_factory, m_isCompressed, m_offset, m_size, m_stream,
+                m_crcCheck ? std::make_unique<Crc32Check>(*m_crcCheck) : nullptr), stream);
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
+        HRESULT STDMETHODCALLTYPE Read(void* buffer, ULONG countBytes, ULONG* bytesRead) noexcept override try
+        {
+            auto position = m_relativePosition;
+            ULONG amountRead = 0;
+            ThrowHrIfFailed(RangeStream::Read(buffer, countBytes, &amountRead));
+            // Bytes that came through ReadAt were already seen, Crc32Check skips them.
+            if (m_crcCheck) { m_crcCheck->Update(position, buffer, amountRead); }
+            if (bytesRead) { *bytesRead = amountRead; }
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
+        // IStreamInternal
+        bool ReadAt(std::uint64_t position, void* buffer, ULONG countBytes, ULONG* bytesRead) override
+        {
+            ULONG amountRead = 0;
+            if (!RangeStream::ReadAt(position, buffer, countBytes, &amountRead))
+            {
+                return false;
+            }
+            if (m_crcCheck) { m_crcCheck->Update(position, buffer, amountRead); }
+            if (bytesRead) { *bytesRead = amountRead; }
+            return true;
+        }
+
+        // IStreamView
+        const std::uint8_t* GetView(std::uint64_t offset, std::uint64_t size) override
+        {   // Bytes handed out as a view are never seen, so they can't be checked.
+            return m_crcCheck ? nullptr : RangeStream::GetView(offset, size);
+        }
+
         // IStreamInternal
         std::uint64_t GetSizeOnZip() override { return m_compressedSize; }
         bool IsCompressed() override { return m_isCompressed; }
@@ -41,5 +83,6 @@ namespace MSIX {
         std::string     m_contentType;
         bool            m_isCompressed = false;
         std::uint64_t   m_compressedSize;
+        std::unique_ptr<Crc32Check> m_crcCheck;
     };
 }
\ No newline at end of file
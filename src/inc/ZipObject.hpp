@@ -9,14 +9,55 @@
 #include "StreamBase.hpp"
 #include "StorageObject.hpp"
 #include "AppxFactory.hpp"
+#include "ICompressionObject.hpp"
+#include "Crc32.hpp"
+#include "SHA256.hpp"
 
 #include <vector>
-#include <map>
+#include <string>
 #include <memory>
 
+// internal interface
+// Digests of the bytes of a zip archive, taken the way an AppX signature takes them: of the archive as it was before
+// its last file, the signature, was added. Both are empty if lastFile isn't in the archive or anything but its local
+// file header and data comes after the file before it, as then the archive can't have been made that way.
+// {6d119d79-a3f1-4014-a9d4-5f98ea8cb00d}
+#ifndef WIN32
+interface IZipArchive : public IUnknown
+#else
+class IZipArchive : public IUnknown
+#endif
+{
+public:
+    // SHA-256 of every byte before the local file header of lastFile, read front to back.
+    virtual std::vector<std::uint8_t> GetFileRecordsDigest(const std::string& lastFile) = 0;
+
+    // SHA-256 of the central directory without the header of lastFile and of the records after it, which say how
+    // many entries the central directory had, its size and its offset without lastFile.
+    virtual std::vector<std::uint8_t> GetCentralDirectoryDigest(const std::string& lastFile) = 0;
+};
+MSIX_INTERFACE(IZipArchive, 0x6d119d79,0xa3f1,0x4014,0xa9,0xd4,0x5f,0x98,0xea,0x8c,0xb0,0x0d);
+
 namespace MSIX {
+    // Fixed size record with the information of a central directory file header needed to read the file.
+    // The file name is stored in ZipObject::m_names.
+    struct CentralDirectoryEntry
+    {
+        std::uint64_t compressedSize;
+        std::uint64_t uncompressedSize;
+        std::uint64_t relativeOffsetOfLocalHeader;
+        std::uint32_t crc32;
+        std::uint32_t fileNameOffset;
+        std::uint16_t fileNameLength;
+        std::uint16_t compressionMethod;
+        std::uint16_t generalPurposeBitFlags;
+
+        // Bit 3: sizes and crc are in the data descriptor after the compressed data.
+        bool IsGeneralPurposeBitSet() const noexcept { return (generalPurposeBitFlags & 0x0008) != 0; }
+    };
+
     // This represents a raw stream over a.zip file.
-    class ZipObject final : public ComClass<ZipObject, IStorageObject>
+    class ZipObject final : public ComClass<ZipObject, IStorageObject, IZipArchive>
     {
     public:
         ZipObject(IMsixFactory* factory, const ComPtr<IStream>& stream);
@@ -28,9 +69,116 @@ namespace MSIX {
         ComPtr<IStream> OpenFile(const std::string& fileName, MSIX::FileStream::Mode mode) override { NOTIMPLEMENTED; }
         std::string GetFileName() override;
 
+        // IZipArchive methods
+        std::vector<std::uint8_t> GetFileRecordsDigest(const std::string& lastFile) override;
+        std::vector<std::uint8_t> GetCentralDirectoryDigest(const std::string& lastFile) override;
+
     protected:
+        std::string GetEntryName(const CentralDirectoryEntry& entry);
+        bool FindEntry(const std::string& fileName, std::uint32_t& index);
+        bool FindLastFile(const std::string& lastFile, std::uint32_t& index);
+
         IMsixFactory*                          m_factory;
         ComPtr<IStream>                        m_stream;
-        std::map<std::string, ComPtr<IStream>> m_streams;
+        // The same stream with read-ahead over the file data. Files and their local file headers are read through it.
+        ComPtr<IStream>                        m_readAhead;
+        // Parsed central directory, in archive order, and the names of all its entries.
+        std::vector<CentralDirectoryEntry>     m_centralDirectory;
+        std::string                            m_names;
+        // The central directory as it was read, in the stream's view of it or in m_centralDirectoryBuffer, kept
+        // for its digest. Where it is, and where the archive ends.
+        const std::uint8_t*                    m_centralDirectoryData = nullptr;
+        std::vector<std::uint8_t>              m_centralDirectoryBuffer;
+        std::uint64_t                          m_offsetStartOfCD = 0;
+        std::uint64_t                          m_sizeOfCD = 0;
+        std::uint64_t                          m_endOfArchive = 0;
+        // Indexes of m_centralDirectory sorted by file name.
+        std::vector<std::uint32_t>             m_sortedEntries;
+        // The same indexes sorted by the offset of their local file header. GetFileNames returns the files
+        // in this order, so reading them in that order goes through the archive front to back.
+        std::vector<std::uint32_t>             m_offsetOrder;
+        // Streams for each entry are created on first use in GetFile, same index as m_centralDirectory.
+        std::vector<ComPtr<IStream>>           m_streams;
     };//class ZipObject
+
+    // Reads the entries of a zip archive front to back as they come out of the stream, without ever seeking.
+    // This is for streams that can't seek, like pipes or downloads in progress, so the central directory
+    // is never looked at and everything is taken from the local file headers and data descriptors.
+    class ZipStreamReader final
+    {
+    public:
+        ZipStreamReader(const ComPtr<IStream>& stream);
+        ~ZipStreamReader();
+
+        // Moves to the next entry, skipping whatever is left of the current one. Returns false once the
+        // central directory is reached, after reading the rest of the stream.
+        bool MoveNext();
+
+        // Reads the uncompressed data of the current entry. Returns 0 at the end of the entry, once its
+        // crc and sizes have been checked against the local file header or the data descriptor.
+        ULONG Read(std::uint8_t* buffer, ULONG countBytes);
+
+        const std::string& GetName() const noexcept { return m_name; }
+        bool IsCompressed() const noexcept { return m_isCompressed; }
+        // Only valid once Read returned 0.
+        std::uint64_t GetSizeOnZip() const noexcept { return m_compressedRead; }
+        std::uint64_t GetUncompressedSize() const noexcept { return m_uncompressedRead; }
+
+        // Keeps what is needed for the digests of the archive without lastFile while the entries go by: every byte
+        // before the local file header of lastFile is hashed, the central directory is kept. Call it before the
+        // first MoveNext.
+        void KeepDigests(const std::string& lastFile);
+
+        // Only valid once MoveNext returned false. Empty if lastFile wasn't the last file of the archive, or the
+        // digest wasn't kept.
+        std::vector<std::uint8_t> GetFileRecordsDigest();
+        std::vector<std::uint8_t> GetCentralDirectoryDigest();
+
+    protected:
+        // Makes sure there are at least count bytes buffered. Returns false if the stream ends before.
+        bool Fill(std::size_t count);
+        std::size_t Available() const noexcept { return m_end - m_begin; }
+        void Consume(std::size_t count);
+
+        ULONG ReadStored(std::uint8_t* buffer, ULONG countBytes);
+        ULONG ReadStoredUntilDataDescriptor(std::uint8_t* buffer, ULONG countBytes);
+        ULONG ReadDeflated(std::uint8_t* buffer, ULONG countBytes);
+        bool IsDataDescriptor(std::size_t sizeFieldLength);
+        void ReadDataDescriptor();
+
+        ComPtr<IStream>                     m_stream;
+        std::vector<std::uint8_t>           m_buffer;
+        std::size_t                         m_begin = 0;
+        std::size_t                         m_end = 0;
+        bool                                m_finished = false;
+        std::uint64_t                       m_position = 0;
+
+        // Digests
+        std::string                         m_lastFile;
+        bool                                m_keepDigests = false;
+        bool                                m_hashFileRecords = false;
+        bool                                m_lastFileFound = false;
+        bool                                m_lastFileIsLast = false;
+        bool                                m_inCentralDirectory = false;
+        std::uint64_t                       m_lastFileOffset = 0;
+        SHA256                              m_fileRecordsHash;
+        std::vector<std::uint8_t>           m_fileRecordsDigest;
+        std::vector<std::uint8_t>           m_centralDirectory;     // and the records after it
+
+        // Current entry
+        std::string                         m_name;
+        bool                                m_inEntry = false;
+        bool                                m_isCompressed = false;
+        bool                                m_hasDataDescriptor = false;
+        bool                                m_isZip64 = false;
+        bool                                m_inflateEnded = false;
+        bool                                m_dataDescriptorRead = false;
+        std::uint32_t                       m_expectedCrc = 0;
+        std::uint64_t                       m_expectedCompressedSize = 0;
+        std::uint64_t                       m_expectedUncompressedSize = 0;
+        std::uint64_t                       m_compressedRead = 0;
+        std::uint64_t                       m_uncompressedRead = 0;
+        Crc32                               m_crc;
+        std::unique_ptr<ICompressionObject> m_compressionObject;
+    };//class ZipStreamReader
 }
@@ -11,6 +11,7 @@
 #include <string>
 #include <initializer_list>
 #include <algorithm>
+#include <cstdlib>
 
 // Describes which command the user specified
 enum class UserSpecified
@@ -18,7 +19,8 @@ enum class UserSpecified
     Nothing,
     Help,
     Unpack,
-    Unbundle
+    Unbundle,
+    Verify
 };
 
 // Tracks the state of the current parse operation as well as implements input validation
@@ -41,6 +43,18 @@ struct State
         return true;
     }
 
+    bool ForwardOnly()
+    {
+        unpackOptions = static_cast<MSIX_PACKUNPACK_OPTION>(unpackOptions | MSIX_PACKUNPACK_OPTION::MSIX_PACKUNPACK_OPTION_FORWARDONLY);
+        return true;
+    }
+
+    bool MapFile()
+    {
+        unpackOptions = static_cast<MSIX_PACKUNPACK_OPTION>(unpackOptions | MSIX_PACKUNPACK_OPTION::MSIX_PACKUNPACK_OPTION_MAPFILE);
+        return true;
+    }
+
     bool SkipManifestValidation()
     {
         validationOptions = static_cast<MSIX_VALIDATION_OPTION>(validationOptions | MSIX_VALIDATION_OPTION::MSIX_VALIDATION_OPTION_SKIPAPPXMANIFEST);
@@ -53,6 +67,18 @@ struct State
         return true;
     }
 
+    bool VerifyCrc()
+    {
+        validationOptions = static_cast<MSIX_VALIDATION_OPTION>(validationOptions | MSIX_VALIDATION_OPTION::MSIX_VALIDATION_OPTION_VERIFYCRC);
+        return true;
+    }
+
+    bool DeferPayloadChecks()
+    {
+        validationOptions = static_cast<MSIX_VALIDATION_OPTION>(validationOptions | MSIX_VALIDATION_OPTION::MSIX_VALIDATION_OPTION_DEFERPAYLOADCHECKS);
+        return true;
+    }
+
     bool AllowSignatureOriginUnknown()
     {
         validationOptions = static_cast<MSIX_VALIDATION_OPTION>(validationOptions | MSIX_VALIDATION_OPTION::MSIX_VALIDATION_OPTION_ALLOWSIGNATUREORIGINUNKNOWN);
@@ -85,9 +111,18 @@ struct State
         return true;
     }
 
+    bool SetJobs(const std::string& value)
+    {
+        char* end = nullptr;
+        auto count = std::strtoul(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0' || count > 1024) { return false; }
+        jobs = static_cast<UINT32>(count);
+        return true;
+    }
+
     bool Validate()
     {
-        if (packageName.empty() || directoryName.empty()) {
+        if (packageName.empty() || (directoryName.empty() && specified != UserSpecified::Verify)) {
             return false;
         }
         return true;
@@ -96,6 +131,7 @@ struct State
     std::string packageName;
     std::string certName;
     std::string directoryName;
+    UINT32 jobs                              = 0;
     UserSpecified specified                  = UserSpecified::Nothing;
     MSIX_VALIDATION_OPTION validationOptions = MSIX_VALIDATION_OPTION::MSIX_VALIDATION_OPTION_FULL;
     MSIX_PACKUNPACK_OPTION unpackOptions     = MSIX_PACKUNPACK_OPTION::MSIX_PACKUNPACK_OPTION_NONE;
@@ -187,6 +223,17 @@ int Help(char* toolName, std::vector<Command>& commands, State& state)
         std::cout << "    specified output <directory>. The output has the same directory structure " << std::endl;
         std::cout << "    as the package. its packages will be unpacked in a directory named as the package full name" << std::endl;
         break;
+    case UserSpecified::Verify:
+        command = std::find(commands.begin(), commands.end(), "verify");
+        std::cout << "    " << toolName << " verify -p <package> [options] " << std::endl;
+        std::cout << std::endl;
+        std::cout << "Description:" << std::endl;
+        std::cout << "------------" << std::endl;
+        std::cout << "    Checks every block of every payload file of the package at the input <package>" << std::endl;
+        std::cout << "    name against its block map, without extracting anything. The blocks are checked" << std::endl;
+        std::cout << "    on several threads. If <package> is a bundle, the payload files of its applicable" << std::endl;
+        std::cout << "    packages are checked. Files that fail are listed." << std::endl;
+        break;
     }
     std::cout << std::endl;
     std::cout << "Options:" << std::endl;
@@ -244,6 +291,8 @@ bool ParseInput(std::vector<Command>& commands, State& state, int argc, char* ar
     return state.Validate();
 }
 
+int Verify(State& state);
+
 // Parses argc/argv input via commands into state, and calls into the 
 // appropriate function with the correct parameters if warranted.
 int ParseAndRun(std::vector<Command>& commands, int argc, char* argv[])
@@ -269,11 +318,14 @@ int ParseAndRun(std::vector<Command>& commands, int argc, char* argv[])
             const_cast<char*>(state.packageName.c_str()),
             const_cast<char*>(state.directoryName.c_str())
         );
+    case UserSpecified::Verify:
+        return Verify(state);
     }
     return -1; // should never end up here.
 }
 
 LPVOID STDMETHODCALLTYPE MyAllocate(SIZE_T cb)  { return std::malloc(cb); }
+void STDMETHODCALLTYPE MyFree(LPVOID pv)        { std::free(pv); }
 
 class Text
 {
@@ -286,6 +338,72 @@ public:
     void Cleanup() { if (content) { std::free(content); content = nullptr; } }
 };
 
+// Releases an object from the packaging APIs when it goes out of scope.
+template <class T>
+class Object
+{
+public:
+    T** operator&() { return &content; }
+    T* operator->() { return content; }
+    ~Object() { if (content) { content->Release(); } }
+
+    T* content = nullptr;
+};
+
+// Checks the blocks of every payload file of the package and lists the files that fail. Returns the error of
+// the first one that does.
+int Verify(State& state)
+{
+    Object<IAppxFactory> factory;
+    HRESULT hr = CoCreateAppxFactoryWithHeap(MyAllocate, MyFree, state.validationOptions, &factory);
+    if (FAILED(hr)) { return hr; }
+
+    Object<IStream> stream;
+    if (state.unpackOptions & MSIX_PACKUNPACK_OPTION::MSIX_PACKUNPACK_OPTION_MAPFILE)
+    {
+        hr = CreateMappedStreamOnFile(const_cast<char*>(state.packageName.c_str()), &stream);
+    }
+    else
+    {
+        hr = CreateStreamOnFile(const_cast<char*>(state.packageName.c_str()), true, &stream);
+    }
+    if (FAILED(hr)) { return hr; }
+
+    Object<IAppxPackageReader> reader;
+    hr = factory->CreatePackageReader(stream.content, &reader);
+    if (FAILED(hr)) { return hr; }
+
+    Object<IMsixPackageVerifier> verifier;
+    hr = reader->QueryInterface(UuidOfImpl<IMsixPackageVerifier>::iid, reinterpret_cast<void**>(&verifier));
+    if (FAILED(hr)) { return hr; }
+
+    Object<IMsixVerificationResults> results;
+    hr = verifier->VerifyPackage(state.jobs, &results);
+    if (FAILED(hr)) { return hr; }
+
+    UINT32 count = 0;
+    hr = results->GetCount(&count);
+    if (FAILED(hr)) { return hr; }
+
+    HRESULT first = S_OK;
+    UINT32 failed = 0;
+    for (UINT32 i = 0; i < count; i++)
+    {
+        HRESULT result = S_OK;
+        hr = results->GetResult(i, &result);
+        if (FAILED(hr)) { return hr; }
+        if (SUCCEEDED(result)) { continue; }
+
+        Text name;
+        hr = results->GetFileName(i, &name);
+        if (FAILED(hr)) { return hr; }
+        std::cout << "    " << name.content << ": error " << std::hex << result << std::dec << std::endl;
+        if (failed++ == 0) { first = result; }
+    }
+    std::cout << count << " files verified, " << failed << " failed." << std::endl;
+    return first;
+}
+
 // Defines the grammar of commands and each command's associated options,
 int main(int argc, char* argv[])
 {
@@ -304,10 +422,18 @@ int main(int argc, char* argv[])
                     [](State& state, const std::string&) {return state.CreatePackageSubfolder(); }),
                 Option("-mv", false, "Skips manifest validation.  By default manifest validation is enabled.",
                     [](State& state, const std::string&) { return state.SkipManifestValidation(); }),
+                Option("-fo", false, "Reads the package front to back without seeking, as it would from a pipe. Payload files are staged under the output directory until the package is validated.",
+                    [](State& state, const std::string&) { return state.ForwardOnly(); }),
                 Option("-sv", false, "Skips signature validation.  By default signature validation is enabled.",
                     [](State& state, const std::string&) { return state.AllowSignatureOriginUnknown(); }),
                 Option("-ss", false, "Skips enforcement of signed packages.  By default packages must be signed.",
                     [](State& state, const std::string&) { return state.SkipSignature(); }),
+                Option("-vc", false, "Verifies the crc-32 of every file extracted.  By default only the block map hashes are checked.",
+                    [](State& state, const std::string&) { return state.VerifyCrc(); }),
+                Option("-dp", false, "Checks each payload file against the block map when it is first read.  By default all of them are checked when the package is opened.",
+                    [](State& state, const std::string&) { return state.DeferPayloadChecks(); }),
+                Option("-mf", false, "Maps the package into memory instead of reading it.  The package must not be changed while it is read.",
+                    [](State& state, const std::string&) { return state.MapFile(); }),
                 Option("-?", false, "Displays this help text.",
                     [](State& state, const std::string&) { return false; })                
             })
@@ -327,6 +453,12 @@ int main(int argc, char* argv[])
                     [](State& state, const std::string&) { return state.AllowSignatureOriginUnknown(); }),
                 Option("-ss", false, "Skips enforcement of signed packages.  By default packages must be signed.",
                     [](State& state, const std::string&) { return state.SkipSignature(); }),
+                Option("-vc", false, "Verifies the crc-32 of every file extracted.  By default only the block map hashes are checked.",
+                    [](State& state, const std::string&) { return state.VerifyCrc(); }),
+                Option("-dp", false, "Checks each payload file against the block map when it is first read.  By default all of them are checked when the package is opened.",
+                    [](State& state, const std::string&) { return state.DeferPayloadChecks(); }),
+                Option("-mf", false, "Maps the package into memory instead of reading it.  The package must not be changed while it is read.",
+                    [](State& state, const std::string&) { return state.MapFile(); }),
                 Option("-sl", false, "Only for bundles. Skips matching packages with the language of the system. By default unpacked resources packages will match the system languages.",
                     [](State& state, const std::string&) { return state.SkipLanguage(); }),
                 Option("-sp", false, "Only for bundles. Skips matching packages with of the same system. By default unpacked application packages will only match the platform.",
@@ -335,6 +467,27 @@ int main(int argc, char* argv[])
                     [](State& state, const std::string&) { return false; })                
             })
         },
+        {   Command("verify", "Check the files of a package against its block map",
+                [](State& state) { return state.Specify(UserSpecified::Verify); },
+            {
+                Option("-p", true, "REQUIRED, specify input package name.",
+                    [](State& state, const std::string& name) { return state.SetPackageName(name); }),
+                Option("--jobs", true, "Number of threads that check blocks.  By default one per core.",
+                    [](State& state, const std::string& value) { return state.SetJobs(value); }),
+                Option("-mv", false, "Skips manifest validation.  By default manifest validation is enabled.",
+                    [](State& state, const std::string&) { return state.SkipManifestValidation(); }),
+                Option("-sv", false, "Skips signature validation.  By default signature validation is enabled.",
+                    [](State& state, const std::string&) { return state.AllowSignatureOriginUnknown(); }),
+                Option("-ss", false, "Skips enforcement of signed packages.  By default packages must be signed.",
+                    [](State& state, const std::string&) { return state.SkipSignature(); }),
+                Option("-dp", false, "Checks each payload file against the block map when it is first read.  By default all of them are checked when the package is opened.",
+                    [](State& state, const std::string&) { return state.DeferPayloadChecks(); }),
+                Option("-mf", false, "Maps the package into memory instead of reading it.  The package must not be changed while it is read.",
+                    [](State& state, const std::string&) { return state.MapFile(); }),
+                Option("-?", false, "Displays this help text.",
+                    [](State& state, const std::string&) { return false; })
+            })
+        },
         {   Command("-?", "Displays this help text.",
                 [](State& state) { return state.Specify(UserSpecified::Help);}, {})
         },
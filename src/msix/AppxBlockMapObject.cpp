@@ -107,6 +107,20 @@ namespace MSIX {
         });
         dom->ForEachElementIn(dom->GetDocument(), XmlQueryName::BlockMap_File, visitor);
         ThrowErrorIf(Error::XmlError, (0 == context.countFilesFound), "Empty AppxBlockMap.xml");
+
+        ComPtr<IMsixFactoryOverrides> factoryOverrides;
+        ThrowHrIfFailed(factory->QueryInterface(UuidOfImpl<IMsixFactoryOverrides>::iid, reinterpret_cast<void**>(&factoryOverrides)));
+        ComPtr<IUnknown> blockCacheUnk;
+        ThrowHrIfFailed(factoryOverrides->GetCurrentSpecifiedExtension(MSIX_FACTORY_EXTENSION_BLOCK_CACHE, &blockCacheUnk));
+        if (blockCacheUnk.Get() != nullptr)
+        {
+            UINT64 capacity = 0;
+            ThrowHrIfFailed(blockCacheUnk.As<IMsixBlockCacheSettings>()->GetCapacity(&capacity));
+            if (capacity != 0)
+            {
+                m_blockCache = std::make_shared<BlockCache>(capacity);
+            }
+        }
     }
 
     // IVerifierObject
@@ -117,7 +131,13 @@ namespace MSIX {
         std::ostringstream builder;
         builder << "file: '" << part << "' not tracked by blockmap.";
         ThrowErrorIf(Error::BlockMapSemanticError, item == m_blockMap.end(), builder.str().c_str());
-        return ComPtr<IStream>::Make<BlockMapStream>(m_factory, part, stream, item->second);
+        auto table = m_blockTableIndex.find(part);
+        if (table == m_blockTableIndex.end())
+        {
+            m_blockTables.push_back(std::make_shared<const std::vector<Block>>(item->second));
+            table = m_blockTableIndex.emplace(part, m_blockTables.size() - 1).first;
+        }
+        return ComPtr<IStream>::Make<BlockMapStream>(m_factory, part, stream, m_blockTables[table->second], m_blockCache, table->second, m_threadPool);
     }
 
     // IAppxBlockMapReader
@@ -9,6 +9,7 @@
 #include "AppxPackageObject.hpp"
 #include "MSIXResource.hpp"
 #include "VectorStream.hpp"
+#include "RangedSourceStream.hpp"
 
 namespace MSIX {
     // IAppxFactory
@@ -28,8 +29,15 @@ namespace MSIX {
         ComPtr<IMsixFactory> self;
         ThrowHrIfFailed(QueryInterface(UuidOfImpl<IMsixFactory>::iid, reinterpret_cast<void**>(&self)));
         ComPtr<IStream> input(inputStream);
+        if (!input && m_rangedSource)
+        {   // No stream given, read the package from the ranged source.
+            input = ComPtr<IStream>::Make<RangedSourceStream>(m_rangedSource);
+        }
+        ThrowErrorIfNot(Error::InvalidParameter, input, "Invalid parameter");
         auto zip = ComPtr<IStorageObject>::Make<ZipObject>(self.Get(), input);
-        auto result = ComPtr<IAppxPackageReader>::Make<AppxPackageObject>(self.Get(), m_validationOptions, m_applicabilityFlags, zip);
+        auto internal = input.TryAs<IStreamInternal>();
+        std::string fileIdentity = internal ? internal->GetFileIdentity() : std::string();
+        auto result = ComPtr<IAppxPackageReader>::Make<AppxPackageObject>(self.Get(), m_validationOptions, m_applicabilityFlags, zip, fileIdentity);
         *packageReader = result.Detach();
         return static_cast<HRESULT>(Error::OK);
     } CATCH_RETURN();
@@ -182,6 +190,18 @@ namespace MSIX {
         {
             ThrowHrIfFailed(extension->QueryInterface(UuidOfImpl<IMsixApplicabilityLanguagesEnumerator>::iid, reinterpret_cast<void**>(&m_applicabilityLanguagesEnumerator)));
         }
+        else if (name == MSIX_FACTORY_EXTENSION_RANGED_SOURCE)
+        {
+            ThrowHrIfFailed(extension->QueryInterface(UuidOfImpl<IMsixRangedSource>::iid, reinterpret_cast<void**>(&m_rangedSource)));
+        }
+        else if (name == MSIX_FACTORY_EXTENSION_BLOCK_CACHE)
+        {
+            ThrowHrIfFailed(extension->QueryInterface(UuidOfImpl<IMsixBlockCacheSettings>::iid, reinterpret_cast<void**>(&m_blockCacheSettings)));
+        }
+        else if (name == MSIX_FACTORY_EXTENSION_VERIFICATION_CACHE)
+        {
+            ThrowHrIfFailed(extension->QueryInterface(UuidOfImpl<IMsixVerificationCacheSettings>::iid, reinterpret_cast<void**>(&m_verificationCacheSettings)));
+        }
         else
         {
             return static_cast<HRESULT>(Error::InvalidParameter);
@@ -208,6 +228,27 @@ namespace MSIX {
                 *extension = m_applicabilityLanguagesEnumerator.As<IUnknown>().Detach();
             }
         }
+        else if (name == MSIX_FACTORY_EXTENSION_RANGED_SOURCE)
+        {
+            if (m_rangedSource.Get() != nullptr)
+            {
+                *extension = m_rangedSource.As<IUnknown>().Detach();
+            }
+        }
+        else if (name == MSIX_FACTORY_EXTENSION_BLOCK_CACHE)
+        {
+            if (m_blockCacheSettings.Get() != nullptr)
+            {
+                *extension = m_blockCacheSettings.As<IUnknown>().Detach();
+            }
+        }
+        else if (name == MSIX_FACTORY_EXTENSION_VERIFICATION_CACHE)
+        {
+            if (m_verificationCacheSettings.Get() != nullptr)
+            {
+                *extension = m_verificationCacheSettings.As<IUnknown>().Detach();
+            }
+        }
         else
         {
             return static_cast<HRESULT>(Error::InvalidParameter);
@@ -119,11 +119,11 @@ namespace MSIX {
     std::string AppxManifestPackageId::ComputePublisherId(const std::string& publisher)
     {
         auto wpublisher = utf8_to_u16string(publisher);
-        std::vector<std::uint8_t> buffer(wpublisher.size() * sizeof(char16_t));
-        memcpy(buffer.data(), &wpublisher[0], wpublisher.size() * sizeof(char16_t));
 
         std::vector<std::uint8_t> hash;
-        ThrowErrorIfNot(Error::Unexpected, SHA256::ComputeHash(buffer.data(), static_cast<uint32_t>(buffer.size()), hash),  "Failed computing publisherId");
+        SHA256 hasher;
+        hasher.Update(reinterpret_cast<const std::uint8_t*>(wpublisher.data()), wpublisher.size() * sizeof(char16_t));
+        hasher.Final(hash);
         return Encoding::Base32Encoding(hash);
     }
 
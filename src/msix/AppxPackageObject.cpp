@@ -16,6 +16,7 @@
 #include "Enumerators.hpp"
 #include "AppxFile.hpp"
 #include "DirectoryObject.hpp"
+#include "VerificationCache.hpp"
 
 #ifdef BUNDLE_SUPPORT
 #include "Applicability.hpp"
@@ -25,6 +26,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
 #include <memory>
 #include <limits>
 #include <algorithm>
@@ -54,8 +56,29 @@ namespace MSIX {
         APPXSIGNATURE_P7X,
     };
 
+    // Position of every file in the container. Containers list their files in the order they are stored,
+    // which for a zip is the order of the local file headers. Reading files in this order reads the package
+    // front to back instead of seeking back and forth.
+    static std::map<std::string, std::size_t> GetContainerOrder(const ComPtr<IStorageObject>& container)
+    {
+        std::map<std::string, std::size_t> result;
+        auto fileNames = container->GetFileNames(FileNameOptions::All);
+        for (std::size_t index = 0; index < fileNames.size(); index++)
+        {
+            result.emplace(fileNames[index], index);
+        }
+        return result;
+    }
+
+    // Files that aren't in the container go last.
+    static std::size_t GetContainerPosition(const std::map<std::string, std::size_t>& order, const std::string& fileName)
+    {
+        auto position = order.find(fileName);
+        return (position == order.end()) ? order.size() : position->second;
+    }
+
     AppxPackageObject::AppxPackageObject(IMsixFactory* factory, MSIX_VALIDATION_OPTION validation,
-        MSIX_APPLICABILITY_OPTIONS applicabilityFlags, const ComPtr<IStorageObject>& container) :
+        MSIX_APPLICABILITY_OPTIONS applicabilityFlags, const ComPtr<IStorageObject>& container, const std::string& fileIdentity) :
         m_factory(factory),
         m_validation(validation),
         m_container(container)
@@ -69,7 +92,8 @@ namespace MSIX {
         if ((validation & MSIX_VALIDATION_OPTION_SKIPSIGNATURE) == 0)
         {   ThrowErrorIfNot(Error::MissingAppxSignatureP7X, file, "AppxSignature.p7x not in archive!");
         }
-        m_appxSignature = ComPtr<IVerifierObject>::Make<AppxSignatureObject>(factory, validation, file);
+        auto verificationCache = VerificationCache::Create(factory, validation, fileIdentity);
+        m_appxSignature = ComPtr<IVerifierObject>::Make<AppxSignatureObject>(factory, validation, file, verificationCache.get(), m_container);
 
         // 2. Get content type using signature object for validation
         file = m_container->GetFile(CONTENT_TYPES_XML);
@@ -189,7 +213,8 @@ namespace MSIX {
         // 5. Ensure that the stream collection contains streams wired up for their appropriate validation
         // and partition the container's file names into footprint and payload files.  First by going through
         // the footprint files, and then by going through the payload files.
-        auto filesToProcess = m_container->GetFileNames(FileNameOptions::All);
+        auto allFileNames = m_container->GetFileNames(FileNameOptions::All);
+        std::set<std::string> filesToProcess(allFileNames.begin(), allFileNames.end());
         for (const auto& fileName : m_container->GetFileNames(FileNameOptions::FootPrintOnly))
         {   auto footPrintFile = std::find(std::begin(footPrintFileNames), std::end(footPrintFileNames), fileName);
             if (footPrintFile != std::end(footPrintFileNames))
@@ -199,18 +224,18 @@ namespace MSIX {
                     auto stream = footPrintFile->GetValidationStream(this);
                     if (fileName == CODEINTEGRITY_CAT)
                     {
-                        m_files[fileName] = MSIX::ComPtr<IAppxFile>::Make<MSIX::AppxFile>(m_factory.Get(), "AppxMetadata\\CodeIntegrity.cat", std::move(stream));;
+                        m_files.Add(fileName, "AppxMetadata\\CodeIntegrity.cat", MSIX::ComPtr<IAppxFile>::Make<MSIX::AppxFile>(m_factory.Get(), "AppxMetadata\\CodeIntegrity.cat", std::move(stream)));
                     }
                     else if (fileName == APPXBUNDLEMANIFEST_XML)
                     {
-                        m_files[fileName] = MSIX::ComPtr<IAppxFile>::Make<MSIX::AppxFile>(m_factory.Get(), "AppxMetadata\\AppxBundleManifest.xml", std::move(stream));;
+                        m_files.Add(fileName, "AppxMetadata\\AppxBundleManifest.xml", MSIX::ComPtr<IAppxFile>::Make<MSIX::AppxFile>(m_factory.Get(), "AppxMetadata\\AppxBundleManifest.xml", std::move(stream)));
                     }
                     else
                     {
-                        m_files[fileName] = MSIX::ComPtr<IAppxFile>::Make<MSIX::AppxFile>(m_factory.Get(), fileName, std::move(stream));;
+                        m_files.Add(fileName, fileName, MSIX::ComPtr<IAppxFile>::Make<MSIX::AppxFile>(m_factory.Get(), fileName, std::move(stream)));
                     }
                 }
-                filesToProcess.erase(std::remove(filesToProcess.begin(), filesToProcess.end(), fileName), filesToProcess.end());
+                filesToProcess.erase(fileName);
             }
         }
 
@@ -294,7 +319,7 @@ namespace MSIX {
                 
                 UINT64 size;
                 ThrowHrIfFailed(package->GetSize(&size));
-                ThrowErrorIf(Error::AppxManifestSemanticError, end.u.LowPart != size,
+                ThrowErrorIf(Error::AppxManifestSemanticError, end.QuadPart != size,
                     "Size mistmach of package between AppxManifestBundle.appx and container");
 
                 // Validate the package
@@ -335,7 +360,7 @@ namespace MSIX {
                 applicability.AddPackageIfApplicable(reader, packageName, bundleInfoInternal->GetLanguages(),
                     packageType, bundleInfoInternal->HasQualifiedResources());
 
-                m_files[packageName] = ComPtr<IAppxFile>::Make<MSIX::AppxFile>(m_factory.Get(), packageName, std::move(packageStream));
+                m_files.Add(packageName, packageName, ComPtr<IAppxFile>::Make<MSIX::AppxFile>(m_factory.Get(), packageName, std::move(packageStream)));
                 // Intentionally don't remove from fileToProcess. For bundles, it is possible to don't unpack packages, like
                 // resource packages that are not languages packages.
             }
@@ -345,19 +370,47 @@ namespace MSIX {
         else
         {
 #endif // BUNDLE_SUPPORT
+            // Payload files as named in the block map and in the container, in container order so their local
+            // headers are read front to back here, and so is their data by whoever enumerates them later.
+            std::vector<std::pair<std::string, std::string>> payloadFiles;
             for (const auto& fileName : blockMapFiles)
             {   auto footPrintFile = std::find(std::begin(footPrintFileNames), std::end(footPrintFileNames), fileName);
                 if (footPrintFile == std::end(footPrintFileNames))
                 {
-                    auto opcFileName = Encoding::EncodeFileName(fileName);
-                    m_payloadFiles.push_back(opcFileName);
-                    auto fileStream = m_container->GetFile(opcFileName);
-                    ThrowErrorIfNot(Error::FileNotFound, fileStream, "File described in blockmap not contained in OPC container");
-                    VerifyFile(fileStream, fileName, blockMapInternal);
-                    auto blockMapStream = m_appxBlockMap->GetValidationStream(fileName, fileStream);
-                    m_files[opcFileName] = MSIX::ComPtr<IAppxFile>::Make<MSIX::AppxFile>(m_factory.Get(), fileName, std::move(blockMapStream));
-                    filesToProcess.erase(std::remove(filesToProcess.begin(), filesToProcess.end(), opcFileName), filesToProcess.end());
+                    payloadFiles.emplace_back(fileName, Encoding::EncodeFileName(fileName));
+                }
+            }
+            auto containerOrder = GetContainerOrder(m_container);
+            std::stable_sort(payloadFiles.begin(), payloadFiles.end(), [&](const std::pair<std::string, std::string>& left, const std::pair<std::string, std::string>& right)
+            {
+                return GetContainerPosition(containerOrder, left.second) < GetContainerPosition(containerOrder, right.second);
+            });
+
+            // Deferred, a file's local header is only read, and checked against the block map, when the file is
+            // first used. What the central directory and the block map say is still checked here.
+            bool deferChecks = (m_validation & MSIX_VALIDATION_OPTION_DEFERPAYLOADCHECKS) != 0;
+            for (const auto& payloadFile : payloadFiles)
+            {
+                const auto& fileName = payloadFile.first;
+                const auto& opcFileName = payloadFile.second;
+                m_payloadFiles.push_back(opcFileName);
+                m_payloadBlockMapNames.push_back(fileName);
+                if (deferChecks)
+                {
+                    ThrowErrorIf(Error::FileNotFound, (containerOrder.find(opcFileName) == containerOrder.end()), "File described in blockmap not contained in OPC container");
+                    UINT64 size = 0;
+                    ThrowHrIfFailed(blockMapInternal->GetFile(fileName)->GetUncompressedSize(&size));
+                    auto container = m_container;
+                    auto blockMap = m_appxBlockMap;
+                    m_files.Add(opcFileName, fileName, MSIX::ComPtr<IAppxFile>::Make<MSIX::AppxFile>(m_factory.Get(), fileName, size,
+                        [container, blockMap, fileName, opcFileName]() { return OpenPayloadFile(container, blockMap, fileName, opcFileName); }));
                 }
+                else
+                {
+                    auto blockMapStream = OpenPayloadFile(m_container, m_appxBlockMap, fileName, opcFileName);
+                    m_files.Add(opcFileName, fileName, MSIX::ComPtr<IAppxFile>::Make<MSIX::AppxFile>(m_factory.Get(), fileName, std::move(blockMapStream)));
+                }
+                filesToProcess.erase(opcFileName);
             }
 
             // If the map is not empty, there's a file in the container that didn't go to the footprint or payload
@@ -368,6 +421,17 @@ namespace MSIX {
 #endif
     }
 
+    // Stream over a payload file that checks it against the block map as it is read, once the file in the container
+    // has been checked against the block map.
+    ComPtr<IStream> AppxPackageObject::OpenPayloadFile(const ComPtr<IStorageObject>& container, const ComPtr<IVerifierObject>& blockMap,
+        const std::string& fileName, const std::string& opcFileName)
+    {
+        auto fileStream = container->GetFile(opcFileName);
+        ThrowErrorIfNot(Error::FileNotFound, fileStream, "File described in blockmap not contained in OPC container");
+        VerifyFile(fileStream, fileName, blockMap.As<IAppxBlockMapInternal>());
+        return blockMap->GetValidationStream(fileName, fileStream);
+    }
+
     // Verify file in OPC and BlockMap
     void AppxPackageObject::VerifyFile(const ComPtr<IStream>& stream, const std::string& fileName, const ComPtr<IAppxBlockMapInternal>& blockMapInternal)
     {
@@ -417,37 +481,19 @@ namespace MSIX {
     }
 
     void AppxPackageObject::Unpack(MSIX_PACKUNPACK_OPTION options, const ComPtr<IStorageObject>& to)
-    {
+    {   // Footprint and payload files are extracted together in container order.
         auto fileNames = GetFileNames(FileNameOptions::All);
+        auto containerOrder = GetContainerOrder(m_container);
+        std::stable_sort(fileNames.begin(), fileNames.end(), [&](const std::string& left, const std::string& right)
+        {
+            return GetContainerPosition(containerOrder, left) < GetContainerPosition(containerOrder, right);
+        });
         for (const auto& fileName : fileNames)
         {   // Don't extract packages files
             auto file = std::find(std::begin(m_applicablePackagesNames), std::end(m_applicablePackagesNames), fileName);
             if (file == std::end(m_applicablePackagesNames))
             {
-                std::string targetName;
-                if (options & MSIX_PACKUNPACK_OPTION_CREATEPACKAGESUBFOLDER)
-                {   // Don't use to->GetPathSeparator(). DirectoryObject::OpenFile created directories
-                    // by looking at "/" in the string. If to->GetPathSeparator() is used the subfolder with
-                    // the package full name won't be created on Windows, but it will on other platforms.
-                    // This means that we have different behaviors in non-Win platforms.
-                    ComPtr<IAppxManifestPackageId> packageId;
-                    if (m_isBundle)
-                    {
-                        auto manifest = m_appxBundleManifest.As<IAppxBundleManifestReader>();
-                        ThrowHrIfFailed(manifest->GetPackageId(&packageId));
-                    }
-                    else
-                    {
-                        auto manifest = m_appxManifest.As<IAppxManifestReader>();
-                        ThrowHrIfFailed(manifest->GetPackageId(&packageId));
-                    }
-                    targetName = packageId.As<IAppxManifestPackageIdInternal>()->GetPackageFullName() + "/" + fileName;
-                }
-                else
-                {   targetName = Encoding::DecodeFileName(fileName);
-                }
-
-                auto targetFile = to->OpenFile(targetName, MSIX::FileStream::Mode::WRITE_UPDATE);
+                auto targetFile = to->OpenFile(GetTargetName(options, fileName), MSIX::FileStream::Mode::WRITE_UPDATE);
                 auto sourceFile = GetFile(fileName).As<IStream>();
 
                 ULARGE_INTEGER bytesCount = {0};
@@ -482,6 +528,73 @@ namespace MSIX {
 #endif
     }
 
+    std::string AppxPackageObject::GetTargetName(MSIX_PACKUNPACK_OPTION options, const std::string& fileName)
+    {
+        if (options & MSIX_PACKUNPACK_OPTION_CREATEPACKAGESUBFOLDER)
+        {   // Don't use to->GetPathSeparator(). DirectoryObject::OpenFile created directories
+            // by looking at "/" in the string. If to->GetPathSeparator() is used the subfolder with
+            // the package full name won't be created on Windows, but it will on other platforms.
+            // This means that we have different behaviors in non-Win platforms.
+            ComPtr<IAppxManifestPackageId> packageId;
+            if (m_isBundle)
+            {
+                auto manifest = m_appxBundleManifest.As<IAppxBundleManifestReader>();
+                ThrowHrIfFailed(manifest->GetPackageId(&packageId));
+            }
+            else
+            {
+                auto manifest = m_appxManifest.As<IAppxManifestReader>();
+                ThrowHrIfFailed(manifest->GetPackageId(&packageId));
+            }
+            return packageId.As<IAppxManifestPackageIdInternal>()->GetPackageFullName() + "/" + fileName;
+        }
+        else
+        {   // Decoded when the package was opened. Names that couldn't be decoded fail here, as before.
+            auto targetName = m_files.GetTargetName(fileName);
+            return (targetName != nullptr) ? *targetName : Encoding::DecodeFileName(fileName);
+        }
+    }
+
+    std::vector<PackageVerifier::File> AppxPackageObject::GetFilesToVerify()
+    {
+        std::vector<PackageVerifier::File> files;
+        if (m_isBundle)
+        {
+            for (std::size_t i = 0; i < m_applicablePackages.size(); i++)
+            {
+                auto packageFiles = m_applicablePackages[i].As<IPackage>()->GetFilesToVerify();
+                for (auto& file : packageFiles)
+                {
+                    file.name = m_applicablePackagesNames[i] + "/" + file.name;
+                    files.push_back(std::move(file));
+                }
+            }
+            return files;
+        }
+
+        auto blockMapInternal = m_appxBlockMap.As<IAppxBlockMapInternal>();
+        for (std::size_t i = 0; i < m_payloadFiles.size(); i++)
+        {
+            PackageVerifier::File file;
+            file.name = m_payloadBlockMapNames[i];
+            auto appxFile = GetAppxFile(m_payloadFiles[i]);
+            // With deferred checks this is where the file is checked against the block map, and fails on its own.
+            file.result = appxFile->GetStream(&file.checked);
+            if (FAILED(file.result))
+            {
+                files.push_back(std::move(file));
+                continue;
+            }
+            file.stream = m_container->GetFile(m_payloadFiles[i]);
+            UINT64 size = 0;
+            ThrowHrIfFailed(appxFile->GetSize(&size));
+            file.size = size;
+            file.blocks = blockMapInternal->GetBlocks(file.name);
+            files.push_back(std::move(file));
+        }
+        return files;
+    }
+
     // IStorageObject
     const char* AppxPackageObject::GetPathSeparator() { return "/"; }
 
@@ -517,12 +630,7 @@ namespace MSIX {
 
     ComPtr<IAppxFile> AppxPackageObject::GetAppxFile(const std::string& fileName)
     {
-        auto result = m_files.find(fileName);
-        if (result == m_files.end())
-        {
-            return ComPtr<IAppxFile>();
-        }
-        return result->second;
+        return m_files.FindByContainerName(fileName);
     }
 
     ComPtr<IStream> AppxPackageObject::OpenFile(const std::string& fileName, MSIX::FileStream::Mode mode) { NOTIMPLEMENTED; }
@@ -649,7 +757,7 @@ namespace MSIX {
     {
         if (m_isBundle) { return static_cast<HRESULT>(Error::PackageIsBundle); }
         ThrowErrorIf(Error::InvalidParameter, (fileName == nullptr || file == nullptr || *file != nullptr), "bad pointer");
-        auto result = GetAppxFile(Encoding::EncodeFileName(fileName));
+        auto result = m_files.FindByName(fileName);
         ThrowErrorIfNot(Error::FileNotFound, result, "requested file not in package")
         // Clients expect the stream's pointer to be at the start of the file!
         ComPtr<IStream> stream;
@@ -677,4 +785,52 @@ namespace MSIX {
             return static_cast<HRESULT>(MSIX::Error::NotSupported);
         #endif
     } CATCH_RETURN();
+
+    // IMsixPackageVerifier
+    HRESULT STDMETHODCALLTYPE AppxPackageObject::VerifyPackage(UINT32 threadCount, IMsixVerificationResults** results) noexcept try
+    {
+        ThrowErrorIf(Error::InvalidParameter, (results == nullptr || *results != nullptr), "bad pointer");
+        auto files = GetFilesToVerify();
+        PackageVerifier verifier(m_appxBlockMap.As<IAppxBlockMapInternal>()->GetThreadPool(), threadCount);
+        auto fileResults = verifier.Verify(files);
+        std::vector<std::string> names;
+        names.reserve(files.size());
+        for (const auto& file : files)
+        {
+            names.push_back(file.name);
+        }
+        *results = ComPtr<IMsixVerificationResults>::Make<VerificationResults>(m_factory.Get(), std::move(names), std::move(fileResults)).Detach();
+        return static_cast<HRESULT>(Error::OK);
+    } CATCH_RETURN();
+
+    // IMsixBlockCacheStatistics
+    HRESULT STDMETHODCALLTYPE AppxPackageObject::GetBlockCacheStatistics(UINT64* hits, UINT64* misses) noexcept try
+    {
+        ThrowErrorIf(Error::InvalidParameter, (hits == nullptr || misses == nullptr), "bad pointer");
+        *hits = 0;
+        *misses = 0;
+        if (m_isBundle)
+        {
+            for (const auto& package : m_applicablePackages)
+            {
+                UINT64 packageHits = 0;
+                UINT64 packageMisses = 0;
+                ThrowHrIfFailed(package.As<IMsixBlockCacheStatistics>()->GetBlockCacheStatistics(&packageHits, &packageMisses));
+                *hits += packageHits;
+                *misses += packageMisses;
+            }
+            return static_cast<HRESULT>(Error::OK);
+        }
+
+        auto cache = m_appxBlockMap.As<IAppxBlockMapInternal>()->GetBlockCache();
+        if (cache)
+        {
+            std::uint64_t cacheHits = 0;
+            std::uint64_t cacheMisses = 0;
+            cache->GetStatistics(cacheHits, cacheMisses);
+            *hits = cacheHits;
+            *misses = cacheMisses;
+        }
+        return static_cast<HRESULT>(Error::OK);
+    } CATCH_RETURN();
 }
\ No newline at end of file
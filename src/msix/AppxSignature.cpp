@@ -6,12 +6,16 @@
 #include "Exceptions.hpp"
 #include "StreamBase.hpp"
 #include "StorageObject.hpp"
+#include "ZipObject.hpp"
 #include "AppxSignature.hpp"
 #include "AppxPackaging.hpp"
 #include "HashStream.hpp"
 #include "ComHelper.hpp"
 #include "SignatureValidator.hpp"
 #include "BlockMapStream.hpp"
+#include "VerificationCache.hpp"
+#include "SHA256.hpp"
+#include "StreamHelper.hpp"
 
 #include <string>
 #include <vector>
@@ -21,6 +25,24 @@
 
 namespace MSIX {
 
+// Hash of the whole of AppxSignature.p7x, which is what the verification cache knows it by. Empty if it's too big
+// to be a signature, the validator rejects it.
+static std::vector<std::uint8_t> GetSignatureHash(const ComPtr<IStream>& stream)
+{
+    LARGE_INTEGER start = { 0 };
+    ULARGE_INTEGER end = { 0 };
+    ThrowHrIfFailed(stream->Seek(start, StreamBase::Reference::END, &end));
+    ThrowHrIfFailed(stream->Seek(start, StreamBase::Reference::START, nullptr));
+    std::vector<std::uint8_t> hash;
+    if (end.QuadPart == 0 || end.QuadPart > (2 << 20)) { return hash; }
+
+    std::vector<std::uint8_t> buffer(static_cast<std::size_t>(end.QuadPart));
+    Helper::ReadAll(stream, buffer.data(), buffer.size());
+    ThrowHrIfFailed(stream->Seek(start, StreamBase::Reference::START, nullptr));
+    ThrowErrorIfNot(Error::SignatureInvalid, SHA256::ComputeHash(buffer.data(), static_cast<std::uint32_t>(buffer.size()), hash), "Invalid signature");
+    return hash;
+}
+
 void AppxSignatureObject::ValidateDigestHeader(DigestHeader* header, std::size_t numberOfHashes, std::size_t modHashes)
 {
     ThrowErrorIf(Error::SignatureInvalid, (
@@ -65,10 +87,31 @@ void AppxSignatureObject::ValidateDigestHeader(DigestHeader* header, std::size_t
     ThrowErrorIf(Error::SignatureInvalid, (digestsFound != 4 && digestsFound != 5), "Digest hashes missing entries");
 }
 
-AppxSignatureObject::AppxSignatureObject(IMsixFactory* factory, MSIX_VALIDATION_OPTION validationOptions, const ComPtr<IStream>& stream) : 
+AppxSignatureObject::AppxSignatureObject(IMsixFactory* factory, MSIX_VALIDATION_OPTION validationOptions, const ComPtr<IStream>& stream, VerificationCache* cache,
+    const ComPtr<IStorageObject>& container) : 
     m_stream(stream), 
     m_validationOptions(validationOptions)
 {
+    std::vector<std::uint8_t> signatureHash;
+    if (cache && stream)
+    {   // The digests it kept are still checked against the parts they are for, so only the signature is taken on trust.
+        signatureHash = GetSignatureHash(stream);
+        VerificationCache::Entry entry;
+        if (!signatureHash.empty() && cache->Find(signatureHash, entry) && (entry.checks & VerificationCache::Check::Signature))
+        {
+            m_hasDigests       = entry.hasDigests;
+            m_FileRecords      = std::move(entry.fileRecords);
+            m_CentralDirectory = std::move(entry.centralDirectory);
+            m_ContentTypes     = std::move(entry.contentTypes);
+            m_AppxBlockMap     = std::move(entry.blockMap);
+            m_CodeIntegrity    = std::move(entry.codeIntegrity);
+            m_signatureOrigin  = entry.origin;
+            m_publisher        = std::move(entry.publisher);
+            ValidateArchive(container);
+            return;
+        }
+    }
+
     m_hasDigests = SignatureValidator::Validate(factory, validationOptions, stream, this, m_signatureOrigin, m_publisher);
 
     if (0 == (validationOptions & MSIX_VALIDATION_OPTION::MSIX_VALIDATION_OPTION_SKIPSIGNATURE))
@@ -76,6 +119,23 @@ AppxSignatureObject::AppxSignatureObject(IMsixFactory* factory, MSIX_VALIDATION_
         LARGE_INTEGER li{0};    
         ThrowHrIfFailed(stream->Seek(li, StreamBase::Reference::START, nullptr));
     }
+
+    ValidateArchive(container);
+
+    if (!signatureHash.empty())
+    {
+        VerificationCache::Entry entry;
+        entry.checks           = VerificationCache::Check::Signature;
+        entry.hasDigests       = m_hasDigests;
+        entry.fileRecords      = m_FileRecords;
+        entry.centralDirectory = m_CentralDirectory;
+        entry.contentTypes     = m_ContentTypes;
+        entry.blockMap         = m_AppxBlockMap;
+        entry.codeIntegrity    = m_CodeIntegrity;
+        entry.origin           = m_signatureOrigin;
+        entry.publisher        = m_publisher;
+        cache->Add(signatureHash, entry);
+    }
 }
 
 ComPtr<IStream>  AppxSignatureObject::GetValidationStream(const std::string& part, const ComPtr<IStream>& stream)
@@ -94,9 +154,21 @@ ComPtr<IStream>  AppxSignatureObject::GetValidationStream(const std::string& par
         {   // This stream implementation will throw if the underlying stream does not match the digest
             return ComPtr<IStream>::Make<HashStream>(stream, this->GetCodeIntegrityDigest());
         }
-        // TODO: unnamed stream for central directory?
     }
     return stream;
 }
 
+// The signature is the last file of the package, its digests are of the package as it was before it was added.
+void AppxSignatureObject::ValidateArchive(const ComPtr<IStorageObject>& container)
+{
+    if (!m_hasDigests || !container) { return; }
+    auto archive = container.TryAs<IZipArchive>();
+    if (!archive) { return; }
+
+    ThrowErrorIf(Error::SignatureInvalid, (archive->GetFileRecordsDigest("AppxSignature.p7x") != m_FileRecords),
+        "file records don't match their digest in the signature");
+    ThrowErrorIf(Error::SignatureInvalid, (archive->GetCentralDirectoryDigest("AppxSignature.p7x") != m_CentralDirectory),
+        "central directory doesn't match its digest in the signature");
+}
+
 } // namespace MSIX
@@ -0,0 +1,55 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#include "BlockCache.hpp"
+
+namespace MSIX {
+
+    BlockCache::BlockCache(std::uint64_t capacity) : m_capacity(capacity)
+    {
+    }
+
+    BlockCache::Data BlockCache::Find(std::size_t file, std::size_t block)
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        auto item = m_index.find({ file, block });
+        if (item == m_index.end())
+        {
+            m_misses++;
+            return nullptr;
+        }
+        m_hits++;
+        m_entries.splice(m_entries.begin(), m_entries, item->second);
+        return item->second->second;
+    }
+
+    void BlockCache::Add(std::size_t file, std::size_t block, const Data& data)
+    {
+        if (!data || data->size() > m_capacity) { return; }
+
+        std::lock_guard<std::mutex> guard(m_lock);
+        Key key = { file, block };
+        if (m_index.find(key) != m_index.end())
+        {   // Another stream read it at the same time.
+            return;
+        }
+        m_entries.emplace_front(key, data);
+        m_index[key] = m_entries.begin();
+        m_size += data->size();
+        while (m_size > m_capacity)
+        {
+            auto& last = m_entries.back();
+            m_size -= last.second->size();
+            m_index.erase(last.first);
+            m_entries.pop_back();
+        }
+    }
+
+    void BlockCache::GetStatistics(std::uint64_t& hits, std::uint64_t& misses)
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        hits = m_hits;
+        misses = m_misses;
+    }
+}
@@ -0,0 +1,125 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#include "BlockDeflater.hpp"
+#include "ICompressionObject.hpp"
+#include "Exceptions.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+namespace MSIX {
+
+    namespace {
+        // BLOCKMAP_BLOCK_SIZE, without BlockMapStream.hpp and the stream headers it brings in.
+        const std::uint64_t BlockSize = 65536;
+
+        // Compresses the input set on compressor into output, growing it as needed.
+        void Compress(ICompressionObject* compressor, CompressionFlush flush, std::vector<std::uint8_t>& output)
+        {
+            std::size_t produced = 0;
+            for (;;)
+            {
+                compressor->SetOutput(output.data() + produced, output.size() - produced);
+                ThrowErrorIf(Error::Unexpected, (compressor->Deflate(flush) == CompressionStatus::Error), "deflate failed");
+                produced = output.size() - compressor->GetAvailableDestinationSize();
+                if (produced < output.size()) { break; }
+                output.resize(output.size() * 2);
+            }
+            output.resize(produced);
+        }
+    }
+
+    BlockDeflater::BlockDeflater(std::size_t threads) :
+        m_threads((threads != 0) ? threads : std::max(1u, std::thread::hardware_concurrency()))
+    {
+    }
+
+    void BlockDeflater::Deflate(const std::uint8_t* data, std::uint64_t size, std::vector<std::uint8_t>& compressed, std::vector<std::uint32_t>& blockSizes)
+    {
+        auto count = static_cast<std::size_t>((size + BlockSize - 1) / BlockSize);
+        std::vector<std::vector<std::uint8_t>> outputs(count);
+        blockSizes.assign(count, 0);
+
+        // Every block starts from a reset compressor, which is what makes the output independent of which
+        // thread compressed it.
+        std::atomic<std::size_t> next(0);
+        std::atomic<bool> stop(false);
+        std::mutex errorLock;
+        std::exception_ptr error;
+
+        auto worker = [&]()
+        {
+            std::unique_ptr<ICompressionObject> compressor;
+            try
+            {
+                compressor = CreateCompressionObject();
+                ThrowErrorIf(Error::Unexpected, (compressor->Initialize(CompressionOperation::Deflate) != CompressionStatus::Ok), "deflate initialize failed");
+                for (auto i = next++; i < count && !stop; i = next++)
+                {
+                    auto offset = static_cast<std::uint64_t>(i) * BlockSize;
+                    auto blockSize = static_cast<std::size_t>(std::min<std::uint64_t>(BlockSize, size - offset));
+                    ThrowErrorIf(Error::Unexpected, (compressor->Reset() != CompressionStatus::Ok), "deflate reset failed");
+                    compressor->SetInput(const_cast<std::uint8_t*>(data + offset), blockSize);
+                    outputs[i].resize(blockSize + blockSize / 8 + 64);
+                    Compress(compressor.get(), CompressionFlush::Full, outputs[i]);
+                    blockSizes[i] = static_cast<std::uint32_t>(outputs[i].size());
+                }
+                compressor->Cleanup();
+            }
+            catch (...)
+            {
+                if (compressor) { compressor->Cleanup(); }
+                std::lock_guard<std::mutex> lock(errorLock);
+                if (!error) { error = std::current_exception(); }
+                stop = true;
+            }
+        };
+
+        // This thread is one of the workers.
+        auto threadCount = std::min(m_threads, std::max(count, std::size_t(1)));
+        std::vector<std::thread> threads;
+        for (std::size_t i = 1; i < threadCount; i++)
+        {
+            try
+            {
+                threads.emplace_back(worker);
+            }
+            catch (const std::system_error&)
+            {   // Make do with the threads we have.
+                break;
+            }
+        }
+        worker();
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        if (error) { std::rethrow_exception(error); }
+
+        // After the last full flush, finishing a stream with no more input writes an empty final block, 03 00.
+        std::vector<std::uint8_t> end(16);
+        {
+            auto compressor = CreateCompressionObject();
+            ThrowErrorIf(Error::Unexpected, (compressor->Initialize(CompressionOperation::Deflate) != CompressionStatus::Ok), "deflate initialize failed");
+            compressor->SetInput(nullptr, 0);
+            Compress(compressor.get(), CompressionFlush::Finish, end);
+            compressor->Cleanup();
+        }
+
+        std::size_t total = end.size();
+        for (const auto& output : outputs) { total += output.size(); }
+        compressed.clear();
+        compressed.reserve(total);
+        for (const auto& output : outputs)
+        {
+            compressed.insert(compressed.end(), output.begin(), output.end());
+        }
+        compressed.insert(compressed.end(), end.begin(), end.end());
+    }
+}
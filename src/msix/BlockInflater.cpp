@@ -0,0 +1,138 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#include "BlockInflater.hpp"
+#include "BlockMapStream.hpp"
+#include "ICompressionObject.hpp"
+#include "Exceptions.hpp"
+#include "SHA256.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+namespace MSIX {
+
+    // Runs of at least this many blocks are inflated on several threads.
+    const std::size_t ParallelBlocks = 4;
+
+    BlockInflater::BlockInflater(const ComPtr<IStream>& compressed, const std::vector<Block>& blocks, std::uint64_t size,
+        std::shared_ptr<ThreadPool> threads) :
+        m_compressed(compressed), m_threadPool(std::move(threads))
+    {
+        std::uint64_t compressedOffset = 0;
+        for (std::size_t i = 0; i < blocks.size() && (i * BLOCKMAP_BLOCK_SIZE) < size; i++)
+        {
+            auto blockSize = static_cast<std::uint32_t>(std::min(BLOCKMAP_BLOCK_SIZE, size - i * BLOCKMAP_BLOCK_SIZE));
+            m_blocks.push_back({ compressedOffset, blocks[i].compressedSize, blockSize, &blocks[i].hash });
+            compressedOffset += blocks[i].compressedSize;
+        }
+    }
+
+    std::uint64_t BlockInflater::Inflate(std::size_t first, std::size_t count, std::uint8_t* output)
+    {
+        ThrowErrorIf(Error::InvalidParameter, (first > m_blocks.size() || count > m_blocks.size() - first), "blocks out of range");
+        if (count == 0) { return 0; }
+
+        // The compressed bytes of the whole run are next to each other, get them in one go.
+        auto begin = m_blocks[first].compressedOffset;
+        auto end = m_blocks[first + count - 1].compressedOffset + m_blocks[first + count - 1].compressedSize;
+        auto view = m_compressed.TryAs<IStreamView>();
+        const std::uint8_t* compressed = view ? view->GetView(begin, end - begin) : nullptr;
+        if (compressed == nullptr)
+        {
+            ThrowErrorIf(Error::FileRead, (end - begin > std::numeric_limits<ULONG>::max()), "run of blocks too big");
+            m_buffer.resize(static_cast<std::size_t>(end - begin));
+            LARGE_INTEGER start = { 0 };
+            start.QuadPart = static_cast<LONGLONG>(begin);
+            ThrowHrIfFailed(m_compressed->Seek(start, StreamBase::START, nullptr));
+            ULONG read = 0;
+            ThrowHrIfFailed(m_compressed->Read(m_buffer.data(), static_cast<ULONG>(m_buffer.size()), &read));
+            ThrowErrorIf(Error::FileRead, (read != m_buffer.size()), "compressed blocks cut short");
+            compressed = m_buffer.data();
+        }
+
+        // One thread for a few blocks, otherwise one per core. This thread is one of them.
+        auto threadCount = (count < ParallelBlocks || !m_threadPool) ? 1 :
+            std::min(static_cast<std::size_t>(std::max(1u, std::thread::hardware_concurrency())), count);
+
+        // Blocks are handed out in groups, whose hashes are computed together, as long as that leaves every
+        // thread something to do. They are handed out in order, so when one fails every block before it was
+        // already taken and will be finished. The good output is everything before the first block that failed.
+        auto group = std::max(static_cast<std::size_t>(1), std::min(BLOCKMAP_HASH_GROUP, count / threadCount));
+        std::atomic<std::size_t> next(0);
+        std::atomic<std::size_t> failed(count);
+        std::mutex errorLock;
+        std::exception_ptr error;
+
+        auto worker = [&]()
+        {
+            try
+            {
+                auto inflater = CreateCompressionObject();
+                std::vector<SHA256::Buffer> buffers(group);
+                std::vector<std::vector<std::uint8_t>> hashes(group);
+                for (auto i = next.fetch_add(group); i < count && i < failed; i = next.fetch_add(group))
+                {
+                    // Inflate the group up to the first block that can't be, then check the ones that could.
+                    auto end = std::min(count, i + group);
+                    auto bad = i;
+                    for (; bad < end; bad++)
+                    {
+                        const auto& block = m_blocks[first + bad];
+                        std::uint8_t* blockOutput = output + bad * BLOCKMAP_BLOCK_SIZE;
+                        if (inflater->DecompressBlock(compressed + (block.compressedOffset - begin), static_cast<std::size_t>(block.compressedSize),
+                                blockOutput, block.size) != CompressionStatus::Ok)
+                        {
+                            break;
+                        }
+                        buffers[bad - i] = { blockOutput, block.size };
+                    }
+                    SHA256::ComputeHashes(buffers.data(), bad - i, hashes.data());
+                    for (std::size_t j = i; j < bad; j++)
+                    {
+                        const auto& hash = hashes[j - i];
+                        if ((hash.size() != m_blocks[first + j].hash->size()) || (memcmp(hash.data(), m_blocks[first + j].hash->data(), hash.size()) != 0))
+                        {
+                            bad = j;
+                            break;
+                        }
+                    }
+                    if (bad < end)
+                    {
+                        auto lowest = failed.load();
+                        while (bad < lowest && !failed.compare_exchange_weak(lowest, bad)) {}
+                    }
+                }
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(errorLock);
+                if (!error) { error = std::current_exception(); }
+                failed = 0;
+            }
+        };
+
+        if (m_threadPool)
+        {
+            m_threadPool->Run(threadCount, worker);
+        }
+        else
+        {
+            worker();
+        }
+        if (error) { std::rethrow_exception(error); }
+
+        std::uint64_t good = 0;
+        for (std::size_t i = 0; i < failed; i++)
+        {
+            good += m_blocks[first + i].size;
+        }
+        return good;
+    }
+}
@@ -0,0 +1,247 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#include "Crc32.hpp"
+
+#include <array>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CRC32_CLMUL 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+// GCC and clang only let intrinsics be used in functions compiled for the instruction set they need.
+#if defined(CRC32_CLMUL) && !defined(_MSC_VER)
+#define CRC32_TARGET_CLMUL __attribute__((target("pclmul,sse4.1")))
+#else
+#define CRC32_TARGET_CLMUL
+#endif
+
+namespace MSIX {
+
+    namespace {
+
+        typedef std::uint32_t(*Crc32Kernel)(std::uint32_t crc, const std::uint8_t* buffer, std::size_t size);
+
+        typedef std::array<std::array<std::uint32_t, 256>, 8> Crc32Tables;
+
+        // tables[0] is the usual byte at a time table. tables[n] advances the crc of a byte over n more zero bytes.
+        const Crc32Tables& GetTables() noexcept
+        {
+            static const Crc32Tables tables = []()
+            {
+                Crc32Tables result;
+                for (std::uint32_t i = 0; i < 256; i++)
+                {
+                    std::uint32_t value = i;
+                    for (int bit = 0; bit < 8; bit++)
+                    {
+                        value = (value & 1) ? (0xEDB88320 ^ (value >> 1)) : (value >> 1);
+                    }
+                    result[0][i] = value;
+                }
+                for (std::size_t n = 1; n < result.size(); n++)
+                {
+                    for (std::uint32_t i = 0; i < 256; i++)
+                    {
+                        result[n][i] = (result[n - 1][i] >> 8) ^ result[0][result[n - 1][i] & 0xFF];
+                    }
+                }
+                return result;
+            }();
+            return tables;
+        }
+
+        // Slice-by-8. Works on any processor and does 8 bytes per step with independent table lookups.
+        std::uint32_t UpdateSliceBy8(std::uint32_t crc, const std::uint8_t* buffer, std::size_t size) noexcept
+        {
+            const auto& t = GetTables();
+            while (size >= 8)
+            {
+                std::uint32_t low = crc ^ (static_cast<std::uint32_t>(buffer[0]) | (static_cast<std::uint32_t>(buffer[1]) << 8) |
+                    (static_cast<std::uint32_t>(buffer[2]) << 16) | (static_cast<std::uint32_t>(buffer[3]) << 24));
+                std::uint32_t high = static_cast<std::uint32_t>(buffer[4]) | (static_cast<std::uint32_t>(buffer[5]) << 8) |
+                    (static_cast<std::uint32_t>(buffer[6]) << 16) | (static_cast<std::uint32_t>(buffer[7]) << 24);
+                crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+                      t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^ t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+                buffer += 8;
+                size -= 8;
+            }
+            while (size-- > 0)
+            {
+                crc = t[0][(crc ^ *buffer++) & 0xFF] ^ (crc >> 8);
+            }
+            return crc;
+        }
+
+#if defined(CRC32_CLMUL)
+        bool SupportsClmul() noexcept
+        {
+            // CPUID leaf 1, ECX: bit 1 is PCLMULQDQ, bit 19 is SSE4.1
+            unsigned int ecx = 0;
+#ifdef _MSC_VER
+            int info[4] = {};
+            __cpuid(info, 1);
+            ecx = static_cast<unsigned int>(info[2]);
+#else
+            unsigned int eax = 0, ebx = 0, edx = 0;
+            if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) { return false; }
+#endif
+            return ((ecx & (1u << 1)) != 0) && ((ecx & (1u << 19)) != 0);
+        }
+
+        // Folds 64 bytes at a time with carry-less multiplies, then reduces to 32 bits with Barrett reduction.
+        // See Intel's "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction". The constants
+        // are the ones for the reflected 0xEDB88320 polynomial. size must be at least 64 and a multiple of 16.
+        CRC32_TARGET_CLMUL std::uint32_t FoldClmul(std::uint32_t crc, const std::uint8_t* buffer, std::size_t size) noexcept
+        {
+            alignas(16) static const std::uint64_t k1k2[] = { 0x0154442bd4, 0x01c6e41596 };
+            alignas(16) static const std::uint64_t k3k4[] = { 0x01751997d0, 0x00ccaa009e };
+            alignas(16) static const std::uint64_t k5k0[] = { 0x0163cd6124, 0x0000000000 };
+            alignas(16) static const std::uint64_t poly[] = { 0x01db710641, 0x01f7011641 };
+
+            __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+            x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + 0x00));
+            x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + 0x10));
+            x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + 0x20));
+            x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + 0x30));
+            x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+            x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+            buffer += 64;
+            size -= 64;
+
+            // Four 128 bit lanes folded in parallel.
+            while (size >= 64)
+            {
+                x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+                x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+                x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+                x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+                x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+                x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+                x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+                x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+                y5 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + 0x00));
+                y6 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + 0x10));
+                y7 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + 0x20));
+                y8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + 0x30));
+                x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+                x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+                x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+                x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+                buffer += 64;
+                size -= 64;
+            }
+
+            // Fold the four lanes into one.
+            x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+            x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+            x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+            x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+            x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+            x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+            x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+            x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+            x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+            x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+            // Whatever 16 byte blocks are left.
+            while (size >= 16)
+            {
+                x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer));
+                x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+                x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+                x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+                buffer += 16;
+                size -= 16;
+            }
+
+            // 128 bits to 64 bits.
+            x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+            x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+            x1 = _mm_srli_si128(x1, 8);
+            x1 = _mm_xor_si128(x1, x2);
+            x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+            x2 = _mm_srli_si128(x1, 4);
+            x1 = _mm_and_si128(x1, x3);
+            x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+            x1 = _mm_xor_si128(x1, x2);
+
+            // Barrett reduction to 32 bits.
+            x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+            x2 = _mm_and_si128(x1, x3);
+            x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+            x2 = _mm_and_si128(x2, x3);
+            x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+            x1 = _mm_xor_si128(x1, x2);
+            return static_cast<std::uint32_t>(_mm_extract_epi32(x1, 1));
+        }
+
+        std::uint32_t UpdateClmul(std::uint32_t crc, const std::uint8_t* buffer, std::size_t size) noexcept
+        {
+            if (size >= 64)
+            {
+                auto folded = size & ~static_cast<std::size_t>(15);
+                crc = FoldClmul(crc, buffer, folded);
+                buffer += folded;
+                size -= folded;
+            }
+            return UpdateSliceBy8(crc, buffer, size);
+        }
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+        // ARMv8 has instructions for this very polynomial.
+        std::uint32_t UpdateArmCrc(std::uint32_t crc, const std::uint8_t* buffer, std::size_t size) noexcept
+        {
+            while (size >= 8)
+            {
+                std::uint64_t value;
+                std::memcpy(&value, buffer, sizeof(value));
+                crc = __crc32d(crc, value);
+                buffer += 8;
+                size -= 8;
+            }
+            while (size-- > 0)
+            {
+                crc = __crc32b(crc, *buffer++);
+            }
+            return crc;
+        }
+#endif
+
+        Crc32Kernel SelectKernel() noexcept
+        {
+#if defined(__ARM_FEATURE_CRC32)
+            return UpdateArmCrc;
+#else
+#if defined(CRC32_CLMUL)
+            if (SupportsClmul())
+            {
+                return UpdateClmul;
+            }
+#endif
+            return UpdateSliceBy8;
+#endif
+        }
+    }
+
+    void Crc32::Update(const std::uint8_t* buffer, std::size_t size) noexcept
+    {
+        static const Crc32Kernel kernel = SelectKernel();
+        m_value = kernel(m_value, buffer, size);
+    }
+}
@@ -0,0 +1,189 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#include "FileNameIndex.hpp"
+#include "Exceptions.hpp"
+#include "Encoding.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace MSIX {
+
+    namespace {
+        // Characters as they are compared for each kind of key.
+        inline char Normalize(bool separators, bool fold, char c)
+        {
+            if (separators && c == '\\') { return '/'; }
+            if (fold && c >= 'A' && c <= 'Z') { return static_cast<char>(c - 'A' + 'a'); }
+            return c;
+        }
+
+        // FNV-1a
+        inline std::uint64_t Hash(bool separators, bool fold, const char* name, std::size_t length)
+        {
+            std::uint64_t hash = 0xcbf29ce484222325ull;
+            for (std::size_t i = 0; i < length; i++)
+            {
+                hash = (hash ^ static_cast<std::uint8_t>(Normalize(separators, fold, name[i]))) * 0x100000001b3ull;
+            }
+            return hash;
+        }
+
+        inline bool Equal(bool separators, bool fold, const char* left, std::size_t leftLength, const char* right, std::size_t rightLength)
+        {
+            if (leftLength != rightLength) { return false; }
+            for (std::size_t i = 0; i < leftLength; i++)
+            {
+                if (Normalize(separators, fold, left[i]) != Normalize(separators, fold, right[i])) { return false; }
+            }
+            return true;
+        }
+    }
+
+    const std::uint32_t FileNameIndex::Empty;
+
+    void FileNameIndex::Add(const std::string& containerName, const std::string& name, const ComPtr<IAppxFile>& file)
+    {
+        auto existing = Find(Key::ContainerName, containerName.data(), containerName.size());
+        if (existing != Empty)
+        {
+            m_entries[existing].file = file;
+            return;
+        }
+
+        Entry entry;
+        entry.containerName = m_strings.size();
+        entry.containerNameLength = containerName.size();
+        m_strings += containerName;
+        entry.name = m_strings.size();
+        entry.nameLength = name.size();
+        m_strings += name;
+        // Only percent encoded names change when decoded. If the name can't be decoded, unpacking it fails
+        // as it always did, but it can still be read.
+        entry.hasTargetName = true;
+        if (containerName.find('%') != std::string::npos)
+        {
+            try
+            {
+                entry.targetName = Encoding::DecodeFileName(containerName);
+            }
+            catch (const Exception&)
+            {
+                entry.hasTargetName = false;
+            }
+        }
+        entry.file = file;
+        m_entries.push_back(std::move(entry));
+
+        ThrowErrorIf(Error::Unexpected, (m_entries.size() >= Empty), "too many files");
+        if (m_entries.size() * 2 > m_byContainerName.size())
+        {
+            Rehash(std::max<std::size_t>(16, m_byContainerName.size() * 2));
+        }
+        else
+        {
+            auto id = static_cast<std::uint32_t>(m_entries.size() - 1);
+            Insert(Key::ContainerName, id);
+            Insert(Key::Name, id);
+            Insert(Key::FoldedName, id);
+        }
+    }
+
+    ComPtr<IAppxFile> FileNameIndex::FindByContainerName(const std::string& containerName) const
+    {
+        auto id = Find(Key::ContainerName, containerName.data(), containerName.size());
+        return (id == Empty) ? ComPtr<IAppxFile>() : m_entries[id].file;
+    }
+
+    ComPtr<IAppxFile> FileNameIndex::FindByName(const char* name) const
+    {
+        auto length = std::strlen(name);
+        auto id = Find(Key::Name, name, length);
+        if (id == Empty) { id = Find(Key::FoldedName, name, length); }
+        return (id == Empty) ? ComPtr<IAppxFile>() : m_entries[id].file;
+    }
+
+    const std::string* FileNameIndex::GetTargetName(const std::string& containerName) const
+    {
+        auto id = Find(Key::ContainerName, containerName.data(), containerName.size());
+        if (id == Empty || !m_entries[id].hasTargetName) { return nullptr; }
+        const auto& entry = m_entries[id];
+        // Names that don't change when decoded aren't stored twice.
+        return entry.targetName.empty() ? &containerName : &entry.targetName;
+    }
+
+    std::uint32_t FileNameIndex::Find(Key key, const char* name, std::size_t length) const
+    {
+        const auto& table = GetTable(key);
+        if (table.empty()) { return Empty; }
+        bool separators = (key != Key::ContainerName);
+        bool fold = (key == Key::FoldedName);
+        auto mask = table.size() - 1;
+        for (auto slot = static_cast<std::size_t>(Hash(separators, fold, name, length)) & mask; table[slot] != Empty; slot = (slot + 1) & mask)
+        {
+            const char* candidate = nullptr;
+            std::size_t candidateLength = 0;
+            GetName(key, m_entries[table[slot]], &candidate, &candidateLength);
+            if (Equal(separators, fold, name, length, candidate, candidateLength)) { return table[slot]; }
+        }
+        return Empty;
+    }
+
+    // The first file with a name wins, later ones can only be found by their container name.
+    void FileNameIndex::Insert(Key key, std::uint32_t id)
+    {
+        const char* name = nullptr;
+        std::size_t length = 0;
+        GetName(key, m_entries[id], &name, &length);
+        if (Find(key, name, length) != Empty) { return; }
+
+        auto& table = GetTable(key);
+        auto mask = table.size() - 1;
+        auto slot = static_cast<std::size_t>(Hash(key != Key::ContainerName, key == Key::FoldedName, name, length)) & mask;
+        while (table[slot] != Empty) { slot = (slot + 1) & mask; }
+        table[slot] = id;
+    }
+
+    void FileNameIndex::Rehash(std::size_t capacity)
+    {
+        for (auto key : { Key::ContainerName, Key::Name, Key::FoldedName })
+        {
+            GetTable(key).assign(capacity, Empty);
+            for (std::uint32_t id = 0; id < m_entries.size(); id++)
+            {
+                Insert(key, id);
+            }
+        }
+    }
+
+    std::vector<std::uint32_t>& FileNameIndex::GetTable(Key key)
+    {
+        return const_cast<std::vector<std::uint32_t>&>(static_cast<const FileNameIndex*>(this)->GetTable(key));
+    }
+
+    const std::vector<std::uint32_t>& FileNameIndex::GetTable(Key key) const
+    {
+        switch (key)
+        {
+        case Key::ContainerName: return m_byContainerName;
+        case Key::Name:          return m_byName;
+        default:                 return m_byFoldedName;
+        }
+    }
+
+    void FileNameIndex::GetName(Key key, const Entry& entry, const char** name, std::size_t* length) const
+    {
+        if (key == Key::ContainerName)
+        {
+            *name = m_strings.data() + entry.containerName;
+            *length = entry.containerNameLength;
+        }
+        else
+        {
+            *name = m_strings.data() + entry.name;
+            *length = entry.nameLength;
+        }
+    }
+}
@@ -31,11 +31,26 @@ namespace MSIX {
         // State::UNINITIALIZED
         InflateHandler([](InflateStream* self, void*, ULONG)
         {
-            ThrowHrIfFailed(self->m_stream->Seek({0}, StreamBase::START, nullptr));
-            self->m_fileCurrentPosition = 0;
-            self->m_fileCurrentWindowPositionEnd = 0;
+            // Start at the closest sync point before where the caller wants to read.
+            auto syncPoint = self->GetSyncPoint(self->m_seekPosition);
+            LARGE_INTEGER start = { 0 };
+            start.QuadPart = static_cast<LONGLONG>(syncPoint.compressedPosition);
+            ThrowHrIfFailed(self->m_stream->Seek(start, StreamBase::START, nullptr));
+            self->m_inflateStartPosition = syncPoint.position;
+            self->m_fileCurrentPosition = syncPoint.position;
+            self->m_fileCurrentWindowPositionEnd = syncPoint.position;
+            self->m_inflateWindowPosition = 0;
+            self->m_inflateWindowSize = 0;
+            if (self->m_inflateWindow.empty())
+            {
+                self->m_compressedBuffer.resize(BufferSize);
+                self->m_inflateWindow.resize(BufferSize);
+            }
 
-            self->m_compressionStatus = self->m_compressionObject->Initialize(CompressionOperation::Inflate);
+            // Starting over after a seek back reuses the inflate state.
+            self->m_compressionStatus = self->m_compressionInitialized ?
+                self->m_compressionObject->Reset() : self->m_compressionObject->Initialize(CompressionOperation::Inflate);
+            self->m_compressionInitialized = true;
             ThrowErrorIfNot(Error::InflateInitialize, (self->m_compressionStatus == CompressionStatus::Ok), "compression_stream_init failed");
             return std::make_pair(true, InflateStream::State::READY_TO_READ);
         }), // State::UNINITIALIZED
@@ -45,32 +60,61 @@ namespace MSIX {
         {
             ThrowErrorIfNot(Error::InflateRead,(self->m_compressionObject->GetAvailableSourceSize() == 0), "uninflated bytes overwritten");
             ULONG available = 0;
-            self->m_compressedBuffer = std::make_unique<std::vector<std::uint8_t>>(BufferSize);
-            ThrowHrIfFailed(self->m_stream->Read(self->m_compressedBuffer->data(), static_cast<ULONG>(self->m_compressedBuffer->size()), &available));
+            ThrowHrIfFailed(self->m_stream->Read(self->m_compressedBuffer.data(), static_cast<ULONG>(self->m_compressedBuffer.size()), &available));
             ThrowErrorIf(Error::FileRead, (available == 0), "Getting nothing back is unexpected here.");
-            self->m_compressionObject->SetInput(self->m_compressedBuffer->data(), static_cast<size_t>(available));
+            self->m_compressionObject->SetInput(self->m_compressedBuffer.data(), static_cast<size_t>(available));
             return std::make_pair(true, InflateStream::State::READY_TO_INFLATE);
         }), // State::READY_TO_READ
 
         // State::READY_TO_INFLATE
-        InflateHandler([](InflateStream* self, void*, ULONG)
+        InflateHandler([](InflateStream* self, void* buffer, ULONG countBytes)
         {
-            self->m_inflateWindow = std::make_unique<std::vector<std::uint8_t>>(BufferSize);
-            self->m_inflateWindowPosition = 0;
-            self->m_compressionObject->SetOutput(self->m_inflateWindow->data(), self->m_inflateWindow->size());
+            // If everything inflated so far was already copied or skipped and the caller wants at least a
+            // window's worth, inflate straight into the caller's buffer.
+            bool direct = (self->m_fileCurrentWindowPositionEnd == self->m_seekPosition) && (countBytes >= BufferSize);
+            auto output = direct ? static_cast<std::uint8_t*>(buffer) : self->m_inflateWindow.data();
+            std::size_t outputSize = direct ? countBytes : BufferSize;
+            self->m_compressionObject->SetOutput(output, outputSize);
             self->m_compressionStatus = self->m_compressionObject->Inflate();
             switch (self->m_compressionStatus)
             {
             case CompressionStatus::Error:
+                if (self->m_inflateStartPosition != 0)
+                {   // What comes before the sync point is needed after all, the blocks weren't compressed on their
+                    // own. Forget about sync points and inflate from the start.
+                    self->m_syncPoints.clear();
+                    return std::make_pair(true, InflateStream::State::UNINITIALIZED);
+                }
                 self->Cleanup();
                 ThrowErrorIfNot(Error::InflateCorruptData, false, "inflate failed unexpectedly.");
                 break;
             case CompressionStatus::Ok:
             case CompressionStatus::End:
             default:
-                self->m_fileCurrentWindowPositionEnd += (BufferSize - self->m_compressionObject->GetAvailableDestinationSize());
+            {
+                auto produced = static_cast<ULONG>(outputSize - self->m_compressionObject->GetAvailableDestinationSize());
+                if (self->m_crcCheck)
+                {   // Only counts what extends the bytes checked from the start, so after jumping to a sync point the
+                    // file is checked only if it is read from the start later.
+                    self->m_crcCheck->Update(self->m_fileCurrentWindowPositionEnd, output, produced);
+                }
+                self->m_fileCurrentWindowPositionEnd += produced;
+                self->m_inflateWindowPosition = 0;
+                self->m_inflateWindowSize = direct ? 0 : produced;
+                if (direct)
+                {
+                    self->m_bytesRead           += produced;
+                    self->m_seekPosition        += produced;
+                    self->m_fileCurrentPosition  = self->m_fileCurrentWindowPositionEnd;
+                    if (self->m_fileCurrentPosition == self->m_uncompressedSize)
+                    {
+                        self->Cleanup();
+                        return std::make_pair(false, InflateStream::State::UNINITIALIZED);
+                    }
+                }
                 return std::make_pair(true, InflateStream::State::READY_TO_COPY);
             }
+            }
         }), // State::READY_TO_INFLATE
 
         // State::READY_TO_COPY
@@ -91,13 +135,12 @@ namespace MSIX {
             }
 
             // now that we're within the window between current file position and seek position
-            // calculate the number of bytes to skip ahead within this window
-            ULONG bytesToSkipInWindow = (ULONG)(self->m_seekPosition - self->m_fileCurrentPosition);
-            self->m_inflateWindowPosition += bytesToSkipInWindow;
+            // skip ahead within this window
+            self->m_inflateWindowPosition += static_cast<ULONG>(self->m_seekPosition - self->m_fileCurrentPosition);
+            self->m_fileCurrentPosition = self->m_seekPosition;
 
-            // Calculate the difference between the beginning of the window and the seek position.
             // if there's nothing left in the window to copy, then we need to fetch another window.
-            ULONG bytesRemainingInWindow = static_cast<ULONG>((BufferSize - self->m_compressionObject->GetAvailableDestinationSize()) - self->m_inflateWindowPosition);
+            ULONG bytesRemainingInWindow = self->m_inflateWindowSize - self->m_inflateWindowPosition;
             if (bytesRemainingInWindow == 0)
             {
                 return std::make_pair(true, (self->m_compressionObject->GetAvailableDestinationSize() == 0) ? InflateStream::State::READY_TO_INFLATE : InflateStream::State::READY_TO_READ);
@@ -106,7 +149,7 @@ namespace MSIX {
             ULONG bytesToCopy = std::min(countBytes, bytesRemainingInWindow);
             if (bytesToCopy > 0)
             {
-                memcpy(buffer, &(self->m_inflateWindow->at(self->m_inflateWindowPosition)), bytesToCopy);
+                memcpy(buffer, self->m_inflateWindow.data() + self->m_inflateWindowPosition, bytesToCopy);
                 self->m_bytesRead             += bytesToCopy;
                 self->m_seekPosition          += bytesToCopy;
                 self->m_inflateWindowPosition += bytesToCopy;
@@ -132,10 +175,11 @@ namespace MSIX {
     };
 
     InflateStream::InflateStream(
-        const ComPtr<IStream>& stream, std::uint64_t uncompressedSize
+        const ComPtr<IStream>& stream, std::uint64_t uncompressedSize, std::unique_ptr<Crc32Check> crcCheck
     ) : m_stream(stream),
         m_state(State::UNINITIALIZED),
-        m_uncompressedSize(uncompressedSize)
+        m_uncompressedSize(uncompressedSize),
+        m_crcCheck(std::move(crcCheck))
     {
         m_compressionObject = CreateCompressionObject();
     }
@@ -165,6 +209,25 @@ namespace MSIX {
         return static_cast<HRESULT>(Error::OK);
     } CATCH_RETURN();
 
+    HRESULT InflateStream::Clone(IStream** stream) noexcept try
+    {   // The clone gets its own source stream and starts inflating from the beginning when read.
+        ComPtr<IStream> source;
+        ThrowHrIfFailed(m_stream->Clone(&source));
+        auto clone = ComPtr<IStream>::Make<InflateStream>(source, m_uncompressedSize, m_crcCheck ? std::make_unique<Crc32Check>(*m_crcCheck) : nullptr);
+        clone.As<IStreamInternal>()->SetSyncPoints(m_syncPoints);
+        ReturnClone(clone, stream);
+        return static_cast<HRESULT>(Error::OK);
+    } CATCH_RETURN();
+
+    ComPtr<IStream> InflateStream::GetCompressedStream()
+    {   // A clone, so reading it doesn't move the source out from under us. None if the CRC is checked, the
+        // check only sees what this stream inflates, in order, so nothing may be inflated elsewhere.
+        if (m_crcCheck) { return ComPtr<IStream>(); }
+        ComPtr<IStream> source;
+        if (FAILED(m_stream->Clone(&source))) { return ComPtr<IStream>(); }
+        return source;
+    }
+
     HRESULT InflateStream::Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER *newPosition) noexcept try
     {
         LARGE_INTEGER seekPosition = { 0 };
@@ -188,27 +251,38 @@ namespace MSIX {
         {
             m_seekPosition = seekPosition.QuadPart;
             // If the caller is trying to seek back to an earlier
-            // point in the inflated stream, we will need to reset
-            // zlib and start inflating from the beginning of the
-            // stream; otherwise, seeking forward is fine: We will
-            // catch up to the seek pointer during the ::Read operation.
-            if (m_seekPosition < m_fileCurrentPosition)
+            // point in the inflated stream, or past a sync point that
+            // hasn't been inflated yet, we will need to reset zlib and
+            // start inflating from the closest sync point; otherwise,
+            // seeking forward is fine: We will catch up to the seek
+            // pointer during the ::Read operation.
+            if ((m_seekPosition < m_fileCurrentPosition) || (GetSyncPoint(m_seekPosition).position > m_fileCurrentWindowPositionEnd))
             {
                 m_fileCurrentPosition = 0;
-                Cleanup();
+                m_state = State::UNINITIALIZED;
             }
         }
         if (newPosition) { newPosition->QuadPart = m_seekPosition; }
         return static_cast<HRESULT>(Error::OK);
     } CATCH_RETURN();
 
+    SyncPoint InflateStream::GetSyncPoint(std::uint64_t position) const
+    {
+        auto next = std::upper_bound(m_syncPoints.begin(), m_syncPoints.end(), position, [](std::uint64_t value, const SyncPoint& point)
+        {
+            return value < point.position;
+        });
+        return (next == m_syncPoints.begin()) ? SyncPoint{ 0, 0 } : *(next - 1);
+    }
+
     void InflateStream::Cleanup()
     {
-        if (m_state != State::UNINITIALIZED)
+        if (m_compressionInitialized)
         {
             m_compressionObject->Cleanup();
-            m_state = State::UNINITIALIZED;
+            m_compressionInitialized = false;
         }
+        m_state = State::UNINITIALIZED;
     }
 } /* msix */
 
@@ -0,0 +1,35 @@
+//
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+//  MSIXResource.cpp is generated by CMake. Do not edit.
+//
+#include "MSIXResource.hpp"
+#include <vector>
+
+namespace MSIX {
+
+    namespace Resource {
+
+        // This represents a zip file that contains all the resources used 
+        // by this project.
+        const std::uint8_t resourceByte[resourceLength] = {0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x08, 0x00, 0x08, 0x00, 0xdc, 0x91, 0xbd, 0x4e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x64, 0x08, 0x00, 0x00, 0x1e, 0x00, 0x20, 0x00, 0x63, 0x65, 0x72, 0x74, 0x73, 0x2f, 0x62, 0x61, 0x73, 0x65, 0x36, 0x34, 0x5f, 0x4d, 0x53, 0x46, 0x54, 0x5f, 0x52, 0x43, 0x41, 0x5f, 0x32, 0x30, 0x31, 0x30, 0x2e, 0x63, 0x65, 0x72, 0x55, 0x54, 0x0d, 0x00, 0x07, 0x21, 0xcc, 0xee, 0x5c, 0x5d, 0xe2, 0xd2, 0x6a, 0x5a, 0xe2, 0xd2, 0x6a, 0x75, 0x78, 0x0b, 0x00, 0x01, 0x04, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x8d, 0x56, 0x49, 0xcf, 0xa3, 0x38, 0x10, 0xbd, 0x47, 0xe2, 0x3f, 0xcc, 0x3d, 0x6a, 0x05, 0x08, 0x24, 0x70, 0xb4, 0xd9, 0xc2, 0x9a, 0x98, 0xb0, 0xdf, 0x58, 0xc2, 0x16, 0x08, 0x01, 0x12, 0x0c, 0xfc, 0xfa, 0xa1, 0xbf, 0xbe, 0x8e, 0x5a, 0x63, 0xc9, 0xb2, 0x54, 0x65, 0xbb, 0xfc, 0xaa, 0x5e, 0x55, 0xf9, 0xd7, 0xaf, 0x6d, 0x40, 0x49, 0x51, 0xad, 0x7f, 0x04, 0xc9, 0x76, 0x54, 0x59, 0x15, 0x80, 0x23, 0xfd, 0x16, 0xfe, 0x22, 0x76, 0xa6, 0xaa, 0xca, 0x67, 0x47, 0x10, 0x00, 0xef, 0x17, 0x00, 0xab, 0x10, 0x14, 0x2a, 0xd2, 0x4d, 0x7c, 0xd2, 0x92, 0xfd, 0xc9, 0xd6, 0x67, 0xa9, 0x7d, 0x7f, 0xc2, 0x98, 0x34, 0xd9, 0xbe, 0x06, 0x16, 0x2c, 0x9e, 0x7d, 0xf9, 0xac, 0x14, 0x1e, 0x93, 0x10, 0xa0, 0x51, 0x06, 0xa2, 0x00, 0x89, 0x5d, 0x25, 0x4a, 0x86, 0x09, 0x9e, 0x0a, 0xa0, 0x5c, 0x09, 0x96, 0xa6, 0xe0, 0x79, 0xe6, 0x2c, 0xad, 0xc0, 0x86, 0x85, 0xe5, 0x6d, 0xd7, 0x39, 0x42, 0x93, 0x95, 0x29, 0x5d, 0xbe, 0x93, 0x36, 0x23, 0x13, 0x9a, 0x99, 0x25, 0x11, 0x5c, 0xff, 0xe8, 0x52, 0x07, 0x52, 0x5a, 0x43, 0xec, 0x22, 0x85, 0x9a, 0x92, 0x16, 0xcd, 0x97, 0x1a, 0xa4, 0x7f, 0x34, 0x9d, 0x23, 0xbb, 0xd4, 0x3b, 0x3c, 0x6a, 0x53, 0x4a, 0xf3, 0x6d, 0x26, 0x40, 0x31, 0x39, 0x6a, 0x78, 0x9b, 0x65, 0xa6, 0x34, 0x53, 0x52, 0x4b, 0x8b, 0x29, 0x82, 0x1f, 0x8b, 0x60, 0x36, 0xdf, 0xc4, 0xce, 0xf1, 0x9b, 0x3a, 0x6d, 0xf9, 0x35, 0xa1, 0x23, 0x52, 0x95, 0xb5, 0x29, 0x39, 0xa2, 0x02, 0xd1, 0xde, 0xb2, 0xed, 0x6e, 0x63, 0xdf, 0xda, 0x4e, 0xb9, 0x05, 0x0a, 0x3c, 0x32, 0x56, 0xf8, 0x25, 0x0e, 0x6c, 0x56, 0x15, 0x55, 0x6c, 0x3a, 0x00, 0x5f, 0xca, 0xd4, 0xfa, 0xbd, 0x12, 0x3b, 0xab, 0x56, 0x57, 0xb3, 0x96, 0x28, 0x6b, 0x55, 0x49, 0xff, 0xb7, 0x74, 0x75, 0xf1, 0x1f, 0x99, 0x8a, 0x2d, 0x11, 0xcc, 0x7e, 0x2d, 0xc0, 0xbf, 0x21, 0x25, 0x76, 0xff, 0x07, 0xeb, 0xdf, 0x90, 0x12, 0xbb, 0xff, 0x83, 0xf5, 0x6f, 0x48, 0x89, 0xdd, 0xdf, 0xb0, 0x16, 0x85, 0x5a, 0x99, 0x80, 0x54, 0x84, 0x7b, 0xaf, 0xdc, 0xd5, 0xe4, 0x28, 0x22, 0x69, 0x8b, 0xa2, 0x0b, 0x00, 0xa3, 0x0a, 0x22, 0xfe, 0xd1, 0xeb, 0xc4, 0x0e, 0x74, 0x1b, 0x3b, 0x90, 0xc0, 0x0a, 0x1a, 0xd3, 0xb1, 0x57, 0x67, 0x84, 0x4f, 0x16, 0xc5, 0x86, 0x05, 0xe7, 0x60, 0x1a, 0x86, 0x21, 0xbe, 0x0e, 0x8c, 0x72, 0x52, 0x9f, 0x28, 0x8f, 0x1c, 0xfb, 0xed, 0x18, 0x2c, 0x46, 0x30, 0x5f, 0xe4, 0xd7, 0x54, 0x3d, 0x72, 0x5a, 0x39, 0x23, 0x92, 0x25, 0x76, 0x3c, 0xfc, 0x76, 0x43, 0xa4, 0xa3, 0xcb, 0x38, 0xf2, 0x59, 0xc7, 0xc7, 0x74, 0xe2, 0xdb, 0x92, 0xc0, 0x70, 0x30, 0xa4, 0xf5, 0xe4, 0x6e, 0xbb, 0xec, 0x7c, 0xf8, 0x78, 0x3d, 0x2d, 0x7e, 0x64, 0x21, 0x95, 0x63, 0x37, 0xc8, 0xd4, 0x32, 0x52, 0x6f, 0x58, 0x9d, 0x43, 0x9b, 0x26, 0xe9, 0xda, 0x25, 0x76, 0xc9, 0x52, 0x32, 0x6b, 0xb3, 0x30, 0x1c, 0x25, 0x20, 0xfb, 0x76, 0xa8, 0x43, 0x6a, 0xbf, 0xef, 0xa2, 0x6e, 0x6c, 0x4a, 0x57, 0xa2, 0x8a, 0x7c, 0x7f, 0xe9, 0x50, 0xc9, 0x48, 0xea, 0x2c, 0xa5, 0xa8, 0xb3, 0xde, 0xce, 0xcd, 0xd5, 0xed, 0xea, 0x35, 0xbe, 0xfc, 0xfe, 0x28, 0x81, 0xb1, 0x19, 0x4d, 0x62, 0xc7, 0xbe, 0x13, 0x57, 0xa8, 0xee, 0x3e, 0x9f, 0x1f, 0x14, 0x2a, 0x49, 0x13, 0x8a, 0xfb, 0x1e, 0x55, 0x5f, 0x9f, 0xa4, 0xcf, 0x52, 0x06, 0x4e, 0x5e, 0x2b, 0xd3, 0x18, 0xdb, 0xef, 0x1a, 0xb4, 0x9c, 0xf8, 0x0a, 0x67, 0xae, 0x17, 0x34, 0x53, 0xc8, 0xcb, 0x8d, 0xe4, 0x93, 0x9e, 0x2b, 0xea, 0xeb, 0x49, 0xec, 0xd4, 0xce, 0xaf, 0xc6, 0xd0, 0x0e, 0xd0, 0xed, 0x40, 0x89, 0x9f, 0x72, 0x7a, 0x5d, 0x8f, 0x95, 0xed, 0x48, 0x70, 0xb5, 0xf3, 0x77, 0x7e, 0x16, 0xa0, 0xfd, 0xb8, 0xf6, 0xaa, 0x0b, 0xda, 0x2e, 0xd0, 0xfb, 0x37, 0xc9, 0x71, 0x00, 0x79, 0xfb, 0x73, 0x67, 0x85, 0xa3, 0xc7, 0x28, 0x21, 0xdb, 0x54, 0xc4, 0xee, 0x19, 0x54, 0xc2, 0x07, 0xd3, 0x8e, 0x28, 0xd8, 0xfd, 0x07, 0x4e, 0x89, 0xb6, 0x9f, 0xf3, 0x06, 0xa1, 0xc3, 0x93, 0xec, 0x30, 0x1f, 0xa5, 0xe1, 0x78, 0xca, 0x59, 0x25, 0x7e, 0x38, 0xe6, 0x4c, 0xc2, 0xc5, 0x1a, 0x2b, 0xb7, 0x59, 0x03, 0x2d, 0x6d, 0x94, 0x7d, 0x6c, 0x9c, 0x4b, 0xaa, 0x11, 0x89, 0xdd, 0xf4, 0xfe, 0x6c, 0x6f, 0x20, 0x3f, 0xe5, 0x13, 0xc5, 0x76, 0x3f, 0x33, 0x61, 0xc0, 0x60, 0x21, 0xef, 0xbf, 0x55, 0x6a, 0x43, 0xbd, 0xd2, 0x5a, 0xc0, 0x4a, 0xac, 0x1d, 0xad, 0x97, 0x0a, 0x2f, 0xdd, 0x52, 0x90, 0xd3, 0x9e, 0x32, 0x7a, 0xf1, 0x96, 0xd5, 0xe6, 0x72, 0xcd, 0x0e, 0x03, 0xc8, 0x89, 0xdd, 0xe0, 0xe7, 0xfe, 0x9b, 0x02, 0xe2, 0x5c, 0xd8, 0x38, 0x3c, 0xbb, 0xe3, 0x18, 0x46, 0x31, 0x3a, 0xe7, 0xe7, 0x61, 0x6a, 0xbe, 0xba, 0xcf, 0x94, 0xaa, 0x2b, 0xb5, 0xb0, 0x5b, 0x35, 0xbc, 0x3f, 0x61, 0xdc, 0xf9, 0x4e, 0x97, 0xb4, 0x32, 0xfd, 0x08, 0x97, 0x44, 0xfa, 0x98, 0x37, 0x3e, 0xca, 0x88, 0x5d, 0xb7, 0xf7, 0xa9, 0x57, 0x90, 0x8b, 0x2f, 0x13, 0x7a, 0x9f, 0x23, 0x02, 0xcc, 0xb9, 0x60, 0x7a, 0xe6, 0x1a, 0xb8, 0x57, 0x25, 0x46, 0x15, 0xca, 0xe6, 0x51, 0xa8, 0x4d, 0x4b, 0x8a, 0xfd, 0xb1, 0xbc, 0x5b, 0xb7, 0x6c, 0xe5, 0xd2, 0x34, 0xbc, 0xac, 0xd7, 0xcf, 0xe3, 0xbb, 0x1a, 0xc8, 0x17, 0xd7, 0xcd, 0x93, 0x2c, 0x2a, 0xf0, 0xb3, 0x94, 0x07, 0x79, 0xb6, 0xe7, 0xea, 0x04, 0xf0, 0x57, 0x3b, 0xca, 0x09, 0x2d, 0x97, 0x7b, 0x92, 0x7e, 0x45, 0xb1, 0x7d, 0x2e, 0x04, 0xaa, 0x3b, 0x8a, 0xe3, 0x6b, 0x7f, 0xb5, 0x0a, 0xa5, 0x12, 0xb3, 0xa1, 0x9f, 0x82, 0x00, 0xde, 0xd5, 0x32, 0xa9, 0xa2, 0xe9, 0x7b, 0x22, 0x76, 0x23, 0x17, 0x08, 0xfc, 0xca, 0x4c, 0xd9, 0x29, 0xd1, 0x8f, 0xa3, 0xd2, 0xce, 0xcf, 0xd2, 0xc4, 0x6b, 0x66, 0xab, 0xbc, 0xf9, 0xa2, 0xce, 0xe5, 0x35, 0xd5, 0x12, 0xdc, 0xb9, 0x36, 0x3d, 0x1c, 0xeb, 0x5b, 0xfb, 0x95, 0x5b, 0x09, 0xab, 0x22, 0x40, 0x00, 0x76, 0x94, 0x84, 0x9d, 0x15, 0x18, 0x5b, 0x6e, 0x6e, 0xb9, 0x76, 0x41, 0xdc, 0x46, 0x78, 0x53, 0x00, 0x61, 0x88, 0x45, 0x1c, 0x8a, 0x9e, 0x4d, 0x3a, 0x00, 0x5d, 0x0e, 0x10, 0xb8, 0x1b, 0xfb, 0x25, 0x78, 0x58, 0x41, 0xf6, 0x67, 0x1f, 0x23, 0xc9, 0x05, 0x72, 0xa9, 0x3c, 0xf2, 0x17, 0xe6, 0xd0, 0x75, 0xcd, 0xbc, 0x45, 0x33, 0xb6, 0x24, 0xbe, 0xd1, 0xe0, 0xc6, 0xa4, 0x53, 0xac, 0x98, 0x08, 0x4b, 0x20, 0xd4, 0x74, 0x1c, 0x42, 0x08, 0x14, 0xc1, 0x9a, 0x5d, 0xf8, 0x73, 0x33, 0x02, 0x58, 0x44, 0x9b, 0xbc, 0x8b, 0xd4, 0x72, 0x4a, 0x2d, 0x80, 0x24, 0x03, 0x22, 0x20, 0x6e, 0x99, 0xb5, 0xd5, 0x49, 0xa0, 0x2f, 0x4d, 0xd3, 0x2d, 0x87, 0xef, 0xe9, 0xd4, 0xf2, 0x9f, 0x6c, 0x2e, 0x49, 0x73, 0xf6, 0xba, 0x9a, 0xbf, 0x88, 0xda, 0xec, 0xaf, 0xfe, 0x91, 0xba, 0x09, 0x36, 0xd7, 0x73, 0x47, 0xa6, 0x74, 0x66, 0x0e, 0xab, 0x2d, 0x74, 0x18, 0x5f, 0xbe, 0x70, 0xee, 0x77, 0x28, 0x6f, 0x7b, 0xa6, 0x5d, 0x36, 0x3f, 0x7c, 0x73, 0x57, 0x48, 0xe7, 0xcf, 0xd7, 0x1b, 0xcf, 0x91, 0xe2, 0xe1, 0x68, 0xc8, 0x97, 0xd1, 0x1b, 0x72, 0xa5, 0x30, 0x56, 0xde, 0x53, 0x98, 0x88, 0xa6, 0x58, 0xee, 0xcc, 0xfb, 0x8f, 0xfd, 0x5d, 0xfa, 0xde, 0xc7, 0x47, 0x4b, 0x0a, 0xa9, 0x56, 0x3b, 0xec, 0xe6, 0xf6, 0x30, 0xce, 0x8a, 0x94, 0xd8, 0x51, 0xe7, 0xc4, 0x9e, 0x18, 0xbe, 0xc4, 0x6d, 0x2e, 0x7d, 0x1e, 0x7c, 0x81, 0x18, 0x06, 0x29, 0x6b, 0xa4, 0xb1, 0x82, 0xa8, 0x0f, 0x71, 0x0e, 0xc7, 0x7b, 0xd6, 0x08, 0x79, 0x6d, 0xf1, 0xde, 0xd8, 0x93, 0x2a, 0x5a, 0xb9, 0x3d, 0x97, 0x73, 0x93, 0x9f, 0x0a, 0x54, 0xe5, 0x58, 0x27, 0x48, 0x6d, 0x7c, 0xb0, 0xd8, 0xe5, 0xd8, 0xce, 0x94, 0xde, 0x86, 0x15, 0x1f, 0x62, 0xc5, 0x94, 0xe3, 0x1c, 0x19, 0x4f, 0xdc, 0x3f, 0xe1, 0x51, 0x0e, 0x8d, 0xa0, 0xda, 0xaf, 0x80, 0x3c, 0xeb, 0x7c, 0xc1, 0x79, 0x47, 0x11, 0x9e, 0xbe, 0xc3, 0xdc, 0x38, 0x9d, 0x44, 0xb1, 0x69, 0xc4, 0xdd, 0x86, 0x55, 0xbc, 0x6e, 0xd5, 0xfe, 0xf0, 0xf2, 0x0d, 0x13, 0x57, 0x28, 0xe8, 0x2e, 0xdc, 0x3b, 0x13, 0x14, 0x93, 0x8d, 0x1e, 0x36, 0xf4, 0x8e, 0x2d, 0x87, 0x58, 0xa3, 0x8e, 0x0b, 0x3a, 0x02, 0x72, 0xd1, 0x74, 0x2a, 0xf5, 0x0d, 0x8c, 0x2a, 0x8e, 0xc1, 0xf0, 0x09, 0x6a, 0xd3, 0x67, 0xbe, 0x6d, 0x53, 0x99, 0x9d, 0xa0, 0x11, 0xbb, 0x57, 0x7f, 0xe1, 0xb1, 0xa6, 0x71, 0x8f, 0x65, 0x5c, 0x95, 0x10, 0xf5, 0x21, 0xe7, 0x82, 0x58, 0x31, 0x4e, 0x2f, 0xf2, 0x61, 0xb5, 0xc1, 0x5b, 0xbe, 0xf6, 0xf9, 0xfb, 0xfc, 0x60, 0xdf, 0x68, 0x08, 0xd6, 0x22, 0xfa, 0x5c, 0xbc, 0x12, 0x9e, 0x0f, 0x17, 0x40, 0x97, 0xb0, 0x5c, 0x4f, 0xdf, 0xc3, 0x56, 0xa3, 0x1a, 0x92, 0x7e, 0x98, 0xcb, 0x2d, 0xd3, 0x8a, 0xef, 0x49, 0x1f, 0xd2, 0x83, 0x6d, 0x2d, 0xa2, 0x76, 0xd8, 0xf3, 0xa1, 0xf7, 0x1c, 0xa4, 0x24, 0xd7, 0x1d, 0x7e, 0x92, 0x2b, 0x8c, 0x53, 0x33, 0x66, 0x96, 0xfd, 0xad, 0x62, 0xd1, 0x94, 0x1d, 0x8e, 0x8a, 0x12, 0x67, 0x83, 0x1c, 0xc3, 0xab, 0x64, 0x13, 0xbb, 0x9b, 0x1f, 0xc9, 0x9f, 0xb9, 0x9c, 0xa7, 0xf1, 0xf9, 0x2c, 0xb3, 0x64, 0xa5, 0x8c, 0x37, 0xb4, 0x64, 0xf2, 0x6e, 0xdc, 0x7d, 0xb6, 0x8e, 0x43, 0xe7, 0xae, 0x50, 0xc6, 0x08, 0x32, 0xbe, 0x8d, 0x4c, 0x2d, 0x0c, 0x65, 0xd2, 0x5b, 0x62, 0xbd, 0xa7, 0x5f, 0x35, 0x6b, 0xbd, 0x2e, 0x95, 0x89, 0xb7, 0x0a, 0x43, 0x5f, 0xe7, 0xbb, 0x26, 0xe3, 0xc7, 0xa4, 0x49, 0x2e, 0xf3, 0x4e, 0x1e, 0x27, 0x3c, 0xc4, 0xaf, 0x0f, 0x95, 0x8f, 0x5b, 0x8b, 0xa0, 0x54, 0x63, 0x9c, 0x2b, 0x88, 0xca, 0xc5, 0x03, 0xd7, 0x69, 0xba, 0x9c, 0xc7, 0xe3, 0xde, 0xdc, 0x7b, 0x5f, 0xcc, 0x20, 0xcd, 0x43, 0x66, 0x73, 0x4d, 0xc5, 0xad, 0xeb, 0x59, 0x1e, 0xd5, 0x98, 0x71, 0x4d, 0x4f, 0x27, 0xa0, 0xad, 0xf7, 0xd7, 0x65, 0x5c, 0xc3, 0xc5, 0xf8, 0x2c, 0x1e, 0xc7, 0xdc, 0xa0, 0x3f, 0xee, 0x8d, 0x3a, 0x4f, 0xfa, 0x71, 0xb9, 0x30, 0xef, 0x2b, 0xf9, 0x30, 0xd1, 0x89, 0x76, 0xa0, 0x32, 0x84, 0xe0, 0xfb, 0x94, 0x2a, 0xb3, 0x92, 0x4f, 0x26, 0xbd, 0xc5, 0x42, 0xd5, 0x6d, 0x08, 0x8d, 0xa2, 0xa7, 0x37, 0x67, 0x52, 0x40, 0x0e, 0x13, 0x1b, 0x1c, 0xa8, 0x56, 0x49, 0xb3, 0x8b, 0x67, 0xd2, 0x0d, 0xd7, 0x07, 0x57, 0xfd, 0x6a, 0x65, 0x4f, 0xf1, 0x26, 0x6f, 0xf6, 0x7e, 0xbe, 0x0c, 0x92, 0x25, 0xfe, 0xc7, 0x37, 0xe2, 0x5f, 0x50, 0x4b, 0x07, 0x08, 0xc5, 0xcd, 0x4c, 0xac, 0xf0, 0x05, 0x00, 0x00, 0x64, 0x08, 0x00, 0x00, 0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x08, 0x00, 0x08, 0x00, 0xdc, 0x91, 0xbd, 0x4e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x64, 0x08, 0x00, 0x00, 0x1e, 0x00, 0x20, 0x00, 0x63, 0x65, 0x72, 0x74, 0x73, 0x2f, 0x62, 0x61, 0x73, 0x65, 0x36, 0x34, 0x5f, 0x4d, 0x53, 0x46, 0x54, 0x5f, 0x52, 0x43, 0x41, 0x5f, 0x32, 0x30, 0x31, 0x31, 0x2e, 0x63, 0x65, 0x72, 0x55, 0x54, 0x0d, 0x00, 0x07, 0x21, 0xcc, 0xee, 0x5c, 0x5d, 0xe2, 0xd2, 0x6a, 0x5a, 0xe2, 0xd2, 0x6a, 0x75, 0x78, 0x0b, 0x00, 0x01, 0x04, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x8d, 0x56, 0x47, 0xcf, 0xa3, 0xca, 0x12, 0xdd, 0x5b, 0xf2, 0x7f, 0xb8, 0x7b, 0x6b, 0x44, 0x34, 0x61, 0xd9, 0xe4, 0x9c, 0xf3, 0xce, 0xe4, 0x68, 0x0c, 0xb6, 0x49, 0xbf, 0xfe, 0xf1, 0xcd, 0xbc, 0xe5, 0xd5, 0xe8, 0x22, 0x21, 0xa4, 0xaa, 0xee, 0x6a, 0xce, 0xa9, 0x73, 0x4a, 0xfd, 0xeb, 0xd7, 0xf9, 0x30, 0xbc, 0x28, 0x1b, 0xff, 0xb0, 0xbc, 0xe3, 0xc9, 0x82, 0xcc, 0x02, 0x8f, 0xff, 0x09, 0xfe, 0xba, 0x5e, 0x74, 0x59, 0x16, 0x48, 0x8f, 0x65, 0x01, 0x1d, 0x56, 0x60, 0x95, 0x19, 0x50, 0xc9, 0xb6, 0x85, 0x2f, 0xf2, 0xa7, 0xdc, 0xcb, 0xf7, 0x2b, 0xe1, 0x3e, 0xe1, 0x33, 0x4c, 0x79, 0xad, 0x76, 0x38, 0x60, 0x30, 0x55, 0x37, 0xd5, 0x5d, 0x23, 0xd2, 0x2b, 0xcc, 0x00, 0xfb, 0x2d, 0x00, 0x8e, 0x65, 0xae, 0x97, 0x86, 0xe3, 0x35, 0x1d, 0x74, 0x22, 0x40, 0x7c, 0x9e, 0xa9, 0x75, 0x36, 0x08, 0xf4, 0x8d, 0x3f, 0x80, 0xc3, 0x54, 0x46, 0x70, 0x96, 0xf3, 0xd8, 0x3e, 0xaf, 0x33, 0xb4, 0x7e, 0xa5, 0x43, 0x0e, 0xa7, 0x28, 0xbe, 0xf1, 0x1c, 0x30, 0xff, 0xe4, 0x32, 0x8f, 0x41, 0x94, 0xfe, 0x7a, 0x49, 0x44, 0x64, 0x49, 0x07, 0x7b, 0x93, 0x5a, 0x90, 0xfd, 0xc9, 0x8c, 0x9e, 0xe0, 0x23, 0xaf, 0x18, 0x53, 0x96, 0x0c, 0xa5, 0x87, 0x9c, 0x65, 0xb8, 0x14, 0x53, 0xd6, 0xf3, 0xad, 0x73, 0xb1, 0x5f, 0xd2, 0x96, 0xdf, 0x75, 0x0e, 0xfc, 0x3e, 0x11, 0x6c, 0xfa, 0xeb, 0x7a, 0xf1, 0xc2, 0xbe, 0xcd, 0x06, 0xfa, 0x48, 0xd1, 0x04, 0x96, 0x05, 0x65, 0x49, 0x31, 0xbb, 0xb2, 0xd1, 0x60, 0x3f, 0x57, 0x0f, 0x8f, 0xd0, 0x38, 0x77, 0xf9, 0x95, 0x1d, 0x05, 0xf0, 0x43, 0xa4, 0xf7, 0x47, 0xe4, 0xdc, 0x65, 0x4e, 0x5e, 0x75, 0x8f, 0x5f, 0xa5, 0x3a, 0x33, 0x7e, 0xbe, 0x27, 0x0f, 0x87, 0xbc, 0xeb, 0xad, 0xbc, 0x1a, 0x9e, 0x8c, 0x87, 0x3f, 0xd1, 0x23, 0x5e, 0xff, 0x1f, 0xdb, 0xf4, 0x03, 0xc0, 0x61, 0xcb, 0x32, 0x7f, 0x43, 0x7a, 0xbd, 0xfc, 0x17, 0xac, 0x7f, 0x43, 0x7a, 0xbd, 0xfc, 0x17, 0xac, 0x7f, 0x43, 0x7a, 0xbd, 0xfc, 0x0d, 0x6b, 0x55, 0xc9, 0x8d, 0x0e, 0x60, 0x91, 0x75, 0x27, 0xd1, 0x95, 0x53, 0x8c, 0xb3, 0xf9, 0xb3, 0x8b, 0x3e, 0x00, 0xb8, 0xcc, 0x72, 0x2b, 0xf8, 0xc9, 0xab, 0xd7, 0x0b, 0x18, 0x4f, 0x75, 0xd8, 0xec, 0x5e, 0xf1, 0xe2, 0x64, 0x78, 0xb5, 0xc1, 0x63, 0xf2, 0xfe, 0x60, 0x15, 0xe3, 0xab, 0x69, 0x1b, 0x44, 0x07, 0xee, 0x22, 0x1e, 0x12, 0x9d, 0x2b, 0x6a, 0xcb, 0xa5, 0x5f, 0x38, 0x53, 0xb2, 0x72, 0xdc, 0xd5, 0x79, 0xa2, 0x3c, 0x55, 0x84, 0x40, 0x76, 0xd3, 0x89, 0xeb, 0xe5, 0xf8, 0x80, 0x7e, 0x12, 0x46, 0x22, 0x2d, 0x6e, 0xe3, 0x57, 0x18, 0x66, 0x7e, 0x37, 0xc6, 0xc3, 0x5e, 0x5f, 0x35, 0x2d, 0x2c, 0x95, 0xb0, 0x5b, 0xce, 0xb9, 0xbf, 0x03, 0x82, 0x1b, 0xaa, 0x9b, 0xb3, 0x05, 0xd4, 0x54, 0xd3, 0x47, 0x86, 0x82, 0x31, 0x5f, 0x6d, 0xf3, 0x5e, 0x90, 0x4c, 0x78, 0xbd, 0x10, 0xaa, 0x55, 0x24, 0xa2, 0xc4, 0x3e, 0x97, 0xf6, 0x28, 0xb5, 0xe7, 0x9b, 0x4b, 0x03, 0x1f, 0xea, 0x76, 0x34, 0xf1, 0x6f, 0x32, 0xa5, 0x6c, 0xf2, 0x49, 0x20, 0xcb, 0xae, 0x3d, 0xa5, 0x07, 0x5d, 0x54, 0xd8, 0x09, 0xae, 0xca, 0xa8, 0x62, 0x76, 0x2b, 0xa7, 0xa4, 0xf7, 0xed, 0xd1, 0xaf, 0xda, 0xf5, 0x72, 0xc7, 0x9d, 0xea, 0xa5, 0x74, 0x0d, 0x4e, 0xab, 0x4b, 0xad, 0xba, 0xcf, 0x1b, 0x2d, 0xc6, 0xa4, 0xbd, 0xbf, 0xb0, 0x97, 0xab, 0xe0, 0x36, 0x51, 0x61, 0x3a, 0x67, 0x0e, 0x1e, 0x36, 0xb1, 0x82, 0x4a, 0x06, 0xcf, 0x67, 0x27, 0xe1, 0x2e, 0x21, 0xcd, 0x0d, 0xbc, 0xf1, 0x7d, 0xe6, 0x1d, 0xc2, 0x59, 0xa1, 0xa6, 0xb1, 0x9c, 0x09, 0xb3, 0x61, 0x88, 0xb9, 0x2a, 0x73, 0xc4, 0xf6, 0xab, 0x06, 0x0c, 0x3e, 0x39, 0xde, 0xb7, 0xcc, 0x76, 0x35, 0xd6, 0x75, 0x9e, 0xa4, 0xd0, 0xa8, 0x72, 0x0f, 0x17, 0x36, 0x24, 0x0d, 0x5d, 0x9a, 0xce, 0x21, 0xbd, 0x81, 0x87, 0x72, 0xbb, 0x2a, 0x65, 0x82, 0x81, 0xdd, 0xeb, 0x05, 0x52, 0x86, 0xd7, 0xe3, 0x20, 0xdc, 0xf2, 0xdd, 0x86, 0x0f, 0x6f, 0xa6, 0x12, 0x0d, 0x45, 0xd9, 0x04, 0x53, 0x21, 0x7b, 0xd5, 0xc6, 0xd7, 0x07, 0x8b, 0xf9, 0x37, 0xd7, 0xab, 0xf6, 0xfa, 0x70, 0xb4, 0xd0, 0x6e, 0x30, 0xc6, 0xf6, 0x0f, 0x15, 0x53, 0x67, 0xba, 0x45, 0xbe, 0x9c, 0xf3, 0x9a, 0x93, 0xb3, 0x82, 0x26, 0x39, 0x38, 0x69, 0x29, 0x25, 0x5c, 0x13, 0x87, 0xeb, 0xad, 0x76, 0x4c, 0x67, 0xb9, 0xc1, 0xbe, 0xdf, 0xa7, 0xd4, 0x98, 0x6e, 0xc0, 0xb6, 0x1d, 0xae, 0x77, 0xa1, 0x6c, 0x61, 0x39, 0x3d, 0x00, 0xda, 0x92, 0xb0, 0x7e, 0xdf, 0xd6, 0x78, 0x48, 0xdc, 0xc1, 0x66, 0x52, 0x0b, 0x7b, 0x9f, 0xaa, 0x56, 0x24, 0xcb, 0xf6, 0x76, 0x77, 0xbb, 0x85, 0x44, 0x5d, 0x23, 0x75, 0xad, 0xe7, 0x65, 0x75, 0xf4, 0xcd, 0x3c, 0xbb, 0xae, 0x06, 0x97, 0x07, 0x0b, 0xd5, 0x01, 0x41, 0x80, 0x32, 0xcc, 0x59, 0x32, 0x57, 0xde, 0x05, 0x2c, 0xa5, 0x03, 0xf5, 0xed, 0x44, 0x64, 0xe3, 0xc6, 0xdb, 0xe0, 0x15, 0xa7, 0xa2, 0xb2, 0x18, 0xe9, 0xc7, 0x8a, 0xa5, 0xf8, 0x07, 0x6e, 0xed, 0x45, 0x92, 0x52, 0x9f, 0xad, 0x71, 0x3b, 0x84, 0x86, 0xab, 0x10, 0xb4, 0xa1, 0x85, 0x44, 0x3d, 0xe5, 0xd9, 0x9a, 0x15, 0xdd, 0xbe, 0x6a, 0x05, 0xd3, 0x42, 0x16, 0xb7, 0xf7, 0xc9, 0x46, 0xcc, 0xec, 0xfb, 0x64, 0x9f, 0xa0, 0xb4, 0xae, 0x17, 0xd7, 0xf9, 0x98, 0x0c, 0xb8, 0xb7, 0x7e, 0xbc, 0x15, 0x28, 0xe0, 0x98, 0xc0, 0xdd, 0xd1, 0xed, 0xcb, 0xb1, 0x89, 0x4f, 0x2a, 0x06, 0xf7, 0x44, 0x9e, 0x9a, 0xc5, 0x97, 0xdf, 0xba, 0x4e, 0x6b, 0xa3, 0x14, 0x32, 0xa7, 0x44, 0x23, 0xf2, 0x23, 0x65, 0xe4, 0xd7, 0x31, 0x0f, 0x4d, 0x1b, 0x1f, 0xdb, 0xf5, 0x42, 0x72, 0x2d, 0x9a, 0x99, 0xe8, 0x1c, 0x31, 0x16, 0x83, 0xda, 0x94, 0xb1, 0xe1, 0xec, 0x1e, 0x14, 0x30, 0x4c, 0x13, 0x7b, 0x7a, 0xd7, 0xad, 0xc7, 0x1d, 0xce, 0xa8, 0xd7, 0x1c, 0x5a, 0x7a, 0x0e, 0x09, 0x2e, 0x01, 0xcd, 0x94, 0x2d, 0x73, 0xc0, 0x06, 0xcc, 0x88, 0xf0, 0xab, 0x77, 0x80, 0xb3, 0x9b, 0x3f, 0x5e, 0x93, 0x6c, 0xea, 0x14, 0xbc, 0xce, 0x82, 0x38, 0x5e, 0xb9, 0x35, 0xe6, 0x02, 0x07, 0xf6, 0x80, 0x2d, 0x41, 0x0c, 0xf0, 0x4f, 0xf5, 0xf3, 0x0c, 0x74, 0x80, 0xfc, 0xcf, 0x3a, 0x9c, 0x17, 0x2a, 0xdb, 0xcf, 0x1a, 0x98, 0x00, 0xad, 0x68, 0xdb, 0x64, 0xe7, 0x9f, 0x15, 0x7c, 0xb2, 0x26, 0xa6, 0x52, 0xd2, 0x73, 0xbe, 0x6d, 0x3c, 0x7b, 0xe5, 0x41, 0xac, 0xa8, 0x6b, 0xcc, 0x30, 0x40, 0x64, 0x8d, 0xcd, 0x67, 0x7e, 0x57, 0xb6, 0xc1, 0xca, 0xd9, 0x67, 0x7c, 0x4c, 0xe4, 0x7a, 0xc9, 0x0c, 0x60, 0xf3, 0x1a, 0x63, 0x03, 0xee, 0x74, 0xd6, 0x39, 0x27, 0x81, 0x44, 0xef, 0xc7, 0x7a, 0xc3, 0x36, 0x27, 0x3a, 0x49, 0x66, 0x94, 0xbd, 0x49, 0x52, 0xe8, 0x85, 0x7b, 0xf7, 0x8f, 0xb5, 0xc2, 0x9f, 0x6f, 0x14, 0x41, 0x8a, 0x66, 0xc1, 0xe8, 0x31, 0xd7, 0xc3, 0x97, 0xcc, 0x8b, 0x68, 0x54, 0x8f, 0x65, 0xf2, 0xa6, 0x76, 0xed, 0xc4, 0xf5, 0x9e, 0x36, 0xce, 0xf5, 0xf2, 0xac, 0x4d, 0x46, 0x01, 0xd6, 0xc0, 0x96, 0x30, 0x14, 0xc0, 0xe0, 0x2e, 0xbb, 0x4e, 0x08, 0x3b, 0x60, 0x71, 0x61, 0xf6, 0x65, 0x8c, 0x89, 0xf6, 0x11, 0x8c, 0x68, 0x58, 0x96, 0xad, 0x1c, 0x87, 0x93, 0x52, 0x3c, 0x4e, 0x05, 0x71, 0x22, 0x4c, 0x58, 0xe9, 0xd3, 0xa8, 0xcf, 0xb2, 0xa1, 0x3e, 0x9d, 0x15, 0xe7, 0xc8, 0xab, 0x0e, 0xa0, 0x3d, 0xc2, 0xb1, 0x40, 0xb8, 0xc3, 0x1d, 0x15, 0x71, 0x09, 0x75, 0x0e, 0x3d, 0xf4, 0x3b, 0x0a, 0xeb, 0xf6, 0x61, 0x15, 0xe5, 0xd6, 0xd0, 0x28, 0x33, 0x35, 0xc8, 0x2a, 0x67, 0x3a, 0xcd, 0xd4, 0x2e, 0xb9, 0xec, 0x4e, 0x71, 0xfe, 0x66, 0x64, 0xad, 0xd4, 0x59, 0x41, 0x9e, 0x11, 0x0d, 0x80, 0x34, 0xed, 0xb7, 0x23, 0x8e, 0x3e, 0x9e, 0xc0, 0x22, 0xbb, 0x94, 0xf6, 0x6c, 0x47, 0xe8, 0x3a, 0xfe, 0xb2, 0x16, 0x4d, 0xd3, 0x43, 0x37, 0x79, 0x7d, 0x85, 0xe8, 0xfd, 0x21, 0x52, 0xc5, 0xa0, 0x2a, 0xb6, 0x8f, 0x43, 0xa4, 0x40, 0x6c, 0x71, 0x20, 0x58, 0x69, 0x18, 0x7e, 0xa6, 0xbd, 0x1c, 0x3c, 0xe3, 0x22, 0x74, 0xd2, 0x60, 0x90, 0x77, 0xc0, 0x35, 0xdb, 0x76, 0x8c, 0x86, 0xd9, 0x14, 0x9e, 0x55, 0xf9, 0xc2, 0x20, 0xa2, 0x3b, 0xd4, 0x83, 0x26, 0x9a, 0xb2, 0x7d, 0x2a, 0x01, 0xe3, 0xc9, 0xc6, 0xbb, 0x70, 0xcd, 0x5b, 0x6f, 0x02, 0xf3, 0x88, 0x83, 0x6a, 0xb8, 0x9f, 0xaa, 0x86, 0x3b, 0x17, 0xee, 0x6d, 0x0d, 0x3c, 0xbe, 0x6f, 0x87, 0x7c, 0x38, 0x6a, 0x84, 0xe8, 0x1f, 0x29, 0x04, 0x7e, 0x25, 0x8d, 0xfb, 0xa8, 0xa1, 0x4f, 0x6a, 0x7f, 0x3f, 0x65, 0x2a, 0x22, 0x1a, 0x6a, 0x78, 0xab, 0x9f, 0x7d, 0x06, 0xcb, 0xed, 0xd9, 0xf3, 0xc5, 0x06, 0x1b, 0x41, 0x02, 0xd3, 0x27, 0x93, 0x6f, 0xa4, 0x0c, 0x3f, 0xdf, 0xe3, 0xeb, 0xcf, 0x19, 0x41, 0x9c, 0x9d, 0x45, 0x70, 0x51, 0x5e, 0xf8, 0x9b, 0x99, 0xa7, 0x1f, 0x6d, 0xb2, 0x00, 0x32, 0x35, 0xa9, 0x9f, 0xa0, 0xa7, 0x23, 0x9e, 0x8c, 0x6e, 0xde, 0xad, 0x4c, 0xca, 0x69, 0xbc, 0x93, 0x93, 0xfd, 0xdd, 0x36, 0x1d, 0x9c, 0xef, 0xa7, 0xbb, 0xbd, 0xac, 0x8f, 0x89, 0xfd, 0xed, 0x46, 0x86, 0x4d, 0xce, 0xe3, 0x36, 0xbf, 0x65, 0xab, 0x07, 0x1e, 0x84, 0xb3, 0x9e, 0x86, 0x76, 0x87, 0x0f, 0xcb, 0x13, 0x94, 0x1b, 0x2b, 0x82, 0xb1, 0x31, 0x98, 0x0f, 0xbf, 0x02, 0x54, 0xbc, 0x27, 0xa2, 0x9f, 0x09, 0xa0, 0x78, 0x3a, 0x0b, 0x2d, 0x98, 0xd7, 0x0b, 0x6c, 0xc6, 0xa3, 0x7d, 0x14, 0xc9, 0x0b, 0xbc, 0x54, 0xd6, 0x18, 0x1e, 0x59, 0x64, 0xb9, 0xd3, 0xfb, 0x1c, 0x41, 0xa8, 0x81, 0x8e, 0x5e, 0xbe, 0x74, 0x6d, 0x55, 0x94, 0x8e, 0x4c, 0x25, 0xad, 0xf6, 0xdc, 0x51, 0xac, 0x86, 0x04, 0x55, 0xc1, 0xb2, 0x39, 0x4c, 0xaa, 0xf0, 0xd1, 0x0f, 0xe2, 0xed, 0x7a, 0x19, 0x9b, 0x56, 0x92, 0x54, 0xf3, 0x69, 0xf4, 0x80, 0x32, 0x27, 0xaf, 0x74, 0x07, 0x72, 0xa8, 0x8f, 0xc5, 0x24, 0xa0, 0x53, 0x72, 0x5e, 0x91, 0xf3, 0xc7, 0xe6, 0xb6, 0x33, 0x7a, 0x97, 0x3c, 0x4f, 0x94, 0x72, 0x5f, 0x7d, 0xb4, 0x68, 0xac, 0x46, 0xac, 0xde, 0xb8, 0xb3, 0x33, 0xe1, 0xb2, 0x7d, 0x7a, 0x93, 0x81, 0x32, 0xfa, 0x24, 0x77, 0x4b, 0x3f, 0x81, 0xd8, 0xd6, 0x6d, 0xcd, 0x13, 0x58, 0xaa, 0xa2, 0x41, 0x60, 0x6e, 0xbd, 0x5c, 0x33, 0x8a, 0x40, 0xb6, 0x40, 0x7a, 0x67, 0xd6, 0x2c, 0x38, 0xd2, 0xf5, 0xf2, 0xfb, 0xca, 0xc0, 0x1b, 0xdc, 0xbf, 0x5c, 0x23, 0xfe, 0x07, 0x50, 0x4b, 0x07, 0x08, 0xdb, 0x57, 0x2e, 0x58, 0xe9, 0x05, 0x00, 0x00, 0x64, 0x08, 0x00, 0x00, 0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x08, 0x00, 0x08, 0x00, 0xdc, 0x91, 0xbd, 0x4e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xa6, 0x09, 0x00, 0x00, 0x1f, 0x00, 0x20, 0x00, 0x63, 0x65, 0x72, 0x74, 0x73, 0x2f, 0x62, 0x61, 0x73, 0x65, 0x36, 0x34, 0x5f, 0x53, 0x54, 0x4f, 0x52, 0x45, 0x5f, 0x50, 0x43, 0x41, 0x5f, 0x32, 0x30, 0x31, 0x31, 0x2e, 0x63, 0x65, 0x72, 0x55, 0x54, 0x0d, 0x00, 0x07, 0x21, 0xcc, 0xee, 0x5c, 0x5d, 0xe2, 0xd2, 0x6a, 0x5a, 0xe2, 0xd2, 0x6a, 0x75, 0x78, 0x0b, 0x00, 0x01, 0x04, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x95, 0x96, 0x49, 0xaf, 0xab, 0x3c, 0x12, 0x86, 0xf7, 0x91, 0xf2, 0x1f, 0x7a, 0x1f, 0x5d, 0x85, 0x39, 0x64, 0x69, 0x83, 0x99, 0xc2, 0x10, 0x08, 0xf3, 0x8e, 0x21, 0x40, 0x18, 0x02, 0x21, 0x04, 0x08, 0xbf, 0xbe, 0x7d, 0xce, 0x55, 0xb7, 0xbe, 0x45, 0x6f, 0xda, 0x92, 0x65, 0xc9, 0x2e, 0xdb, 0xe5, 0xf2, 0x5b, 0x8f, 0xfd, 0xe7, 0x0f, 0x2e, 0x10, 0xc9, 0xaa, 0xf9, 0x2f, 0x01, 0x39, 0xae, 0x2a, 0xa9, 0x02, 0x70, 0xd1, 0x4f, 0xe7, 0x9f, 0xfd, 0xce, 0x50, 0x55, 0x99, 0xdc, 0x04, 0x01, 0xea, 0x87, 0x12, 0x2c, 0x2a, 0x04, 0xa5, 0x7a, 0x89, 0x1c, 0x0d, 0xf5, 0x25, 0xf8, 0x5b, 0x6a, 0x60, 0xc2, 0xb2, 0x79, 0x55, 0xcd, 0x43, 0x3e, 0x2f, 0x04, 0x04, 0xf6, 0x5b, 0x02, 0xa2, 0x00, 0x1f, 0x22, 0xd2, 0x0d, 0xd0, 0xc8, 0xfb, 0x1d, 0x20, 0x3d, 0x04, 0x2b, 0x43, 0xf0, 0x7d, 0x63, 0x45, 0x1b, 0x70, 0x60, 0x69, 0xfa, 0x78, 0x19, 0x57, 0x68, 0xf3, 0x2a, 0xa3, 0xaa, 0x21, 0xed, 0x72, 0x22, 0xa5, 0x98, 0x15, 0x89, 0xc0, 0xfa, 0x3b, 0x96, 0xb9, 0x90, 0xd4, 0xda, 0x58, 0x26, 0xe7, 0xb4, 0xb3, 0xd7, 0xfd, 0x4e, 0xa9, 0x41, 0xf6, 0x77, 0xa4, 0x77, 0x25, 0x8f, 0x1c, 0x22, 0x5a, 0x9b, 0x33, 0xea, 0xdc, 0xe5, 0x02, 0x14, 0x53, 0x5a, 0x5b, 0x70, 0xad, 0x72, 0xb9, 0x9d, 0xd3, 0x1a, 0x7d, 0x0d, 0x11, 0xc8, 0x3f, 0x3b, 0x82, 0xd5, 0x18, 0xdc, 0xa0, 0xad, 0xb3, 0xee, 0xbc, 0xed, 0x77, 0x29, 0x15, 0x13, 0xaa, 0xa4, 0xcd, 0x29, 0x6d, 0x97, 0x36, 0xe5, 0x7f, 0xb1, 0x75, 0x97, 0x04, 0x26, 0x9e, 0xe5, 0x95, 0x76, 0xe8, 0x13, 0x89, 0x7c, 0xfe, 0x26, 0xa1, 0xc3, 0xaa, 0xa2, 0xba, 0x18, 0x2e, 0x5a, 0x94, 0x2a, 0x33, 0x7f, 0x5a, 0x63, 0x53, 0x19, 0xa3, 0x46, 0xcb, 0x7e, 0x67, 0xb9, 0x06, 0x1b, 0xfc, 0xf4, 0x6e, 0xff, 0xed, 0x5d, 0x7f, 0xfb, 0x6a, 0x78, 0x36, 0xec, 0xf7, 0x22, 0xd8, 0x91, 0xe8, 0xdb, 0xb6, 0x8c, 0x16, 0xcd, 0xf7, 0x36, 0xe4, 0x1a, 0x38, 0xa0, 0x3f, 0x7e, 0x08, 0xd0, 0xb8, 0xf8, 0x94, 0x84, 0x7d, 0x48, 0xe4, 0xf6, 0x13, 0xd3, 0xce, 0x8f, 0x97, 0xb6, 0x01, 0x98, 0xdf, 0x51, 0xb8, 0x1a, 0x8a, 0xd7, 0xf9, 0x4d, 0x1a, 0x9c, 0x3f, 0xb1, 0x88, 0xee, 0x06, 0x5c, 0xfe, 0xce, 0xaa, 0x0c, 0xff, 0x3f, 0xde, 0xff, 0xfa, 0x8e, 0xcc, 0x79, 0xbf, 0xcb, 0x9e, 0x70, 0xce, 0x3a, 0x89, 0x48, 0xb0, 0xb5, 0x71, 0xcb, 0x16, 0xed, 0xef, 0x9e, 0x22, 0x5a, 0x59, 0x13, 0x9f, 0xe6, 0x9b, 0xd2, 0xe6, 0x1c, 0x3f, 0xed, 0xd2, 0x0d, 0xa4, 0x6f, 0x42, 0xf9, 0x84, 0x27, 0xaf, 0x55, 0x44, 0x79, 0xa5, 0x87, 0x4c, 0xf8, 0x73, 0x32, 0x7c, 0x9b, 0xf8, 0x4c, 0x65, 0xa9, 0x3e, 0x0c, 0x40, 0xc8, 0xc2, 0xed, 0x25, 0xdf, 0xd4, 0x94, 0x16, 0x6d, 0x84, 0x6f, 0xcd, 0x03, 0x80, 0x51, 0x05, 0x71, 0x01, 0x3f, 0xe3, 0x17, 0xd0, 0x63, 0x0d, 0xd8, 0x02, 0x3b, 0x39, 0x83, 0x0e, 0xe2, 0x2a, 0x58, 0xdc, 0x6c, 0x11, 0xb2, 0xf3, 0x61, 0xbf, 0x3b, 0x24, 0xb5, 0x79, 0x43, 0x40, 0xb9, 0x8f, 0x08, 0xe1, 0x48, 0xb7, 0x52, 0x1a, 0xf0, 0xd6, 0xb3, 0xe6, 0xc8, 0xe0, 0x92, 0x17, 0xe8, 0x5a, 0xc4, 0xc7, 0x8f, 0xeb, 0x8d, 0x1b, 0xd1, 0x8a, 0xa3, 0x61, 0x70, 0x58, 0x35, 0xaa, 0x05, 0xed, 0xb7, 0x7e, 0x52, 0xbd, 0xd1, 0x1b, 0x8f, 0xbe, 0xb0, 0xdf, 0x99, 0xc3, 0x76, 0xb4, 0xb7, 0xf7, 0x71, 0xd8, 0xbe, 0xc7, 0x66, 0xba, 0x58, 0x79, 0x94, 0x78, 0x0e, 0x9a, 0xc6, 0xc3, 0x50, 0x17, 0xc9, 0xb5, 0x1e, 0xf4, 0x49, 0x9d, 0xe0, 0xf7, 0x42, 0xdf, 0xc5, 0xc4, 0x12, 0x2a, 0xd3, 0x38, 0xb9, 0x39, 0x6b, 0xa7, 0x27, 0x5a, 0xcd, 0x5b, 0xc7, 0x88, 0x43, 0x7e, 0xbf, 0xf3, 0x5a, 0x52, 0x2a, 0x95, 0x2f, 0x7b, 0x97, 0x67, 0x2b, 0x6b, 0xa4, 0x91, 0xad, 0x4f, 0x6a, 0x2a, 0x68, 0xa0, 0x0f, 0xb9, 0x74, 0xc8, 0x7c, 0x06, 0x15, 0x7c, 0xcf, 0xca, 0x65, 0x1f, 0x2a, 0x2c, 0x15, 0x7d, 0x6b, 0x9d, 0x70, 0xa2, 0xe7, 0x21, 0x3d, 0xd4, 0xc4, 0x43, 0xbb, 0x5d, 0x13, 0xd7, 0xc2, 0x7a, 0x20, 0xf4, 0x91, 0x0e, 0xb9, 0xf3, 0x93, 0xaf, 0x53, 0xd1, 0x96, 0xaf, 0x74, 0x9e, 0x92, 0x2a, 0x7f, 0x70, 0xc2, 0x88, 0x57, 0x89, 0x7b, 0x68, 0x41, 0xbe, 0x14, 0x2a, 0xf6, 0x65, 0x26, 0xcd, 0x3d, 0xd1, 0x8b, 0x15, 0x57, 0xa9, 0xb9, 0x3f, 0xee, 0xf8, 0x56, 0x3d, 0x54, 0xa0, 0x03, 0x8e, 0xa4, 0x2a, 0x77, 0x0d, 0x57, 0x52, 0x6b, 0x72, 0x88, 0xe0, 0xd9, 0xde, 0x26, 0x46, 0xa6, 0x64, 0x47, 0x3d, 0xf0, 0xc1, 0x87, 0xe5, 0x5c, 0xd5, 0x50, 0x79, 0xc2, 0x79, 0x48, 0x7c, 0xf2, 0x12, 0x5e, 0x54, 0xff, 0xb9, 0x95, 0x12, 0x3b, 0x65, 0x53, 0xa3, 0xb2, 0xa1, 0xf6, 0x0e, 0x67, 0x68, 0xc2, 0x7e, 0xbf, 0xfb, 0x1c, 0xd6, 0xd3, 0xe8, 0x1e, 0x8f, 0xd9, 0xd1, 0x75, 0xef, 0xda, 0x2a, 0x2d, 0x97, 0x0a, 0x3e, 0x60, 0x5d, 0x12, 0xc2, 0xeb, 0x1d, 0x7e, 0xae, 0xdb, 0xad, 0x6e, 0xdd, 0xb7, 0xe5, 0xb0, 0x85, 0xb4, 0x28, 0xae, 0x7c, 0xe6, 0xee, 0xc2, 0xda, 0xbf, 0x04, 0x15, 0x0e, 0xa1, 0x67, 0xbc, 0x1c, 0xe9, 0xb3, 0xdf, 0xb5, 0x27, 0x7a, 0x03, 0x97, 0xd7, 0xec, 0x01, 0x78, 0x39, 0xa4, 0xdd, 0x1b, 0xb4, 0x4e, 0xb9, 0xba, 0x5c, 0x7c, 0x8f, 0x38, 0x8d, 0x0d, 0x23, 0x87, 0xf3, 0xeb, 0xc4, 0x48, 0x26, 0x2e, 0x8f, 0x4f, 0x84, 0x2f, 0x34, 0x64, 0x5e, 0x85, 0x1e, 0x55, 0x45, 0xb2, 0xe2, 0x44, 0xaf, 0x32, 0x94, 0xa9, 0xfd, 0x8e, 0xaa, 0xe2, 0x52, 0xc8, 0xc2, 0xd9, 0x6d, 0xdf, 0x55, 0x42, 0x6a, 0xdd, 0x76, 0x75, 0xd7, 0x96, 0x1f, 0x87, 0x68, 0x2a, 0xca, 0x38, 0x23, 0xa6, 0x85, 0x97, 0x03, 0xa0, 0x9b, 0x67, 0x2b, 0x0d, 0x56, 0x62, 0x28, 0xa1, 0x16, 0x13, 0xd2, 0xbb, 0x48, 0xa4, 0xa1, 0xa7, 0xd0, 0xf9, 0xd5, 0x04, 0xfb, 0x9d, 0x04, 0x01, 0x6a, 0xb2, 0x51, 0xc8, 0xfd, 0x34, 0xd1, 0xb2, 0xdb, 0xfb, 0x91, 0xc8, 0xcc, 0x41, 0xaf, 0xdb, 0x34, 0x5b, 0x7d, 0xf3, 0xd9, 0x5c, 0x09, 0x78, 0xf9, 0x4a, 0x4f, 0x65, 0x24, 0x97, 0xa9, 0xaa, 0x47, 0x04, 0x89, 0x6a, 0x3c, 0x6d, 0xc4, 0x70, 0x3c, 0xb0, 0xf2, 0x67, 0x89, 0x58, 0x1f, 0x9f, 0xe2, 0xfc, 0x42, 0x16, 0x73, 0x15, 0x19, 0xa2, 0x0e, 0xb7, 0xbb, 0x2a, 0xea, 0x86, 0xbe, 0x5d, 0xcf, 0x50, 0xa6, 0xa3, 0x63, 0x11, 0x4d, 0x35, 0x3a, 0xba, 0xf2, 0x5b, 0xa3, 0x86, 0x40, 0x61, 0x8c, 0xae, 0x4e, 0xf4, 0x92, 0x2a, 0xdd, 0xf5, 0xe6, 0x06, 0xdc, 0xa2, 0x91, 0x93, 0x2f, 0x33, 0x68, 0xbf, 0x5b, 0x24, 0x21, 0xe4, 0x45, 0xa1, 0x61, 0xad, 0xf1, 0x5d, 0x7e, 0xf9, 0x2c, 0xba, 0xf9, 0xc7, 0xb1, 0xb9, 0x8c, 0xa6, 0xad, 0x8a, 0xc0, 0x06, 0xb0, 0x67, 0x54, 0x78, 0xc3, 0x0c, 0x03, 0x5e, 0xb6, 0x20, 0x10, 0x69, 0x97, 0x25, 0x82, 0x10, 0xc8, 0x82, 0xb9, 0x7a, 0xb8, 0x35, 0xb0, 0x26, 0xb1, 0xd5, 0xa2, 0xfc, 0x64, 0x93, 0x43, 0x58, 0x10, 0x46, 0x48, 0x02, 0x67, 0xf7, 0xbb, 0xf1, 0x41, 0x74, 0x0b, 0x0f, 0x91, 0xda, 0xe4, 0xc4, 0xa9, 0xe5, 0x39, 0x4d, 0x98, 0xde, 0xac, 0xeb, 0x18, 0xb0, 0xc1, 0xb9, 0xf3, 0x96, 0x81, 0x6d, 0xc3, 0xb2, 0xce, 0x3c, 0x50, 0xda, 0x06, 0x66, 0x54, 0xd9, 0x03, 0x6f, 0x81, 0x24, 0x90, 0x55, 0x60, 0x2f, 0x10, 0x1a, 0xe0, 0xfd, 0x93, 0xc9, 0xb9, 0xb8, 0xd8, 0xe8, 0x87, 0x9b, 0x55, 0x0d, 0xae, 0x3f, 0x0c, 0x53, 0xf0, 0x7c, 0x50, 0xf0, 0x08, 0xba, 0x00, 0xfb, 0xa6, 0x1c, 0x0d, 0xc8, 0xff, 0xda, 0x61, 0x45, 0x2d, 0x76, 0x64, 0xc0, 0x04, 0x48, 0x8a, 0x3a, 0x59, 0xa5, 0xba, 0x36, 0xc8, 0x62, 0x25, 0xe0, 0x5b, 0xcc, 0xfd, 0xf5, 0x5c, 0x37, 0xc5, 0x51, 0x99, 0x86, 0x30, 0xa4, 0xfe, 0xd7, 0x5a, 0x59, 0x1c, 0xd7, 0x90, 0xd0, 0xe2, 0x72, 0xd0, 0xec, 0xd1, 0x47, 0xbe, 0x05, 0x15, 0xb1, 0xdf, 0xe5, 0x0a, 0xe0, 0xf4, 0xef, 0x19, 0x53, 0x63, 0xf9, 0xa4, 0xff, 0xa0, 0x87, 0xde, 0x99, 0x73, 0x7a, 0x3b, 0x2f, 0x09, 0xd5, 0xcc, 0x98, 0x9d, 0x6f, 0x9d, 0x86, 0xdf, 0x94, 0x72, 0xc8, 0x88, 0x76, 0x36, 0x9d, 0xc0, 0x3c, 0x25, 0x31, 0x19, 0x09, 0xb3, 0xc5, 0x84, 0x69, 0x24, 0x32, 0xff, 0x65, 0xa0, 0x54, 0x18, 0x35, 0x66, 0xa8, 0xcf, 0x2f, 0x06, 0xc9, 0x7f, 0x8d, 0x07, 0xfb, 0xb3, 0xea, 0x12, 0x96, 0x91, 0xfa, 0x1b, 0x3d, 0xdb, 0x53, 0x80, 0x8d, 0x90, 0x57, 0x43, 0xdb, 0x40, 0x8c, 0x2c, 0x08, 0x3f, 0xf1, 0xf0, 0xa4, 0xfd, 0x0e, 0x6e, 0x40, 0xa8, 0x1a, 0xad, 0xcf, 0x15, 0x67, 0xb1, 0x1e, 0xfc, 0x9c, 0xd3, 0x39, 0xad, 0x77, 0xff, 0x64, 0x36, 0x5b, 0xa7, 0x14, 0x31, 0x67, 0xf2, 0x34, 0xe8, 0x94, 0xd9, 0x66, 0xcf, 0xff, 0xcb, 0x87, 0xa7, 0xbd, 0x88, 0x36, 0xbe, 0xc1, 0x3e, 0x56, 0xab, 0x39, 0x33, 0xb1, 0x0f, 0x3a, 0xb4, 0x81, 0x88, 0x99, 0x05, 0xc1, 0xc5, 0x62, 0xbb, 0x68, 0xc3, 0xef, 0x45, 0xeb, 0x11, 0x96, 0xf0, 0xa4, 0xc1, 0x7d, 0x99, 0x2b, 0xa9, 0x5e, 0xfa, 0xe7, 0x37, 0xfb, 0x5c, 0xee, 0x47, 0xe4, 0x5b, 0x1d, 0x22, 0xa2, 0xcb, 0x2c, 0xe1, 0x8c, 0xbc, 0x3b, 0x65, 0xda, 0x75, 0xd1, 0x57, 0x0a, 0xfc, 0x82, 0xb5, 0x95, 0x03, 0x79, 0xd1, 0xd2, 0x35, 0x0d, 0xf3, 0x74, 0xbc, 0xdd, 0xf7, 0x3b, 0x41, 0xbc, 0x52, 0xa7, 0xa7, 0x02, 0x36, 0xe5, 0x73, 0x3c, 0x06, 0xf4, 0xd9, 0x12, 0xd2, 0x97, 0x18, 0x7f, 0xa6, 0x50, 0x65, 0xfa, 0xba, 0x11, 0x3f, 0xa7, 0xf1, 0x18, 0xab, 0xe5, 0x53, 0xb0, 0x9b, 0x3e, 0x14, 0xe9, 0x67, 0x36, 0x3a, 0x65, 0x39, 0xf8, 0xd7, 0x74, 0x13, 0x69, 0x2b, 0x5c, 0x49, 0x75, 0xbf, 0xeb, 0xee, 0xb1, 0x5c, 0x68, 0x8a, 0x9d, 0x6e, 0xaf, 0x7c, 0x8d, 0xdf, 0x61, 0xaf, 0x4e, 0x62, 0x2f, 0xbe, 0x3c, 0x49, 0xa4, 0xea, 0x24, 0x36, 0xe2, 0xa0, 0xb7, 0xe6, 0x47, 0x5a, 0xb4, 0x51, 0x2f, 0xe4, 0xdb, 0x50, 0x4b, 0x8e, 0xbd, 0x85, 0xfa, 0xfc, 0x88, 0x67, 0xc3, 0xf3, 0xbb, 0x79, 0xc4, 0x7a, 0xf0, 0xee, 0x8b, 0xb6, 0x70, 0xcf, 0x7b, 0x9b, 0x27, 0xf9, 0xad, 0x87, 0x75, 0x30, 0xcd, 0x83, 0xd8, 0x93, 0x85, 0x3f, 0xe7, 0xdf, 0x20, 0x5f, 0x5e, 0xfd, 0x3b, 0x48, 0xed, 0x9b, 0xd1, 0xe7, 0xab, 0xf8, 0x7c, 0x09, 0x93, 0x39, 0x0b, 0x1c, 0xa3, 0x7c, 0x9a, 0x95, 0x52, 0xf8, 0xd2, 0x53, 0x5b, 0x65, 0xbf, 0x73, 0xbd, 0x55, 0x34, 0xe1, 0xdb, 0xa2, 0x9a, 0xdb, 0x65, 0x7d, 0xb3, 0x6c, 0x7b, 0xd3, 0xeb, 0xbc, 0xc2, 0xa4, 0xcf, 0x5e, 0x7d, 0xed, 0xd9, 0x27, 0x72, 0x52, 0x04, 0x31, 0x3f, 0xbc, 0x2f, 0x57, 0x00, 0x3f, 0x49, 0x48, 0x7c, 0xa3, 0xfa, 0xc1, 0x11, 0x6b, 0x4a, 0x3f, 0x60, 0x14, 0x08, 0x87, 0xf7, 0x7e, 0xb7, 0xa1, 0xaa, 0xe0, 0x8a, 0x3a, 0x46, 0xc8, 0x78, 0x98, 0xc7, 0x8c, 0xa3, 0xef, 0x96, 0x73, 0x7d, 0x09, 0x74, 0x9e, 0xb3, 0xa6, 0x15, 0x9d, 0xc8, 0x4f, 0x47, 0xc1, 0x8f, 0xdf, 0x5d, 0x12, 0xe4, 0x48, 0x94, 0xed, 0x4b, 0x76, 0xd0, 0x06, 0xd4, 0xad, 0x5a, 0x5a, 0xe6, 0x53, 0x26, 0xdc, 0x09, 0xe7, 0xc5, 0x91, 0xbe, 0x33, 0xc5, 0xf9, 0xf1, 0x74, 0x8b, 0x54, 0x34, 0x51, 0xc1, 0xde, 0xa3, 0xaf, 0xc0, 0x99, 0xe7, 0xee, 0xc8, 0x1d, 0xf2, 0x43, 0xe0, 0x75, 0xa3, 0x44, 0xd5, 0x42, 0x05, 0x66, 0xe5, 0xd9, 0x84, 0xe8, 0x3d, 0xb1, 0x26, 0x5b, 0x1d, 0x05, 0xfd, 0x88, 0xd6, 0x8b, 0xd9, 0x9c, 0x12, 0x80, 0x19, 0x75, 0xe6, 0x8a, 0xdc, 0x3d, 0x66, 0x03, 0xab, 0x6a, 0x74, 0xe0, 0xd8, 0x8c, 0xaf, 0x67, 0x80, 0x9b, 0xe1, 0xd3, 0xb1, 0x09, 0x36, 0x6b, 0xd9, 0xb4, 0x69, 0x81, 0x3e, 0xf8, 0x67, 0xda, 0x93, 0x5e, 0xbc, 0xff, 0xec, 0x3d, 0x81, 0x1c, 0xb1, 0x62, 0x3e, 0xa7, 0x3c, 0x0a, 0x78, 0x42, 0x61, 0x30, 0xa3, 0x06, 0x26, 0x77, 0x06, 0xb7, 0xd0, 0xc6, 0xcf, 0x27, 0xa1, 0x51, 0x57, 0x58, 0x2e, 0x56, 0x1a, 0x7b, 0x19, 0xee, 0x20, 0xa2, 0x62, 0x5f, 0xd7, 0x81, 0xa4, 0x97, 0xe4, 0xcb, 0xa8, 0x3b, 0xa3, 0xc1, 0x59, 0x2c, 0x0e, 0x37, 0x44, 0x74, 0xc1, 0x57, 0x5c, 0xd4, 0x1c, 0xcb, 0x9b, 0x19, 0x8e, 0x58, 0x51, 0xdc, 0x75, 0xe1, 0x2a, 0x70, 0x71, 0xa6, 0x81, 0xc4, 0xb2, 0xbc, 0x00, 0x78, 0x44, 0xda, 0x39, 0x8d, 0x4b, 0xe9, 0xc3, 0x59, 0x44, 0xcd, 0x1c, 0x6a, 0x8d, 0x33, 0x51, 0x28, 0xc5, 0x37, 0xb3, 0xf4, 0xa3, 0x53, 0x33, 0xb1, 0x46, 0x3d, 0xc6, 0xf6, 0x76, 0x19, 0x78, 0xe6, 0x76, 0x79, 0x71, 0x58, 0x51, 0xd5, 0xc3, 0xa0, 0xe5, 0x18, 0x76, 0xfe, 0x98, 0x6c, 0x55, 0x99, 0x07, 0x5c, 0x5f, 0xea, 0x45, 0xa5, 0x6c, 0x8d, 0x2f, 0x04, 0x22, 0xd5, 0x0c, 0x40, 0xc6, 0xaf, 0xca, 0xef, 0xa7, 0x0b, 0x99, 0xe2, 0xff, 0xf8, 0x88, 0xfd, 0x1b, 0x50, 0x4b, 0x07, 0x08, 0x49, 0xb0, 0x8f, 0x98, 0x19, 0x07, 0x00, 0x00, 0xa6, 0x09, 0x00, 0x00, 0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x08, 0x00, 0x08, 0x00, 0xdc, 0x91, 0xbd, 0x4e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x26, 0x07, 0x00, 0x00, 0x23, 0x00, 0x20, 0x00, 0x63, 0x65, 0x72, 0x74, 0x73, 0x2f, 0x62, 0x61, 0x73, 0x65, 0x36, 0x34, 0x5f, 0x57, 0x69, 0x6e, 0x64, 0x6f, 0x77, 0x73, 0x5f, 0x50, 0x72, 0x6f, 0x64, 0x75, 0x63, 0x74, 0x69, 0x6f, 0x6e, 0x2e, 0x63, 0x65, 0x72, 0x55, 0x54, 0x0d, 0x00, 0x07, 0x21, 0xcc, 0xee, 0x5c, 0x5d, 0xe2, 0xd2, 0x6a, 0x5a, 0xe2, 0xd2, 0x6a, 0x75, 0x78, 0x0b, 0x00, 0x01, 0x04, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x8d, 0x55, 0xcb, 0xb2, 0xaa, 0x38, 0x14, 0x9d, 0x5b, 0xe5, 0x3f, 0xf4, 0xdc, 0xba, 0x75, 0x00, 0x05, 0x65, 0xd0, 0x83, 0x04, 0xc2, 0x43, 0x0c, 0x1a, 0x0c, 0x20, 0xce, 0x78, 0x78, 0x40, 0x5e, 0x3e, 0x31, 0xc0, 0xd7, 0x77, 0xf4, 0x0c, 0xfa, 0x76, 0x75, 0x0f, 0x3a, 0x55, 0x54, 0xc1, 0xce, 0x4e, 0xf6, 0x62, 0xaf, 0xb5, 0x92, 0x5f, 0xbf, 0xf8, 0x80, 0xc8, 0xb4, 0xdd, 0x3f, 0x34, 0xe4, 0x51, 0xdb, 0xb0, 0x35, 0x40, 0xd1, 0x3b, 0xf8, 0x6b, 0x3a, 0xc1, 0xb6, 0x6d, 0x40, 0x5d, 0xd3, 0xc0, 0x6c, 0xc8, 0x01, 0xb3, 0x21, 0xc8, 0x6d, 0x8a, 0x19, 0x00, 0x80, 0x1c, 0x3b, 0x36, 0x1c, 0x10, 0x4e, 0xab, 0x48, 0xcf, 0xc1, 0x7b, 0x40, 0x58, 0x02, 0x17, 0xe6, 0xd5, 0xad, 0xa8, 0xce, 0xa6, 0xca, 0x04, 0x08, 0xc8, 0xc3, 0x98, 0x4e, 0x80, 0xae, 0xc1, 0x42, 0x47, 0x1b, 0x0c, 0x2a, 0x13, 0x88, 0x3e, 0x82, 0x05, 0xd6, 0x82, 0x00, 0xf7, 0x68, 0x04, 0x1e, 0xcc, 0xdd, 0x80, 0x6f, 0x49, 0xb5, 0x3a, 0x2b, 0x52, 0xa9, 0xb8, 0x26, 0x4d, 0x26, 0x24, 0xd2, 0xa2, 0x47, 0x3a, 0xd8, 0xfe, 0xcc, 0xa5, 0x74, 0x3a, 0x81, 0xe2, 0xba, 0x3e, 0x9a, 0xe2, 0x2b, 0x69, 0x48, 0x6f, 0x95, 0x20, 0xfd, 0x99, 0xb9, 0x50, 0xc3, 0x17, 0xaf, 0xd1, 0x7c, 0xfd, 0x4a, 0x25, 0xb5, 0xc9, 0x34, 0xa8, 0x27, 0xf3, 0x35, 0xe3, 0x4f, 0x91, 0x99, 0xf5, 0x2b, 0x29, 0x51, 0x87, 0x35, 0xf6, 0xa9, 0xc8, 0x31, 0xf4, 0xb8, 0xa6, 0x61, 0x5d, 0xa6, 0x8d, 0x3a, 0x26, 0xd2, 0x51, 0xb0, 0x8d, 0x8c, 0xd7, 0xf2, 0x5e, 0xd9, 0x1c, 0xe7, 0xbe, 0xb5, 0x7e, 0x1d, 0xad, 0xa0, 0xfc, 0xac, 0x3a, 0x43, 0x42, 0x04, 0x94, 0xe3, 0x92, 0xaf, 0xa0, 0xe0, 0x64, 0x30, 0xa1, 0x77, 0x4b, 0xc4, 0x78, 0x1f, 0x28, 0x1a, 0xb0, 0x8e, 0x65, 0x3c, 0x1a, 0xf1, 0x3b, 0xba, 0xd5, 0xdf, 0x19, 0x7f, 0xc7, 0xb0, 0x05, 0x7a, 0x6d, 0x04, 0xeb, 0x1f, 0x6c, 0x11, 0x05, 0x75, 0x40, 0xb1, 0x87, 0x19, 0x22, 0x91, 0x1e, 0x10, 0x62, 0x4f, 0x27, 0x88, 0x5d, 0x0f, 0xd1, 0xc1, 0xbd, 0xc4, 0xa1, 0xdc, 0x66, 0xa6, 0xda, 0x61, 0x0f, 0x30, 0x3d, 0xff, 0xcc, 0x5a, 0x88, 0x65, 0xfb, 0x63, 0xe8, 0x3d, 0x13, 0x49, 0xae, 0xb0, 0xb7, 0x60, 0x16, 0xf8, 0xc4, 0x1d, 0xd4, 0x07, 0x6e, 0x1c, 0xba, 0x43, 0x32, 0x77, 0x5f, 0xd3, 0xc9, 0xb1, 0x25, 0x39, 0x91, 0xd4, 0x21, 0x35, 0xd5, 0x21, 0x3a, 0x78, 0xd7, 0x77, 0xa7, 0xcc, 0x12, 0x44, 0x3f, 0x35, 0x39, 0x9a, 0x7f, 0xf6, 0xe3, 0xc0, 0x2b, 0x55, 0xc9, 0x3c, 0x1b, 0x39, 0x87, 0xd0, 0xe6, 0xdc, 0xf0, 0x4e, 0xfe, 0x83, 0x1d, 0x64, 0x00, 0xb0, 0xd5, 0x00, 0x59, 0x81, 0x77, 0x86, 0x96, 0x3b, 0xfc, 0x1d, 0x81, 0x21, 0x4c, 0x63, 0x2d, 0xca, 0x0b, 0xd7, 0x6e, 0xab, 0xf9, 0x29, 0xbd, 0x0e, 0x9d, 0xd4, 0x1d, 0x97, 0x1b, 0x2d, 0x50, 0xc9, 0x7e, 0x3a, 0x59, 0x9a, 0x61, 0x74, 0x5f, 0x88, 0xdd, 0x37, 0xad, 0xd2, 0x8d, 0xa2, 0x9c, 0x98, 0xd5, 0xd7, 0xe0, 0x12, 0x96, 0x4d, 0xe5, 0x98, 0x4a, 0x28, 0xc1, 0xab, 0x0a, 0xa3, 0x88, 0x5c, 0x2a, 0x51, 0x38, 0xeb, 0x27, 0xdd, 0x04, 0x1a, 0x52, 0x83, 0xf2, 0xae, 0x34, 0x8b, 0x75, 0x56, 0xcc, 0xa2, 0x8e, 0x63, 0xf0, 0x36, 0x3d, 0x6e, 0x2d, 0x6d, 0xb5, 0xa6, 0xe6, 0x58, 0xa9, 0x8a, 0x36, 0x36, 0x19, 0xdc, 0x81, 0xce, 0x0f, 0x33, 0x90, 0x5a, 0x6e, 0x43, 0x2b, 0x3b, 0x24, 0x86, 0x02, 0x0e, 0xe3, 0x23, 0x81, 0xe1, 0xe3, 0x54, 0x91, 0x53, 0xf9, 0xd2, 0x21, 0x57, 0xdf, 0x56, 0xeb, 0xec, 0xa8, 0x58, 0x4c, 0x27, 0x0f, 0xfe, 0xc3, 0xb1, 0x9c, 0x96, 0xb4, 0x27, 0xe9, 0xd2, 0x1e, 0xae, 0x6a, 0xba, 0xf4, 0x7a, 0xd8, 0xd0, 0x22, 0x90, 0xa1, 0x6b, 0xd0, 0x6d, 0xbb, 0x77, 0x15, 0x5d, 0x75, 0x57, 0xa3, 0x3f, 0x43, 0x6e, 0x6e, 0x1f, 0xbb, 0xc1, 0xea, 0xcd, 0xd7, 0x6d, 0xf4, 0xb2, 0x7b, 0xe1, 0x2f, 0x4c, 0xbe, 0x83, 0x96, 0x7f, 0x15, 0xa2, 0x56, 0xd9, 0x0b, 0x9a, 0x9f, 0x8e, 0xe4, 0xa8, 0x9d, 0x7c, 0x77, 0xd7, 0x86, 0x81, 0xa2, 0xe3, 0xee, 0xb5, 0xd3, 0xce, 0x37, 0x13, 0x9d, 0x63, 0xf9, 0x5a, 0x6c, 0xd7, 0xc7, 0x01, 0xb9, 0x8e, 0xab, 0x0b, 0xfb, 0x5e, 0x39, 0x91, 0xe3, 0x3d, 0x6a, 0xbb, 0x51, 0xcc, 0x71, 0x3b, 0x9d, 0x44, 0x31, 0x6a, 0xb7, 0xb3, 0x3c, 0x3f, 0xe5, 0xcf, 0xe7, 0xe2, 0x1a, 0x5e, 0x6f, 0xf9, 0x4a, 0x2b, 0x84, 0xd2, 0xbd, 0x57, 0x1b, 0xf1, 0x3b, 0x99, 0x3b, 0xe3, 0xb8, 0x44, 0xf3, 0xc5, 0x97, 0xa3, 0x66, 0x29, 0xcd, 0xe3, 0xed, 0xd0, 0x7c, 0x1b, 0xca, 0xcd, 0x77, 0xe2, 0x84, 0xd8, 0x3a, 0x20, 0x00, 0x4e, 0x27, 0x97, 0x85, 0x0d, 0xf3, 0xb7, 0xb3, 0x0e, 0x8c, 0x59, 0x8c, 0xf3, 0xed, 0x09, 0x35, 0x84, 0x39, 0x33, 0xf2, 0xc8, 0x71, 0x58, 0x04, 0x21, 0x30, 0x35, 0x97, 0x5d, 0x74, 0x98, 0x47, 0xf6, 0xe7, 0x9b, 0xf8, 0x16, 0x60, 0x98, 0x59, 0xe4, 0x93, 0xbb, 0xe5, 0x6c, 0xc2, 0x08, 0x19, 0x10, 0xa5, 0xe7, 0x20, 0xff, 0x7a, 0x3d, 0x82, 0xc6, 0x79, 0xde, 0xbf, 0x8a, 0xc6, 0x7a, 0x2e, 0x1d, 0xac, 0xe4, 0xab, 0x7a, 0x8f, 0x0d, 0xfb, 0xad, 0xff, 0x0c, 0x11, 0x6f, 0x83, 0x51, 0x53, 0x79, 0x23, 0x34, 0x30, 0x11, 0x98, 0xc6, 0x3e, 0xea, 0xda, 0xbc, 0x35, 0xe9, 0xb9, 0x54, 0x84, 0x7b, 0x4c, 0x09, 0xc3, 0x3f, 0x5a, 0x34, 0xd0, 0xf0, 0x18, 0x70, 0x59, 0x2d, 0xdc, 0xb1, 0xba, 0xf3, 0xf8, 0xdc, 0xd5, 0x89, 0x1c, 0x35, 0xfe, 0x13, 0xd3, 0xa0, 0xd8, 0x6a, 0x82, 0x70, 0x0c, 0xd7, 0xc5, 0x86, 0x56, 0xe3, 0xb1, 0xc4, 0x4f, 0xae, 0x49, 0x1d, 0xf5, 0xd8, 0x44, 0x62, 0x34, 0x12, 0xd1, 0xa5, 0xfe, 0x80, 0xe1, 0xea, 0x53, 0xd3, 0x66, 0x24, 0xc2, 0x30, 0x06, 0x86, 0x53, 0x5d, 0x41, 0xd9, 0x6c, 0x8d, 0xc7, 0xfe, 0x70, 0xc2, 0x12, 0x99, 0x1d, 0xe5, 0x5d, 0xd3, 0x19, 0xab, 0x20, 0x56, 0x29, 0x36, 0x88, 0xc9, 0xbd, 0xc9, 0xb3, 0x2d, 0x8e, 0x03, 0xa3, 0x07, 0xdb, 0xc7, 0xd0, 0xba, 0xa0, 0xd0, 0x24, 0x52, 0x21, 0x64, 0x16, 0x50, 0x36, 0x83, 0x3a, 0xcf, 0xe6, 0x69, 0x97, 0xfc, 0xe6, 0xdd, 0x4d, 0xe3, 0xbe, 0x92, 0xbd, 0xca, 0x62, 0xa9, 0x7e, 0xa5, 0x16, 0xe6, 0xbe, 0xe0, 0x9a, 0x7f, 0x6c, 0x04, 0xae, 0x7d, 0x91, 0xbb, 0xba, 0x86, 0x43, 0x22, 0x42, 0x9d, 0x50, 0x9b, 0x61, 0x6a, 0x7c, 0x7f, 0x9c, 0xbc, 0x17, 0x7a, 0xac, 0x71, 0xcf, 0xee, 0x65, 0xbe, 0x0b, 0x63, 0x11, 0xf9, 0xad, 0xa3, 0x04, 0xf1, 0xf3, 0x21, 0xa0, 0x90, 0xa3, 0x41, 0xa6, 0xa6, 0x3d, 0x4c, 0x40, 0x7c, 0x03, 0x8e, 0x40, 0x2b, 0xaa, 0xe0, 0x92, 0x59, 0x1e, 0xdb, 0x9e, 0x57, 0xfc, 0x9c, 0xc8, 0xe6, 0x9b, 0xe6, 0x77, 0x77, 0xc9, 0x65, 0x22, 0x09, 0xaf, 0xd4, 0x7c, 0x5e, 0x93, 0x39, 0x1c, 0xa7, 0x93, 0x8d, 0xe4, 0xd6, 0x69, 0xeb, 0x8d, 0xff, 0x1b, 0x47, 0x4b, 0x98, 0x0e, 0x3e, 0x4c, 0x52, 0x40, 0xac, 0x2f, 0xce, 0x26, 0xb0, 0x19, 0xd0, 0xff, 0x7d, 0x82, 0xfe, 0x78, 0x14, 0x81, 0x57, 0xa4, 0x89, 0xe7, 0x98, 0xe5, 0xce, 0xa5, 0x3f, 0x80, 0xcb, 0x93, 0x1c, 0x62, 0x57, 0xa8, 0x4b, 0x71, 0x2d, 0x07, 0x07, 0x41, 0xfc, 0xea, 0xb8, 0x26, 0x97, 0xeb, 0x21, 0x39, 0x1a, 0x8b, 0xc7, 0x0e, 0x9b, 0x8b, 0x38, 0xbd, 0x18, 0x74, 0x25, 0x83, 0x8b, 0xec, 0x2b, 0xd4, 0x91, 0x01, 0xdd, 0xc1, 0xe5, 0xb0, 0xf3, 0xbb, 0x1a, 0x9c, 0x5f, 0xd7, 0x95, 0x2a, 0xac, 0x74, 0x46, 0xcd, 0x9b, 0x3b, 0x5b, 0x77, 0xca, 0xd9, 0x9a, 0xf9, 0xd5, 0x0b, 0x24, 0xb3, 0xe9, 0x24, 0xfe, 0x0a, 0x53, 0x2b, 0x40, 0xb8, 0x27, 0x07, 0x47, 0x3e, 0x6d, 0x0d, 0x17, 0x29, 0xc3, 0xa9, 0xf2, 0xc1, 0x1d, 0x9a, 0x09, 0x76, 0xc3, 0x9a, 0x1a, 0xf7, 0x2b, 0xab, 0xea, 0x26, 0xa0, 0xed, 0x46, 0xf5, 0x66, 0x8b, 0x18, 0x5c, 0x29, 0x3a, 0x29, 0x36, 0xa5, 0xa2, 0xb3, 0xd1, 0xcf, 0x97, 0xe9, 0x44, 0xee, 0x0c, 0xa6, 0xae, 0x5a, 0x79, 0x7f, 0xcb, 0x8b, 0x99, 0xdd, 0x0a, 0xcb, 0x79, 0x3a, 0x0e, 0x67, 0x6a, 0x2e, 0x71, 0x50, 0xc0, 0x53, 0x9f, 0x6c, 0xbf, 0x8b, 0xbc, 0x4d, 0xcf, 0x87, 0x4b, 0xf7, 0x7d, 0x1a, 0x0a, 0x36, 0xf0, 0x6e, 0xe5, 0xe5, 0xa5, 0xdb, 0xdf, 0xf6, 0xe4, 0xf8, 0x58, 0x24, 0xe5, 0x74, 0x92, 0xfa, 0x8c, 0x50, 0x66, 0xd6, 0x7b, 0xc9, 0xcc, 0xe4, 0x78, 0x36, 0x6f, 0x93, 0xba, 0x28, 0xdb, 0x19, 0x29, 0xf6, 0x8f, 0xd1, 0xbe, 0x88, 0x8e, 0xdc, 0x8a, 0x5d, 0xb6, 0xd9, 0x19, 0xe1, 0xb3, 0x95, 0x54, 0xd8, 0xf1, 0xc4, 0xfb, 0x93, 0x1e, 0x76, 0x2f, 0x79, 0xab, 0x7d, 0xbb, 0xcf, 0x0d, 0xf7, 0x45, 0x2d, 0x9d, 0x52, 0x45, 0x1b, 0x4a, 0x9d, 0xa4, 0x8a, 0x95, 0x12, 0xe8, 0x6a, 0x8f, 0x64, 0x1d, 0xdc, 0x94, 0x9b, 0xf9, 0x24, 0x49, 0xe4, 0xa2, 0xd9, 0xb9, 0x98, 0x39, 0x85, 0xed, 0x2f, 0x9e, 0x5b, 0xb9, 0xfc, 0x96, 0xe4, 0xfe, 0x59, 0x7c, 0x4b, 0xf9, 0x9f, 0x7f, 0x4e, 0x27, 0x9f, 0x4b, 0x0f, 0xb9, 0xfa, 0x7f, 0x5c, 0x84, 0x7f, 0x01, 0x50, 0x4b, 0x07, 0x08, 0xf4, 0x77, 0x60, 0xfd, 0x0d, 0x05, 0x00, 0x00, 0x26, 0x07, 0x00, 0x00, 0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x08, 0x00, 0x08, 0x00, 0xdc, 0x91, 0xbd, 0x4e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x48, 0x08, 0x00, 0x00, 0x2c, 0x00, 0x20, 0x00, 0x63, 0x65, 0x72, 0x74, 0x73, 0x2f, 0x62, 0x61, 0x73, 0x65, 0x36, 0x34, 0x5f, 0x57, 0x69, 0x6e, 0x64, 0x6f, 0x77, 0x73, 0x5f, 0x50, 0x72, 0x6f, 0x64, 0x75, 0x63, 0x74, 0x69, 0x6f, 0x6e, 0x5f, 0x50, 0x43, 0x41, 0x5f, 0x32, 0x30, 0x31, 0x31, 0x2e, 0x63, 0x65, 0x72, 0x55, 0x54, 0x0d, 0x00, 0x07, 0x21, 0xcc, 0xee, 0x5c, 0x5d, 0xe2, 0xd2, 0x6a, 0x5a, 0xe2, 0xd2, 0x6a, 0x75, 0x78, 0x0b, 0x00, 0x01, 0x04, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x8d, 0x56, 0x49, 0xcf, 0xa3, 0xba, 0x12, 0xdd, 0x47, 0xca, 0x7f, 0x78, 0xfb, 0xa8, 0x15, 0x86, 0x40, 0x60, 0x71, 0x17, 0x36, 0x18, 0x02, 0x09, 0x10, 0x66, 0xc8, 0x8e, 0x21, 0xcc, 0x43, 0x26, 0x70, 0xc2, 0xaf, 0xbf, 0xfe, 0xbe, 0x7e, 0xfd, 0x74, 0xaf, 0xd4, 0x6a, 0x3d, 0x4b, 0x08, 0x28, 0x97, 0xcb, 0x75, 0xaa, 0x4e, 0x95, 0xfd, 0xe3, 0x07, 0x19, 0x10, 0xa9, 0x9a, 0xf9, 0x1f, 0x09, 0x39, 0x9e, 0xa6, 0x68, 0x12, 0xf0, 0xd0, 0x97, 0xf0, 0xc7, 0x7a, 0x65, 0x68, 0x9a, 0x42, 0x2f, 0x92, 0x04, 0xf6, 0x9b, 0x12, 0x60, 0x0d, 0x82, 0x52, 0x3b, 0xc6, 0x76, 0xce, 0x04, 0x25, 0xf8, 0x1e, 0x92, 0x0c, 0x4c, 0x58, 0xb6, 0xf7, 0xaa, 0xad, 0x55, 0x11, 0x53, 0x10, 0xd8, 0x4f, 0x05, 0xc8, 0x12, 0xac, 0x65, 0x74, 0x32, 0x40, 0xab, 0xae, 0x57, 0x80, 0xf6, 0x11, 0xac, 0x0c, 0x29, 0x08, 0x8c, 0x37, 0x5a, 0x80, 0x03, 0x4b, 0x33, 0x20, 0x66, 0x3c, 0xa9, 0xcb, 0xab, 0x8c, 0xa9, 0x6e, 0x69, 0x9f, 0x53, 0x29, 0xb3, 0x7b, 0x23, 0x19, 0x58, 0x3f, 0xe7, 0x32, 0x0f, 0xd2, 0x7a, 0x77, 0x51, 0xe9, 0x39, 0xed, 0xed, 0xf7, 0x7a, 0x75, 0x68, 0x40, 0xf6, 0x73, 0x66, 0xf4, 0x14, 0x9f, 0xbe, 0xc5, 0xac, 0x3e, 0x67, 0x8c, 0xd8, 0xe7, 0x12, 0x94, 0x53, 0x56, 0xc7, 0xe4, 0xa9, 0x72, 0xb5, 0x9b, 0xd3, 0x06, 0x7d, 0x0c, 0x19, 0xa8, 0x5f, 0x3b, 0x82, 0xb7, 0x71, 0xf3, 0xc2, 0xae, 0xc9, 0x7a, 0x71, 0x59, 0xaf, 0x52, 0xe6, 0x42, 0x69, 0x8a, 0x3e, 0xa7, 0xac, 0x5d, 0xda, 0x4c, 0xf0, 0x21, 0xda, 0x7d, 0x12, 0x9a, 0x64, 0x95, 0x5f, 0xda, 0x51, 0x40, 0x25, 0xaa, 0xf8, 0x49, 0x22, 0x87, 0xd3, 0x64, 0x0d, 0x1b, 0x1e, 0xc0, 0x87, 0x2a, 0x33, 0x0d, 0x0f, 0xbd, 0x0d, 0x19, 0x71, 0x86, 0x57, 0x52, 0x24, 0x0e, 0x9e, 0xfd, 0x09, 0xbf, 0xa4, 0x4d, 0xfc, 0x4b, 0x4a, 0x7f, 0xcb, 0x1a, 0x09, 0x56, 0xff, 0xc5, 0xfa, 0x27, 0xa4, 0xeb, 0xd5, 0xff, 0x83, 0xf5, 0x4f, 0x48, 0x09, 0x8a, 0x7f, 0x63, 0x9d, 0x0c, 0x09, 0xff, 0xc2, 0xda, 0xfd, 0xc2, 0xfa, 0x13, 0x69, 0x4e, 0x76, 0x72, 0xe6, 0x9c, 0x35, 0x4a, 0xff, 0xa0, 0xcf, 0x97, 0x43, 0xd0, 0x7c, 0xad, 0x21, 0x16, 0x6a, 0x68, 0xdb, 0x14, 0x2a, 0x8d, 0x86, 0xac, 0xf1, 0x48, 0x56, 0x5d, 0x0d, 0xcb, 0x76, 0xac, 0x1f, 0xc7, 0x8b, 0x56, 0xcd, 0x99, 0x09, 0x6c, 0x04, 0xa1, 0x0d, 0xe4, 0xb2, 0x44, 0x67, 0x92, 0x45, 0x09, 0xd8, 0xa3, 0x44, 0xbe, 0x21, 0x30, 0x29, 0x63, 0xe2, 0x4f, 0xed, 0x7a, 0x75, 0x2a, 0x87, 0x86, 0x13, 0x22, 0xb6, 0xeb, 0x7b, 0x01, 0x48, 0xaa, 0x98, 0x78, 0xc6, 0xb2, 0xe7, 0x29, 0xf4, 0xa1, 0x5d, 0xb0, 0x2f, 0x13, 0x79, 0x12, 0xfc, 0xb2, 0x32, 0x07, 0x96, 0x1a, 0xe7, 0xc5, 0x3a, 0x49, 0x8f, 0xdb, 0x91, 0x7a, 0x15, 0xaa, 0xce, 0xc1, 0x62, 0xdb, 0xb8, 0x8d, 0x80, 0xd6, 0x2b, 0xd3, 0x85, 0x78, 0x27, 0x78, 0x43, 0xb2, 0x91, 0x32, 0x2c, 0x5f, 0x68, 0x3e, 0x1e, 0xdf, 0x6c, 0x4c, 0x63, 0x2e, 0xc7, 0xec, 0x2b, 0x72, 0xd4, 0xae, 0xae, 0xd2, 0x8a, 0x01, 0xcd, 0xe9, 0xb4, 0xcd, 0x1c, 0x3e, 0x18, 0x44, 0x1a, 0x0d, 0xc3, 0x70, 0x7a, 0x40, 0x3e, 0xd5, 0x27, 0x67, 0xb7, 0x5f, 0xaf, 0xfc, 0x25, 0x10, 0xb8, 0xfc, 0xfc, 0xd4, 0xf7, 0xfd, 0xe1, 0x70, 0xe6, 0xb9, 0x8f, 0x6b, 0xe8, 0x29, 0x5f, 0xa9, 0x6d, 0xa6, 0x4c, 0x5d, 0xf3, 0x86, 0x94, 0x30, 0x35, 0x67, 0x9a, 0x92, 0x92, 0x96, 0x7d, 0x26, 0x8e, 0xd0, 0x1d, 0x15, 0xcc, 0x6c, 0xb7, 0xb4, 0xac, 0xd8, 0x77, 0x7f, 0x07, 0x7b, 0x92, 0xcd, 0x45, 0xdc, 0x4a, 0x68, 0x3a, 0x49, 0xe1, 0xa7, 0x98, 0x74, 0xb6, 0xc4, 0x35, 0xfd, 0xbc, 0x4b, 0xe1, 0xb3, 0xae, 0x03, 0xb3, 0x54, 0xea, 0x05, 0x24, 0x90, 0xf6, 0xa6, 0xe9, 0xad, 0x0b, 0x1c, 0x5d, 0x35, 0x5a, 0x30, 0x4a, 0x91, 0x89, 0xa2, 0x88, 0xa9, 0x03, 0x69, 0xce, 0xaf, 0x45, 0x16, 0x10, 0x0b, 0x4b, 0x90, 0xa7, 0x10, 0x3f, 0x22, 0x83, 0x17, 0x06, 0xc9, 0x3a, 0xa5, 0x0c, 0x4f, 0xeb, 0xaf, 0x96, 0x41, 0x82, 0x79, 0xa6, 0xeb, 0xeb, 0x34, 0x79, 0xda, 0xde, 0xbe, 0x68, 0xcf, 0x5d, 0x56, 0x98, 0xf9, 0xa6, 0xbe, 0x07, 0x68, 0xcf, 0x46, 0xe0, 0x89, 0x2a, 0x26, 0xa4, 0xec, 0x77, 0x3d, 0xae, 0x57, 0xcf, 0x09, 0xbe, 0xd4, 0xa8, 0x78, 0x86, 0xb5, 0xc7, 0xbb, 0xc0, 0x90, 0x00, 0x46, 0x00, 0x24, 0x96, 0x04, 0x7c, 0x03, 0x93, 0x98, 0x6f, 0x0d, 0x08, 0x54, 0xc9, 0x7d, 0xaa, 0xc0, 0xb6, 0x61, 0xd9, 0x64, 0x01, 0x79, 0xcb, 0xa0, 0x44, 0xc0, 0x80, 0xd4, 0x57, 0xd6, 0xf3, 0xf5, 0x4a, 0x2e, 0xed, 0x10, 0x42, 0xf7, 0x76, 0xb4, 0x35, 0xae, 0xa9, 0x52, 0xd4, 0xb1, 0x8d, 0xd9, 0x9e, 0xfb, 0xab, 0xc7, 0x3d, 0xaa, 0x42, 0x09, 0x67, 0x7f, 0x01, 0x17, 0x52, 0x9b, 0x0f, 0x58, 0x22, 0x04, 0x62, 0x8d, 0x55, 0x80, 0x86, 0x64, 0xb8, 0x3b, 0x02, 0xc5, 0x00, 0xb9, 0x0d, 0x6b, 0x52, 0x9b, 0xc8, 0x00, 0xb6, 0x07, 0x4e, 0x5f, 0x9c, 0x3b, 0xd8, 0x02, 0x49, 0x34, 0xf1, 0x23, 0x8e, 0xb1, 0x8c, 0x63, 0x39, 0x70, 0x28, 0x0f, 0xd8, 0x87, 0x2d, 0x04, 0x3e, 0x26, 0xbe, 0xc1, 0xed, 0x02, 0x8a, 0x6f, 0x3d, 0xd7, 0x40, 0xaa, 0x0c, 0xc2, 0x12, 0x7a, 0x24, 0x0e, 0x62, 0x97, 0x9e, 0x9a, 0x4d, 0x5d, 0x47, 0xaa, 0x3e, 0x52, 0x1e, 0xe3, 0xb7, 0xca, 0x1c, 0x2d, 0xb7, 0x31, 0x7e, 0xcb, 0x30, 0xfc, 0xd6, 0x76, 0x04, 0xe4, 0x2d, 0xd0, 0x34, 0xd0, 0x54, 0xba, 0x09, 0x3c, 0x54, 0x6d, 0x30, 0xe6, 0x07, 0x07, 0x5b, 0xb5, 0x30, 0x13, 0x76, 0x3f, 0x09, 0xa3, 0xfa, 0x7f, 0xf2, 0x9c, 0x6b, 0x52, 0x86, 0x9a, 0x33, 0xf5, 0x75, 0x3b, 0x31, 0xe6, 0x27, 0x95, 0x44, 0x4c, 0x58, 0xdd, 0xe6, 0xa1, 0x49, 0x65, 0x1f, 0xd1, 0x24, 0x35, 0xeb, 0xa6, 0x8c, 0x28, 0x5f, 0x22, 0x1d, 0xe6, 0x91, 0x53, 0x7c, 0xf1, 0x98, 0xd4, 0xa6, 0x44, 0x61, 0xb3, 0xa6, 0x3e, 0xc6, 0x87, 0x23, 0x35, 0x80, 0x71, 0x58, 0xc6, 0xda, 0x11, 0xc7, 0x84, 0xc9, 0xfe, 0x81, 0x30, 0x1a, 0x79, 0x0d, 0x34, 0x0c, 0x34, 0xaa, 0x92, 0xf4, 0x15, 0x4d, 0x5f, 0x81, 0x0b, 0x90, 0xaa, 0x86, 0xfb, 0x9f, 0x1f, 0xeb, 0x55, 0xce, 0xe6, 0xec, 0x1f, 0xfc, 0xe8, 0xb2, 0xc1, 0x59, 0x4e, 0x14, 0x99, 0xa7, 0x49, 0x0f, 0xa1, 0xc8, 0x7f, 0xab, 0xd0, 0xb9, 0x22, 0x90, 0x6e, 0x83, 0xf0, 0xc9, 0x03, 0x0c, 0x41, 0xe1, 0x69, 0xcb, 0xa9, 0x37, 0x3f, 0xf9, 0xef, 0xfa, 0x21, 0x20, 0x59, 0x25, 0x99, 0x53, 0xce, 0x6f, 0x21, 0x0b, 0xd4, 0xee, 0x9a, 0xe9, 0xd3, 0x73, 0x12, 0xb8, 0xf3, 0x03, 0x93, 0x6a, 0x11, 0xa7, 0xe3, 0x22, 0xd8, 0xeb, 0x15, 0x62, 0xcf, 0x9b, 0xbb, 0xda, 0xd8, 0xee, 0x31, 0xa6, 0xbc, 0xf8, 0x1e, 0x42, 0x37, 0x9d, 0x0c, 0x3f, 0xb1, 0xe3, 0x68, 0x08, 0xb7, 0x4b, 0x39, 0x39, 0xe1, 0x4c, 0x61, 0xcb, 0x1f, 0x27, 0x73, 0xcc, 0x9b, 0xdd, 0x23, 0x95, 0xf2, 0x2c, 0x79, 0x53, 0xf8, 0x68, 0xf6, 0x97, 0x7b, 0x63, 0xe1, 0x74, 0xbd, 0xa2, 0xb1, 0x6b, 0xdf, 0x61, 0x19, 0xdd, 0xf4, 0x89, 0xdb, 0xb5, 0xe0, 0x63, 0x0e, 0x29, 0xc2, 0xc1, 0x43, 0x9d, 0x37, 0x36, 0xc2, 0xd6, 0x18, 0x52, 0xfc, 0x22, 0x27, 0x96, 0x58, 0x3f, 0x4c, 0xda, 0x4f, 0x15, 0x80, 0xc3, 0x63, 0xfa, 0x28, 0xce, 0xbc, 0x7f, 0xa3, 0x78, 0x4b, 0xb4, 0xde, 0xc2, 0x7a, 0x55, 0x0d, 0x66, 0x84, 0x3b, 0xad, 0xca, 0x16, 0x27, 0x11, 0x78, 0xeb, 0x18, 0x3c, 0x4b, 0xc4, 0x94, 0x99, 0xbe, 0x2f, 0xea, 0xd3, 0x4e, 0xd8, 0x53, 0xc5, 0xc8, 0x4f, 0xc2, 0x39, 0x3e, 0xd5, 0x65, 0xb3, 0x3f, 0x0b, 0x6d, 0x9e, 0x0d, 0xa2, 0x37, 0x59, 0xd3, 0x26, 0xde, 0xc8, 0xcd, 0xd9, 0x53, 0x3a, 0xc2, 0x6a, 0xed, 0xd0, 0x09, 0xf7, 0xc5, 0x54, 0xee, 0x6e, 0x71, 0x4e, 0xea, 0x77, 0x2f, 0xe8, 0x12, 0xa5, 0x4b, 0x28, 0xa2, 0xed, 0x7c, 0xbb, 0x1b, 0xee, 0x53, 0x45, 0x1f, 0x5a, 0x75, 0x83, 0x33, 0x8a, 0x83, 0x03, 0x25, 0x15, 0xd1, 0x26, 0xac, 0x8e, 0x0f, 0xcd, 0x69, 0x23, 0xeb, 0xa8, 0xb9, 0x0d, 0x26, 0x95, 0xf5, 0xe2, 0x16, 0x2b, 0x10, 0x36, 0x77, 0xfa, 0x5d, 0xee, 0x4d, 0x41, 0x46, 0xc7, 0xc6, 0x93, 0xae, 0x03, 0x25, 0xde, 0x12, 0xe5, 0x35, 0x88, 0x4e, 0xad, 0x5e, 0x0e, 0x6a, 0xcc, 0xd4, 0x4f, 0xa8, 0x89, 0xa5, 0x7b, 0x1b, 0x61, 0x74, 0xdd, 0xb7, 0xfe, 0xbb, 0xbe, 0xee, 0x53, 0x08, 0x85, 0x2b, 0xbf, 0x5e, 0x5d, 0xc7, 0x8c, 0x02, 0x98, 0x3b, 0xc5, 0xc3, 0xfd, 0xc2, 0x67, 0x0f, 0x61, 0x69, 0x47, 0xf6, 0xe3, 0x32, 0x6d, 0xc0, 0xe2, 0x6c, 0xdb, 0xb0, 0xd9, 0x04, 0xc4, 0x64, 0xf3, 0x4a, 0xd1, 0x13, 0x1f, 0x15, 0xd0, 0x3c, 0xee, 0x4f, 0xb1, 0x9b, 0x38, 0xb5, 0xad, 0x4c, 0x91, 0x87, 0x54, 0x71, 0xa1, 0xd7, 0x2b, 0xd5, 0x0e, 0x06, 0x8a, 0x33, 0xa3, 0xa8, 0x6e, 0x53, 0x2b, 0x6b, 0xa6, 0xd3, 0xf5, 0x60, 0x72, 0x28, 0x58, 0x42, 0x51, 0x76, 0x97, 0xe1, 0xfe, 0x50, 0xaa, 0x5e, 0x72, 0xba, 0xc6, 0x8e, 0x6e, 0x0c, 0x7c, 0x32, 0xd7, 0x39, 0x95, 0xa3, 0xcf, 0x6c, 0xf9, 0x5b, 0xdd, 0xd2, 0xe8, 0xb1, 0xbc, 0x11, 0x0b, 0x70, 0x8e, 0xe3, 0xe0, 0x36, 0xf8, 0x57, 0x69, 0x71, 0xa0, 0x33, 0x3f, 0x28, 0xad, 0x84, 0x43, 0x32, 0xda, 0x82, 0x1d, 0x15, 0xd3, 0xb0, 0x7b, 0xc6, 0xfb, 0x4c, 0xed, 0x3f, 0x46, 0xf5, 0x3e, 0x77, 0xbb, 0xd4, 0xd2, 0x63, 0x05, 0xc7, 0xcc, 0x91, 0x43, 0x2e, 0x10, 0x3e, 0x2d, 0x53, 0x68, 0xaf, 0xf5, 0x6a, 0x9a, 0x7b, 0x7f, 0xf0, 0xe5, 0x97, 0x8a, 0xa2, 0xf7, 0x32, 0xde, 0xb2, 0x64, 0xe1, 0x1f, 0x40, 0x34, 0xb1, 0x2a, 0x8d, 0xc7, 0x64, 0x82, 0x85, 0x23, 0x1e, 0x82, 0x18, 0x8f, 0x1f, 0xe1, 0xbe, 0x8d, 0xcc, 0x4a, 0xb8, 0x67, 0xca, 0xa3, 0xb3, 0xbb, 0x56, 0xcb, 0xfc, 0x57, 0x34, 0x0d, 0x3c, 0x39, 0x2f, 0xca, 0x02, 0x54, 0xe7, 0xb3, 0x9d, 0xe1, 0x2c, 0xe4, 0x5a, 0xdd, 0xb0, 0x6a, 0x14, 0x7a, 0xd5, 0xd4, 0xbf, 0x35, 0xbd, 0xdf, 0xf4, 0xc6, 0xac, 0x74, 0x89, 0x93, 0xc7, 0xaf, 0xa4, 0x8c, 0x49, 0xbf, 0x99, 0x23, 0xdf, 0xce, 0x59, 0x4a, 0x14, 0xa8, 0x90, 0x1b, 0xb8, 0x6b, 0xf1, 0xa1, 0xaf, 0x80, 0x9c, 0x17, 0x8b, 0x75, 0x83, 0x86, 0xc8, 0xde, 0x54, 0x2d, 0x0b, 0xa3, 0xdd, 0x5f, 0xeb, 0xd5, 0xf7, 0xb5, 0x00, 0x99, 0xf2, 0x6f, 0xae, 0x0a, 0x7f, 0x03, 0x50, 0x4b, 0x07, 0x08, 0x14, 0x55, 0x5e, 0xcd, 0xd3, 0x05, 0x00, 0x00, 0x48, 0x08, 0x00, 0x00, 0x50, 0x4b, 0x03, 0x04, 0x14, 0x00, 0x08, 0x00, 0x08, 0x00, 0xdc, 0x91, 0xbd, 0x4e, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x8a, 0x08, 0x00, 0x00, 0x28, 0x00, 0x20, 0x00, 0x63, 0x65, 0x72, 0x74, 0x73, 0x2f, 0x4d, 0x69, 0x63, 0x72, 0x6f, 0x73, 0x6f, 0x66, 0x74, 0x5f, 0x4d, 0x61, 0x72, 0x6b, 0x65, 0x74, 0x50, 0x6c, 0x61, 0x63, 0x65, 0x5f, 0x50, 0x43, 0x41, 0x5f, 0x32, 0x30, 0x31, 0x31, 0x2e, 0x63, 0x65, 0x72, 0x55, 0x54, 0x0d, 0x00, 0x07, 0x21, 0xcc, 0xee, 0x5c, 0x5d, 0xe2, 0xd2, 0x6a, 0x5a, 0xe2, 0xd2, 0x6a, 0x75, 0x78, 0x0b, 0x00, 0x01, 0x04, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x75, 0x56, 0xc9, 0xb2, 0xb2, 0xba, 0x1a, 0x9d, 0x5b, 0xe5, 0x3b, 0xdc, 0x39, 0xf5, 0x97, 0x08, 0x36, 0x30, 0x4c, 0x42, 0xe8, 0x03, 0x82, 0xf4, 0x33, 0x01, 0x05, 0x69, 0x54, 0xa4, 0x95, 0xa7, 0xbf, 0xb8, 0x77, 0xdd, 0xaa, 0x73, 0xea, 0x9c, 0x9b, 0x09, 0xf0, 0x25, 0xf9, 0xba, 0xb5, 0x56, 0xc8, 0x9f, 0x3f, 0xcb, 0x80, 0x58, 0x52, 0x8c, 0xff, 0x20, 0x6c, 0x3b, 0x8a, 0xa8, 0x20, 0xe0, 0xe0, 0xaf, 0xf1, 0xcf, 0x7a, 0x45, 0x14, 0x45, 0x42, 0x02, 0x42, 0x60, 0x83, 0x32, 0x30, 0x2a, 0x10, 0x64, 0x8a, 0x43, 0x46, 0x00, 0x80, 0xf0, 0x4a, 0x64, 0x74, 0xb8, 0x1d, 0x77, 0x25, 0x76, 0xbe, 0xdf, 0xcb, 0x30, 0x0b, 0x60, 0xc0, 0xac, 0x6c, 0xf2, 0xf2, 0x2e, 0xf1, 0x23, 0x0d, 0x81, 0xd5, 0x8a, 0xeb, 0x15, 0x10, 0x20, 0x4f, 0xac, 0x76, 0x44, 0x56, 0x28, 0x78, 0x96, 0x25, 0xe1, 0x51, 0xf5, 0xdc, 0x19, 0x3b, 0x64, 0x09, 0x09, 0xb6, 0x2e, 0x46, 0x90, 0x68, 0x1e, 0x23, 0xce, 0x17, 0xa9, 0xea, 0x23, 0xd6, 0x1e, 0xe2, 0x02, 0x5b, 0x04, 0xec, 0x7e, 0xe6, 0xe0, 0x44, 0xe4, 0xf5, 0xca, 0xad, 0xbd, 0x32, 0xf6, 0xf9, 0x3e, 0x12, 0xf0, 0x95, 0xc0, 0xf1, 0x77, 0x57, 0x4e, 0x3c, 0xc7, 0xaf, 0x8a, 0xa4, 0xe6, 0xe7, 0x98, 0x89, 0x68, 0x05, 0x1b, 0x43, 0xf2, 0x80, 0x43, 0x52, 0x8b, 0xf4, 0x65, 0x59, 0x4b, 0xce, 0xc9, 0xa8, 0xfe, 0x46, 0x14, 0xd6, 0x2b, 0x3c, 0xed, 0x8d, 0x8b, 0x6f, 0x7c, 0x62, 0xd6, 0x18, 0xa2, 0x87, 0x95, 0x39, 0xbe, 0xf8, 0xb9, 0x30, 0x1e, 0xed, 0x4a, 0x53, 0x1e, 0x32, 0x6e, 0xe6, 0x62, 0x03, 0x2a, 0x82, 0x32, 0x12, 0x07, 0x8f, 0x72, 0x9e, 0x18, 0xc4, 0x71, 0x47, 0x43, 0x50, 0x66, 0xe2, 0x84, 0xb4, 0x31, 0x2b, 0x9f, 0xf5, 0xca, 0xff, 0xb1, 0x66, 0x7f, 0xb3, 0xfa, 0x05, 0x82, 0x85, 0x80, 0x75, 0x02, 0xca, 0xdf, 0x6c, 0x73, 0x82, 0x3c, 0x8f, 0x4c, 0x78, 0x06, 0x36, 0xcc, 0x0c, 0x6f, 0x69, 0x96, 0x83, 0xaa, 0x34, 0x4f, 0x98, 0xfc, 0xb5, 0x5e, 0xc5, 0x75, 0x4a, 0xc7, 0xcc, 0x6e, 0xc2, 0x02, 0x30, 0x7f, 0x67, 0x13, 0x07, 0x6e, 0xd5, 0x2a, 0x92, 0xb6, 0x43, 0x5c, 0x5b, 0x93, 0x5c, 0x80, 0xe4, 0xd7, 0xfe, 0x74, 0x44, 0x77, 0xfb, 0x0a, 0x59, 0x75, 0x48, 0x18, 0xbe, 0x4e, 0x11, 0x14, 0x62, 0x56, 0x1d, 0x17, 0x0f, 0xac, 0x9a, 0xa7, 0x52, 0xf5, 0xed, 0x90, 0x41, 0x40, 0xfb, 0xdb, 0x87, 0x89, 0x60, 0xc7, 0xe5, 0x2d, 0xb7, 0xc0, 0x0f, 0x82, 0xdc, 0x1f, 0x1b, 0x98, 0xc8, 0xf5, 0xef, 0xbd, 0xd9, 0xe6, 0x49, 0xdd, 0x55, 0xeb, 0x55, 0x2a, 0xc3, 0x36, 0xf4, 0x8d, 0x4a, 0xf9, 0xd6, 0x8b, 0x93, 0x8c, 0x08, 0x98, 0x59, 0x10, 0x86, 0xca, 0x3f, 0x90, 0xc3, 0xe2, 0x82, 0x27, 0x02, 0x16, 0x07, 0xbe, 0xf3, 0x28, 0xd3, 0x96, 0x77, 0x0c, 0xd6, 0xab, 0x77, 0xeb, 0xda, 0xb3, 0x20, 0x4d, 0x89, 0x9d, 0xf5, 0x19, 0x6a, 0xed, 0x87, 0xfd, 0x2c, 0x1c, 0x6c, 0x75, 0x69, 0xa9, 0xd0, 0x35, 0x67, 0x32, 0xdd, 0x27, 0x30, 0x76, 0x4d, 0x7a, 0xd4, 0xfd, 0xdc, 0x21, 0xb5, 0x52, 0xce, 0x78, 0xa0, 0x1f, 0xec, 0x7e, 0x23, 0xc2, 0xf3, 0xeb, 0xc1, 0x06, 0xc1, 0x7a, 0x25, 0x08, 0xba, 0xff, 0xd9, 0x5c, 0xae, 0x4c, 0x79, 0x37, 0x1a, 0x31, 0x97, 0x9a, 0xfa, 0x5e, 0x11, 0xfb, 0x92, 0x9c, 0x9a, 0x58, 0xd9, 0x43, 0x83, 0x9c, 0x28, 0x3e, 0xcd, 0x83, 0xd6, 0x0d, 0xb5, 0x7d, 0x53, 0x75, 0x17, 0x73, 0xdf, 0x8b, 0xa1, 0x88, 0x17, 0x22, 0x58, 0x9a, 0xa2, 0xb2, 0x64, 0xc1, 0x42, 0xe2, 0x37, 0x67, 0xc2, 0x6f, 0xc2, 0x42, 0xd9, 0xb7, 0x30, 0xb8, 0x98, 0xbd, 0xee, 0xd0, 0xfa, 0x49, 0x96, 0xe3, 0x43, 0x1b, 0xe5, 0xe5, 0xc3, 0x79, 0xb9, 0xe2, 0x5e, 0x0d, 0xaa, 0x3e, 0x7e, 0x18, 0x62, 0xca, 0x50, 0x8d, 0x19, 0x9e, 0x94, 0x23, 0x72, 0x9f, 0xf6, 0x70, 0x4d, 0x3c, 0x52, 0x37, 0x4b, 0x0e, 0xc3, 0x70, 0xb6, 0xa3, 0xbb, 0xca, 0x11, 0xef, 0xd5, 0xf3, 0xcd, 0x91, 0x0e, 0x8a, 0x91, 0x67, 0x6f, 0xd7, 0xc8, 0x78, 0x29, 0xc0, 0x0c, 0x64, 0xb9, 0x6d, 0x10, 0x1a, 0x08, 0x5f, 0x1d, 0x51, 0x50, 0x1b, 0xdb, 0xf3, 0x3c, 0xb8, 0x07, 0x3d, 0xd8, 0x24, 0x40, 0xbb, 0xc3, 0xe7, 0x23, 0x89, 0xd7, 0xab, 0x24, 0x91, 0xb0, 0xc9, 0x2a, 0x36, 0x9d, 0x2b, 0xfb, 0x49, 0xf6, 0xa9, 0x9c, 0x7d, 0x51, 0xa7, 0xcf, 0x9e, 0xd1, 0xdc, 0x24, 0xf5, 0x75, 0xd6, 0x2a, 0x91, 0xd5, 0x7a, 0x43, 0xdf, 0x36, 0x8f, 0xfc, 0xb8, 0x91, 0x6e, 0xd6, 0xab, 0xfd, 0x90, 0xf9, 0x6d, 0xf4, 0xbe, 0x5c, 0x3c, 0x40, 0x35, 0x2e, 0x1e, 0x08, 0x40, 0xfc, 0xf6, 0x9d, 0xed, 0x64, 0x91, 0x9b, 0x26, 0x54, 0xb3, 0x82, 0x98, 0x09, 0x8e, 0xa5, 0x08, 0xc0, 0x02, 0xf0, 0xb9, 0x53, 0x60, 0x3c, 0x2f, 0xaa, 0xf3, 0xdb, 0x11, 0x67, 0xa1, 0xaa, 0x8d, 0x21, 0x84, 0x40, 0x42, 0xc6, 0xe4, 0x2e, 0x4f, 0x17, 0x81, 0xf1, 0x8b, 0x05, 0x70, 0x40, 0xb1, 0xa0, 0xf6, 0x86, 0x19, 0xc6, 0x20, 0x54, 0x58, 0xd1, 0x52, 0xb0, 0x98, 0x59, 0xae, 0xd0, 0xa7, 0x32, 0x56, 0x23, 0xfd, 0xf8, 0xee, 0x35, 0x6e, 0x3f, 0x85, 0x6f, 0xd0, 0xeb, 0x6d, 0x7b, 0xba, 0xb4, 0x83, 0x35, 0xca, 0x5f, 0x4d, 0xd8, 0xb4, 0x09, 0x61, 0x88, 0xd7, 0x2b, 0x11, 0x4c, 0xcc, 0x47, 0x32, 0xcb, 0xa7, 0x48, 0xf2, 0xd8, 0xde, 0x66, 0x30, 0x4e, 0x73, 0xa5, 0x4c, 0xa1, 0x52, 0x36, 0x29, 0x81, 0xa5, 0x84, 0xce, 0x0b, 0xcb, 0x2c, 0x0b, 0x66, 0x45, 0xe2, 0x82, 0xcc, 0x22, 0x72, 0xf6, 0x04, 0xee, 0x08, 0xb7, 0x40, 0x52, 0x80, 0x35, 0x42, 0xf8, 0xad, 0xe2, 0x87, 0x87, 0xa9, 0x30, 0x2e, 0xf4, 0x58, 0xce, 0x87, 0xbc, 0x00, 0xe7, 0x2f, 0x8b, 0x65, 0x9b, 0x40, 0x70, 0xe3, 0x30, 0x12, 0xc0, 0xe2, 0x41, 0xde, 0x80, 0x0c, 0x03, 0x02, 0xb9, 0x9f, 0xb5, 0xca, 0x68, 0x85, 0x04, 0x5e, 0x80, 0x08, 0x78, 0x67, 0xbd, 0xfa, 0xcc, 0x9c, 0x1f, 0x9e, 0x03, 0x2a, 0x5c, 0x02, 0xd3, 0xc7, 0x8a, 0x3b, 0xa8, 0xa8, 0x6b, 0xf7, 0x8e, 0x4d, 0xc4, 0xe4, 0x67, 0xb5, 0x3c, 0xda, 0x16, 0xc1, 0xbb, 0xd1, 0xd1, 0xa0, 0xf6, 0xc4, 0x77, 0xc9, 0xae, 0x73, 0x3a, 0x95, 0xc1, 0x41, 0xff, 0xf0, 0x0b, 0xc3, 0xc7, 0x7e, 0xd1, 0xc5, 0x5f, 0xb8, 0xae, 0xd7, 0xc6, 0x10, 0x9f, 0xf9, 0xf1, 0xc2, 0x94, 0xc3, 0xa2, 0xa0, 0x56, 0x67, 0xe1, 0x27, 0x66, 0xec, 0x6d, 0xc8, 0xda, 0xb3, 0x4e, 0x2f, 0xaa, 0xa2, 0x17, 0x2d, 0x54, 0x50, 0xb0, 0x9c, 0xaf, 0xda, 0xc5, 0x1b, 0x29, 0xc0, 0xb4, 0x54, 0x71, 0xa6, 0x47, 0xf2, 0xa1, 0x3f, 0x26, 0xda, 0x7f, 0x7d, 0x8e, 0xfe, 0x18, 0x2a, 0x3f, 0x3d, 0xb7, 0x5c, 0x79, 0xe1, 0x3d, 0x76, 0xe6, 0x85, 0x98, 0xb8, 0x95, 0x10, 0xfa, 0xf6, 0xc3, 0x15, 0xe1, 0x0c, 0x50, 0x5e, 0xf0, 0xcf, 0x54, 0xb6, 0x47, 0xf3, 0xce, 0x0d, 0x8b, 0xb2, 0xd8, 0x94, 0xd5, 0xeb, 0xbf, 0xaa, 0x76, 0x5f, 0xc4, 0x0c, 0x3d, 0x24, 0x52, 0xf7, 0xd2, 0x19, 0xa3, 0x4a, 0x1e, 0xff, 0x3f, 0xfe, 0x37, 0xfa, 0x92, 0xc3, 0xff, 0xe2, 0x3f, 0xac, 0x51, 0xb0, 0x16, 0xcc, 0x9f, 0x91, 0x92, 0x0f, 0x89, 0xb1, 0xc4, 0xd7, 0xa1, 0x05, 0x84, 0x2c, 0x5b, 0x4e, 0x5f, 0x15, 0xb7, 0x0f, 0xa5, 0xfd, 0xf8, 0xbb, 0xed, 0x2d, 0x92, 0x2a, 0xab, 0xa1, 0x34, 0x24, 0x70, 0xb0, 0xf1, 0xe6, 0x53, 0xb7, 0x5e, 0xdd, 0x3f, 0x2f, 0x75, 0xa3, 0x80, 0x48, 0x92, 0xd2, 0x06, 0xe9, 0xf8, 0x90, 0xee, 0xe7, 0xce, 0x28, 0x85, 0x83, 0x50, 0x1a, 0x1d, 0x9b, 0x9d, 0xee, 0x03, 0xca, 0x2f, 0xc5, 0x89, 0x0f, 0x6f, 0x23, 0xb7, 0xd1, 0xa3, 0xd6, 0xbf, 0x64, 0x8c, 0x9a, 0xbc, 0xb0, 0xf7, 0x2c, 0xfc, 0x68, 0x67, 0x76, 0xf7, 0xf5, 0x4a, 0xd3, 0x7b, 0x5d, 0xe5, 0x18, 0x6b, 0xfb, 0x69, 0x3b, 0x7e, 0xd3, 0xa6, 0xe4, 0x19, 0xf5, 0x4f, 0x52, 0x11, 0x93, 0x68, 0xed, 0x66, 0xf3, 0xbe, 0xa2, 0xe0, 0x6e, 0x82, 0xb9, 0x00, 0x43, 0x65, 0xeb, 0xf5, 0x6d, 0x8f, 0x51, 0xe7, 0x55, 0x51, 0x09, 0xd2, 0x44, 0x31, 0x6f, 0x47, 0xdb, 0x4a, 0xd7, 0x2b, 0x9b, 0xbb, 0x99, 0xd0, 0xe7, 0x63, 0x6f, 0x9f, 0xd4, 0x67, 0xeb, 0x6e, 0x9e, 0x3b, 0x2a, 0xb8, 0xa3, 0xdb, 0xf1, 0x6c, 0x75, 0x57, 0x8f, 0x6a, 0xee, 0x5d, 0x78, 0xc0, 0x12, 0xbc, 0x3a, 0xdb, 0xa0, 0x9f, 0xd3, 0x87, 0x8b, 0xa9, 0xd4, 0x7c, 0x5d, 0x35, 0x37, 0xdd, 0x26, 0x97, 0x6b, 0xf5, 0x6c, 0xf3, 0xe5, 0x84, 0x89, 0xeb, 0xa3, 0x66, 0x1e, 0xfa, 0x48, 0x16, 0xc6, 0xf9, 0x71, 0x38, 0xb2, 0x67, 0x38, 0x3d, 0xb1, 0xe7, 0x96, 0x5c, 0xee, 0x56, 0xd3, 0xed, 0x7d, 0x8b, 0x37, 0x36, 0x48, 0x98, 0x22, 0xda, 0x82, 0x5c, 0xa7, 0x76, 0x42, 0x39, 0x9f, 0x5b, 0x01, 0x7c, 0x8e, 0x94, 0xce, 0x04, 0x21, 0xb4, 0x16, 0x0f, 0xb2, 0x69, 0x9a, 0x48, 0x0f, 0x1f, 0x75, 0x0c, 0x59, 0xef, 0x40, 0xdd, 0xe5, 0x9c, 0x0e, 0x03, 0xc6, 0x8c, 0x36, 0x7a, 0x60, 0xbc, 0x9c, 0xbe, 0x1f, 0x19, 0x89, 0xad, 0x0f, 0x9a, 0xeb, 0x57, 0x35, 0xf2, 0x2f, 0xb1, 0x19, 0x5a, 0x49, 0xd2, 0x6e, 0x85, 0x5d, 0xe3, 0xef, 0x62, 0x27, 0x21, 0x4b, 0x15, 0x77, 0xe9, 0xa6, 0x9f, 0x26, 0xe7, 0x9e, 0xd8, 0x98, 0x3d, 0xbc, 0xa3, 0xa3, 0x2f, 0x5a, 0xf4, 0x23, 0xe4, 0x0e, 0x98, 0x9f, 0x95, 0x1b, 0xf5, 0xfc, 0x38, 0xa9, 0x47, 0x1b, 0x61, 0xa1, 0x87, 0xfc, 0x81, 0x2a, 0xa7, 0x81, 0xb8, 0xb2, 0x4b, 0xe9, 0x28, 0x94, 0xa9, 0x36, 0x97, 0x4c, 0x62, 0x2d, 0xba, 0xd0, 0x4e, 0xc1, 0x81, 0xf2, 0x12, 0xd1, 0x88, 0x3a, 0x87, 0x0a, 0x78, 0x36, 0x27, 0xce, 0x49, 0xbd, 0x31, 0xc9, 0xee, 0x48, 0xc3, 0x62, 0x83, 0x3a, 0xc3, 0xe8, 0x76, 0xb1, 0x28, 0x5c, 0xbb, 0x6c, 0x2b, 0x8a, 0xd4, 0xbb, 0xb9, 0x9d, 0x6e, 0x79, 0x67, 0x3c, 0xda, 0xf4, 0xec, 0x8a, 0xf8, 0xf4, 0xb4, 0x96, 0x1c, 0x74, 0x61, 0xbc, 0x72, 0x3d, 0x7e, 0x56, 0x8a, 0x09, 0xf3, 0xb2, 0x9f, 0x2e, 0x05, 0xd3, 0x83, 0x6c, 0xf3, 0xb2, 0xfa, 0x17, 0xde, 0x51, 0x61, 0xc4, 0x99, 0xe3, 0xf3, 0xa6, 0x26, 0x67, 0xad, 0xf1, 0x47, 0xe1, 0x7d, 0xef, 0xb3, 0x99, 0x93, 0x96, 0x9f, 0x08, 0x8f, 0xe9, 0xc6, 0x9d, 0xf4, 0x70, 0xbd, 0x0a, 0xa9, 0xa2, 0xa4, 0x4e, 0x50, 0x89, 0xd3, 0x23, 0x0e, 0x20, 0xa3, 0x34, 0x92, 0x18, 0xf8, 0x84, 0x33, 0x28, 0x4d, 0x4d, 0x9b, 0x84, 0xc4, 0x33, 0x63, 0xc8, 0xa3, 0xe6, 0x5d, 0xd4, 0xc3, 0x56, 0x2d, 0xf3, 0xed, 0x93, 0xc5, 0x95, 0x32, 0xbc, 0xb4, 0x77, 0xe8, 0xee, 0x72, 0x28, 0x0c, 0xe6, 0x82, 0x45, 0x1e, 0xd1, 0xf7, 0x8c, 0x9f, 0x2f, 0x5e, 0x3c, 0xbf, 0x42, 0x0f, 0xba, 0x49, 0x66, 0x70, 0x5b, 0xc9, 0xf7, 0xaa, 0x79, 0xef, 0x70, 0x77, 0xdc, 0x85, 0xb4, 0x1a, 0xf8, 0x61, 0x1c, 0x66, 0x66, 0xc0, 0x6f, 0x4a, 0x4f, 0x8d, 0x3f, 0x37, 0xef, 0x06, 0xf3, 0xe1, 0xdd, 0xe5, 0x5c, 0x4e, 0xe9, 0x0b, 0x1f, 0x36, 0xe3, 0xb5, 0xf1, 0x3f, 0x46, 0x7d, 0xae, 0xdb, 0x50, 0x0b, 0xd8, 0xf5, 0xea, 0xe7, 0x62, 0x81, 0x0d, 0xe1, 0x5f, 0x2e, 0x1b, 0xff, 0x05, 0x50, 0x4b, 0x07, 0x08, 0xd5, 0x7a, 0x64, 0x63, 0x31, 0x06, 0x00, 0x00, 0x8a, 0x08, 0x00, 0x00, 0x50, 0x4b, 0x01, 0x02, 0x14, 0x03, 0x14, 0x00, 0x08, 0x00, 0x08, 0x00, 0xdc, 0x91, 0xbd, 0x4e, 0xc5, 0xcd, 0x4c, 0xac, 0xf0, 0x05, 0x00, 0x00, 0x64, 0x08, 0x00, 0x00, 0x1e, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xb4, 0x81, 0x00, 0x00, 0x00, 0x00, 0x63, 0x65, 0x72, 0x74, 0x73, 0x2f, 0x62, 0x61, 0x73, 0x65, 0x36, 0x34, 0x5f, 0x4d, 0x53, 0x46, 0x54, 0x5f, 0x52, 0x43, 0x41, 0x5f, 0x32, 0x30, 0x31, 0x30, 0x2e, 0x63, 0x65, 0x72, 0x55, 0x54, 0x0d, 0x00, 0x07, 0x21, 0xcc, 0xee, 0x5c, 0x5d, 0xe2, 0xd2, 0x6a, 0x5a, 0xe2, 0xd2, 0x6a, 0x75, 0x78, 0x0b, 0x00, 0x01, 0x04, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x50, 0x4b, 0x01, 0x02, 0x14, 0x03, 0x14, 0x00, 0x08, 0x00, 0x08, 0x00, 0xdc, 0x91, 0xbd, 0x4e, 0xdb, 0x57, 0x2e, 0x58, 0xe9, 0x05, 0x00, 0x00, 0x64, 0x08, 0x00, 0x00, 0x1e, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xb4, 0x81, 0x5c, 0x06, 0x00, 0x00, 0x63, 0x65, 0x72, 0x74, 0x73, 0x2f, 0x62, 0x61, 0x73, 0x65, 0x36, 0x34, 0x5f, 0x4d, 0x53, 0x46, 0x54, 0x5f, 0x52, 0x43, 0x41, 0x5f, 0x32, 0x30, 0x31, 0x31, 0x2e, 0x63, 0x65, 0x72, 0x55, 0x54, 0x0d, 0x00, 0x07, 0x21, 0xcc, 0xee, 0x5c, 0x5d, 0xe2, 0xd2, 0x6a, 0x5a, 0xe2, 0xd2, 0x6a, 0x75, 0x78, 0x0b, 0x00, 0x01, 0x04, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x50, 0x4b, 0x01, 0x02, 0x14, 0x03, 0x14, 0x00, 0x08, 0x00, 0x08, 0x00, 0xdc, 0x91, 0xbd, 0x4e, 0x49, 0xb0, 0x8f, 0x98, 0x19, 0x07, 0x00, 0x00, 0xa6, 0x09, 0x00, 0x00, 0x1f, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xb4, 0x81, 0xb1, 0x0c, 0x00, 0x00, 0x63, 0x65, 0x72, 0x74, 0x73, 0x2f, 0x62, 0x61, 0x73, 0x65, 0x36, 0x34, 0x5f, 0x53, 0x54, 0x4f, 0x52, 0x45, 0x5f, 0x50, 0x43, 0x41, 0x5f, 0x32, 0x30, 0x31, 0x31, 0x2e, 0x63, 0x65, 0x72, 0x55, 0x54, 0x0d, 0x00, 0x07, 0x21, 0xcc, 0xee, 0x5c, 0x5d, 0xe2, 0xd2, 0x6a, 0x5a, 0xe2, 0xd2, 0x6a, 0x75, 0x78, 0x0b, 0x00, 0x01, 0x04, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x50, 0x4b, 0x01, 0x02, 0x14, 0x03, 0x14, 0x00, 0x08, 0x00, 0x08, 0x00, 0xdc, 0x91, 0xbd, 0x4e, 0xf4, 0x77, 0x60, 0xfd, 0x0d, 0x05, 0x00, 0x00, 0x26, 0x07, 0x00, 0x00, 0x23, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xb4, 0x81, 0x37, 0x14, 0x00, 0x00, 0x63, 0x65, 0x72, 0x74, 0x73, 0x2f, 0x62, 0x61, 0x73, 0x65, 0x36, 0x34, 0x5f, 0x57, 0x69, 0x6e, 0x64, 0x6f, 0x77, 0x73, 0x5f, 0x50, 0x72, 0x6f, 0x64, 0x75, 0x63, 0x74, 0x69, 0x6f, 0x6e, 0x2e, 0x63, 0x65, 0x72, 0x55, 0x54, 0x0d, 0x00, 0x07, 0x21, 0xcc, 0xee, 0x5c, 0x5d, 0xe2, 0xd2, 0x6a, 0x5a, 0xe2, 0xd2, 0x6a, 0x75, 0x78, 0x0b, 0x00, 0x01, 0x04, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x50, 0x4b, 0x01, 0x02, 0x14, 0x03, 0x14, 0x00, 0x08, 0x00, 0x08, 0x00, 0xdc, 0x91, 0xbd, 0x4e, 0x14, 0x55, 0x5e, 0xcd, 0xd3, 0x05, 0x00, 0x00, 0x48, 0x08, 0x00, 0x00, 0x2c, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xb4, 0x81, 0xb5, 0x19, 0x00, 0x00, 0x63, 0x65, 0x72, 0x74, 0x73, 0x2f, 0x62, 0x61, 0x73, 0x65, 0x36, 0x34, 0x5f, 0x57, 0x69, 0x6e, 0x64, 0x6f, 0x77, 0x73, 0x5f, 0x50, 0x72, 0x6f, 0x64, 0x75, 0x63, 0x74, 0x69, 0x6f, 0x6e, 0x5f, 0x50, 0x43, 0x41, 0x5f, 0x32, 0x30, 0x31, 0x31, 0x2e, 0x63, 0x65, 0x72, 0x55, 0x54, 0x0d, 0x00, 0x07, 0x21, 0xcc, 0xee, 0x5c, 0x5d, 0xe2, 0xd2, 0x6a, 0x5a, 0xe2, 0xd2, 0x6a, 0x75, 0x78, 0x0b, 0x00, 0x01, 0x04, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x50, 0x4b, 0x01, 0x02, 0x14, 0x03, 0x14, 0x00, 0x08, 0x00, 0x08, 0x00, 0xdc, 0x91, 0xbd, 0x4e, 0xd5, 0x7a, 0x64, 0x63, 0x31, 0x06, 0x00, 0x00, 0x8a, 0x08, 0x00, 0x00, 0x28, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xb4, 0x81, 0x02, 0x20, 0x00, 0x00, 0x63, 0x65, 0x72, 0x74, 0x73, 0x2f, 0x4d, 0x69, 0x63, 0x72, 0x6f, 0x73, 0x6f, 0x66, 0x74, 0x5f, 0x4d, 0x61, 0x72, 0x6b, 0x65, 0x74, 0x50, 0x6c, 0x61, 0x63, 0x65, 0x5f, 0x50, 0x43, 0x41, 0x5f, 0x32, 0x30, 0x31, 0x31, 0x2e, 0x63, 0x65, 0x72, 0x55, 0x54, 0x0d, 0x00, 0x07, 0x21, 0xcc, 0xee, 0x5c, 0x5d, 0xe2, 0xd2, 0x6a, 0x5a, 0xe2, 0xd2, 0x6a, 0x75, 0x78, 0x0b, 0x00, 0x01, 0x04, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x50, 0x4b, 0x05, 0x06, 0x00, 0x00, 0x00, 0x00, 0x06, 0x00, 0x06, 0x00, 0xa6, 0x02, 0x00, 0x00, 0xa9, 0x26, 0x00, 0x00, 0x00, 0x00};
+    }
+
+    
+    const NamespaceManager s_xmlNamespaces[] = {
+    {   // XmlContentType::ContentTypeXml
+        
+    },
+    {   // XmlContentType::AppxBlockMapXml
+        
+    },
+    {   // XmlContentType::AppxManifestXml
+        
+        
+    },
+    {   // XmlContentType::AppxBundleManifestXml
+        
+        
+    }};
+}
@@ -19,22 +19,38 @@ namespace MSIX {
         CompressionStatus Initialize(CompressionOperation operation) noexcept
         {
             m_compressionStream = {0};
+            m_operation = operation;
 
             switch (operation)
             {
                 case CompressionOperation::Inflate:
                     return GetStatus(compression_stream_init(&m_compressionStream, COMPRESSION_STREAM_DECODE, COMPRESSION_ZLIB));
                     break;
+                case CompressionOperation::Deflate:
+                    return GetStatus(compression_stream_init(&m_compressionStream, COMPRESSION_STREAM_ENCODE, COMPRESSION_ZLIB));
+                    break;
                 default:
                     NOTIMPLEMENTED;
             }
         }
 
+        CompressionStatus Reset() noexcept
+        {   // compression_stream can't be reset, start a new one.
+            compression_stream_destroy(&m_compressionStream);
+            return Initialize(m_operation);
+        }
+
         CompressionStatus Inflate() noexcept
         {
             return GetStatus(compression_stream_process(&m_compressionStream, 0));
         }
 
+        CompressionStatus Deflate(CompressionFlush flush) noexcept
+        {   // libcompression can only end a stream, it has no way to flush in the middle of one.
+            if (flush == CompressionFlush::Full) { return CompressionStatus::Error; }
+            return GetStatus(compression_stream_process(&m_compressionStream, (flush == CompressionFlush::Finish) ? COMPRESSION_STREAM_FINALIZE : 0));
+        }
+
         CompressionStatus Cleanup() noexcept
         {
             return GetStatus(compression_stream_destroy(&m_compressionStream));
@@ -62,8 +78,16 @@ namespace MSIX {
             m_compressionStream.dst_size = size;
         }
 
+        CompressionStatus DecompressBlock(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t destinationSize) noexcept
+        {   // COMPRESSION_ZLIB is raw deflate, which is what a block is.
+            if (destinationSize == 0) { return CompressionStatus::Ok; }
+            size_t produced = compression_decode_buffer(destination, destinationSize, source, sourceSize, nullptr, COMPRESSION_ZLIB);
+            return (produced == destinationSize) ? CompressionStatus::Ok : CompressionStatus::Error;
+        }
+
     private:
         compression_stream m_compressionStream = {0};
+        CompressionOperation m_operation = CompressionOperation::Inflate;
 
         CompressionStatus GetStatus(compression_status status)
         {
@@ -0,0 +1,435 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#include "BlockDecoder.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace MSIX {
+
+    namespace {
+
+        // A table entry for the first bits of the input. Codes longer than the root bits of a table go
+        // through a subtable indexed by the bits after them.
+        struct Entry
+        {
+            std::uint16_t value;    // literal, base of a length or distance, or where the subtable starts
+            std::uint8_t  bits;     // length of the code, less the root bits for codes in a subtable
+            std::uint8_t  op;       // kind of entry, and the extra bits of a base or index bits of a subtable
+        };
+
+        enum : std::uint8_t
+        {
+            Invalid     = 0x00,
+            Literal     = 0x10,
+            Base        = 0x20,
+            EndOfBlock  = 0x40,
+            Subtable    = 0x80,
+            LowBits     = 0x0F,
+        };
+
+        const unsigned LiteralRootBits = 10;
+        const unsigned DistanceRootBits = 8;
+        const unsigned CodeLengthRootBits = 7;
+        // Big enough for the subtables of any complete code, building a table checks it anyway.
+        const std::size_t LiteralTableSize = 2048;
+        const std::size_t DistanceTableSize = 1024;
+        const std::size_t CodeLengthTableSize = 1 << CodeLengthRootBits;
+
+        const std::uint16_t LengthBase[29] = {
+            3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        const std::uint8_t LengthExtra[29] = {
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        const std::uint16_t DistanceBase[30] = {
+            1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+            4097, 6145, 8193, 12289, 16385, 24577 };
+        const std::uint8_t DistanceExtra[30] = {
+            0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+        const std::uint8_t CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+        Entry LiteralEntry(unsigned symbol)
+        {
+            if (symbol < 256)  { return { static_cast<std::uint16_t>(symbol), 0, Literal }; }
+            if (symbol == 256) { return { 0, 0, EndOfBlock }; }
+            if (symbol < 286)  { return { LengthBase[symbol - 257], 0, static_cast<std::uint8_t>(Base | LengthExtra[symbol - 257]) }; }
+            return { 0, 0, Invalid };
+        }
+
+        Entry DistanceEntry(unsigned symbol)
+        {
+            if (symbol < 30) { return { DistanceBase[symbol], 0, static_cast<std::uint8_t>(Base | DistanceExtra[symbol]) }; }
+            return { 0, 0, Invalid };
+        }
+
+        Entry CodeLengthEntry(unsigned symbol)
+        {
+            return { static_cast<std::uint16_t>(symbol), 0, Literal };
+        }
+
+        // Builds the decoding table of the canonical code with the given code lengths. Only complete codes
+        // are accepted, except a literal/length or distance code with a single code, as zlib does.
+        bool BuildTable(const std::uint8_t* lengths, unsigned count, Entry (*make)(unsigned), bool allowSingle,
+            unsigned rootBits, Entry* table, std::size_t tableSize)
+        {
+            unsigned counts[16] = { 0 };
+            for (unsigned i = 0; i < count; i++) { counts[lengths[i]]++; }
+            counts[0] = 0;
+
+            int left = 1;
+            unsigned maxLength = 0;
+            for (unsigned length = 1; length < 16; length++)
+            {
+                left = (left << 1) - static_cast<int>(counts[length]);
+                if (left < 0) { return false; }
+                if (counts[length] != 0) { maxLength = length; }
+            }
+            if (left > 0 && !(allowSingle && maxLength <= 1)) { return false; }
+
+            const Entry invalid = { 0, 0, Invalid };
+            std::size_t rootSize = std::size_t(1) << rootBits;
+            for (std::size_t i = 0; i < rootSize; i++) { table[i] = invalid; }
+
+            // Symbols in the order of their codes.
+            unsigned offsets[16] = { 0 };
+            for (unsigned length = 1; length < 15; length++) { offsets[length + 1] = offsets[length] + counts[length]; }
+            std::uint16_t sorted[288];
+            for (unsigned i = 0; i < count; i++)
+            {
+                if (lengths[i] != 0) { sorted[offsets[lengths[i]]++] = static_cast<std::uint16_t>(i); }
+            }
+
+            unsigned remaining[16];
+            std::memcpy(remaining, counts, sizeof(counts));
+            std::size_t used = rootSize;
+            unsigned code = 0;
+            unsigned symbol = 0;
+            unsigned prefix = ~0u;
+            Entry* subtable = nullptr;
+            unsigned subtableBits = 0;
+            for (unsigned length = 1; length <= maxLength; length++, code <<= 1)
+            {
+                for (unsigned n = 0; n < counts[length]; n++, code++)
+                {
+                    // Codes are read starting with their most significant bit.
+                    unsigned reversed = 0;
+                    for (unsigned bit = 0; bit < length; bit++) { reversed |= ((code >> bit) & 1) << (length - 1 - bit); }
+                    Entry entry = make(sorted[symbol++]);
+                    if (length <= rootBits)
+                    {
+                        entry.bits = static_cast<std::uint8_t>(length);
+                        for (std::size_t i = reversed; i < rootSize; i += std::size_t(1) << length) { table[i] = entry; }
+                    }
+                    else
+                    {
+                        if ((reversed & (rootSize - 1)) != prefix)
+                        {   // As few bits as hold the rest of the codes that start with this prefix.
+                            prefix = reversed & (rootSize - 1);
+                            subtableBits = length - rootBits;
+                            int room = 1 << subtableBits;
+                            while (subtableBits + rootBits < maxLength)
+                            {
+                                room -= static_cast<int>(remaining[subtableBits + rootBits]);
+                                if (room <= 0) { break; }
+                                subtableBits++;
+                                room <<= 1;
+                            }
+                            std::size_t size = std::size_t(1) << subtableBits;
+                            if (used + size > tableSize) { return false; }
+                            table[prefix] = { static_cast<std::uint16_t>(used), static_cast<std::uint8_t>(rootBits), static_cast<std::uint8_t>(Subtable | subtableBits) };
+                            subtable = table + used;
+                            for (std::size_t i = 0; i < size; i++) { subtable[i] = invalid; }
+                            used += size;
+                        }
+                        entry.bits = static_cast<std::uint8_t>(length - rootBits);
+                        for (std::size_t i = reversed >> rootBits; i < (std::size_t(1) << subtableBits); i += std::size_t(1) << (length - rootBits)) { subtable[i] = entry; }
+                    }
+                    remaining[length]--;
+                }
+            }
+            return true;
+        }
+
+        struct FixedTables
+        {
+            Entry literal[LiteralTableSize];
+            Entry distance[DistanceTableSize];
+
+            FixedTables()
+            {
+                std::uint8_t lengths[288];
+                std::memset(lengths, 8, 144);
+                std::memset(lengths + 144, 9, 112);
+                std::memset(lengths + 256, 7, 24);
+                std::memset(lengths + 280, 8, 8);
+                BuildTable(lengths, 288, LiteralEntry, false, LiteralRootBits, literal, LiteralTableSize);
+                std::memset(lengths, 5, 32);
+                BuildTable(lengths, 32, DistanceEntry, false, DistanceRootBits, distance, DistanceTableSize);
+            }
+        };
+
+        const FixedTables& GetFixedTables()
+        {
+            static const FixedTables tables;
+            return tables;
+        }
+
+        // Reads the input least significant bit first out of a 64 bit buffer. Past the end of the input the
+        // buffer is filled with zero bytes, which are counted so that using them can be told apart.
+        class BitReader
+        {
+        public:
+            BitReader(const std::uint8_t* source, std::size_t size) : m_next(source), m_end(source + size) {}
+
+            // At least 56 bits in the buffer after this.
+            void Refill()
+            {
+                if (m_end - m_next >= 8)
+                {
+                    std::uint64_t word;
+                    std::memcpy(&word, m_next, sizeof(word));
+                    m_buffer |= LittleEndian(word) << m_count;
+                    m_next += (63 ^ m_count) >> 3;
+                    m_count |= 56;
+                }
+                else
+                {
+                    while (m_count <= 56)
+                    {
+                        std::uint64_t byte = 0;
+                        if (m_next < m_end) { byte = *m_next++; } else { m_overrun++; }
+                        m_buffer |= byte << m_count;
+                        m_count += 8;
+                    }
+                }
+            }
+
+            unsigned Peek() const { return static_cast<unsigned>(m_buffer); }
+            unsigned Count() const { return m_count; }
+
+            void Drop(unsigned bits)
+            {
+                m_buffer >>= bits;
+                m_count -= bits;
+            }
+
+            unsigned Take(unsigned bits)
+            {
+                unsigned value = static_cast<unsigned>(m_buffer & ((std::uint64_t(1) << bits) - 1));
+                Drop(bits);
+                return value;
+            }
+
+            Entry Decode(const Entry* table, unsigned rootBits)
+            {
+                Entry entry = table[Peek() & ((1u << rootBits) - 1)];
+                if (entry.op & Subtable)
+                {
+                    Drop(rootBits);
+                    entry = table[entry.value + (Peek() & ((1u << (entry.op & LowBits)) - 1))];
+                }
+                Drop(entry.bits);
+                return entry;
+            }
+
+            // Goes to the next byte boundary and gives the bytes still in the buffer back to the input, for
+            // stored blocks. False if some of them weren't in the input.
+            bool Align()
+            {
+                Drop(m_count & 7);
+                unsigned bytes = m_count >> 3;
+                if (bytes < m_overrun) { return false; }
+                m_next -= bytes - m_overrun;
+                m_overrun = 0;
+                m_buffer = 0;
+                m_count = 0;
+                return true;
+            }
+
+            // False if bits past the end of the input were used.
+            bool InInput() const { return m_count >= m_overrun * 8; }
+
+            const std::uint8_t* Next() const { return m_next; }
+            std::size_t Available() const { return static_cast<std::size_t>(m_end - m_next); }
+            void Skip(std::size_t bytes) { m_next += bytes; }
+
+        protected:
+            static std::uint64_t LittleEndian(std::uint64_t word)
+            {
+                const std::uint16_t one = 1;
+                if (*reinterpret_cast<const std::uint8_t*>(&one) == 1) { return word; }
+                std::uint64_t result = 0;
+                for (int i = 0; i < 8; i++) { result = (result << 8) | ((word >> (i * 8)) & 0xFF); }
+                return result;
+            }
+
+            const std::uint8_t* m_next;
+            const std::uint8_t* m_end;
+            std::uint64_t m_buffer = 0;
+            unsigned m_count = 0;
+            unsigned m_overrun = 0;
+        };
+
+        bool ReadDynamicTables(BitReader& reader, Entry* literal, Entry* distance)
+        {
+            reader.Refill();
+            unsigned literalCount = reader.Take(5) + 257;
+            unsigned distanceCount = reader.Take(5) + 1;
+            unsigned codeLengthCount = reader.Take(4) + 4;
+            if (literalCount > 286 || distanceCount > 30) { return false; }
+
+            std::uint8_t codeLengths[19] = { 0 };
+            for (unsigned i = 0; i < codeLengthCount; i++)
+            {
+                reader.Refill();
+                codeLengths[CodeLengthOrder[i]] = static_cast<std::uint8_t>(reader.Take(3));
+            }
+            Entry codeLengthTable[CodeLengthTableSize];
+            if (!BuildTable(codeLengths, 19, CodeLengthEntry, false, CodeLengthRootBits, codeLengthTable, CodeLengthTableSize)) { return false; }
+
+            std::uint8_t lengths[286 + 30];
+            unsigned total = literalCount + distanceCount;
+            for (unsigned n = 0; n < total; )
+            {
+                reader.Refill();
+                Entry entry = reader.Decode(codeLengthTable, CodeLengthRootBits);
+                if (entry.op != Literal) { return false; }
+                if (entry.value < 16)
+                {
+                    lengths[n++] = static_cast<std::uint8_t>(entry.value);
+                    continue;
+                }
+                std::uint8_t value = 0;
+                unsigned repeat = 0;
+                if (entry.value == 16)
+                {
+                    if (n == 0) { return false; }
+                    value = lengths[n - 1];
+                    repeat = 3 + reader.Take(2);
+                }
+                else if (entry.value == 17) { repeat = 3 + reader.Take(3); }
+                else { repeat = 11 + reader.Take(7); }
+                if (repeat > total - n) { return false; }
+                std::memset(lengths + n, value, repeat);
+                n += repeat;
+            }
+            if (lengths[256] == 0) { return false; }
+
+            return BuildTable(lengths, literalCount, LiteralEntry, true, LiteralRootBits, literal, LiteralTableSize) &&
+                   BuildTable(lengths + literalCount, distanceCount, DistanceEntry, true, DistanceRootBits, distance, DistanceTableSize);
+        }
+    }
+
+    CompressionStatus DecodeBlock(const std::uint8_t* source, std::size_t sourceSize, std::uint8_t* destination, std::size_t destinationSize) noexcept
+    {
+        if (destinationSize == 0) { return CompressionStatus::Ok; }
+
+        BitReader reader(source, sourceSize);
+        std::uint8_t* out = destination;
+        std::uint8_t* const outEnd = destination + destinationSize;
+        Entry dynamicLiteral[LiteralTableSize];
+        Entry dynamicDistance[DistanceTableSize];
+
+        for (;;)
+        {
+            reader.Refill();
+            unsigned final = reader.Take(1);
+            unsigned type = reader.Take(2);
+            const Entry* literal = nullptr;
+            const Entry* distance = nullptr;
+            if (type == 0)
+            {
+                if (!reader.Align() || reader.Available() < 4) { return CompressionStatus::Error; }
+                const std::uint8_t* header = reader.Next();
+                std::size_t length = header[0] | (header[1] << 8);
+                std::size_t complement = header[2] | (header[3] << 8);
+                if (length != (~complement & 0xFFFF)) { return CompressionStatus::Error; }
+                reader.Skip(4);
+                std::size_t copy = std::min(length, static_cast<std::size_t>(outEnd - out));
+                if (reader.Available() < copy) { return CompressionStatus::Error; }
+                std::memcpy(out, reader.Next(), copy);
+                reader.Skip(copy);
+                out += copy;
+                if (out == outEnd) { return CompressionStatus::Ok; }
+            }
+            else if (type == 1)
+            {
+                literal = GetFixedTables().literal;
+                distance = GetFixedTables().distance;
+            }
+            else if (type == 2)
+            {
+                if (!ReadDynamicTables(reader, dynamicLiteral, dynamicDistance)) { return CompressionStatus::Error; }
+                literal = dynamicLiteral;
+                distance = dynamicDistance;
+            }
+            else
+            {
+                return CompressionStatus::Error;
+            }
+
+            while (literal != nullptr)
+            {
+                // A length and distance with their extra bits take at most 48 bits, so a few literals go
+                // between refills.
+                if (reader.Count() < 48) { reader.Refill(); }
+                Entry entry = reader.Decode(literal, LiteralRootBits);
+                if (entry.op == Literal)
+                {
+                    *out++ = static_cast<std::uint8_t>(entry.value);
+                    if (out == outEnd) { break; }
+                }
+                else if (entry.op & Base)
+                {
+                    std::size_t length = entry.value + reader.Take(entry.op & LowBits);
+                    Entry distanceEntry = reader.Decode(distance, DistanceRootBits);
+                    if (!(distanceEntry.op & Base)) { return CompressionStatus::Error; }
+                    std::size_t back = distanceEntry.value + reader.Take(distanceEntry.op & LowBits);
+                    if (back > static_cast<std::size_t>(out - destination)) { return CompressionStatus::Error; }
+
+                    // Output stops when destination is full, even in the middle of a match.
+                    std::size_t room = static_cast<std::size_t>(outEnd - out);
+                    const std::uint8_t* from = out - back;
+                    if (back >= 8 && room >= length + 8)
+                    {
+                        std::uint8_t* end = out + length;
+                        do
+                        {
+                            std::memcpy(out, from, 8);
+                            out += 8;
+                            from += 8;
+                        } while (out < end);
+                        out = end;
+                    }
+                    else
+                    {
+                        length = std::min(length, room);
+                        if (back == 1)
+                        {
+                            std::memset(out, *from, length);
+                            out += length;
+                        }
+                        else
+                        {
+                            for (std::size_t i = 0; i < length; i++) { *out++ = *from++; }
+                        }
+                        if (out == outEnd) { break; }
+                    }
+                }
+                else if (entry.op == EndOfBlock)
+                {
+                    literal = nullptr;
+                }
+                else
+                {
+                    return CompressionStatus::Error;
+                }
+            }
+            if (out == outEnd) { break; }
+            // The data ended before destination was full.
+            if (final || !reader.InInput()) { return CompressionStatus::Error; }
+        }
+        return reader.InInput() ? CompressionStatus::Ok : CompressionStatus::Error;
+    }
+}
@@ -0,0 +1,18 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#pragma once
+
+#include "ICompressionObject.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace MSIX {
+
+    // Inflates raw deflate data that is all in memory into a buffer of known size, in one go. Knowing both
+    // ends up front it needs no window or state between calls and decodes straight into destination.
+    // Returns Ok once destination is full, Error if the data is bad or ends before that.
+    CompressionStatus DecodeBlock(const std::uint8_t* source, std::size_t sourceSize, std::uint8_t* destination, std::size_t destinationSize) noexcept;
+}
@@ -3,6 +3,7 @@
 //  See LICENSE file in the project root for full license information.
 //
 #include "ICompressionObject.hpp"
+#include "BlockDecoder.hpp"
 #include "Exceptions.hpp"
 #ifdef WIN32
 #include "zlib.h"
@@ -23,25 +24,53 @@ namespace MSIX {
         CompressionStatus Initialize(CompressionOperation operation) noexcept
         {
             m_zstrm = { 0 };
+            m_operation = operation;
 
             switch (operation)
             {
                 case CompressionOperation::Inflate:
                     return GetStatus(inflateInit2(&m_zstrm, -MAX_WBITS));
                     break;
+                case CompressionOperation::Deflate:
+                    return GetStatus(deflateInit2(&m_zstrm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY));
+                    break;
                 default:
                     NOTIMPLEMENTED;
             }
         }
 
+        CompressionStatus Reset() noexcept
+        {
+            SetInput(nullptr, 0);
+            SetOutput(nullptr, 0);
+            return GetStatus((m_operation == CompressionOperation::Deflate) ? deflateReset(&m_zstrm) : inflateReset(&m_zstrm));
+        }
+
         CompressionStatus Inflate() noexcept
         {
             return GetStatus(inflate(&m_zstrm, Z_NO_FLUSH));
         }
 
+        CompressionStatus Deflate(CompressionFlush flush) noexcept
+        {
+            int zflush = Z_NO_FLUSH;
+            switch (flush)
+            {
+                case CompressionFlush::Full:
+                    zflush = Z_FULL_FLUSH;
+                    break;
+                case CompressionFlush::Finish:
+                    zflush = Z_FINISH;
+                    break;
+                default:
+                    break;
+            }
+            return GetStatus(deflate(&m_zstrm, zflush));
+        }
+
         CompressionStatus Cleanup() noexcept
         {
-            return GetStatus(inflateEnd(&m_zstrm));
+            return GetStatus((m_operation == CompressionOperation::Deflate) ? deflateEnd(&m_zstrm) : inflateEnd(&m_zstrm));
         }
 
         size_t GetAvailableSourceSize() noexcept
@@ -66,8 +95,14 @@ namespace MSIX {
             m_zstrm.avail_out = static_cast<uint32_t>(size);
         }
 
+        CompressionStatus DecompressBlock(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t destinationSize) noexcept
+        {   // zlib's streaming inflate keeps a window and state for more input, a block needs neither.
+            return DecodeBlock(source, sourceSize, destination, destinationSize);
+        }
+
     private:
         z_stream        m_zstrm;
+        CompressionOperation m_operation = CompressionOperation::Inflate;
 
         CompressionStatus GetStatus(int status)
         {
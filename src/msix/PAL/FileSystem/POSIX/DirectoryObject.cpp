@@ -9,6 +9,7 @@
 #include <sys/stat.h>
 #include <errno.h>
 #include <fts.h>
+#include <cstdio>
 
 namespace MSIX {
 
@@ -52,4 +53,18 @@ namespace MSIX {
         auto result = ComPtr<IStream>::Make<FileStream>(std::move(name), mode);
         return result;
     }
+    void DirectoryObject::Rename(const std::string& from, const std::string& to)
+    {
+        std::string source = m_root + "/" + from;
+        std::string target = m_root + "/" + to;
+        std::string path = target.substr(0, target.find_last_of("/"));
+        mkdirp(path);
+        ThrowErrorIfNot(Error::FileWrite, (std::rename(source.c_str(), target.c_str()) == 0), target.c_str());
+    }
+
+    void DirectoryObject::Remove(const std::string& name)
+    {
+        std::string path = m_root + "/" + name;
+        ThrowErrorIfNot(Error::FileWrite, (std::remove(path.c_str()) == 0), path.c_str());
+    }
 }
@@ -0,0 +1,81 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+// 
+#include "Exceptions.hpp"
+#include "StreamBase.hpp"
+#include "MappedFileStream.hpp"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits>
+#include <algorithm>
+#include <sstream>
+
+namespace MSIX {
+
+    namespace {
+        // Device and inode say which file it is, size and times whether it changed. The change time can't be
+        // set back by anyone who rewrites the file.
+        std::string GetIdentity(const struct stat& fileStat)
+        {
+            std::ostringstream identity;
+            identity << fileStat.st_dev << ":" << fileStat.st_ino << ":" << fileStat.st_size << ":";
+            #ifdef __APPLE__
+            identity << fileStat.st_mtimespec.tv_sec << "." << fileStat.st_mtimespec.tv_nsec << ":"
+                << fileStat.st_ctimespec.tv_sec << "." << fileStat.st_ctimespec.tv_nsec;
+            #else
+            identity << fileStat.st_mtim.tv_sec << "." << fileStat.st_mtim.tv_nsec << ":"
+                << fileStat.st_ctim.tv_sec << "." << fileStat.st_ctim.tv_nsec;
+            #endif
+            return identity.str();
+        }
+
+        // Reads past the end of a mapped file that was truncated fault with SIGBUS instead of failing, so only
+        // files no other user can write to are mapped.
+        bool IsWritableByOthers(const struct stat& fileStat)
+        {
+            if ((fileStat.st_mode & (S_IWGRP | S_IWOTH)) != 0) { return true; }
+            return ((fileStat.st_mode & S_IWUSR) != 0) && (fileStat.st_uid != geteuid());
+        }
+    }
+
+    ComPtr<IStream> MappedFileStream::Create(const std::string& name)
+    {
+        int fd = open(name.c_str(), O_RDONLY);
+        if (fd == -1) { return ComPtr<IStream>(); }
+
+        void* data = MAP_FAILED;
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) == 0 && S_ISREG(fileStat.st_mode) && !IsWritableByOthers(fileStat) && fileStat.st_size > 0 &&
+            static_cast<std::uint64_t>(fileStat.st_size) <= std::numeric_limits<size_t>::max())
+        {
+            data = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        // The mapping keeps its own reference to the file.
+        close(fd);
+        if (data == MAP_FAILED) { return ComPtr<IStream>(); }
+        return ComPtr<IStream>::Make<MappedFileStream>(name, reinterpret_cast<const std::uint8_t*>(data), static_cast<std::uint64_t>(fileStat.st_size),
+            GetIdentity(fileStat));
+    }
+
+    void MappedFileStream::WillNeed(std::uint64_t position, std::uint64_t size)
+    {
+        #ifdef MADV_WILLNEED
+        if (position >= m_size || size == 0) { return; }
+        size = std::min(size, m_size - position);
+        // madvise wants a page aligned address. The mapping itself starts on a page boundary.
+        static const std::uint64_t pageSize = static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+        auto start = position - (position % pageSize);
+        madvise(const_cast<std::uint8_t*>(m_data + start), static_cast<size_t>(position + size - start), MADV_WILLNEED);
+        #endif
+    }
+
+    MappedFileStream::~MappedFileStream()
+    {
+        if (!m_owner) { munmap(const_cast<std::uint8_t*>(m_data), static_cast<size_t>(m_size)); }
+    }
+}
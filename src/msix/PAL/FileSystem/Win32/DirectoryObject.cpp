@@ -13,6 +13,7 @@
 #include <sstream>
 #include <locale>
 #include <codecvt>
+#include <algorithm>
 #include "MSIXWindows.hpp"
 #include "UnicodeConversion.hpp"
 
@@ -111,7 +112,9 @@ namespace MSIX {
         NOTIMPLEMENTED;
     }
 
-    ComPtr<IStream> DirectoryObject::OpenFile(const std::string& fileName, FileStream::Mode mode)
+    // Makes sure all the directories in the path of fileName exist under root and returns the full path of
+    // the file with Windows separators.
+    static std::string CreateDirectories(const std::string& root, const std::string& fileName)
     {
         std::vector<std::string> directories;
         auto PopFirst = [&directories]()
@@ -122,7 +125,7 @@ namespace MSIX {
         };
 
         // Add the root directory and build a list of directory names to ensure exist
-        std::istringstream stream(m_root + "/" + fileName);
+        std::istringstream stream(root + "/" + fileName);
         std::string directory;
         while (getline(stream, directory, '/'))
         {
@@ -158,13 +161,44 @@ namespace MSIX {
                     ThrowWin32ErrorIfNot(lastError, (lastError == ERROR_ALREADY_EXISTS), "CreateDirectory");
                 }
             }
-            path = path + GetPathSeparator() + PopFirst();
+            path = path + "\\" + PopFirst();
             found = false;
         }
         while(directories.size() > 0);
+        return path;
+    }
+
+    ComPtr<IStream> DirectoryObject::OpenFile(const std::string& fileName, FileStream::Mode mode)
+    {
+        auto path = CreateDirectories(m_root, fileName);
         auto result = ComPtr<IStream>::Make<FileStream>(std::move(utf8_to_wstring(path)), mode);
         return result;
     }
+
+    void DirectoryObject::Rename(const std::string& from, const std::string& to)
+    {
+        std::string source = m_root + "/" + from;
+        std::replace(source.begin(), source.end(), '/', '\\');
+        auto target = CreateDirectories(m_root, to);
+        if (!MoveFileEx(utf8_to_wstring(source).c_str(), utf8_to_wstring(target).c_str(), MOVEFILE_REPLACE_EXISTING))
+        {
+            ThrowWin32ErrorIfNot(GetLastError(), false, "MoveFileEx");
+        }
+    }
+
+    void DirectoryObject::Remove(const std::string& name)
+    {
+        std::string path = m_root + "/" + name;
+        std::replace(path.begin(), path.end(), '/', '\\');
+        auto utf16Path = utf8_to_wstring(path);
+        auto attributes = GetFileAttributes(utf16Path.c_str());
+        bool removed = (attributes != INVALID_FILE_ATTRIBUTES) && ((attributes & FILE_ATTRIBUTE_DIRECTORY) ?
+            RemoveDirectory(utf16Path.c_str()) : DeleteFile(utf16Path.c_str()));
+        if (!removed)
+        {
+            ThrowWin32ErrorIfNot(GetLastError(), false, "Remove");
+        }
+    }
 }
 
 // Don't pollute other compilation units with any of our #defs...
@@ -0,0 +1,251 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#include "SHA256Hardware.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define SHA256_HARDWARE_X86 1
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#elif (defined(__aarch64__) && defined(__ARM_FEATURE_CRYPTO)) || defined(_M_ARM64)
+    // GCC and clang only have the intrinsics when the file is built for armv8-a+crypto, see CMakeLists.txt.
+    #define SHA256_HARDWARE_ARM 1
+    #ifdef _MSC_VER
+        #include <arm64_neon.h>
+    #else
+        #include <arm_neon.h>
+    #endif
+    #if defined(__linux__)
+        #include <sys/auxv.h>
+        #include <asm/hwcap.h>
+    #elif defined(_WIN32)
+        #include <windows.h>
+    #endif
+#endif
+
+// The instructions are only used after checking the processor has them, so on x86 the functions that use them
+// are built for them without building the whole file that way.
+#if defined(SHA256_HARDWARE_X86) && !defined(_MSC_VER)
+    #define SHA256_TARGET __attribute__((target("sha,sse4.1")))
+#else
+    #define SHA256_TARGET
+#endif
+
+namespace MSIX {
+
+    namespace {
+
+        alignas(16) const std::uint32_t K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+        };
+
+        // Hashes count 64 byte blocks of data into state.
+        typedef void (*Transform)(std::uint32_t* state, const std::uint8_t* data, std::size_t count);
+
+    #if defined(SHA256_HARDWARE_X86)
+        bool HasInstructions()
+        {
+            // SHA is bit 29 of EBX for leaf 7, the transform also needs SSSE3 and SSE4.1, bits 9 and 19 of ECX
+            // for leaf 1.
+            unsigned int leaf1[4] = {};
+            unsigned int leaf7[4] = {};
+        #ifdef _MSC_VER
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) { return false; }
+            __cpuid(info, 1);
+            std::memcpy(leaf1, info, sizeof(info));
+            __cpuidex(info, 7, 0);
+            std::memcpy(leaf7, info, sizeof(info));
+        #else
+            if (__get_cpuid_max(0, nullptr) < 7) { return false; }
+            __cpuid(1, leaf1[0], leaf1[1], leaf1[2], leaf1[3]);
+            __cpuid_count(7, 0, leaf7[0], leaf7[1], leaf7[2], leaf7[3]);
+        #endif
+            return ((leaf7[1] & (1u << 29)) != 0) && ((leaf1[2] & (1u << 9)) != 0) && ((leaf1[2] & (1u << 19)) != 0);
+        }
+
+        // The state is kept as ABEF and CDGH, the way sha256rnds2 wants it. The message words are in groups of
+        // four, each group made from the four before it.
+        SHA256_TARGET void TransformBlocks(std::uint32_t* state, const std::uint8_t* data, std::size_t count)
+        {
+            const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bull, 0x0405060700010203ull);
+
+            __m128i dcba = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state));
+            __m128i hgfe = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4));
+            __m128i cdab = _mm_shuffle_epi32(dcba, 0xB1);
+            __m128i efgh = _mm_shuffle_epi32(hgfe, 0x1B);
+            __m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+            __m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xF0);
+
+            for (; count != 0; count--, data += 64)
+            {
+                const __m128i abefSaved = abef;
+                const __m128i cdghSaved = cdgh;
+                __m128i words[4];
+                for (int i = 0; i < 4; i++)
+                {
+                    words[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 16)), byteSwap);
+                }
+                for (int i = 0; i < 16; i++)
+                {
+                    if (i >= 4)
+                    {
+                        __m128i next = _mm_sha256msg1_epu32(words[i & 3], words[(i - 3) & 3]);
+                        next = _mm_add_epi32(next, _mm_alignr_epi8(words[(i - 1) & 3], words[(i - 2) & 3], 4));
+                        words[i & 3] = _mm_sha256msg2_epu32(next, words[(i - 1) & 3]);
+                    }
+                    __m128i message = _mm_add_epi32(words[i & 3], _mm_load_si128(reinterpret_cast<const __m128i*>(K + i * 4)));
+                    cdgh = _mm_sha256rnds2_epu32(cdgh, abef, message);
+                    abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(message, 0x0E));
+                }
+                abef = _mm_add_epi32(abef, abefSaved);
+                cdgh = _mm_add_epi32(cdgh, cdghSaved);
+            }
+
+            __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+            __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_blend_epi16(feba, dchg, 0xF0));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), _mm_alignr_epi8(dchg, feba, 8));
+        }
+    #elif defined(SHA256_HARDWARE_ARM)
+        bool HasInstructions()
+        {
+        #if defined(__APPLE__)
+            return true; // every arm64 Apple processor has them
+        #elif defined(__linux__)
+            return (getauxval(AT_HWCAP) & HWCAP_SHA2) != 0;
+        #elif defined(_WIN32)
+            return IsProcessorFeaturePresent(PF_ARM_V8_CRYPTO_INSTRUCTIONS_AVAILABLE) != 0;
+        #else
+            return false;
+        #endif
+        }
+
+        // The message words are in groups of four, each group made from the four before it.
+        void TransformBlocks(std::uint32_t* state, const std::uint8_t* data, std::size_t count)
+        {
+            uint32x4_t abcd = vld1q_u32(state);
+            uint32x4_t efgh = vld1q_u32(state + 4);
+
+            for (; count != 0; count--, data += 64)
+            {
+                const uint32x4_t abcdSaved = abcd;
+                const uint32x4_t efghSaved = efgh;
+                uint32x4_t words[4];
+                for (int i = 0; i < 4; i++)
+                {
+                    words[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + i * 16)));
+                }
+                for (int i = 0; i < 16; i++)
+                {
+                    if (i >= 4)
+                    {
+                        words[i & 3] = vsha256su1q_u32(vsha256su0q_u32(words[i & 3], words[(i - 3) & 3]), words[(i - 2) & 3], words[(i - 1) & 3]);
+                    }
+                    uint32x4_t message = vaddq_u32(words[i & 3], vld1q_u32(K + i * 4));
+                    uint32x4_t previous = abcd;
+                    abcd = vsha256hq_u32(abcd, efgh, message);
+                    efgh = vsha256h2q_u32(efgh, previous, message);
+                }
+                abcd = vaddq_u32(abcd, abcdSaved);
+                efgh = vaddq_u32(efgh, efghSaved);
+            }
+
+            vst1q_u32(state, abcd);
+            vst1q_u32(state + 4, efgh);
+        }
+    #endif
+
+        Transform GetTransform()
+        {
+        #if defined(SHA256_HARDWARE_X86) || defined(SHA256_HARDWARE_ARM)
+            static const Transform transform = HasInstructions() ? TransformBlocks : nullptr;
+            return transform;
+        #else
+            return nullptr;
+        #endif
+        }
+    }
+
+    bool SHA256Hardware::IsAvailable()
+    {
+        return GetTransform() != nullptr;
+    }
+
+    void SHA256Hardware::Reset()
+    {
+        static const std::uint32_t initial[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        };
+        std::memcpy(m_state, initial, sizeof(m_state));
+        m_buffered = 0;
+        m_length = 0;
+    }
+
+    void SHA256Hardware::Update(const std::uint8_t* data, std::size_t size)
+    {
+        auto transform = GetTransform();
+        m_length += size;
+        if (m_buffered != 0)
+        {
+            auto count = std::min(size, sizeof(m_buffer) - m_buffered);
+            std::memcpy(m_buffer + m_buffered, data, count);
+            m_buffered += count;
+            data += count;
+            size -= count;
+            if (m_buffered < sizeof(m_buffer)) { return; }
+            transform(m_state, m_buffer, 1);
+            m_buffered = 0;
+        }
+        if (size >= sizeof(m_buffer))
+        {
+            auto blocks = size / sizeof(m_buffer);
+            transform(m_state, data, blocks);
+            data += blocks * sizeof(m_buffer);
+            size -= blocks * sizeof(m_buffer);
+        }
+        if (size != 0)
+        {
+            std::memcpy(m_buffer, data, size);
+            m_buffered = size;
+        }
+    }
+
+    void SHA256Hardware::Final(std::uint8_t* hash)
+    {
+        // A 1 bit, zeros up to 8 bytes short of a block and the length in bits, big endian.
+        std::uint64_t bits = m_length * 8;
+        std::uint8_t padding[sizeof(m_buffer) + 8] = { 0x80 };
+        std::size_t size = ((m_buffered < 56) ? 56 : 120) - m_buffered;
+        for (int i = 0; i < 8; i++)
+        {
+            padding[size + i] = static_cast<std::uint8_t>(bits >> (56 - i * 8));
+        }
+        Update(padding, size + 8);
+
+        for (int i = 0; i < 8; i++)
+        {
+            hash[i * 4]     = static_cast<std::uint8_t>(m_state[i] >> 24);
+            hash[i * 4 + 1] = static_cast<std::uint8_t>(m_state[i] >> 16);
+            hash[i * 4 + 2] = static_cast<std::uint8_t>(m_state[i] >> 8);
+            hash[i * 4 + 3] = static_cast<std::uint8_t>(m_state[i]);
+        }
+        Reset();
+    }
+}
@@ -0,0 +1,36 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace MSIX {
+
+    // SHA-256 on the SHA instructions of the processor, SHA-NI on x86 and the crypto extension on ARMv8.
+    // Only usable when IsAvailable says the processor running us has them.
+    class SHA256Hardware
+    {
+    public:
+        static const std::size_t HashSize = 32;
+
+        // Whether the processor has the instructions. Checked the first time, the answer doesn't change.
+        static bool IsAvailable();
+
+        SHA256Hardware() { Reset(); }
+
+        void Reset();
+        void Update(const std::uint8_t* data, std::size_t size);
+
+        // Writes HashSize bytes of hash and resets.
+        void Final(std::uint8_t* hash);
+
+    protected:
+        std::uint32_t m_state[8];
+        std::uint8_t m_buffer[64];
+        std::size_t m_buffered;
+        std::uint64_t m_length;
+    };
+}
@@ -0,0 +1,95 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#pragma once
+
+// Only included by the files that are built for the vector instructions they use, and only for a kernel. Nothing
+// here may come from the standard library: inline functions built for those instructions could be picked by the
+// linker for code that runs on any processor.
+#include <cstddef>
+#include <cstdint>
+
+namespace MSIX {
+
+    namespace {
+
+        alignas(64) const std::uint32_t LanesK[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+        };
+
+        // SHA-256 of one 64 byte block in each of V::Lanes independent hashes, every lane of a vector belonging to
+        // a different hash. state is word major, the Lanes values of word a, then of word b and so on. V supplies
+        // the vector type and its operations.
+        template <class V>
+        inline void TransformLanes(std::uint32_t* state, const std::uint8_t* const* blocks)
+        {
+            typedef typename V::Vector Vector;
+
+            // The message words, word major like the state, big endian as SHA-256 reads them.
+            alignas(64) std::uint32_t words[16 * V::Lanes];
+            for (std::size_t lane = 0; lane < V::Lanes; lane++)
+            {
+                const std::uint8_t* block = blocks[lane];
+                for (std::size_t i = 0; i < 16; i++)
+                {
+                    words[i * V::Lanes + lane] = (static_cast<std::uint32_t>(block[i * 4]) << 24) | (static_cast<std::uint32_t>(block[i * 4 + 1]) << 16) |
+                        (static_cast<std::uint32_t>(block[i * 4 + 2]) << 8) | static_cast<std::uint32_t>(block[i * 4 + 3]);
+                }
+            }
+
+            Vector w[16];
+            for (int i = 0; i < 16; i++)
+            {
+                w[i] = V::Load(words + i * V::Lanes);
+            }
+
+            Vector a = V::Load(state), b = V::Load(state + V::Lanes), c = V::Load(state + 2 * V::Lanes), d = V::Load(state + 3 * V::Lanes);
+            Vector e = V::Load(state + 4 * V::Lanes), f = V::Load(state + 5 * V::Lanes), g = V::Load(state + 6 * V::Lanes), h = V::Load(state + 7 * V::Lanes);
+
+            // Unrolled, the working variables are renamed instead of moved each round.
+        #if defined(__GNUC__)
+            #pragma GCC unroll 64
+        #endif
+            for (int i = 0; i < 64; i++)
+            {
+                if (i >= 16)
+                {
+                    // w[t] = s1(w[t-2]) + w[t-7] + s0(w[t-15]) + w[t-16], kept in a ring of 16.
+                    Vector w15 = w[(i - 15) & 15];
+                    Vector w2 = w[(i - 2) & 15];
+                    Vector s0 = V::Xor3(V::template Rotate<7>(w15), V::template Rotate<18>(w15), V::template ShiftRight<3>(w15));
+                    Vector s1 = V::Xor3(V::template Rotate<17>(w2), V::template Rotate<19>(w2), V::template ShiftRight<10>(w2));
+                    w[i & 15] = V::Add(V::Add(w[i & 15], s0), V::Add(w[(i - 7) & 15], s1));
+                }
+                Vector t1 = V::Add(V::Add(h, V::Xor3(V::template Rotate<6>(e), V::template Rotate<11>(e), V::template Rotate<25>(e))),
+                    V::Add(V::Choose(e, f, g), V::Add(V::Broadcast(LanesK[i]), w[i & 15])));
+                Vector t2 = V::Add(V::Xor3(V::template Rotate<2>(a), V::template Rotate<13>(a), V::template Rotate<22>(a)), V::Majority(a, b, c));
+                h = g;
+                g = f;
+                f = e;
+                e = V::Add(d, t1);
+                d = c;
+                c = b;
+                b = a;
+                a = V::Add(t1, t2);
+            }
+
+            V::Store(state, V::Add(a, V::Load(state)));
+            V::Store(state + V::Lanes, V::Add(b, V::Load(state + V::Lanes)));
+            V::Store(state + 2 * V::Lanes, V::Add(c, V::Load(state + 2 * V::Lanes)));
+            V::Store(state + 3 * V::Lanes, V::Add(d, V::Load(state + 3 * V::Lanes)));
+            V::Store(state + 4 * V::Lanes, V::Add(e, V::Load(state + 4 * V::Lanes)));
+            V::Store(state + 5 * V::Lanes, V::Add(f, V::Load(state + 5 * V::Lanes)));
+            V::Store(state + 6 * V::Lanes, V::Add(g, V::Load(state + 6 * V::Lanes)));
+            V::Store(state + 7 * V::Lanes, V::Add(h, V::Load(state + 7 * V::Lanes)));
+        }
+    }
+}
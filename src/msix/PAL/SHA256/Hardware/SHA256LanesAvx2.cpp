@@ -0,0 +1,52 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+// The only code built for AVX2, and only called after checking the processor has it.
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+
+#if defined(__clang__)
+    #pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+    #pragma GCC push_options
+    #pragma GCC target("avx2")
+#endif
+
+#include "SHA256Lanes.hpp"
+
+namespace MSIX {
+
+    namespace {
+
+        struct Avx2
+        {
+            typedef __m256i Vector;
+            static const std::size_t Lanes = 8;
+
+            static Vector Load(const std::uint32_t* p) { return _mm256_load_si256(reinterpret_cast<const __m256i*>(p)); }
+            static void Store(std::uint32_t* p, Vector v) { _mm256_store_si256(reinterpret_cast<__m256i*>(p), v); }
+            static Vector Broadcast(std::uint32_t x) { return _mm256_set1_epi32(static_cast<int>(x)); }
+            static Vector Add(Vector x, Vector y) { return _mm256_add_epi32(x, y); }
+            static Vector Xor3(Vector x, Vector y, Vector z) { return _mm256_xor_si256(_mm256_xor_si256(x, y), z); }
+            template <int N> static Vector Rotate(Vector x) { return _mm256_or_si256(_mm256_srli_epi32(x, N), _mm256_slli_epi32(x, 32 - N)); }
+            template <int N> static Vector ShiftRight(Vector x) { return _mm256_srli_epi32(x, N); }
+            // (x & y) ^ (~x & z)
+            static Vector Choose(Vector x, Vector y, Vector z) { return _mm256_xor_si256(_mm256_and_si256(_mm256_xor_si256(y, z), x), z); }
+            // (x & y) ^ (x & z) ^ (y & z)
+            static Vector Majority(Vector x, Vector y, Vector z) { return _mm256_or_si256(_mm256_and_si256(_mm256_or_si256(x, y), z), _mm256_and_si256(x, y)); }
+        };
+    }
+
+    void TransformLanesAvx2(std::uint32_t* state, const std::uint8_t* const* blocks)
+    {
+        TransformLanes<Avx2>(state, blocks);
+    }
+}
+
+#if defined(__clang__)
+    #pragma clang attribute pop
+#elif defined(__GNUC__)
+    #pragma GCC pop_options
+#endif
+#endif
@@ -0,0 +1,51 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+// The only code built for AVX-512F, and only called after checking the processor has it.
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+
+#if defined(__clang__)
+    #pragma clang attribute push (__attribute__((target("avx512f"))), apply_to = function)
+#elif defined(__GNUC__)
+    #pragma GCC push_options
+    #pragma GCC target("avx512f")
+#endif
+
+#include "SHA256Lanes.hpp"
+
+namespace MSIX {
+
+    namespace {
+
+        struct Avx512
+        {
+            typedef __m512i Vector;
+            static const std::size_t Lanes = 16;
+
+            static Vector Load(const std::uint32_t* p) { return _mm512_load_si512(p); }
+            static void Store(std::uint32_t* p, Vector v) { _mm512_store_si512(p, v); }
+            static Vector Broadcast(std::uint32_t x) { return _mm512_set1_epi32(static_cast<int>(x)); }
+            static Vector Add(Vector x, Vector y) { return _mm512_add_epi32(x, y); }
+            // The ternary logic immediates are the truth tables of the three input functions.
+            static Vector Xor3(Vector x, Vector y, Vector z) { return _mm512_ternarylogic_epi32(x, y, z, 0x96); }
+            template <int N> static Vector Rotate(Vector x) { return _mm512_ror_epi32(x, N); }
+            template <int N> static Vector ShiftRight(Vector x) { return _mm512_srli_epi32(x, N); }
+            static Vector Choose(Vector x, Vector y, Vector z) { return _mm512_ternarylogic_epi32(x, y, z, 0xCA); }
+            static Vector Majority(Vector x, Vector y, Vector z) { return _mm512_ternarylogic_epi32(x, y, z, 0xE8); }
+        };
+    }
+
+    void TransformLanesAvx512(std::uint32_t* state, const std::uint8_t* const* blocks)
+    {
+        TransformLanes<Avx512>(state, blocks);
+    }
+}
+
+#if defined(__clang__)
+    #pragma clang attribute pop
+#elif defined(__GNUC__)
+    #pragma GCC pop_options
+#endif
+#endif
@@ -0,0 +1,182 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#include "SHA256MultiBuffer.hpp"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define SHA256_MULTIBUFFER_X86 1
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <cpuid.h>
+    #endif
+#endif
+
+namespace MSIX {
+
+    // In SHA256LanesAvx2.cpp and SHA256LanesAvx512.cpp, the only files built for those instructions.
+    void TransformLanesAvx2(std::uint32_t* state, const std::uint8_t* const* blocks);
+    void TransformLanesAvx512(std::uint32_t* state, const std::uint8_t* const* blocks);
+
+    namespace {
+
+        const std::size_t MaxLanes = 16;
+
+        struct Kernel
+        {
+            void (*transform)(std::uint32_t* state, const std::uint8_t* const* blocks);
+            std::size_t lanes;
+        };
+
+    #if defined(SHA256_MULTIBUFFER_X86)
+        // The processor has to have the instructions and the operating system has to save the registers, which
+        // XCR0 says. AVX needs the XMM and YMM state, AVX-512 the opmask and ZMM state as well.
+        Kernel FindKernel()
+        {
+            unsigned int leaf1[4] = {};
+            unsigned int leaf7[4] = {};
+        #ifdef _MSC_VER
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) { return { nullptr, 0 }; }
+            __cpuid(info, 1);
+            std::memcpy(leaf1, info, sizeof(info));
+            __cpuidex(info, 7, 0);
+            std::memcpy(leaf7, info, sizeof(info));
+        #else
+            if (__get_cpuid_max(0, nullptr) < 7) { return { nullptr, 0 }; }
+            __cpuid(1, leaf1[0], leaf1[1], leaf1[2], leaf1[3]);
+            __cpuid_count(7, 0, leaf7[0], leaf7[1], leaf7[2], leaf7[3]);
+        #endif
+            const unsigned int osxsave = 1u << 27;
+            if ((leaf1[2] & osxsave) == 0) { return { nullptr, 0 }; }
+        #ifdef _MSC_VER
+            auto xcr0 = _xgetbv(0);
+        #else
+            unsigned int xcr0Low = 0;
+            unsigned int xcr0High = 0;
+            __asm__ volatile("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+            std::uint64_t xcr0 = xcr0Low;
+        #endif
+            const unsigned int avx2 = 1u << 5;
+            const unsigned int avx512f = 1u << 16;
+            if (((leaf7[1] & avx512f) != 0) && ((xcr0 & 0xE6) == 0xE6)) { return { TransformLanesAvx512, 16 }; }
+            if (((leaf7[1] & avx2) != 0) && ((xcr0 & 0x06) == 0x06)) { return { TransformLanesAvx2, 8 }; }
+            return { nullptr, 0 };
+        }
+    #else
+        Kernel FindKernel()
+        {
+            return { nullptr, 0 };
+        }
+    #endif
+
+        const Kernel& GetKernel()
+        {
+            static const Kernel kernel = FindKernel();
+            return kernel;
+        }
+
+        // A buffer in a lane. Its whole blocks are hashed where they are, the rest of it with the padding and the
+        // length is copied into tail, one or two more blocks.
+        struct Lane
+        {
+            bool active;
+            std::size_t buffer;
+            const std::uint8_t* data;
+            std::size_t block;
+            std::size_t dataBlocks;
+            std::size_t blocks;
+            std::uint8_t tail[128];
+        };
+    }
+
+    std::size_t SHA256MultiBuffer::GetLanes()
+    {
+        return GetKernel().lanes;
+    }
+
+    void SHA256MultiBuffer::ComputeHashes(const SHA256::Buffer* buffers, std::size_t count, std::vector<std::uint8_t>* hashes)
+    {
+        static const std::uint32_t initial[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        };
+        // Lanes with nothing left to do hash this, and their result is thrown away.
+        static const std::uint8_t idle[64] = {};
+
+        const auto& kernel = GetKernel();
+        alignas(64) std::uint32_t state[8 * MaxLanes];
+        Lane lanes[MaxLanes];
+        const std::uint8_t* blocks[MaxLanes];
+        std::size_t next = 0;
+        std::size_t busy = 0;
+
+        auto start = [&](std::size_t index)
+        {
+            auto& lane = lanes[index];
+            if (next == count)
+            {
+                lane.active = false;
+                return;
+            }
+            const auto& buffer = buffers[next];
+            lane.active = true;
+            lane.buffer = next++;
+            lane.data = buffer.data;
+            lane.block = 0;
+            lane.dataBlocks = buffer.size / 64;
+            std::size_t rest = buffer.size % 64;
+            std::size_t tailSize = (rest < 56) ? 64 : 128;
+            std::memset(lane.tail, 0, sizeof(lane.tail));
+            if (rest != 0) { std::memcpy(lane.tail, buffer.data + lane.dataBlocks * 64, rest); }
+            lane.tail[rest] = 0x80;
+            std::uint64_t bits = static_cast<std::uint64_t>(buffer.size) * 8;
+            for (int i = 0; i < 8; i++)
+            {
+                lane.tail[tailSize - 1 - i] = static_cast<std::uint8_t>(bits >> (i * 8));
+            }
+            lane.blocks = lane.dataBlocks + tailSize / 64;
+            for (std::size_t word = 0; word < 8; word++)
+            {
+                state[word * kernel.lanes + index] = initial[word];
+            }
+            busy++;
+        };
+
+        for (std::size_t i = 0; i < kernel.lanes; i++)
+        {
+            start(i);
+        }
+        while (busy != 0)
+        {
+            for (std::size_t i = 0; i < kernel.lanes; i++)
+            {
+                const auto& lane = lanes[i];
+                blocks[i] = !lane.active ? idle :
+                    (lane.block < lane.dataBlocks) ? lane.data + lane.block * 64 : lane.tail + (lane.block - lane.dataBlocks) * 64;
+            }
+            kernel.transform(state, blocks);
+            for (std::size_t i = 0; i < kernel.lanes; i++)
+            {
+                auto& lane = lanes[i];
+                if (!lane.active || (++lane.block != lane.blocks)) { continue; }
+
+                auto& hash = hashes[lane.buffer];
+                hash.resize(32);
+                for (std::size_t word = 0; word < 8; word++)
+                {
+                    auto value = state[word * kernel.lanes + i];
+                    hash[word * 4]     = static_cast<std::uint8_t>(value >> 24);
+                    hash[word * 4 + 1] = static_cast<std::uint8_t>(value >> 16);
+                    hash[word * 4 + 2] = static_cast<std::uint8_t>(value >> 8);
+                    hash[word * 4 + 3] = static_cast<std::uint8_t>(value);
+                }
+                busy--;
+                start(i);
+            }
+        }
+    }
+}
@@ -0,0 +1,27 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#pragma once
+
+#include "SHA256.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace MSIX {
+
+    // SHA-256 of many buffers at once, one in each lane of the vector registers, 8 with AVX2 and 16 with
+    // AVX-512. Only usable when GetLanes says the processor running us has either.
+    class SHA256MultiBuffer
+    {
+    public:
+        // How many buffers are hashed at once, 0 if the processor can't. Checked the first time.
+        static std::size_t GetLanes();
+
+        // Hashes count buffers into hashes[0] to hashes[count - 1]. A lane that finishes a buffer starts on the
+        // next one, so buffers of different sizes keep every lane busy until the last few.
+        static void ComputeHashes(const SHA256::Buffer* buffers, std::size_t count, std::vector<std::uint8_t>* hashes);
+    };
+}
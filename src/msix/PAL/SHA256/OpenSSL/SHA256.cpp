@@ -1,17 +1,80 @@
-//
-//  Copyright (C) 2017 Microsoft.  All rights reserved.
-//  See LICENSE file in the project root for full license information.
-// 
-#include "Exceptions.hpp"
-#include "SHA256.hpp"
-
-#include "openssl/sha.h"
-
-namespace MSIX {
-    bool SHA256::ComputeHash(std::uint8_t *buffer, std::uint32_t cbBuffer, std::vector<uint8_t>& hash)
-    {
-        hash.resize(SHA256_DIGEST_LENGTH);
-        ::SHA256(buffer, cbBuffer, hash.data());
-        return true;
-    }
-} // namespace MSIX {
\ No newline at end of file
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+// 
+#include "Exceptions.hpp"
+#include "SHA256.hpp"
+#include "SHA256Hardware.hpp"
+#include "SHA256MultiBuffer.hpp"
+
+#include "openssl/sha.h"
+
+namespace MSIX {
+
+    // The OpenSSL in lib is built with OPENSSL_NO_ASM, so its SHA-256 is plain C. Processors with SHA
+    // instructions hash with those instead.
+    struct SHA256::State
+    {
+        State() : hardware(SHA256Hardware::IsAvailable())
+        {
+            if (!hardware) { SHA256_Init(&context); }
+        }
+
+        bool hardware;
+        SHA256Hardware hardwareContext;
+        SHA256_CTX context;
+    };
+
+    SHA256::SHA256() : m_state(new State())
+    {
+    }
+
+    SHA256::~SHA256() = default;
+
+    void SHA256::Update(const std::uint8_t* buffer, std::size_t cbBuffer)
+    {
+        if (m_state->hardware)
+        {   m_state->hardwareContext.Update(buffer, cbBuffer);
+        }
+        else
+        {   SHA256_Update(&m_state->context, buffer, cbBuffer);
+        }
+    }
+
+    void SHA256::Final(std::vector<std::uint8_t>& hash)
+    {
+        hash.resize(SHA256_DIGEST_LENGTH);
+        if (m_state->hardware)
+        {   m_state->hardwareContext.Final(hash.data());
+        }
+        else
+        {   SHA256_Final(hash.data(), &m_state->context);
+            SHA256_Init(&m_state->context);
+        }
+    }
+
+    bool SHA256::ComputeHash(std::uint8_t *buffer, std::uint32_t cbBuffer, std::vector<uint8_t>& hash)
+    {
+        SHA256 hasher;
+        hasher.Update(buffer, cbBuffer);
+        hasher.Final(hash);
+        return true;
+    }
+
+    void SHA256::ComputeHashes(const Buffer* buffers, std::size_t count, std::vector<std::uint8_t>* hashes)
+    {
+        // The SHA instructions hash one buffer faster than AVX2 hashes eight side by side. AVX-512 beats them.
+        auto lanes = SHA256MultiBuffer::GetLanes();
+        if ((count > 1) && ((lanes >= 16) || ((lanes != 0) && !SHA256Hardware::IsAvailable())))
+        {
+            SHA256MultiBuffer::ComputeHashes(buffers, count, hashes);
+            return;
+        }
+        SHA256 hasher;
+        for (std::size_t i = 0; i < count; i++)
+        {
+            hasher.Update(buffers[i].data, buffers[i].size);
+            hasher.Final(hashes[i]);
+        }
+    }
+} // namespace MSIX {
@@ -10,7 +10,10 @@
 #include <winerror.h>
 #include "Exceptions.hpp"
 #include "SHA256.hpp"
+#include "SHA256Hardware.hpp"
+#include "SHA256MultiBuffer.hpp"
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -44,65 +47,115 @@ namespace MSIX {
         }                                                                                  \
     }
 
-    bool SHA256::ComputeHash(std::uint8_t* buffer, std::uint32_t cbBuffer, std::vector<uint8_t>& hash)
+    struct SHA256::State
     {
-        BCRYPT_HASH_HANDLE hashHandleT;
-        BCRYPT_ALG_HANDLE algHandleT;
+        unique_alg_handle algorithm;
+        unique_hash_handle hash;
         DWORD hashLength = 0;
+
+        void CreateHash()
+        {
+            BCRYPT_HASH_HANDLE hashHandleT;
+            ThrowStatusIfFailed(BCryptCreateHash(
+                algorithm.get(),            // Handle to an algorithm provider                 
+                &hashHandleT,               // A pointer to a hash handle - can be a hash or hmac object
+                nullptr,                    // Pointer to the buffer that receives the hash/hmac object
+                0,                          // Size of the buffer in bytes
+                nullptr,                    // A pointer to a key to use for the hash or MAC
+                0,                          // Size of the key in bytes
+                0),                         // Flags
+            "failed computing SHA256 hash");
+            hash.reset(hashHandleT);
+        }
+    };
+
+    SHA256::SHA256() : m_state(new State())
+    {
+        BCRYPT_ALG_HANDLE algHandleT;
         DWORD resultLength = 0;
 
         // Open an algorithm handle
-        // This code passes BCRYPT_HASH_REUSABLE_FLAG with BCryptAlgorithmProvider(...) to load a provider which supports reusable hash
         ThrowStatusIfFailed(BCryptOpenAlgorithmProvider(
             &algHandleT,                // Alg Handle pointer
             BCRYPT_SHA256_ALGORITHM,    // Cryptographic Algorithm name (null terminated unicode string)
             nullptr,                    // Provider name; if null, the default provider is loaded
-            0),                         // Flags; Loads a provider which supports reusable hash
+            0),                         // Flags
         "failed computing SHA256 hash");
+        m_state->algorithm.reset(algHandleT);
 
         // Obtain the length of the hash
-        unique_alg_handle algHandle(algHandleT);
         ThrowStatusIfFailed(BCryptGetProperty(
-            algHandle.get(),            // Handle to a CNG object
+            m_state->algorithm.get(),   // Handle to a CNG object
             BCRYPT_HASH_LENGTH,         // Property name (null terminated unicode string)
-            (PBYTE)&hashLength,         // Address of the output buffer which receives the property value
-            sizeof(hashLength),         // Size of the buffer in bytes
+            (PBYTE)&m_state->hashLength,// Address of the output buffer which receives the property value
+            sizeof(m_state->hashLength),// Size of the buffer in bytes
             &resultLength,              // Number of bytes that were copied into the buffer
             0),                         // Flags
         "failed computing SHA256 hash");
-        ThrowErrorIf(Error::Unexpected, (resultLength != sizeof(hashLength)), "failed computing SHA256 hash");
+        ThrowErrorIf(Error::Unexpected, (resultLength != sizeof(m_state->hashLength)), "failed computing SHA256 hash");
 
-        // Size the hash buffer appropriately
-        hash.resize(hashLength);
-
-        // Create a hash handle
-        ThrowStatusIfFailed(BCryptCreateHash(
-            algHandle.get(),            // Handle to an algorithm provider                 
-            &hashHandleT,               // A pointer to a hash handle - can be a hash or hmac object
-            nullptr,                    // Pointer to the buffer that receives the hash/hmac object
-            0,                          // Size of the buffer in bytes
-            nullptr,                    // A pointer to a key to use for the hash or MAC
-            0,                          // Size of the key in bytes
-            0),                         // Flags
-        "failed computing SHA256 hash");
+        m_state->CreateHash();
+    }
 
-        // Hash the message(s)
-        unique_hash_handle hashHandle(hashHandleT);
-        ThrowStatusIfFailed(BCryptHashData(
-            hashHandle.get(),           // Handle to the hash or MAC object
-            (PBYTE)buffer,              // A pointer to a buffer that contains the data to hash
-            cbBuffer,                   // Size of the buffer in bytes
-            0),                         // Flags
-        "failed computing SHA256 hash");
+    SHA256::~SHA256() = default;
+
+    void SHA256::Update(const std::uint8_t* buffer, std::size_t cbBuffer)
+    {
+        // BCryptHashData takes a ULONG of bytes at a time
+        do
+        {
+            ULONG count = static_cast<ULONG>((std::min)(cbBuffer, static_cast<std::size_t>(ULONG_MAX)));
+            ThrowStatusIfFailed(BCryptHashData(
+                m_state->hash.get(),        // Handle to the hash or MAC object
+                (PBYTE)buffer,              // A pointer to a buffer that contains the data to hash
+                count,                      // Size of the buffer in bytes
+                0),                         // Flags
+            "failed computing SHA256 hash");
+            buffer += count;
+            cbBuffer -= count;
+        } while (cbBuffer != 0);
+    }
+
+    void SHA256::Final(std::vector<std::uint8_t>& hash)
+    {
+        // Size the hash buffer appropriately
+        hash.resize(m_state->hashLength);
 
         // Obtain the hash of the message(s) into the hash buffer
         ThrowStatusIfFailed(BCryptFinishHash(
-            hashHandle.get(),           // Handle to the hash or MAC object
+            m_state->hash.get(),        // Handle to the hash or MAC object
             hash.data(),                // A pointer to a buffer that receives the hash or MAC value
-            hashLength,                 // Size of the buffer in bytes
+            m_state->hashLength,        // Size of the buffer in bytes
             0),                         // Flags
         "failed computing SHA256 hash");
 
+        // A finished hash object can't be used again
+        m_state->CreateHash();
+    }
+
+    bool SHA256::ComputeHash(std::uint8_t* buffer, std::uint32_t cbBuffer, std::vector<uint8_t>& hash)
+    {
+        SHA256 hasher;
+        hasher.Update(buffer, cbBuffer);
+        hasher.Final(hash);
         return true;
     }
+
+    void SHA256::ComputeHashes(const Buffer* buffers, std::size_t count, std::vector<std::uint8_t>* hashes)
+    {
+        // CNG uses the SHA instructions when the processor has them, which hash one buffer faster than AVX2
+        // hashes eight side by side. AVX-512 beats them.
+        auto lanes = SHA256MultiBuffer::GetLanes();
+        if ((count > 1) && ((lanes >= 16) || ((lanes != 0) && !SHA256Hardware::IsAvailable())))
+        {
+            SHA256MultiBuffer::ComputeHashes(buffers, count, hashes);
+            return;
+        }
+        SHA256 hasher;
+        for (std::size_t i = 0; i < count; i++)
+        {
+            hasher.Update(buffers[i].data, buffers[i].size);
+            hasher.Final(hashes[i]);
+        }
+    }
 }
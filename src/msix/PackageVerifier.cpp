@@ -0,0 +1,252 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#include "PackageVerifier.hpp"
+#include "ICompressionObject.hpp"
+#include "StreamBase.hpp"
+#include "SHA256.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace MSIX {
+
+    namespace {
+        // How the blocks of a file are found in its data in the container.
+        struct Layout
+        {
+            bool compressed;
+            bool byOffset;                      // otherwise the file is read through its block map stream
+            std::vector<std::uint64_t> offsets; // where every block starts in the data, and where the last one ends
+        };
+
+        struct Group
+        {
+            std::size_t file;
+            std::size_t first;
+            std::size_t count;
+        };
+
+        // What a thread keeps from one group to the next.
+        struct Worker
+        {
+            std::size_t file = std::numeric_limits<std::size_t>::max();
+            ComPtr<IStream> data;
+            std::unique_ptr<ICompressionObject> inflater;
+            std::vector<std::uint8_t> input;
+            std::vector<std::uint8_t> output;
+            std::vector<SHA256::Buffer> buffers;
+            std::vector<std::vector<std::uint8_t>> hashes;
+        };
+
+        // A stream of its own over the data of the file in the container, so reading it doesn't disturb anyone.
+        ComPtr<IStream> GetData(const PackageVerifier::File& file, bool compressed)
+        {
+            if (compressed) { return file.stream.As<IStreamInternal>()->GetCompressedStream(); }
+            ComPtr<IStream> clone;
+            ThrowHrIfFailed(file.stream->Clone(&clone));
+            return clone;
+        }
+
+        // Whether the blocks of the file can be read by their offsets, from any thread, and where they are.
+        bool GetLayout(const PackageVerifier::File& file, Layout& layout) noexcept try
+        {
+            auto blocks = static_cast<std::size_t>((file.size + BLOCKMAP_BLOCK_SIZE - 1) / BLOCKMAP_BLOCK_SIZE);
+            if (blocks > file.blocks.size()) { return false; }
+
+            layout.compressed = file.stream.As<IStreamInternal>()->IsCompressed();
+            auto data = GetData(file, layout.compressed);
+            // A read of nothing tells if the data can be read without its seek pointer.
+            std::uint8_t none = 0;
+            if (!data || !data.As<IStreamInternal>()->ReadAt(0, &none, 0, nullptr)) { return false; }
+
+            std::uint64_t offset = 0;
+            for (std::size_t i = 0; i < blocks; i++)
+            {
+                layout.offsets.push_back(offset);
+                offset += layout.compressed ? file.blocks[i].compressedSize : std::min(BLOCKMAP_BLOCK_SIZE, file.size - offset);
+            }
+            layout.offsets.push_back(offset);
+            return true;
+        }
+        catch (...)
+        {
+            return false;
+        }
+
+        // Checks a group of blocks. inflated is false, and nothing is known, if a block of a compressed file can't
+        // be inflated on its own or doesn't match its hash once it is. Like for BlockInflater, data that doesn't
+        // start a deflate block where the block map says can still inflate into something, so only reading the
+        // file through its stream tells if the block is bad.
+        HRESULT CheckGroup(const PackageVerifier::File& file, const Layout& layout, const Group& group, Worker& worker, bool& inflated) noexcept try
+        {
+            inflated = true;
+            auto begin = layout.offsets[group.first];
+            auto end = layout.offsets[group.first + group.count];
+            auto view = worker.data.TryAs<IStreamView>();
+            const std::uint8_t* data = view ? view->GetView(begin, end - begin) : nullptr;
+            if (data == nullptr)
+            {
+                ThrowErrorIf(Error::FileRead, (end - begin > std::numeric_limits<ULONG>::max()), "group of blocks too big");
+                worker.input.resize(static_cast<std::size_t>(end - begin));
+                ULONG read = 0;
+                ThrowErrorIfNot(Error::FileRead, worker.data.As<IStreamInternal>()->ReadAt(begin, worker.input.data(), static_cast<ULONG>(end - begin), &read),
+                    "positional read failed");
+                ThrowErrorIf(Error::FileRead, (read != end - begin), "blocks cut short");
+                data = worker.input.data();
+            }
+
+            for (std::size_t i = 0; i < group.count; i++)
+            {
+                auto index = group.first + i;
+                auto size = static_cast<std::size_t>(std::min(BLOCKMAP_BLOCK_SIZE, file.size - index * BLOCKMAP_BLOCK_SIZE));
+                const std::uint8_t* block = data + (layout.offsets[index] - begin);
+                if (layout.compressed)
+                {
+                    std::uint8_t* output = worker.output.data() + i * BLOCKMAP_BLOCK_SIZE;
+                    if (worker.inflater->DecompressBlock(block, static_cast<std::size_t>(layout.offsets[index + 1] - layout.offsets[index]),
+                            output, size) != CompressionStatus::Ok)
+                    {
+                        inflated = false;
+                        return static_cast<HRESULT>(Error::OK);
+                    }
+                    block = output;
+                }
+                worker.buffers[i] = { block, size };
+            }
+
+            SHA256::ComputeHashes(worker.buffers.data(), group.count, worker.hashes.data());
+            for (std::size_t i = 0; i < group.count; i++)
+            {
+                const auto& expected = file.blocks[group.first + i].hash;
+                const auto& hash = worker.hashes[i];
+                if ((expected.size() != hash.size()) || (memcmp(expected.data(), hash.data(), hash.size()) != 0))
+                {
+                    if (layout.compressed)
+                    {
+                        inflated = false;
+                        return static_cast<HRESULT>(Error::OK);
+                    }
+                    return static_cast<HRESULT>(Error::SignatureInvalid);
+                }
+            }
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+
+        // Reads all of the file through its block map stream, which fails at the first block that doesn't match.
+        HRESULT CheckStream(const PackageVerifier::File& file) noexcept try
+        {
+            LARGE_INTEGER start = { 0 };
+            ThrowHrIfFailed(file.checked->Seek(start, StreamBase::Reference::START, nullptr));
+            std::vector<std::uint8_t> buffer(static_cast<std::size_t>(std::min(64 * BLOCKMAP_BLOCK_SIZE, std::max(file.size, std::uint64_t(1)))));
+            std::uint64_t total = 0;
+            while (total < file.size)
+            {
+                ULONG read = 0;
+                ThrowHrIfFailed(file.checked->Read(buffer.data(), static_cast<ULONG>(buffer.size()), &read));
+                ThrowErrorIf(Error::FileRead, (read == 0), "file is shorter than its size");
+                total += read;
+            }
+            ThrowHrIfFailed(file.checked->Seek(start, StreamBase::Reference::START, nullptr));
+            return static_cast<HRESULT>(Error::OK);
+        } CATCH_RETURN();
+    }
+
+    PackageVerifier::PackageVerifier(std::shared_ptr<ThreadPool> pool, std::size_t threads) :
+        m_threadPool(std::move(pool)), m_threads((threads != 0) ? threads : std::max(1u, std::thread::hardware_concurrency()))
+    {
+    }
+
+    std::vector<HRESULT> PackageVerifier::Verify(const std::vector<File>& files)
+    {
+        std::vector<HRESULT> results(files.size(), static_cast<HRESULT>(Error::OK));
+        std::vector<Layout> layouts(files.size());
+        std::vector<Group> groups;
+        for (std::size_t i = 0; i < files.size(); i++)
+        {
+            results[i] = files[i].result;
+            if (FAILED(results[i])) { continue; }
+            layouts[i].byOffset = GetLayout(files[i], layouts[i]);
+            if (!layouts[i].byOffset) { continue; }
+            auto blocks = layouts[i].offsets.size() - 1;
+            for (std::size_t first = 0; first < blocks; first += BLOCKMAP_HASH_GROUP)
+            {
+                groups.push_back({ i, first, std::min(BLOCKMAP_HASH_GROUP, blocks - first) });
+            }
+        }
+
+        // Groups are taken in order. Once a file has failed, or has to be read through its stream, the rest of
+        // its groups are skipped.
+        std::size_t next = 0;
+        std::mutex lock;
+        std::exception_ptr error;
+
+        auto worker = [&]()
+        {
+            try
+            {
+                Worker state;
+                state.inflater = CreateCompressionObject();
+                state.output.resize(static_cast<std::size_t>(BLOCKMAP_HASH_GROUP * BLOCKMAP_BLOCK_SIZE));
+                state.buffers.resize(BLOCKMAP_HASH_GROUP);
+                state.hashes.resize(BLOCKMAP_HASH_GROUP);
+                for (;;)
+                {
+                    Group group;
+                    {
+                        std::lock_guard<std::mutex> guard(lock);
+                        while (next < groups.size() && (!layouts[groups[next].file].byOffset || FAILED(results[groups[next].file]))) { next++; }
+                        if (next == groups.size() || error) { break; }
+                        group = groups[next++];
+                    }
+
+                    const auto& file = files[group.file];
+                    const auto& layout = layouts[group.file];
+                    if (state.file != group.file)
+                    {
+                        state.data = GetData(file, layout.compressed);
+                        state.file = group.file;
+                    }
+                    bool inflated = true;
+                    auto result = CheckGroup(file, layout, group, state, inflated);
+
+                    std::lock_guard<std::mutex> guard(lock);
+                    if (!inflated && SUCCEEDED(results[group.file]))
+                    {   // Its blocks depend on the ones before them.
+                        layouts[group.file].byOffset = false;
+                    }
+                    else if (FAILED(result) && SUCCEEDED(results[group.file]))
+                    {
+                        results[group.file] = result;
+                    }
+                }
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (!error) { error = std::current_exception(); }
+            }
+        };
+
+        // This thread is one of the workers.
+        auto threadCount = std::min(m_threads, std::max(groups.size(), std::size_t(1)));
+        m_threadPool->Run(threadCount, worker);
+        if (error) { std::rethrow_exception(error); }
+
+        // Whatever couldn't be checked by offset, one file at a time.
+        for (std::size_t i = 0; i < files.size(); i++)
+        {
+            if (!layouts[i].byOffset && SUCCEEDED(results[i]))
+            {
+                results[i] = CheckStream(files[i]);
+            }
+        }
+        return results;
+    }
+}
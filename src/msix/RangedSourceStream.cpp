@@ -0,0 +1,283 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#include "Exceptions.hpp"
+#include "StreamBase.hpp"
+#include "RangedSourceStream.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace MSIX {
+
+    // Size and alignment of what is read from the source and kept in the cache.
+    static const std::uint64_t ChunkSize = 64 * 1024;
+    // Longest run of chunks read with a single request.
+    static const std::uint64_t MaxChunksPerRequest = 16;
+    // Requests started ahead of time are held back while this many are in flight. Reads that are
+    // needed right away are never held back.
+    static const std::size_t MaxRequestsInFlight = 8;
+    // Chunks kept in the cache. The least recently used are dropped first.
+    static const std::size_t MaxCachedChunks = 256;
+
+    struct Chunk
+    {
+        std::vector<std::uint8_t> data;
+        bool ready = false;
+        HRESULT result = static_cast<HRESULT>(Error::OK);
+        std::uint64_t lastUse = 0;
+    };
+
+    struct RangedSourceStream::State
+    {
+        ComPtr<IMsixRangedSource> source;
+        std::uint64_t size = 0;
+        std::mutex mutex;
+        std::condition_variable completed;
+        // By chunk index. Chunks are added when they are requested and are ready once the request completes.
+        std::map<std::uint64_t, Chunk> chunks;
+        std::size_t inFlight = 0;
+        // Chunks hinted by WillNeed that haven't been requested yet.
+        std::uint64_t prefetchNext = 0;
+        std::uint64_t prefetchEnd = 0;
+        std::uint64_t uses = 0;
+    };
+
+    namespace {
+
+        class RangeRequest;
+        typedef std::vector<ComPtr<RangeRequest>> RangeRequests;
+
+        RangeRequests StartPrefetch(const std::shared_ptr<RangedSourceStream::State>& state);
+
+        // Reads count chunks starting at chunk first with one ReadRange.
+        class RangeRequest final : public ComClass<RangeRequest, IMsixRangedReadCallback>
+        {
+        public:
+            RangeRequest(const std::shared_ptr<RangedSourceStream::State>& state, std::uint64_t first, std::uint64_t count) :
+                m_state(state), m_first(first), m_count(count)
+            {
+                auto end = std::min((first + count) * ChunkSize, state->size);
+                m_buffer.resize(static_cast<std::size_t>(end - (first * ChunkSize)));
+            }
+
+            // Must be called without holding the lock, the source can complete the read before returning.
+            void Start()
+            {
+                HRESULT hr = m_state->source->ReadRange(m_first * ChunkSize, static_cast<UINT32>(m_buffer.size()), m_buffer.data(), this);
+                if (FAILED(hr)) { Complete(hr, 0); }
+            }
+
+            // IMsixRangedReadCallback
+            HRESULT STDMETHODCALLTYPE ReadCompleted(HRESULT result, UINT32 bytesRead) noexcept override try
+            {
+                Complete(result, bytesRead);
+                return static_cast<HRESULT>(Error::OK);
+            } CATCH_RETURN();
+
+        protected:
+            void Complete(HRESULT result, UINT32 bytesRead)
+            {
+                RangeRequests next;
+                {
+                    std::lock_guard<std::mutex> lock(m_state->mutex);
+                    for (std::uint64_t i = 0; i < m_count; i++)
+                    {   // Chunks aren't dropped from the cache while they are being read.
+                        auto& chunk = m_state->chunks[m_first + i];
+                        auto offset = static_cast<std::size_t>(i * ChunkSize);
+                        auto length = std::min(static_cast<std::size_t>(ChunkSize), m_buffer.size() - offset);
+                        if (SUCCEEDED(result) && (bytesRead < offset + length))
+                        {
+                            result = static_cast<HRESULT>(Error::FileRead);
+                        }
+                        if (SUCCEEDED(result))
+                        {
+                            chunk.data.assign(m_buffer.begin() + offset, m_buffer.begin() + offset + length);
+                        }
+                        chunk.result = result;
+                        chunk.ready = true;
+                    }
+                    m_state->inFlight--;
+                    next = StartPrefetch(m_state);
+                }
+                m_state->completed.notify_all();
+                for (auto& request : next) { request->Start(); }
+            }
+
+            std::shared_ptr<RangedSourceStream::State> m_state;
+            std::uint64_t m_first;
+            std::uint64_t m_count;
+            std::vector<std::uint8_t> m_buffer;
+        };
+
+        // Makes room in the cache for one more chunk, if there is a chunk that can be dropped.
+        void Evict(RangedSourceStream::State& state)
+        {
+            while (state.chunks.size() >= MaxCachedChunks)
+            {
+                auto oldest = state.chunks.end();
+                for (auto chunk = state.chunks.begin(); chunk != state.chunks.end(); chunk++)
+                {
+                    if (chunk->second.ready && (oldest == state.chunks.end() || chunk->second.lastUse < oldest->second.lastUse))
+                    {
+                        oldest = chunk;
+                    }
+                }
+                if (oldest == state.chunks.end()) { return; }
+                state.chunks.erase(oldest);
+            }
+        }
+
+        // Adds the chunks to the cache as being read. Called with the lock held, the request is started after releasing it.
+        ComPtr<RangeRequest> CreateRequest(const std::shared_ptr<RangedSourceStream::State>& state, std::uint64_t first, std::uint64_t count)
+        {
+            for (std::uint64_t index = first; index < first + count; index++)
+            {
+                Evict(*state);
+                state->chunks[index].lastUse = ++state->uses;
+            }
+            state->inFlight++;
+            return ComPtr<RangeRequest>::Make<RangeRequest>(state, first, count);
+        }
+
+        // Requests runs of chunks that aren't in the cache from [first, end), each run at most MaxChunksPerRequest long.
+        // Stops early once limit requests are in flight. Returns where it stopped.
+        std::uint64_t RequestMissing(const std::shared_ptr<RangedSourceStream::State>& state, std::uint64_t first, std::uint64_t end,
+            std::size_t limit, RangeRequests& requests)
+        {
+            while ((first < end) && (state->inFlight < limit))
+            {
+                if (state->chunks.find(first) != state->chunks.end())
+                {
+                    first++;
+                    continue;
+                }
+                std::uint64_t count = 1;
+                while ((first + count < end) && (count < MaxChunksPerRequest) && (state->chunks.find(first + count) == state->chunks.end()))
+                {
+                    count++;
+                }
+                requests.push_back(CreateRequest(state, first, count));
+                first += count;
+            }
+            return first;
+        }
+
+        RangeRequests StartPrefetch(const std::shared_ptr<RangedSourceStream::State>& state)
+        {
+            RangeRequests requests;
+            state->prefetchNext = RequestMissing(state, state->prefetchNext, state->prefetchEnd, MaxRequestsInFlight, requests);
+            return requests;
+        }
+    }
+
+    RangedSourceStream::RangedSourceStream(const ComPtr<IMsixRangedSource>& source) : m_state(std::make_shared<State>())
+    {
+        ThrowErrorIfNot(Error::InvalidParameter, source, "no ranged source");
+        m_state->source = source;
+        UINT64 size = 0;
+        ThrowHrIfFailed(source->GetSize(&size));
+        m_state->size = size;
+    }
+
+    HRESULT STDMETHODCALLTYPE RangedSourceStream::Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER* newPosition) noexcept try
+    {
+        LONGLONG base = 0;
+        switch (origin)
+        {
+        case Reference::CURRENT:
+            base = static_cast<LONGLONG>(m_position);
+            break;
+        case Reference::START:
+            base = 0;
+            break;
+        case Reference::END:
+            base = static_cast<LONGLONG>(m_state->size);
+            break;
+        }
+        ThrowErrorIf(Error::FileSeekOutOfRange, (base + move.QuadPart < 0), "seek before the start of the stream");
+        m_position = static_cast<std::uint64_t>(base + move.QuadPart);
+        if (newPosition) { newPosition->QuadPart = m_position; }
+        return static_cast<HRESULT>(Error::OK);
+    } CATCH_RETURN();
+
+    HRESULT STDMETHODCALLTYPE RangedSourceStream::Read(void* buffer, ULONG countBytes, ULONG* bytesRead) noexcept try
+    {
+        ULONG amountRead = 0;
+        ReadAt(m_position, buffer, countBytes, &amountRead);
+        m_position += amountRead;
+        if (bytesRead) { *bytesRead = amountRead; }
+        return static_cast<HRESULT>(Error::OK);
+    } CATCH_RETURN();
+
+    bool RangedSourceStream::ReadAt(std::uint64_t position, void* buffer, ULONG countBytes, ULONG* bytesRead)
+    {
+        auto& state = *m_state;
+        ULONG amountToRead = (position < state.size) ? static_cast<ULONG>(std::min(static_cast<std::uint64_t>(countBytes), state.size - position)) : 0;
+        auto current = position;
+        auto end = position + amountToRead;
+        auto out = static_cast<std::uint8_t*>(buffer);
+        std::unique_lock<std::mutex> lock(state.mutex);
+        while (current < end)
+        {
+            auto index = current / ChunkSize;
+            auto chunk = state.chunks.find(index);
+            if (chunk == state.chunks.end())
+            {   // Ask for everything that is missing up to the end of the read at once.
+                RangeRequests requests;
+                RequestMissing(m_state, index, ((end - 1) / ChunkSize) + 1, std::numeric_limits<std::size_t>::max(), requests);
+                lock.unlock();
+                for (auto& request : requests) { request->Start(); }
+                lock.lock();
+                continue;
+            }
+            if (!chunk->second.ready)
+            {
+                state.completed.wait(lock);
+                continue;
+            }
+            if (FAILED(chunk->second.result))
+            {   // Forget it, so reading it again asks the source again.
+                auto result = chunk->second.result;
+                state.chunks.erase(chunk);
+                ThrowHrIfFailed(result);
+            }
+            auto offset = static_cast<std::size_t>(current - (index * ChunkSize));
+            ThrowErrorIf(Error::FileRead, (offset >= chunk->second.data.size()), "ranged source is shorter than its size");
+            auto length = static_cast<std::size_t>(std::min(end - current, static_cast<std::uint64_t>(chunk->second.data.size() - offset)));
+            std::memcpy(out, chunk->second.data.data() + offset, length);
+            chunk->second.lastUse = ++state.uses;
+            out += length;
+            current += length;
+        }
+        if (bytesRead) { *bytesRead = amountToRead; }
+        return true;
+    }
+
+    void RangedSourceStream::WillNeed(std::uint64_t position, std::uint64_t size)
+    {
+        auto& state = *m_state;
+        if (position >= state.size || size == 0) { return; }
+        auto first = position / ChunkSize;
+        auto end = ((std::min(size, state.size - position) + position - 1) / ChunkSize) + 1;
+        RangeRequests requests;
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if ((first < state.prefetchNext) || (first > state.prefetchEnd))
+            {   // Not a continuation of what was hinted before. Start over from here.
+                state.prefetchNext = first;
+                state.prefetchEnd = end;
+            }
+            // Don't get further ahead than the cache can hold.
+            state.prefetchEnd = std::min(std::max(state.prefetchEnd, end), state.prefetchNext + (MaxCachedChunks / 2));
+            requests = StartPrefetch(m_state);
+        }
+        for (auto& request : requests) { request->Start(); }
+    }
+}
@@ -0,0 +1,259 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+// 
+#include "Exceptions.hpp"
+#include "StreamBase.hpp"
+#include "VectorStream.hpp"
+#include "ZipObject.hpp"
+#include "StagingObject.hpp"
+#include "AppxPackageObject.hpp"
+#include "BlockMapStream.hpp"
+#include "Encoding.hpp"
+#include "SHA256.hpp"
+
+#include <array>
+#include <cctype>
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace MSIX {
+
+    // Footprint files are small and needed to validate the package, so they are kept in memory.
+    static const std::array<const char*, 6> footprintFiles =
+    {   "AppxManifest.xml",
+        "AppxBlockMap.xml",
+        "AppxSignature.p7x",
+        "AppxMetadata/CodeIntegrity.cat",
+        "[Content_Types].xml",
+        "AppxMetadata/AppxBundleManifest.xml",
+    };
+
+    // The signature is the last file of a signed package, the digests are of the archive without it.
+    static const char* SignatureFile = "AppxSignature.p7x";
+
+    // Directory under the destination where payload files are written until the package is validated.
+    static const char* StagingDirectory = ".msixstaging";
+
+    // Footprint files are read whole into memory before anything can check them, so a package can't make it
+    // hold more than a few of these. No more of AppxSignature.p7x than the signature validator takes. The
+    // others are text, or a catalog of hashes, of which the block map is the biggest: 32 MB is the block map
+    // of a package with more than 30 GB of payload.
+    static const std::uint64_t MaxSignatureSize = 2 << 20;
+    static const std::uint64_t MaxFootprintFileSize = 32 << 20;
+
+    // Whether the file would be unpacked into the staging directory, on a file system that ignores case too.
+    static bool IsInStagingDirectory(const std::string& name)
+    {
+        auto decoded = Encoding::DecodeFileName(name);
+        std::string prefix(StagingDirectory);
+        if (decoded.size() < prefix.size()) { return false; }
+        for (std::size_t i = 0; i < prefix.size(); i++)
+        {
+            if (std::tolower(static_cast<unsigned char>(decoded[i])) != prefix[i]) { return false; }
+        }
+        return (decoded.size() == prefix.size()) || (decoded[prefix.size()] == '/') || (decoded[prefix.size()] == '\\');
+    }
+
+    StagingObject::StagingObject(IMsixFactory* factory, const ComPtr<IStream>& stream, const std::string& destination) :
+        m_factory(factory), m_stream(stream)
+    {
+        m_destination = ComPtr<DirectoryObject>::Make<DirectoryObject>(destination);
+
+        try
+        {
+            ZipStreamReader reader(m_stream);
+            auto options = m_factory->GetValidationOptions();
+            if (!(options & MSIX_VALIDATION_OPTION_SKIPSIGNATURE))
+            {
+                reader.KeepDigests(SignatureFile);
+            }
+            std::vector<std::uint8_t> buffer(static_cast<std::size_t>(BLOCKMAP_BLOCK_SIZE));
+            while (reader.MoveNext())
+            {
+                const auto& name = reader.GetName();
+                ThrowErrorIf(Error::ZipLocalFileHeader, (m_footprintFiles.count(name) != 0) || (m_payloadFiles.count(name) != 0),
+                    "duplicated file name");
+                ThrowErrorIf(Error::NotSupported, (name == "AppxMetadata/AppxBundleManifest.xml"), "bundles can't be unpacked from a forward only stream");
+                ThrowErrorIf(Error::ZipLocalFileHeader, IsInStagingDirectory(name), "file name is in the staging directory");
+                m_fileNames.push_back(name);
+
+                ULONG bytesRead = 0;
+                if (std::find(footprintFiles.begin(), footprintFiles.end(), name) != footprintFiles.end())
+                {
+                    auto& data = m_footprintFiles[name];
+                    bool isSignature = (name == SignatureFile);
+                    while ((bytesRead = reader.Read(buffer.data(), static_cast<ULONG>(buffer.size()))) != 0)
+                    {
+                        ThrowErrorIf(Error::SignatureInvalid, isSignature && (data.size() + bytesRead > MaxSignatureSize), "stream is too big");
+                        ThrowErrorIf(Error::FileRead, (data.size() + bytesRead > MaxFootprintFileSize), "stream too big");
+                        data.insert(data.end(), buffer.data(), buffer.data() + bytesRead);
+                    }
+                    continue;
+                }
+
+                // Payload file. Hash it block by block while it is written out, the block map comes later.
+                auto& staged = m_payloadFiles[name];
+                staged.stagedName = std::string(StagingDirectory) + "/" + std::to_string(m_payloadFiles.size() - 1);
+                auto file = m_destination->OpenFile(staged.stagedName, FileStream::Mode::WRITE);
+                std::size_t filled = 0;
+                do
+                {
+                    bytesRead = reader.Read(buffer.data() + filled, static_cast<ULONG>(buffer.size() - filled));
+                    filled += bytesRead;
+                    if ((filled == buffer.size()) || ((bytesRead == 0) && (filled != 0)))
+                    {
+                        std::vector<std::uint8_t> hash;
+                        ThrowErrorIfNot(Error::SignatureInvalid,
+                            SHA256::ComputeHash(buffer.data(), static_cast<std::uint32_t>(filled), hash), "Invalid signature");
+                        staged.blockHashes.push_back(std::move(hash));
+                        ULONG bytesWritten = 0;
+                        ThrowHrIfFailed(file->Write(buffer.data(), static_cast<ULONG>(filled), &bytesWritten));
+                        ThrowErrorIf(Error::FileWrite, (bytesWritten != filled), "write failed");
+                        filled = 0;
+                    }
+                } while (bytesRead != 0);
+                staged.size = reader.GetUncompressedSize();
+                staged.sizeOnZip = reader.GetSizeOnZip();
+                staged.isCompressed = reader.IsCompressed();
+            }
+            m_fileRecordsDigest = reader.GetFileRecordsDigest();
+            m_centralDirectoryDigest = reader.GetCentralDirectoryDigest();
+        }
+        catch (...)
+        {
+            Rollback();
+            throw;
+        }
+    }
+
+    StagingObject::~StagingObject()
+    {
+        if (!m_committed)
+        {
+            Rollback();
+        }
+    }
+
+    void StagingObject::Commit(const ComPtr<IAppxPackageReader>& package, MSIX_PACKUNPACK_OPTION options)
+    {
+        // AppxPackageObject already checked the sizes of the payload files against the block map. Their content
+        // wasn't read, so check the hashes computed while staging.
+        ComPtr<IAppxBlockMapReader> blockMapReader;
+        ThrowHrIfFailed(package->GetBlockMap(&blockMapReader));
+        auto blockMap = blockMapReader.As<IAppxBlockMapInternal>();
+        std::size_t verified = 0;
+        for (const auto& fileName : blockMap->GetFileNames())
+        {
+            auto staged = m_payloadFiles.find(Encoding::EncodeFileName(fileName));
+            if (staged == m_payloadFiles.end())
+            {   // footprint file, validated when AppxPackageObject read it.
+                continue;
+            }
+            auto blocks = blockMap->GetBlocks(fileName);
+            ThrowErrorIfNot(Error::BlockMapSemanticError, (blocks.size() == staged->second.blockHashes.size()),
+                "Number of blocks in the block map doesn't match the file");
+            for (std::size_t i = 0; i < blocks.size(); i++)
+            {
+                ThrowErrorIfNot(Error::SignatureInvalid, (blocks[i].hash == staged->second.blockHashes[i]), "Signature is corrupt");
+            }
+            verified++;
+        }
+        ThrowErrorIfNot(Error::BlockMapSemanticError, (verified == m_payloadFiles.size()), "Payload file not described in AppxBlockMap.xml");
+
+        // Footprint files go through the package, which validates them on the way out, like Unpack does.
+        // Payload files are already on disk and just need to be moved into place. If that fails part way, the
+        // footprint files written are removed and the payload files moved go back to the staging directory, to
+        // be removed with it.
+        auto packageInternal = package.As<IPackage>();
+        auto packageStorage = package.As<IStorageObject>();
+        std::vector<std::string> written;
+        std::vector<std::pair<std::string, std::string>> moved;
+        try
+        {
+            for (const auto& fileName : packageInternal->GetFootprintFiles())
+            {
+                auto targetName = packageInternal->GetTargetName(options, fileName);
+                auto targetFile = m_destination->OpenFile(targetName, FileStream::Mode::WRITE_UPDATE);
+                written.push_back(targetName);
+                auto sourceFile = packageStorage->GetFile(fileName);
+                ULARGE_INTEGER bytesCount = {0};
+                bytesCount.QuadPart = std::numeric_limits<std::uint64_t>::max();
+                ThrowHrIfFailed(sourceFile->CopyTo(targetFile.Get(), bytesCount, nullptr, nullptr));
+            }
+            for (const auto& fileName : packageStorage->GetFileNames(FileNameOptions::PayloadOnly))
+            {
+                const auto& stagedName = m_payloadFiles.at(fileName).stagedName;
+                auto targetName = packageInternal->GetTargetName(options, fileName);
+                m_destination->Rename(stagedName, targetName);
+                moved.emplace_back(stagedName, targetName);
+            }
+        }
+        catch (...)
+        {
+            for (auto file = moved.rbegin(); file != moved.rend(); file++)
+            {
+                try { m_destination->Rename(file->second, file->first); } catch (...) {}
+            }
+            for (const auto& targetName : written)
+            {
+                try { m_destination->Remove(targetName); } catch (...) {}
+            }
+            throw;
+        }
+        if (!m_payloadFiles.empty())
+        {
+            m_destination->Remove(StagingDirectory);
+        }
+        m_committed = true;
+    }
+
+    void StagingObject::Rollback() noexcept
+    {
+        if (m_payloadFiles.empty())
+        {
+            return;
+        }
+        for (const auto& file : m_payloadFiles)
+        {
+            try { m_destination->Remove(file.second.stagedName); } catch (...) {}
+        }
+        try { m_destination->Remove(StagingDirectory); } catch (...) {}
+        m_payloadFiles.clear();
+    }
+
+    // IStorageObject
+    std::vector<std::string> StagingObject::GetFileNames(FileNameOptions)
+    {
+        return m_fileNames;
+    }
+
+    ComPtr<IStream> StagingObject::GetFile(const std::string& fileName)
+    {
+        auto footprintFile = m_footprintFiles.find(fileName);
+        if (footprintFile != m_footprintFiles.end())
+        {
+            return ComPtr<IStream>::Make<VectorStream>(&footprintFile->second);
+        }
+        auto payloadFile = m_payloadFiles.find(fileName);
+        if (payloadFile != m_payloadFiles.end())
+        {
+            const auto& staged = payloadFile->second;
+            return ComPtr<IStream>::Make<StagedFileStream>(m_destination, staged.stagedName, fileName,
+                staged.size, staged.sizeOnZip, staged.isCompressed);
+        }
+        return ComPtr<IStream>();
+    }
+
+    // IZipArchive
+    std::vector<std::uint8_t> StagingObject::GetFileRecordsDigest(const std::string& lastFile)
+    {
+        return (lastFile == SignatureFile) ? m_fileRecordsDigest : std::vector<std::uint8_t>();
+    }
+
+    std::vector<std::uint8_t> StagingObject::GetCentralDirectoryDigest(const std::string& lastFile)
+    {
+        return (lastFile == SignatureFile) ? m_centralDirectoryDigest : std::vector<std::uint8_t>();
+    }
+}
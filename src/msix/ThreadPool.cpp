@@ -0,0 +1,77 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <system_error>
+
+namespace MSIX {
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto& thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    void ThreadPool::Run(std::size_t count, const std::function<void()>& job)
+    {
+        if (count <= 1)
+        {
+            job();
+            return;
+        }
+
+        Job item = { &job, count - 1, 0 };
+        {
+            std::lock_guard<std::mutex> guard(m_lock);
+            while (m_threads.size() < count - 1)
+            {
+                try
+                {
+                    m_threads.emplace_back([this]() { Work(); });
+                }
+                catch (const std::system_error&)
+                {   // Make do with the threads we have.
+                    break;
+                }
+            }
+            m_jobs.push_back(&item);
+        }
+        m_wake.notify_all();
+
+        job();
+
+        // Whatever is left of the work was taken by the threads that joined in, no more of them are needed.
+        std::unique_lock<std::mutex> lock(m_lock);
+        auto queued = std::find(m_jobs.begin(), m_jobs.end(), &item);
+        if (queued != m_jobs.end()) { m_jobs.erase(queued); }
+        m_done.wait(lock, [&item]() { return item.running == 0; });
+    }
+
+    void ThreadPool::Work()
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        for (;;)
+        {
+            m_wake.wait(lock, [this]() { return m_stop || !m_jobs.empty(); });
+            if (m_stop) { return; }
+
+            auto job = m_jobs.front();
+            job->running++;
+            if (--job->wanted == 0) { m_jobs.pop_front(); }
+            lock.unlock();
+            (*job->run)();
+            lock.lock();
+            if (--job->running == 0) { m_done.notify_all(); }
+        }
+    }
+}
@@ -0,0 +1,259 @@
+//
+//  Copyright (C) 2017 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+//
+#include "VerificationCache.hpp"
+#include "FileStream.hpp"
+#include "StreamHelper.hpp"
+#include "SHA256.hpp"
+
+#include <cstdio>
+#include <random>
+
+namespace MSIX {
+
+    namespace {
+        const std::uint8_t EntryMagic[8] = { 'M', 'S', 'I', 'X', 'V', 'C', '0', '1' };
+        const std::size_t MacSize = 32;
+        const std::size_t MaxEntrySize = 64 * 1024;
+        const std::size_t MinKeySize = 16;
+
+        // Entries are numbers, little endian, and byte strings after their size.
+        class EntryWriter
+        {
+        public:
+            void Number(std::uint32_t value)
+            {
+                for (int i = 0; i < 4; i++) { m_data.push_back(static_cast<std::uint8_t>(value >> (i * 8))); }
+            }
+
+            void Bytes(const std::uint8_t* data, std::size_t size)
+            {
+                Number(static_cast<std::uint32_t>(size));
+                m_data.insert(m_data.end(), data, data + size);
+            }
+
+            void Bytes(const std::vector<std::uint8_t>& data) { Bytes(data.data(), data.size()); }
+            void Text(const std::string& text) { Bytes(reinterpret_cast<const std::uint8_t*>(text.data()), text.size()); }
+
+            std::vector<std::uint8_t>& GetData() { return m_data; }
+
+        protected:
+            std::vector<std::uint8_t> m_data;
+        };
+
+        class EntryReader
+        {
+        public:
+            EntryReader(const std::uint8_t* data, std::size_t size) : m_data(data), m_size(size) {}
+
+            bool Number(std::uint32_t& value)
+            {
+                if (m_size - m_position < 4) { return false; }
+                value = 0;
+                for (int i = 0; i < 4; i++) { value |= static_cast<std::uint32_t>(m_data[m_position++]) << (i * 8); }
+                return true;
+            }
+
+            bool Bytes(std::vector<std::uint8_t>& data)
+            {
+                std::uint32_t size = 0;
+                if (!Number(size) || m_size - m_position < size) { return false; }
+                data.assign(m_data + m_position, m_data + m_position + size);
+                m_position += size;
+                return true;
+            }
+
+            bool Text(std::string& text)
+            {
+                std::vector<std::uint8_t> data;
+                if (!Bytes(data)) { return false; }
+                text.assign(data.begin(), data.end());
+                return true;
+            }
+
+            bool AtEnd() const { return m_position == m_size; }
+
+        protected:
+            const std::uint8_t* m_data;
+            std::size_t m_size;
+            std::size_t m_position = 0;
+        };
+
+        // A digest is either missing or whole.
+        bool IsDigest(const AppxSignatureObject::Digest& digest) { return digest.empty() || digest.size() == HASH_BYTES; }
+
+        // Doesn't stop at the first difference, so how long it takes doesn't say where it is.
+        bool IsSame(const std::uint8_t* left, const std::uint8_t* right, std::size_t size)
+        {
+            std::uint8_t difference = 0;
+            for (std::size_t i = 0; i < size; i++) { difference |= left[i] ^ right[i]; }
+            return difference == 0;
+        }
+    }
+
+    std::unique_ptr<VerificationCache> VerificationCache::Create(IMsixFactory* factory, MSIX_VALIDATION_OPTION options, const std::string& fileIdentity)
+    {
+        if ((options & MSIX_VALIDATION_OPTION_SKIPSIGNATURE) || fileIdentity.empty()) { return nullptr; }
+
+        ComPtr<IMsixFactoryOverrides> factoryOverrides;
+        ThrowHrIfFailed(factory->QueryInterface(UuidOfImpl<IMsixFactoryOverrides>::iid, reinterpret_cast<void**>(&factoryOverrides)));
+        ComPtr<IUnknown> settingsUnk;
+        ThrowHrIfFailed(factoryOverrides->GetCurrentSpecifiedExtension(MSIX_FACTORY_EXTENSION_VERIFICATION_CACHE, &settingsUnk));
+        if (settingsUnk.Get() == nullptr) { return nullptr; }
+
+        auto settings = settingsUnk.As<IMsixVerificationCacheSettings>();
+        LPCSTR directory = nullptr;
+        ThrowHrIfFailed(settings->GetDirectory(&directory));
+        ThrowErrorIf(Error::InvalidParameter, (directory == nullptr || *directory == '\0'), "verification cache has no directory");
+        UINT32 keySize = 0;
+        const BYTE* key = nullptr;
+        ThrowHrIfFailed(settings->GetKey(&keySize, &key));
+        ThrowErrorIf(Error::InvalidParameter, (key == nullptr || keySize < MinKeySize), "verification cache key is too short");
+        return std::make_unique<VerificationCache>(directory, std::vector<std::uint8_t>(key, key + keySize), options, fileIdentity);
+    }
+
+    VerificationCache::VerificationCache(std::string directory, std::vector<std::uint8_t> key, MSIX_VALIDATION_OPTION options, std::string fileIdentity) :
+        m_directory(std::move(directory)), m_key(std::move(key)), m_options(options), m_fileIdentity(std::move(fileIdentity))
+    {
+    }
+
+    bool VerificationCache::Find(const std::vector<std::uint8_t>& signature, Entry& entry) noexcept try
+    {
+        auto stream = ComPtr<IStream>::Make<FileStream>(GetPath(signature), FileStream::Mode::READ);
+        LARGE_INTEGER start = { 0 };
+        ULARGE_INTEGER end = { 0 };
+        ThrowHrIfFailed(stream->Seek(start, StreamBase::Reference::END, &end));
+        if (end.QuadPart < sizeof(EntryMagic) + MacSize || end.QuadPart > MaxEntrySize) { return false; }
+        ThrowHrIfFailed(stream->Seek(start, StreamBase::Reference::START, nullptr));
+        std::vector<std::uint8_t> data(static_cast<std::size_t>(end.QuadPart));
+        Helper::ReadAll(stream, data.data(), data.size());
+
+        // Nothing in it is looked at before the whole of it is known to be ours.
+        auto size = data.size() - MacSize;
+        auto expected = GetMac(std::vector<std::uint8_t>(data.begin(), data.begin() + size));
+        if (!IsSame(expected.data(), data.data() + size, MacSize)) { return false; }
+        if (!IsSame(EntryMagic, data.data(), sizeof(EntryMagic))) { return false; }
+
+        // Another file, signature or options could have been copied over this one, so the key is in the entry too.
+        EntryReader reader(data.data() + sizeof(EntryMagic), size - sizeof(EntryMagic));
+        std::string fileIdentity;
+        std::uint32_t options = 0;
+        std::vector<std::uint8_t> entrySignature;
+        std::uint32_t hasDigests = 0;
+        std::uint32_t origin = 0;
+        Entry result;
+        if (!reader.Text(fileIdentity) || !reader.Number(options) || !reader.Bytes(entrySignature) ||
+            !reader.Number(result.checks) || !reader.Number(hasDigests) ||
+            !reader.Bytes(result.fileRecords) || !reader.Bytes(result.centralDirectory) || !reader.Bytes(result.contentTypes) ||
+            !reader.Bytes(result.blockMap) || !reader.Bytes(result.codeIntegrity) ||
+            !reader.Number(origin) || !reader.Text(result.publisher) || !reader.AtEnd())
+        {
+            return false;
+        }
+        if (fileIdentity != m_fileIdentity || options != static_cast<std::uint32_t>(m_options) || entrySignature != signature) { return false; }
+        if (!IsDigest(result.fileRecords) || !IsDigest(result.centralDirectory) || !IsDigest(result.contentTypes) ||
+            !IsDigest(result.blockMap) || !IsDigest(result.codeIntegrity) || origin > static_cast<std::uint32_t>(SignatureOrigin::Unsigned))
+        {
+            return false;
+        }
+        result.hasDigests = (hasDigests != 0);
+        result.origin = static_cast<SignatureOrigin>(origin);
+        entry = std::move(result);
+        return true;
+    }
+    catch (...)
+    {   // Missing or unreadable, the package is checked in full.
+        return false;
+    }
+
+    void VerificationCache::Add(const std::vector<std::uint8_t>& signature, const Entry& entry) noexcept
+    {
+        std::string temporary;
+        try
+        {
+            EntryWriter writer;
+            auto& data = writer.GetData();
+            data.assign(EntryMagic, EntryMagic + sizeof(EntryMagic));
+            writer.Text(m_fileIdentity);
+            writer.Number(static_cast<std::uint32_t>(m_options));
+            writer.Bytes(signature);
+            writer.Number(entry.checks);
+            writer.Number(entry.hasDigests ? 1 : 0);
+            writer.Bytes(entry.fileRecords);
+            writer.Bytes(entry.centralDirectory);
+            writer.Bytes(entry.contentTypes);
+            writer.Bytes(entry.blockMap);
+            writer.Bytes(entry.codeIntegrity);
+            writer.Number(static_cast<std::uint32_t>(entry.origin));
+            writer.Text(entry.publisher);
+            auto mac = GetMac(data);
+            data.insert(data.end(), mac.begin(), mac.end());
+
+            // Written under a name of its own and renamed, so a reader never sees half an entry.
+            auto path = GetPath(signature);
+            std::random_device random;
+            temporary = path + "." + std::to_string(random()) + std::to_string(random()) + ".tmp";
+            {
+                auto stream = ComPtr<IStream>::Make<FileStream>(temporary, FileStream::Mode::WRITE);
+                ThrowHrIfFailed(stream->Write(data.data(), static_cast<ULONG>(data.size()), nullptr));
+            }
+            if (std::rename(temporary.c_str(), path.c_str()) != 0)
+            {   // Not every platform renames over an existing file.
+                std::remove(path.c_str());
+                if (std::rename(temporary.c_str(), path.c_str()) != 0) { std::remove(temporary.c_str()); }
+            }
+        }
+        catch (...)
+        {
+            if (!temporary.empty()) { std::remove(temporary.c_str()); }
+        }
+    }
+
+    // HMAC-SHA256 of the data with our key.
+    std::vector<std::uint8_t> VerificationCache::GetMac(const std::vector<std::uint8_t>& data)
+    {
+        const std::size_t blockSize = 64;
+        std::vector<std::uint8_t> key(m_key);
+        SHA256 hash;
+        if (key.size() > blockSize)
+        {
+            hash.Update(key.data(), key.size());
+            hash.Final(key);
+        }
+        key.resize(blockSize, 0);
+
+        std::uint8_t pad[blockSize];
+        for (std::size_t i = 0; i < blockSize; i++) { pad[i] = key[i] ^ 0x36; }
+        std::vector<std::uint8_t> inner;
+        hash.Update(pad, blockSize);
+        hash.Update(data.data(), data.size());
+        hash.Final(inner);
+
+        for (std::size_t i = 0; i < blockSize; i++) { pad[i] = key[i] ^ 0x5c; }
+        std::vector<std::uint8_t> mac;
+        hash.Update(pad, blockSize);
+        hash.Update(inner.data(), inner.size());
+        hash.Final(mac);
+        return mac;
+    }
+
+    // The name doesn't say what the entry is for to anyone without the key.
+    std::string VerificationCache::GetPath(const std::vector<std::uint8_t>& signature)
+    {
+        EntryWriter writer;
+        writer.Text(m_fileIdentity);
+        writer.Number(static_cast<std::uint32_t>(m_options));
+        writer.Bytes(signature);
+        auto name = GetMac(writer.GetData());
+
+        static const char digits[] = "0123456789abcdef";
+        std::string path = m_directory + "/";
+        for (std::size_t i = 0; i < 16; i++)
+        {
+            path.push_back(digits[name[i] >> 4]);
+            path.push_back(digits[name[i] & 0xf]);
+        }
+        return path + ".entry";
+    }
+}
@@ -10,12 +10,14 @@
 #include "ZipFileStream.hpp"
 #include "InflateStream.hpp"
 #include "VectorStream.hpp"
+#include "ReadAheadStream.hpp"
 
 #include <memory>
 #include <string>
 #include <limits>
 #include <functional>
 #include <algorithm>
+#include <cstring>
 namespace MSIX {
 /* Zip File Structure
 [LocalFileHeader 1]
@@ -135,6 +137,41 @@ constexpr static const GeneralPurposeBitFlags UnsupportedFlagsMask =
     GeneralPurposeBitFlags::UNSUPPORTED_14 |
     GeneralPurposeBitFlags::UNSUPPORTED_15;
 
+// Reads little-endian values out of an in-memory copy of a region of the archive.
+class BufferReader final
+{
+public:
+    BufferReader(const std::uint8_t* data, std::size_t size) : m_data(data), m_size(size) {}
+
+    template <class T>
+    T Read()
+    {
+        ThrowErrorIf(Error::FileRead, (m_size - m_position < sizeof(T)), "Entire object wasn't read!");
+        T value = 0;
+        for (std::size_t i = 0; i < sizeof(T); i++)
+        {
+            value |= static_cast<T>(static_cast<T>(m_data[m_position + i]) << (i * 8));
+        }
+        m_position += sizeof(T);
+        return value;
+    }
+
+    const std::uint8_t* Skip(std::size_t count)
+    {
+        ThrowErrorIf(Error::FileRead, (m_size - m_position < count), "Entire object wasn't read!");
+        auto result = m_data + m_position;
+        m_position += count;
+        return result;
+    }
+
+    std::size_t GetPosition() noexcept { return m_position; }
+
+private:
+    const std::uint8_t* m_data;
+    std::size_t         m_size;
+    std::size_t         m_position = 0;
+};
+
 /*  FROM APPNOTE.TXT section 4.5.3:
     If one of the size or offset fields in the Local or Central directory
     record is too small to hold the required data, a Zip64 extended information 
@@ -148,264 +185,120 @@ constexpr static const GeneralPurposeBitFlags UnsupportedFlagsMask =
 //////////////////////////////////////////////////////////////////////////////////////////////
 //                                  Zip64ExtendedInformation                                //
 //////////////////////////////////////////////////////////////////////////////////////////////
-class Zip64ExtendedInformation final : public Meta::StructuredObject<
-    Meta::Field2Bytes,  // 0 - tag for the "extra" block type               2 bytes(0x0001)
-    Meta::Field2Bytes,  // 1 - size of this "extra" block                   2 bytes
-    Meta::Field8Bytes,  // 2 - Original uncompressed file size              8 bytes
-                        // No point in validating these as it is actually 
-                        // possible to have a 0-byte file... Who knew.
-    Meta::Field8Bytes,  // 3 - Compressed file size                         8 bytes
-                        // No point in validating these as it is actually 
-                        // possible to have a 0-byte file... Who knew.    
-    Meta::Field8Bytes   // 4 - Offset of local header record                8 bytes
-    //Meta::Field4Bytes // 5 - number of the disk on which the file starts  4 bytes -- ITS A FAAKEE!
->
+// 0 - tag for the "extra" block type               2 bytes(0x0001)
+// 1 - size of this "extra" block                   2 bytes
+// 2 - Original uncompressed file size              8 bytes
+//     No point in validating these as it is actually possible to have a 0-byte file... Who knew.
+// 3 - Compressed file size                         8 bytes
+//     No point in validating these as it is actually possible to have a 0-byte file... Who knew.
+// 4 - Offset of local header record                8 bytes
+// 5 - number of the disk on which the file starts  4 bytes -- ITS A FAAKEE!
+class Zip64ExtendedInformation final
 {
 public:
-    void Read(const ComPtr<IStream>& stream)
-    {
-        StreamBase::Read(stream, &Field<0>().value);
-        Meta::ExactValueValidation<std::uint32_t>(Field<0>().value, static_cast<std::uint32_t>(HeaderIDs::Zip64ExtendedInfo));
+    static const std::size_t Size = 28;
 
-        StreamBase::Read(stream, &Field<1>().value);
-        Meta::OnlyEitherValueValidation<std::uint32_t>(Field<1>().value, 24, 28);
-        
-        StreamBase::Read(stream, &Field<2>().value);
-
-        StreamBase::Read(stream, &Field<3>().value);
-
-        StreamBase::Read(stream, &Field<4>().value);
-        ThrowErrorIfNot(Error::ZipBadExtendedData, Field<4>().value < m_start.QuadPart, "invalid relative header offset");
+    // start is the position in the archive right after the extra field.
+    static void Read(BufferReader& reader, std::uint64_t start, CentralDirectoryEntry& entry)
+    {
+        Meta::ExactValueValidation<std::uint32_t>(reader.Read<std::uint16_t>(), static_cast<std::uint32_t>(HeaderIDs::Zip64ExtendedInfo));
+        Meta::OnlyEitherValueValidation<std::uint32_t>(reader.Read<std::uint16_t>(), 24, 28);
+        entry.uncompressedSize = reader.Read<std::uint64_t>();
+        entry.compressedSize = reader.Read<std::uint64_t>();
+        entry.relativeOffsetOfLocalHeader = reader.Read<std::uint64_t>();
+        ThrowErrorIfNot(Error::ZipBadExtendedData, entry.relativeOffsetOfLocalHeader < start, "invalid relative header offset");
     }
-
-    Zip64ExtendedInformation(ULARGE_INTEGER start) : m_start(start) {}
- 
-    std::uint64_t GetUncompressedSize()         noexcept { return Field<2>().value; }
-    void SetUncompressedSize(std::uint64_t v)   noexcept { Field<2>().value = v; }
-    std::uint64_t GetCompressedSize()           noexcept { return Field<3>().value; }
-    void SetCompressedSize(std::uint64_t v)     noexcept { Field<3>().value = v; }
-    std::uint64_t GetRelativeOffset()           noexcept { return Field<4>().value; }
-    void SetRelativeOffset(std::uint64_t v)     noexcept { Field<4>().value = v; }
-
-private:
-    ULARGE_INTEGER  m_start;
 };
 
-/*  TODO: Implement large file support.
-This type currently represents a "zip32" Central Directory Header.  We need to create a new field type (offset)
-to replace the type for fields 8 & 9 whose implementation is determined by the version needed to extract (field 2)'s
-value.
-
-This type would replace its existing compressed & uncompressed sizes properties (encapsulated in fields 8 & 9)
-with a 64-bit value version of those methods:
-std::uint64_t GetCompressedSize()   { ...
-std::uint64_t GetUncompressedSize() { ...
-void SetCompressedSize  (std::uint64_t...
-void SetUncompressedSize(std::uint64_t...
-
-The underlying implementation of these methods would validate the resulting in/out values and pass the correct
-static_casted value to the new meta object type (offset) which would then hold the correct value, as well
-as handle the correct sizes w.r.t. (de)serialization.
-
-As-is I don't believe that we "need" this for now, so keeping the implementation "simpler" is probably the correct
-answer for now.
-*/
 //////////////////////////////////////////////////////////////////////////////////////////////
 //                              CentralDirectoryFileHeader                                  //
 //////////////////////////////////////////////////////////////////////////////////////////////
-class CentralDirectoryFileHeader final : public Meta::StructuredObject<
-    Meta::Field4Bytes, // 0 - central file header signature   4 bytes(0x02014b50)
-    Meta::Field2Bytes, // 1 - version made by                 2 bytes
-    Meta::Field2Bytes, // 2 - version needed to extract       2 bytes
-    Meta::Field2Bytes, // 3 - general purpose bit flag        2 bytes
-    Meta::Field2Bytes, // 4 - compression method              2 bytes
-    Meta::Field2Bytes, // 5 - last mod file time              2 bytes
-    Meta::Field2Bytes, // 6 - last mod file date              2 bytes
-    Meta::Field4Bytes, // 7 - crc - 32                        4 bytes
-    Meta::Field4Bytes, // 8 - compressed size                 4 bytes
-    Meta::Field4Bytes, // 9 - uncompressed size               4 bytes
-    Meta::Field2Bytes, //10 - file name length                2 bytes
-    Meta::Field2Bytes, //11 - extra field length              2 bytes
-    Meta::Field2Bytes, //12 - file comment length             2 bytes
-    Meta::Field2Bytes, //13 - disk number start               2 bytes
-    Meta::Field2Bytes, //14 - internal file attributes        2 bytes
-    Meta::Field4Bytes, //15 - external file attributes        4 bytes
-    Meta::Field4Bytes, //16 - relative offset of local header 4 bytes
-    Meta::FieldNBytes, //17 - file name(variable size)
-    Meta::FieldNBytes, //18 - extra field(variable size)
-    Meta::FieldNBytes  //19 - file comment(variable size)
-    >
+//  0 - central file header signature   4 bytes(0x02014b50)
+//  1 - version made by                 2 bytes
+//  2 - version needed to extract       2 bytes
+//  3 - general purpose bit flag        2 bytes
+//  4 - compression method              2 bytes
+//  5 - last mod file time              2 bytes
+//  6 - last mod file date              2 bytes
+//  7 - crc - 32                        4 bytes
+//  8 - compressed size                 4 bytes
+//  9 - uncompressed size               4 bytes
+// 10 - file name length                2 bytes
+// 11 - extra field length              2 bytes
+// 12 - file comment length             2 bytes
+// 13 - disk number start               2 bytes
+// 14 - internal file attributes        2 bytes
+// 15 - external file attributes        4 bytes
+// 16 - relative offset of local header 4 bytes
+// 17 - file name(variable size)
+// 18 - extra field(variable size)
+// 19 - file comment(variable size)
+// The central directory is read from the archive in one go, and each header is parsed out of that buffer
+// into a fixed size CentralDirectoryEntry. File names are appended to a single string shared by all entries.
+class CentralDirectoryFileHeader final
 {
 public:
-    void Read(const ComPtr<IStream>& stream)
+    // position is the offset in the archive of the first byte available to the reader.
+    static void Read(BufferReader& reader, std::uint64_t position, bool isZip64, CentralDirectoryEntry& entry, std::string& names)
     {
-        StreamBase::Read(stream, &Field<0>().value);
-        Meta::ExactValueValidation<std::uint32_t>(Field<0>().value, static_cast<std::uint32_t>(Signatures::CentralFileHeader));
-
-        StreamBase::Read(stream, &Field<1>().value);
+        Meta::ExactValueValidation<std::uint32_t>(reader.Read<std::uint32_t>(), static_cast<std::uint32_t>(Signatures::CentralFileHeader));
 
-        StreamBase::Read(stream, &Field<2>().value);
+        reader.Read<std::uint16_t>(); // version made by
+        reader.Read<std::uint16_t>(); // version needed to extract
 
-        StreamBase::Read(stream, &Field<3>().value);
+        entry.generalPurposeBitFlags = reader.Read<std::uint16_t>();
         ThrowErrorIfNot(Error::ZipCentralDirectoryHeader,
-            0 == (Field<3>().value & static_cast<std::uint16_t>(UnsupportedFlagsMask)),
+            0 == (entry.generalPurposeBitFlags & static_cast<std::uint16_t>(UnsupportedFlagsMask)),
             "unsupported flag(s) specified");
 
-        StreamBase::Read(stream, &Field<4>().value);
-        Meta::OnlyEitherValueValidation<std::uint16_t>(Field<4>().value,  static_cast<std::uint16_t>(CompressionType::Deflate),
+        entry.compressionMethod = reader.Read<std::uint16_t>();
+        Meta::OnlyEitherValueValidation<std::uint16_t>(entry.compressionMethod, static_cast<std::uint16_t>(CompressionType::Deflate),
             static_cast<std::uint16_t>(CompressionType::Store));
 
-        StreamBase::Read(stream, &Field<5>().value);
-        StreamBase::Read(stream, &Field<6>().value);
-        StreamBase::Read(stream, &Field<7>().value);
-        StreamBase::Read(stream, &Field<8>().value);
-        StreamBase::Read(stream, &Field<9>().value);
+        reader.Read<std::uint16_t>(); // last mod file time
+        reader.Read<std::uint16_t>(); // last mod file date
+        entry.crc32 = reader.Read<std::uint32_t>();
+        entry.compressedSize = reader.Read<std::uint32_t>();
+        entry.uncompressedSize = reader.Read<std::uint32_t>();
 
-        StreamBase::Read(stream, &Field<10>().value);
-        ThrowErrorIfNot(Error::ZipCentralDirectoryHeader, (Field<10>().value != 0), "unsupported file name size");
-        if (Field<10>().value !=0) {Field<17>().value.resize(Field<10>().value, 0); }
+        entry.fileNameLength = reader.Read<std::uint16_t>();
+        ThrowErrorIfNot(Error::ZipCentralDirectoryHeader, (entry.fileNameLength != 0), "unsupported file name size");
 
-        StreamBase::Read(stream, &Field<11>().value);
-        if (Field<11>().value != 0) { Field<18>().value.resize(Field<11>().value, 0); }
+        std::uint16_t extraFieldLength = reader.Read<std::uint16_t>();
 
-        StreamBase::Read(stream, &Field<12>().value);
-        Meta::ExactValueValidation<std::uint32_t>(Field<12>().value, 0);
+        std::uint16_t fileCommentLength = reader.Read<std::uint16_t>();
+        Meta::ExactValueValidation<std::uint32_t>(fileCommentLength, 0);
 
-        StreamBase::Read(stream, &Field<13>().value);
-        Meta::ExactValueValidation<std::uint32_t>(Field<13>().value, 0);
+        Meta::ExactValueValidation<std::uint32_t>(reader.Read<std::uint16_t>(), 0); // disk number start
 
-        StreamBase::Read(stream, &Field<14>().value);
+        reader.Read<std::uint16_t>(); // internal file attributes
+        reader.Read<std::uint32_t>(); // external file attributes
 
-        StreamBase::Read(stream, &Field<15>().value);
-        StreamBase::Read(stream, &Field<16>().value);
-        ULARGE_INTEGER pos = {0};
-        ThrowHrIfFailed(stream->Seek({0}, StreamBase::Reference::CURRENT, &pos));
-        if (!GetIsZip64())
+        entry.relativeOffsetOfLocalHeader = reader.Read<std::uint32_t>();
+        if (!isZip64)
         {
-            ThrowErrorIf(Error::ZipCentralDirectoryHeader, (Field<16>().value >= pos.QuadPart), "invalid relative header offset");
+            ThrowErrorIf(Error::ZipCentralDirectoryHeader, (entry.relativeOffsetOfLocalHeader >= position + reader.GetPosition()), "invalid relative header offset");
         }
         else
         {
-            ThrowErrorIf(Error::ZipCentralDirectoryHeader, (Field<16>().value != 0xFFFFFFFF), "invalid zip64 local header offset");
+            ThrowErrorIf(Error::ZipCentralDirectoryHeader, (entry.relativeOffsetOfLocalHeader != 0xFFFFFFFF), "invalid zip64 local header offset");
         }
 
-        if (Field<17>().Size())
-        {
-            ThrowHrIfFailed(stream->Read(reinterpret_cast<void*>(Field<17>().value.data()), static_cast<ULONG>(Field<17>().Size()), nullptr));
-        }
+        auto fileName = reader.Skip(entry.fileNameLength);
+        entry.fileNameOffset = static_cast<std::uint32_t>(names.size());
+        names.append(reinterpret_cast<const char*>(fileName), entry.fileNameLength);
 
-        if (Field<18>().Size())
-        {
-            ThrowHrIfFailed(stream->Read(reinterpret_cast<void*>(Field<18>().value.data()), static_cast<ULONG>(Field<18>().Size()), nullptr));
-        }
+        auto extraField = reader.Skip(extraFieldLength);
         // Only process for Zip64ExtendedInformation
-        if (Field<18>().Size() > 2 && Field<18>().value[0] == 0x01 && Field<18>().value[1] == 0x00)
-        {
-            LARGE_INTEGER zero = {0};
-            ThrowHrIfFailed(stream->Seek(zero, StreamBase::Reference::CURRENT, &pos));
-            auto vectorStream = ComPtr<IStream>::Make<VectorStream>(&Field<18>().value);
-            m_extendedInfo = std::make_unique<Zip64ExtendedInformation>(pos);
-            ThrowErrorIfNot(Error::ZipCentralDirectoryHeader, (Field<18>().Size() >= m_extendedInfo->Size()), "Unexpected extended info size");
-            m_extendedInfo->Read(vectorStream.Get());
-        }
-
-        if (Field<19>().Size())
+        if (extraFieldLength > 2 && extraField[0] == 0x01 && extraField[1] == 0x00)
         {
-            ThrowHrIfFailed(stream->Read(reinterpret_cast<void*>(Field<19>().value.data()), static_cast<ULONG>(Field<19>().Size()), nullptr));
+            ThrowErrorIfNot(Error::ZipCentralDirectoryHeader, (extraFieldLength >= Zip64ExtendedInformation::Size), "Unexpected extended info size");
+            BufferReader extraFieldReader(extraField, extraFieldLength);
+            Zip64ExtendedInformation::Read(extraFieldReader, position + reader.GetPosition(), entry);
         }
-    }
 
-    CentralDirectoryFileHeader(bool isZip64) : m_isZip64(isZip64)
-    {
-        SetSignature(static_cast<std::uint32_t>(Signatures::CentralFileHeader));
-        SetVersionMadeBy(static_cast<std::uint16_t>(ZipVersions::Zip64FormatExtension));
-        SetVersionNeededToExtract(static_cast<std::uint16_t>(ZipVersions::Zip32DefaultVersion));  // only set to Zip64FormatExtension iff required!
-        SetLastModFileDate(static_cast<std::uint16_t>(MagicNumbers::FileDate));
-        SetLastModFileTime(static_cast<std::uint16_t>(MagicNumbers::FileTime));
-        SetExtraFieldLength(0);
-        SetFileCommentLength(0);
-        SetDiskNumberStart(0);
-        SetInternalFileAttributes(0);
-        SetExternalFileAttributes(0);
+        reader.Skip(fileCommentLength);
     }
-
-    bool IsGeneralPurposeBitSet() noexcept
-    {   return ((GetGeneralPurposeBitFlags() & GeneralPurposeBitFlags::GeneralPurposeBit) == GeneralPurposeBitFlags::GeneralPurposeBit);
-    }
-
-    std::uint16_t GetVersionNeededToExtract()           noexcept { return Field<2>().value; }
-    GeneralPurposeBitFlags GetGeneralPurposeBitFlags()  noexcept { return static_cast<GeneralPurposeBitFlags>(Field<3>().value); }
-    void SetGeneralPurposeBitFlags(std::uint16_t value) noexcept { Field<3>().value = value; }
-    std::uint16_t GetCompressionMethod()                noexcept { return Field<4>().value; }
-    void SetCompressionMethod(std::uint16_t value)      noexcept { Field<4>().value= value; }
-    std::uint32_t GetCrc32()                            noexcept { return Field<7>().value; }
-    void SetCrc(std::uint32_t value)                    noexcept { Field<7>().value = value; }
-
-    std::uint64_t GetCompressedSize() noexcept
-    {
-        if (!m_extendedInfo.get()) {
-            return static_cast<std::uint64_t>(Field<8>().value);
-        }
-        return m_extendedInfo->GetCompressedSize();
-    }
-
-    // TODO: on-demand create m_extendedInfo?
-    void SetCompressedSize(std::uint32_t value) noexcept { Field<8>().value = value; }
-
-    std::uint64_t GetUncompressedSize() noexcept
-    {
-        if (!m_extendedInfo.get()) {
-            return static_cast<std::uint64_t>(Field<9>().value);
-        }
-        return m_extendedInfo->GetUncompressedSize();
-    }
-
-    // TODO: on-demand create m_extendedInfo?
-    void SetUncompressedSize(std::uint32_t value) noexcept { Field<9>().value = value; }
-
-    std::uint64_t GetRelativeOffsetOfLocalHeader() noexcept
-    {
-        if (!m_extendedInfo.get()) {
-            return static_cast<std::uint64_t>(Field<16>().value);
-        }
-        return m_extendedInfo->GetRelativeOffset();
-    }
-
-    // TODO: on-demand create m_extendedInfo?
-    void SetRelativeOffsetOfLocalHeader(std::uint32_t value) noexcept { Field<16>().value = value; }
-
-    std::string GetFileName()
-    {
-        auto data = Field<17>().value;
-        return std::string(data.begin(), data.end());
-    }
-
-    void SetFileName(std::string name)
-    {
-        auto data = Field<17>().value;
-        data.resize(name.size());
-        data.assign(name.begin(), name.end());
-        SetFileNameLength(static_cast<std::uint16_t>(name.size()));
-    }
-
-    inline bool GetIsZip64() noexcept { return m_isZip64; }
-
-private:
-    void SetSignature(std::uint32_t value)              noexcept { Field<0>().value = value; }
-    void SetVersionMadeBy(std::uint16_t value)          noexcept { Field<1>().value = value; }
-    void SetVersionNeededToExtract(std::uint16_t value) noexcept { Field<2>().value = value; }
-    void SetLastModFileTime(std::uint16_t value)        noexcept { Field<5>().value = value; }
-    void SetLastModFileDate(std::uint16_t value)        noexcept { Field<6>().value = value; }
-    void SetFileNameLength(std::uint16_t value)         noexcept { Field<10>().value = value; }
-    void SetExtraFieldLength(std::uint16_t value)       noexcept { Field<11>().value = value; }
-    std::uint16_t GetExtraFieldLength()                 noexcept { return Field<11>().value;  }
-    void SetFileCommentLength(std::uint16_t value)      noexcept { Field<12>().value = value; }
-    void SetDiskNumberStart(std::uint16_t value)        noexcept { Field<13>().value = value; }
-    void SetInternalFileAttributes(std::uint16_t value) noexcept { Field<14>().value = value; }
-    void SetExternalFileAttributes(std::uint16_t value) noexcept { Field<15>().value = value; }
-
-    std::unique_ptr<Zip64ExtendedInformation> m_extendedInfo;
-    bool m_isZip64 = false;
 };//class CentralDirectoryFileHeader
 
 //////////////////////////////////////////////////////////////////////////////////////////////
@@ -439,7 +332,7 @@ public:
 
         StreamBase::Read(stream, &Field<2>().value);
         ThrowErrorIfNot(Error::ZipLocalFileHeader, ((Field<2>().value & static_cast<std::uint16_t>(UnsupportedFlagsMask)) == 0), "unsupported flag(s) specified");
-        ThrowErrorIfNot(Error::ZipLocalFileHeader, (IsGeneralPurposeBitSet() == m_directoryEntry->IsGeneralPurposeBitSet()), "inconsistent general purpose bits specified");
+        ThrowErrorIfNot(Error::ZipLocalFileHeader, (IsGeneralPurposeBitSet() == m_directoryEntry.IsGeneralPurposeBitSet()), "inconsistent general purpose bits specified");
 
         StreamBase::Read(stream, &Field<3>().value);
         Meta::OnlyEitherValueValidation<std::uint16_t>(Field<3>().value, static_cast<std::uint16_t>(CompressionType::Deflate),
@@ -474,7 +367,7 @@ public:
         }
     }
 
-    LocalFileHeader(std::shared_ptr<CentralDirectoryFileHeader> directoryEntry) : m_isZip64(directoryEntry->GetIsZip64()), m_directoryEntry(directoryEntry)
+    LocalFileHeader(const CentralDirectoryEntry& directoryEntry) : m_directoryEntry(directoryEntry)
     {
     }
 
@@ -486,15 +379,19 @@ public:
     GeneralPurposeBitFlags GetGeneralPurposeBitFlags() noexcept { return static_cast<GeneralPurposeBitFlags>(Field<2>().value); }
     CompressionType GetCompressionType() noexcept { return static_cast<CompressionType>(Field<3>().value); }
 
+    // Zip64 entries have 0xFFFFFFFF here and the real size in the zip64 extra field. The central directory
+    // entry already has the 64 bit value.
     std::uint64_t GetCompressedSize() noexcept
     {
-        return IsGeneralPurposeBitSet() ? m_directoryEntry->GetCompressedSize() : static_cast<std::uint64_t>(Field<7>().value);
+        return (IsGeneralPurposeBitSet() || Field<7>().value == 0xFFFFFFFF) ? m_directoryEntry.compressedSize : static_cast<std::uint64_t>(Field<7>().value);
     }
 
     std::uint64_t GetUncompressedSize() noexcept
-    {   return IsGeneralPurposeBitSet() ? m_directoryEntry->GetUncompressedSize() : static_cast<std::uint64_t>(Field<8>().value);
+    {   return (IsGeneralPurposeBitSet() || Field<8>().value == 0xFFFFFFFF) ? m_directoryEntry.uncompressedSize : static_cast<std::uint64_t>(Field<8>().value);
     }
 
+    std::uint32_t GetCrc32() noexcept { return Field<6>().value; }
+
     std::uint16_t GetFileNameLength()                  noexcept { return Field<9>().value;  }
     std::uint16_t GetExtraFieldLength()                noexcept { return Field<10>().value; }
     void SetGeneralPurposeBitFlag(std::uint16_t value) noexcept { Field<2>().value = value;  }
@@ -517,8 +414,7 @@ public:
         SetFileNameLength(static_cast<std::uint16_t>(name.size()));
     }
 protected:
-    bool                                        m_isZip64        = false;
-    std::shared_ptr<CentralDirectoryFileHeader> m_directoryEntry = nullptr;
+    const CentralDirectoryEntry& m_directoryEntry;
 }; //class LocalFileHeader
 
 //////////////////////////////////////////////////////////////////////////////////////////////
@@ -743,6 +639,7 @@ public:
     bool GetIsZip64()                                           noexcept { return m_isZip64; }
     std::uint64_t GetNumberOfCentralDirectoryEntries()          noexcept { return static_cast<std::uint64_t>(Field<3>().value); }
     std::uint64_t GetStartOfCentralDirectory()                  noexcept { return static_cast<std::uint64_t>(Field<6>().value); }
+    std::uint64_t GetSizeOfCentralDirectory()                   noexcept { return static_cast<std::uint64_t>(Field<5>().value); }
 
 private:
     bool m_isZip64 = false;
@@ -765,21 +662,64 @@ private:
 std::vector<std::string> ZipObject::GetFileNames(FileNameOptions)
 {
     std::vector<std::string> result;
-    std::for_each(m_streams.begin(), m_streams.end(), [&result](auto it)
+    result.reserve(m_offsetOrder.size());
+    std::for_each(m_offsetOrder.begin(), m_offsetOrder.end(), [&](std::uint32_t index)
     {
-        result.push_back(it.first);
+        result.push_back(GetEntryName(m_centralDirectory[index]));
     });
     return result;
 }
 
 ComPtr<IStream> ZipObject::GetFile(const std::string& fileName)
-{   // TODO: Make this on-demand populate m_streams and then pull from there.
-    auto result = m_streams.find(fileName);
-    if (result == m_streams.end())
+{
+    std::uint32_t index = 0;
+    if (!FindEntry(fileName, index))
     {
         return ComPtr<IStream>();
-    }        
-    return result->second;
+    }
+
+    auto& cached = m_streams[index];
+    if (cached)
+    {
+        return cached;
+    }
+
+    // First request for this file. Read its local file header and create the stream for it.
+    const auto& centralDirectoryEntry = m_centralDirectory[index];
+    LARGE_INTEGER pos = {0};
+    pos.QuadPart = centralDirectoryEntry.relativeOffsetOfLocalHeader;
+    ThrowHrIfFailed(m_readAhead->Seek(pos, MSIX::StreamBase::Reference::START, nullptr));
+    LocalFileHeader localFileHeader(centralDirectoryEntry);
+    localFileHeader.Read(m_readAhead.Get());
+
+    // The crc-32 is checked by whichever stream produces the uncompressed bytes.
+    std::unique_ptr<Crc32Check> crcCheck;
+    if (m_factory->GetValidationOptions() & MSIX_VALIDATION_OPTION_VERIFYCRC)
+    {
+        ThrowErrorIfNot(Error::ZipLocalFileHeader, (localFileHeader.IsGeneralPurposeBitSet() || (localFileHeader.GetCrc32() == centralDirectoryEntry.crc32)),
+            "crc-32 in the local file header doesn't match the central directory");
+        crcCheck = std::make_unique<Crc32Check>(centralDirectoryEntry.crc32, localFileHeader.GetUncompressedSize());
+    }
+    bool isCompressed = (localFileHeader.GetCompressionType() == CompressionType::Deflate);
+
+    auto fileStream = ComPtr<IStream>::Make<ZipFileStream>(
+        fileName,
+        "TODO: Implement", // TODO: put value from content type 
+        m_factory,
+        isCompressed,
+        centralDirectoryEntry.relativeOffsetOfLocalHeader + localFileHeader.Size(),
+        localFileHeader.GetCompressedSize(),
+        m_readAhead,
+        isCompressed ? nullptr : std::move(crcCheck)
+        );
+
+    if (isCompressed)
+    {
+        fileStream = ComPtr<IStream>::Make<InflateStream>(std::move(fileStream), localFileHeader.GetUncompressedSize(), std::move(crcCheck));
+    }
+
+    cached = fileStream;
+    return fileStream;
 }
 
 std::string ZipObject::GetFileName()
@@ -787,22 +727,226 @@ std::string ZipObject::GetFileName()
     return m_stream.As<IStreamInternal>()->GetName();
 }
 
+std::string ZipObject::GetEntryName(const CentralDirectoryEntry& entry)
+{
+    return m_names.substr(entry.fileNameOffset, entry.fileNameLength);
+}
+
+bool ZipObject::FindEntry(const std::string& fileName, std::uint32_t& index)
+{
+    auto entry = std::lower_bound(m_sortedEntries.begin(), m_sortedEntries.end(), fileName, [&](std::uint32_t index, const std::string& name)
+    {
+        const auto& centralDirectoryEntry = m_centralDirectory[index];
+        return m_names.compare(centralDirectoryEntry.fileNameOffset, centralDirectoryEntry.fileNameLength, name) < 0;
+    });
+    if (entry == m_sortedEntries.end() || GetEntryName(m_centralDirectory[*entry]) != fileName)
+    {
+        return false;
+    }
+    index = *entry;
+    return true;
+}
+
+// The last file is the one whose local file header comes after those of all the others.
+bool ZipObject::FindLastFile(const std::string& lastFile, std::uint32_t& index)
+{
+    if (!FindEntry(lastFile, index))
+    {
+        return false;
+    }
+    auto offset = m_centralDirectory[index].relativeOffsetOfLocalHeader;
+    for (std::uint32_t other = 0; other < m_centralDirectory.size(); other++)
+    {
+        if (other != index && m_centralDirectory[other].relativeOffsetOfLocalHeader >= offset)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Size of the pieces the file records are hashed in.
+static const std::uint64_t DigestReadSize = 1024 * 1024;
+// Most a data descriptor takes, with its signature and 64 bit sizes.
+static const std::uint64_t MaxDataDescriptorSize = 24;
+
+std::vector<std::uint8_t> ZipObject::GetFileRecordsDigest(const std::string& lastFile)
+{
+    std::vector<std::uint8_t> digest;
+    std::uint32_t index = 0;
+    if (!FindLastFile(lastFile, index))
+    {
+        return digest;
+    }
+
+    // Neither digest is of the last file, so nothing else may hide between its data and the central directory.
+    const auto& last = m_centralDirectory[index];
+    LARGE_INTEGER pos = {0};
+    pos.QuadPart = last.relativeOffsetOfLocalHeader;
+    ThrowHrIfFailed(m_readAhead->Seek(pos, MSIX::StreamBase::Reference::START, nullptr));
+    LocalFileHeader localFileHeader(last);
+    localFileHeader.Read(m_readAhead.Get());
+    auto endOfData = last.relativeOffsetOfLocalHeader + localFileHeader.Size() + localFileHeader.GetCompressedSize();
+    auto dataDescriptorSize = localFileHeader.IsGeneralPurposeBitSet() ? MaxDataDescriptorSize : 0;
+    if (endOfData > m_offsetStartOfCD || m_offsetStartOfCD - endOfData > dataDescriptorSize)
+    {
+        return digest;
+    }
+
+    // One pass front to back, through the read-ahead stream so what is read next is already being fetched. If the
+    // stream is memory backed the bytes are hashed where they are, and the local file headers and blocks read after
+    // this are read from there too.
+    SHA256 hash;
+    auto view = m_readAhead.As<IStreamView>();
+    std::vector<std::uint8_t> buffer;
+    for (std::uint64_t position = 0; position < last.relativeOffsetOfLocalHeader; )
+    {
+        auto count = std::min(DigestReadSize, last.relativeOffsetOfLocalHeader - position);
+        const std::uint8_t* data = view->GetView(position, count);
+        if (data == nullptr)
+        {
+            buffer.resize(static_cast<std::size_t>(count));
+            pos.QuadPart = position;
+            ThrowHrIfFailed(m_readAhead->Seek(pos, MSIX::StreamBase::Reference::START, nullptr));
+            ULONG bytesRead = 0;
+            ThrowHrIfFailed(m_readAhead->Read(buffer.data(), static_cast<ULONG>(count), &bytesRead));
+            ThrowErrorIf(Error::FileRead, (bytesRead != count), "file records cut short");
+            data = buffer.data();
+        }
+        hash.Update(data, static_cast<std::size_t>(count));
+        position += count;
+    }
+    hash.Final(digest);
+    return digest;
+}
+
+// Skips a central directory file header and returns the name in it. The headers were parsed already, this only
+// finds where they are for the digest of the central directory.
+static std::string SkipCentralDirectoryFileHeader(BufferReader& reader)
+{
+    const std::size_t fixedHeaderSize = 46;
+    BufferReader lengths(reader.Skip(fixedHeaderSize) + 28, 3 * sizeof(std::uint16_t));
+    auto fileNameLength = lengths.Read<std::uint16_t>();
+    std::size_t otherLength = lengths.Read<std::uint16_t>();
+    otherLength += lengths.Read<std::uint16_t>();
+    auto fileName = reader.Skip(fileNameLength);
+    reader.Skip(otherLength);
+    return std::string(reinterpret_cast<const char*>(fileName), fileNameLength);
+}
+
+// Digest of the central directory without the header of lastFile, and of the records that end the archive as they
+// were without it. Empty if lastFile has no header. records are changed in place.
+static std::vector<std::uint8_t> GetCentralDirectoryDigest(const std::uint8_t* centralDirectory, std::size_t sizeOfCD,
+    std::vector<std::uint8_t>& records, const std::string& lastFile, std::uint64_t offsetOfLastFile)
+{
+    std::vector<std::uint8_t> digest;
+    BufferReader reader(centralDirectory, sizeOfCD);
+    std::uint64_t entries = 0;
+    std::size_t headerStart = 0;
+    std::size_t headerSize = 0;
+    while (reader.GetPosition() < sizeOfCD)
+    {
+        auto start = reader.GetPosition();
+        if (SkipCentralDirectoryFileHeader(reader) == lastFile && headerSize == 0)
+        {
+            headerStart = start;
+            headerSize = reader.GetPosition() - start;
+        }
+        else
+        {
+            entries++;
+        }
+    }
+    if (headerSize == 0)
+    {
+        return digest;
+    }
+
+    // Values too big for their field in the last record are in the zip64 records and left as they are.
+    std::uint64_t newSizeOfCD = sizeOfCD - headerSize;
+    auto set = [&](std::size_t at, std::size_t size, std::uint64_t value)
+    {
+        bool saturated = (size != sizeof(std::uint64_t));
+        for (std::size_t i = 0; i < size; i++) { saturated = saturated && (records[at + i] == 0xFF); }
+        if (!saturated)
+        {
+            for (std::size_t i = 0; i < size; i++) { records[at + i] = static_cast<std::uint8_t>(value >> (i * 8)); }
+        }
+    };
+    const std::size_t endRecordSize = 22;
+    const std::size_t zip64LocatorSize = 20;
+    const std::size_t zip64RecordSize = 56;
+    ThrowErrorIf(Error::ZipEOCDRecord, (records.size() < endRecordSize), "end of central directory record missing");
+    auto endRecord = records.size() - endRecordSize;
+    set(endRecord + 8, 2, entries);
+    set(endRecord + 10, 2, entries);
+    set(endRecord + 12, 4, newSizeOfCD);
+    set(endRecord + 16, 4, offsetOfLastFile);
+    if (records.size() >= zip64RecordSize + zip64LocatorSize + endRecordSize &&
+        BufferReader(records.data(), records.size()).Read<std::uint32_t>() == static_cast<std::uint32_t>(Signatures::Zip64EndOfCD))
+    {   // The zip64 record comes right after the central directory and the locator right before the last record.
+        set(24, 8, entries);
+        set(32, 8, entries);
+        set(40, 8, newSizeOfCD);
+        set(48, 8, offsetOfLastFile);
+        set(endRecord - zip64LocatorSize + 8, 8, offsetOfLastFile + newSizeOfCD);
+    }
+
+    SHA256 hash;
+    hash.Update(centralDirectory, headerStart);
+    hash.Update(centralDirectory + headerStart + headerSize, sizeOfCD - headerStart - headerSize);
+    hash.Update(records.data(), records.size());
+    hash.Final(digest);
+    return digest;
+}
+
+std::vector<std::uint8_t> ZipObject::GetCentralDirectoryDigest(const std::string& lastFile)
+{
+    std::uint32_t index = 0;
+    if (!FindLastFile(lastFile, index))
+    {
+        return std::vector<std::uint8_t>();
+    }
+
+    auto endOfCD = m_offsetStartOfCD + m_sizeOfCD;
+    ThrowErrorIf(Error::ZipEOCDRecord, (m_endOfArchive - endOfCD > std::numeric_limits<ULONG>::max()), "end of central directory records too big");
+    std::vector<std::uint8_t> records(static_cast<std::size_t>(m_endOfArchive - endOfCD));
+    LARGE_INTEGER pos = {0};
+    pos.QuadPart = endOfCD;
+    ThrowHrIfFailed(m_stream->Seek(pos, StreamBase::Reference::START, nullptr));
+    ULONG bytesRead = 0;
+    ThrowHrIfFailed(m_stream->Read(records.data(), static_cast<ULONG>(records.size()), &bytesRead));
+    ThrowErrorIf(Error::FileRead, (bytesRead != records.size()), "end of central directory records cut short");
+    return MSIX::GetCentralDirectoryDigest(m_centralDirectoryData, static_cast<std::size_t>(m_sizeOfCD), records,
+        lastFile, m_centralDirectory[index].relativeOffsetOfLocalHeader);
+}
+
+// How far ahead of the reads of the file data the underlying stream is asked to fetch.
+static const std::uint64_t ReadAheadDistance = 4 * 1024 * 1024;
+
 ZipObject::ZipObject(IMsixFactory* appxFactory, const ComPtr<IStream>& stream) : m_factory(appxFactory), m_stream(stream)
 {   // Confirm that the file IS the correct format
     EndCentralDirectoryRecord endCentralDirectoryRecord;
     LARGE_INTEGER pos = {0};
     pos.QuadPart = -1 * endCentralDirectoryRecord.Size();
-    ThrowHrIfFailed(m_stream->Seek(pos, StreamBase::Reference::END, nullptr));
+    ULARGE_INTEGER startOfEndCentralDirectoryRecord = {0};
+    ThrowHrIfFailed(m_stream->Seek(pos, StreamBase::Reference::END, &startOfEndCentralDirectoryRecord));
     endCentralDirectoryRecord.Read(m_stream.Get());
 
     // find where the zip central directory exists.
     std::uint64_t offsetStartOfCD = 0;
+    std::uint64_t sizeOfCD = 0;
     std::uint64_t totalNumberOfEntries = 0;
+    std::uint64_t endOfCD = 0;
     Zip64EndOfCentralDirectoryLocator zip64Locator;
     if (!endCentralDirectoryRecord.GetArchiveHasZip64Locator())
     {
         offsetStartOfCD      = endCentralDirectoryRecord.GetStartOfCentralDirectory();
+        sizeOfCD             = endCentralDirectoryRecord.GetSizeOfCentralDirectory();
         totalNumberOfEntries = endCentralDirectoryRecord.GetNumberOfCentralDirectoryEntries();
+        endOfCD              = startOfEndCentralDirectoryRecord.QuadPart;
+        ThrowErrorIf(Error::ZipEOCDRecord, (offsetStartOfCD > endOfCD) || (sizeOfCD > endOfCD - offsetStartOfCD),
+            "invalid size of central directory");
     }
     else
     {   // Make sure that we have a zip64 end of central directory locator            
@@ -816,53 +960,509 @@ ZipObject::ZipObject(IMsixFactory* appxFactory, const ComPtr<IStream>& stream) :
         ThrowHrIfFailed(m_stream->Seek(pos, StreamBase::Reference::START, nullptr));
         zip64EndOfCentralDirectory.Read(m_stream.Get());            
         offsetStartOfCD = zip64EndOfCentralDirectory.GetOffsetStartOfCD();
+        sizeOfCD = zip64EndOfCentralDirectory.GetSizeOfCD();
         totalNumberOfEntries = zip64EndOfCentralDirectory.GetTotalNumberOfEntries();
+        endOfCD = zip64Locator.GetRelativeOffset();
+        // We should have no data between the end of the last central directory header and the start of the EoCD
+        ThrowErrorIfNot(Error::ZipHiddenData, (offsetStartOfCD <= endOfCD) && (sizeOfCD == endOfCD - offsetStartOfCD), "hidden data unsupported");
     }
 
-    // read the zip central directory
-    std::map<std::string, std::shared_ptr<CentralDirectoryFileHeader>> centralDirectory;
-    pos.QuadPart = offsetStartOfCD;
-    ThrowHrIfFailed(m_stream->Seek(pos, StreamBase::Reference::START, nullptr));
-    for (std::uint32_t index = 0; index < totalNumberOfEntries; index++)
+    // parse the zip central directory from memory. If the stream is memory backed use it in place,
+    // otherwise read it with a single read.
+    ThrowErrorIf(Error::ZipEOCDRecord, (sizeOfCD > std::numeric_limits<ULONG>::max()), "central directory too big");
+    const std::uint8_t* centralDirectory = nullptr;
+    auto view = m_stream.TryAs<IStreamView>();
+    if (view) { centralDirectory = view->GetView(offsetStartOfCD, sizeOfCD); }
+    if (centralDirectory == nullptr)
     {
-        auto centralFileHeader = std::make_shared<CentralDirectoryFileHeader>(endCentralDirectoryRecord.GetIsZip64());
-        centralFileHeader->Read(m_stream.Get());
-        // TODO: ensure that there are no collisions on name!
-        centralDirectory.insert(std::make_pair(centralFileHeader->GetFileName(), centralFileHeader));
+        m_centralDirectoryBuffer.resize(static_cast<std::size_t>(sizeOfCD));
+        pos.QuadPart = offsetStartOfCD;
+        ThrowHrIfFailed(m_stream->Seek(pos, StreamBase::Reference::START, nullptr));
+        ULONG bytesRead = 0;
+        ThrowHrIfFailed(m_stream->Read(m_centralDirectoryBuffer.data(), static_cast<ULONG>(m_centralDirectoryBuffer.size()), &bytesRead));
+        ThrowErrorIf(Error::FileRead, (bytesRead != m_centralDirectoryBuffer.size()), "Entire central directory wasn't read!");
+        centralDirectory = m_centralDirectoryBuffer.data();
+    }
+    m_centralDirectoryData = centralDirectory;
+    m_offsetStartOfCD = offsetStartOfCD;
+    m_sizeOfCD = sizeOfCD;
+    m_endOfArchive = startOfEndCentralDirectoryRecord.QuadPart + endCentralDirectoryRecord.Size();
+
+    // Every entry takes at least the fixed part of its header, don't trust the number of entries for the allocation.
+    const std::size_t minimumHeaderSize = 46;
+    m_centralDirectory.reserve(static_cast<std::size_t>(std::min<std::uint64_t>(totalNumberOfEntries, sizeOfCD / minimumHeaderSize)));
+    m_names.reserve(static_cast<std::size_t>(sizeOfCD));
+    BufferReader reader(centralDirectory, static_cast<std::size_t>(sizeOfCD));
+    for (std::uint64_t index = 0; index < totalNumberOfEntries; index++)
+    {
+        CentralDirectoryEntry entry;
+        CentralDirectoryFileHeader::Read(reader, offsetStartOfCD, endCentralDirectoryRecord.GetIsZip64(), entry, m_names);
+        m_centralDirectory.push_back(entry);
     }
 
     if (endCentralDirectoryRecord.GetArchiveHasZip64Locator())
-    {   // We should have no data between the end of the last central directory header and the start of the EoCD
-        ULARGE_INTEGER uPos = {0};
-        ThrowHrIfFailed(m_stream->Seek({0}, StreamBase::Reference::CURRENT, &uPos));
-        ThrowErrorIfNot(Error::ZipHiddenData, (uPos.QuadPart == zip64Locator.GetRelativeOffset()), "hidden data unsupported");
-    }
-
-    // TODO: change population of m_streams into cache semantics and move into ZipObject::GetFile
-    // Read the file repository
-    for (const auto& centralFileHeader : centralDirectory)
-    {
-        pos.QuadPart = centralFileHeader.second->GetRelativeOffsetOfLocalHeader();
-        ThrowHrIfFailed(m_stream->Seek(pos, MSIX::StreamBase::Reference::START, nullptr));
-        auto localFileHeader = std::make_shared<LocalFileHeader>(centralFileHeader.second);
-        localFileHeader->Read(m_stream.Get());
-
-        auto fileStream = ComPtr<IStream>::Make<ZipFileStream>(
-            centralFileHeader.second->GetFileName(),
-            "TODO: Implement", // TODO: put value from content type 
-            m_factory,
-            localFileHeader->GetCompressionType() == CompressionType::Deflate,
-            centralFileHeader.second->GetRelativeOffsetOfLocalHeader() + localFileHeader->Size(),
-            localFileHeader->GetCompressedSize(),
-            m_stream
-            );
-
-        if (localFileHeader->GetCompressionType() == CompressionType::Deflate)
+    {
+        ThrowErrorIfNot(Error::ZipHiddenData, (reader.GetPosition() == sizeOfCD), "hidden data unsupported");
+    }
+
+    // Sort by name for lookups. If there are duplicated names, only the first one is visible.
+    // TODO: ensure that there are no collisions on name!
+    m_sortedEntries.resize(m_centralDirectory.size());
+    for (std::uint32_t index = 0; index < m_sortedEntries.size(); index++)
+    {
+        m_sortedEntries[index] = index;
+    }
+    auto compareNames = [&](std::uint32_t left, std::uint32_t right)
+    {
+        const auto& leftEntry = m_centralDirectory[left];
+        const auto& rightEntry = m_centralDirectory[right];
+        return m_names.compare(leftEntry.fileNameOffset, leftEntry.fileNameLength,
+            m_names, rightEntry.fileNameOffset, rightEntry.fileNameLength);
+    };
+    std::stable_sort(m_sortedEntries.begin(), m_sortedEntries.end(), [&](std::uint32_t left, std::uint32_t right)
+    {
+        return compareNames(left, right) < 0;
+    });
+    m_sortedEntries.erase(std::unique(m_sortedEntries.begin(), m_sortedEntries.end(), [&](std::uint32_t left, std::uint32_t right)
+    {
+        return compareNames(left, right) == 0;
+    }), m_sortedEntries.end());
+
+    m_offsetOrder = m_sortedEntries;
+    std::sort(m_offsetOrder.begin(), m_offsetOrder.end(), [&](std::uint32_t left, std::uint32_t right)
+    {
+        return m_centralDirectory[left].relativeOffsetOfLocalHeader < m_centralDirectory[right].relativeOffsetOfLocalHeader;
+    });
+    m_streams.resize(m_centralDirectory.size());
+    m_readAhead = ComPtr<IStream>::Make<ReadAheadStream>(m_stream, offsetStartOfCD, ReadAheadDistance);
+} // ZipObject::ZipObject
+//////////////////////////////////////////////////////////////////////////////////////////////
+//                              ZipStreamReader member implementation                       //
+//////////////////////////////////////////////////////////////////////////////////////////////
+// Size of the reads done on the underlying stream.
+static const std::size_t StreamReadSize = 64 * 1024;
+// Size of the local file header up to the file name.
+static const std::size_t LocalFileHeaderFixedSize = 30;
+
+ZipStreamReader::ZipStreamReader(const ComPtr<IStream>& stream) : m_stream(stream), m_buffer(StreamReadSize)
+{
+    m_compressionObject = CreateCompressionObject();
+}
+
+ZipStreamReader::~ZipStreamReader()
+{
+    if (m_inEntry && m_isCompressed && !m_inflateEnded)
+    {
+        m_compressionObject->Cleanup();
+    }
+}
+
+bool ZipStreamReader::Fill(std::size_t count)
+{
+    if (Available() >= count)
+    {
+        return true;
+    }
+    // Move what is left to the front and make sure there is room for a whole read past what is needed.
+    if (m_begin != 0)
+    {
+        std::memmove(m_buffer.data(), m_buffer.data() + m_begin, Available());
+        m_end -= m_begin;
+        m_begin = 0;
+    }
+    if (m_buffer.size() < count + StreamReadSize)
+    {
+        m_buffer.resize(count + StreamReadSize);
+    }
+    while (Available() < count)
+    {
+        ULONG bytesRead = 0;
+        ThrowHrIfFailed(m_stream->Read(m_buffer.data() + m_end, static_cast<ULONG>(m_buffer.size() - m_end), &bytesRead));
+        if (bytesRead == 0)
         {
-            fileStream = ComPtr<IStream>::Make<InflateStream>(std::move(fileStream), localFileHeader->GetUncompressedSize());
+            return false;
         }
+        m_end += bytesRead;
+    }
+    return true;
+}
 
-        m_streams.insert(std::make_pair(centralFileHeader.second->GetFileName(), std::move(fileStream)));
+void ZipStreamReader::Consume(std::size_t count)
+{
+    if (m_hashFileRecords)
+    {
+        m_fileRecordsHash.Update(m_buffer.data() + m_begin, count);
     }
-} // ZipObject::ZipObject
+    if (m_inCentralDirectory)
+    {
+        m_centralDirectory.insert(m_centralDirectory.end(), m_buffer.data() + m_begin, m_buffer.data() + m_begin + count);
+    }
+    m_position += count;
+    m_begin += count;
+}
+
+void ZipStreamReader::KeepDigests(const std::string& lastFile)
+{
+    m_lastFile = lastFile;
+    m_keepDigests = true;
+    m_hashFileRecords = true;
+}
+
+std::vector<std::uint8_t> ZipStreamReader::GetFileRecordsDigest()
+{
+    if (!m_finished || !m_lastFileIsLast)
+    {
+        return std::vector<std::uint8_t>();
+    }
+    return m_fileRecordsDigest;
+}
+
+std::vector<std::uint8_t> ZipStreamReader::GetCentralDirectoryDigest()
+{
+    if (!m_finished || !m_lastFileIsLast || !m_inCentralDirectory)
+    {
+        return std::vector<std::uint8_t>();
+    }
+    // The central directory is the file headers at the front of what was kept.
+    BufferReader reader(m_centralDirectory.data(), m_centralDirectory.size());
+    while ((m_centralDirectory.size() - reader.GetPosition() >= sizeof(std::uint32_t)) &&
+        (BufferReader(m_centralDirectory.data() + reader.GetPosition(), sizeof(std::uint32_t)).Read<std::uint32_t>() ==
+            static_cast<std::uint32_t>(Signatures::CentralFileHeader)))
+    {
+        SkipCentralDirectoryFileHeader(reader);
+    }
+    auto sizeOfCD = reader.GetPosition();
+    std::vector<std::uint8_t> records(m_centralDirectory.begin() + sizeOfCD, m_centralDirectory.end());
+    return MSIX::GetCentralDirectoryDigest(m_centralDirectory.data(), sizeOfCD, records, m_lastFile, m_lastFileOffset);
+}
+
+bool ZipStreamReader::MoveNext()
+{
+    if (m_inEntry)
+    {   // Skip what the caller didn't read of the current entry.
+        std::vector<std::uint8_t> skip(StreamReadSize);
+        while (Read(skip.data(), static_cast<ULONG>(skip.size())) != 0) {}
+    }
+    if (m_finished)
+    {
+        return false;
+    }
+
+    ThrowErrorIfNot(Error::FileRead, Fill(sizeof(std::uint32_t)), "unexpected end of the archive");
+    auto signature = BufferReader(m_buffer.data() + m_begin, Available()).Read<std::uint32_t>();
+    if (signature == static_cast<std::uint32_t>(Signatures::CentralFileHeader) ||
+        signature == static_cast<std::uint32_t>(Signatures::Zip64EndOfCD) ||
+        signature == static_cast<std::uint32_t>(Signatures::EndOfCentralDirectory))
+    {   // No more entries. Read the central directory through so the source gets to its end.
+        m_inCentralDirectory = m_keepDigests;
+        do
+        {
+            Consume(Available());
+        } while (Fill(1));
+        m_finished = true;
+        return false;
+    }
+    ThrowErrorIfNot(Error::ZipLocalFileHeader, (signature == static_cast<std::uint32_t>(Signatures::LocalFileHeader)), "expected a local file header");
+
+    ThrowErrorIfNot(Error::FileRead, Fill(LocalFileHeaderFixedSize), "unexpected end of the archive");
+    BufferReader fixed(m_buffer.data() + m_begin, LocalFileHeaderFixedSize);
+    fixed.Read<std::uint32_t>(); // signature
+    auto version = fixed.Read<std::uint16_t>();
+    ThrowErrorIfNot(Error::ZipLocalFileHeader,
+        (version == static_cast<std::uint16_t>(ZipVersions::Zip32DefaultVersion)) ||
+        (version == static_cast<std::uint16_t>(ZipVersions::Zip64FormatExtension)), "unsupported version");
+    auto flags = fixed.Read<std::uint16_t>();
+    ThrowErrorIfNot(Error::ZipLocalFileHeader, ((flags & static_cast<std::uint16_t>(UnsupportedFlagsMask)) == 0), "unsupported flag(s) specified");
+    auto compression = fixed.Read<std::uint16_t>();
+    ThrowErrorIfNot(Error::ZipLocalFileHeader,
+        (compression == static_cast<std::uint16_t>(CompressionType::Deflate)) ||
+        (compression == static_cast<std::uint16_t>(CompressionType::Store)), "unsupported compression method");
+    fixed.Read<std::uint16_t>(); // last mod file time
+    fixed.Read<std::uint16_t>(); // last mod file date
+    auto crc = fixed.Read<std::uint32_t>();
+    std::uint64_t compressedSize = fixed.Read<std::uint32_t>();
+    std::uint64_t uncompressedSize = fixed.Read<std::uint32_t>();
+    auto fileNameLength = fixed.Read<std::uint16_t>();
+    auto extraFieldLength = fixed.Read<std::uint16_t>();
+    ThrowErrorIf(Error::ZipLocalFileHeader, (fileNameLength == 0), "unsupported file name size");
+
+    std::size_t headerSize = LocalFileHeaderFixedSize + fileNameLength + extraFieldLength;
+    ThrowErrorIfNot(Error::FileRead, Fill(headerSize), "unexpected end of the archive");
+    BufferReader reader(m_buffer.data() + m_begin, headerSize);
+    reader.Skip(LocalFileHeaderFixedSize);
+    m_name.assign(reinterpret_cast<const char*>(reader.Skip(fileNameLength)), fileNameLength);
+
+    // The only extra field that matters is the zip64 extended information. It has the sizes when the 32 bit
+    // fields are 0xFFFFFFFF. The data descriptor has 64 bit sizes when it is there, or when the entry needs
+    // the zip64 version to extract, which is what makeappx does.
+    m_isZip64 = (version == static_cast<std::uint16_t>(ZipVersions::Zip64FormatExtension));
+    while (reader.GetPosition() + 2 * sizeof(std::uint16_t) <= headerSize)
+    {
+        auto headerId = reader.Read<std::uint16_t>();
+        auto dataSize = reader.Read<std::uint16_t>();
+        ThrowErrorIf(Error::ZipBadExtendedData, (headerSize - reader.GetPosition() < dataSize), "extra field too big");
+        BufferReader data(reader.Skip(dataSize), dataSize);
+        if (headerId == static_cast<std::uint16_t>(HeaderIDs::Zip64ExtendedInfo))
+        {
+            ThrowErrorIf(Error::ZipBadExtendedData, (dataSize < 2 * sizeof(std::uint64_t)), "zip64 extended information too small");
+            m_isZip64 = true;
+            auto zip64UncompressedSize = data.Read<std::uint64_t>();
+            auto zip64CompressedSize = data.Read<std::uint64_t>();
+            if (uncompressedSize == 0xFFFFFFFF) { uncompressedSize = zip64UncompressedSize; }
+            if (compressedSize == 0xFFFFFFFF) { compressedSize = zip64CompressedSize; }
+        }
+    }
+    if (m_keepDigests)
+    {
+        if (m_lastFileFound)
+        {
+            m_lastFileIsLast = false;
+        }
+        else if (m_name == m_lastFile)
+        {   // The file records digest is of everything before this header.
+            m_lastFileFound = true;
+            m_lastFileIsLast = true;
+            m_lastFileOffset = m_position;
+            if (m_hashFileRecords)
+            {
+                m_fileRecordsHash.Final(m_fileRecordsDigest);
+                m_hashFileRecords = false;
+            }
+        }
+    }
+    Consume(headerSize);
+
+    m_hasDataDescriptor = ((flags & static_cast<std::uint16_t>(GeneralPurposeBitFlags::GeneralPurposeBit)) != 0);
+    ThrowErrorIfNot(Error::ZipLocalFileHeader, (!m_hasDataDescriptor || (crc == 0)), "Invalid Zip CRC");
+    ThrowErrorIfNot(Error::ZipLocalFileHeader, (!m_hasDataDescriptor || (compressedSize == 0)), "Invalid Zip compressed size");
+    m_isCompressed = (compression == static_cast<std::uint16_t>(CompressionType::Deflate));
+    ThrowErrorIf(Error::ZipLocalFileHeader, (!m_isCompressed && !m_hasDataDescriptor && (compressedSize != uncompressedSize)),
+        "stored file with different compressed and uncompressed sizes");
+
+    m_expectedCrc = crc;
+    m_expectedCompressedSize = compressedSize;
+    m_expectedUncompressedSize = uncompressedSize;
+    m_compressedRead = 0;
+    m_uncompressedRead = 0;
+    m_crc = Crc32();
+    m_inflateEnded = false;
+    m_dataDescriptorRead = false;
+    if (m_isCompressed)
+    {
+        ThrowErrorIfNot(Error::InflateInitialize, (m_compressionObject->Initialize(CompressionOperation::Inflate) == CompressionStatus::Ok),
+            "compression_stream_init failed");
+    }
+    m_inEntry = true;
+    return true;
+}
+
+ULONG ZipStreamReader::Read(std::uint8_t* buffer, ULONG countBytes)
+{
+    if (!m_inEntry)
+    {
+        return 0;
+    }
+
+    ULONG bytesRead = 0;
+    if (m_isCompressed)
+    {
+        bytesRead = ReadDeflated(buffer, countBytes);
+    }
+    else if (m_hasDataDescriptor)
+    {
+        bytesRead = ReadStoredUntilDataDescriptor(buffer, countBytes);
+    }
+    else
+    {
+        bytesRead = ReadStored(buffer, countBytes);
+    }
+
+    if (bytesRead != 0)
+    {
+        m_crc.Update(buffer, bytesRead);
+        m_uncompressedRead += bytesRead;
+        return bytesRead;
+    }
+
+    // End of the entry. The data descriptor might have been found and read already.
+    if (m_hasDataDescriptor && !m_dataDescriptorRead)
+    {
+        ReadDataDescriptor();
+    }
+    ThrowErrorIfNot(Error::ZipLocalFileHeader, (m_crc.Value() == m_expectedCrc), "crc-32 of the file doesn't match");
+    ThrowErrorIfNot(Error::ZipLocalFileHeader, (m_compressedRead == m_expectedCompressedSize), "compressed size of the file doesn't match");
+    ThrowErrorIfNot(Error::ZipLocalFileHeader, (m_uncompressedRead == m_expectedUncompressedSize), "uncompressed size of the file doesn't match");
+    m_inEntry = false;
+    return 0;
+}
+
+ULONG ZipStreamReader::ReadStored(std::uint8_t* buffer, ULONG countBytes)
+{
+    auto remaining = m_expectedCompressedSize - m_compressedRead;
+    if (remaining == 0)
+    {
+        return 0;
+    }
+    ThrowErrorIfNot(Error::FileRead, Fill(1), "unexpected end of the archive");
+    auto count = static_cast<ULONG>(std::min({ static_cast<std::uint64_t>(countBytes), remaining, static_cast<std::uint64_t>(Available()) }));
+    std::memcpy(buffer, m_buffer.data() + m_begin, count);
+    Consume(count);
+    m_compressedRead += count;
+    return count;
+}
+
+// The size of a stored file with a data descriptor is only known once the data descriptor is found. A data
+// descriptor signature is only taken as the end of the file if the crc and sizes that follow match the data
+// read so far and the next record starts right after it.
+ULONG ZipStreamReader::ReadStoredUntilDataDescriptor(std::uint8_t* buffer, ULONG countBytes)
+{
+    const std::uint8_t signature[] = { 0x50, 0x4b, 0x07, 0x08 };
+    ThrowErrorIfNot(Error::FileRead, Fill(sizeof(signature)), "unexpected end of the archive");
+    if (std::memcmp(m_buffer.data() + m_begin, signature, sizeof(signature)) == 0 &&
+        (IsDataDescriptor(sizeof(std::uint32_t)) || IsDataDescriptor(sizeof(std::uint64_t))))
+    {
+        return 0;
+    }
+
+    // Everything up to the next possible signature is data.
+    auto data = m_buffer.data() + m_begin;
+    auto available = std::min(Available(), static_cast<std::size_t>(countBytes));
+    auto next = static_cast<const std::uint8_t*>(std::memchr(data + 1, signature[0], available - 1));
+    auto count = static_cast<ULONG>((next == nullptr) ? available : (next - data));
+    std::memcpy(buffer, data, count);
+    Consume(count);
+    m_compressedRead += count;
+    return count;
+}
+
+// makeappx flushes the deflate stream at every block and doesn't always finish it with a last block, so
+// the end of a deflated file with a data descriptor can't be told by inflate alone. Input is only handed to
+// inflate up to the next possible data descriptor signature, which is taken as the end of the file the same
+// way as for stored files.
+ULONG ZipStreamReader::ReadDeflated(std::uint8_t* buffer, ULONG countBytes)
+{
+    const std::uint8_t signature[] = { 0x50, 0x4b, 0x07, 0x08 };
+    while (!m_inflateEnded)
+    {
+        if (Available() == 0)
+        {
+            ThrowErrorIfNot(Error::FileRead, Fill(1), "unexpected end of the archive");
+        }
+        auto data = m_buffer.data() + m_begin;
+        auto available = Available();
+        if (m_hasDataDescriptor)
+        {
+            if (std::memcmp(data, signature, std::min(available, sizeof(signature))) == 0)
+            {
+                ThrowErrorIfNot(Error::FileRead, Fill(sizeof(signature)), "unexpected end of the archive");
+                data = m_buffer.data() + m_begin;
+                available = Available();
+                if (std::memcmp(data, signature, sizeof(signature)) == 0)
+                {   // Get out whatever inflate still holds before checking the crc and sizes.
+                    m_compressionObject->SetInput(data, 0);
+                    m_compressionObject->SetOutput(buffer, countBytes);
+                    m_compressionObject->Inflate();
+                    auto produced = static_cast<ULONG>(countBytes - m_compressionObject->GetAvailableDestinationSize());
+                    if (produced != 0)
+                    {
+                        return produced;
+                    }
+                    if (IsDataDescriptor(sizeof(std::uint32_t)) || IsDataDescriptor(sizeof(std::uint64_t)))
+                    {
+                        m_inflateEnded = true;
+                        m_compressionObject->Cleanup();
+                        return 0;
+                    }
+                    data = m_buffer.data() + m_begin;
+                    available = Available();
+                }
+            }
+            // Everything up to the next possible signature is deflate data.
+            for (auto next = static_cast<const std::uint8_t*>(std::memchr(data + 1, signature[0], available - 1));
+                 next != nullptr;
+                 next = static_cast<const std::uint8_t*>(std::memchr(next + 1, signature[0], data + available - next - 1)))
+            {
+                auto remaining = static_cast<std::size_t>(data + available - next);
+                if (std::memcmp(next, signature, std::min(remaining, sizeof(signature))) == 0)
+                {
+                    available = static_cast<std::size_t>(next - data);
+                    break;
+                }
+                if (remaining == 1) { break; }
+            }
+        }
+        m_compressionObject->SetInput(data, available);
+        m_compressionObject->SetOutput(buffer, countBytes);
+        auto status = m_compressionObject->Inflate();
+        ThrowErrorIf(Error::InflateCorruptData, (status == CompressionStatus::Error) || (status == CompressionStatus::NeedDictionary),
+            "inflate failed unexpectedly.");
+        auto consumed = available - m_compressionObject->GetAvailableSourceSize();
+        Consume(consumed);
+        m_compressedRead += consumed;
+
+        auto produced = static_cast<ULONG>(countBytes - m_compressionObject->GetAvailableDestinationSize());
+        if (status == CompressionStatus::End)
+        {
+            m_inflateEnded = true;
+            m_compressionObject->Cleanup();
+        }
+        if (produced != 0)
+        {
+            return produced;
+        }
+        // Nothing came out, inflate needs more than what is buffered.
+        if (!m_inflateEnded && (consumed == 0))
+        {
+            ThrowErrorIfNot(Error::FileRead, Fill(Available() + 1), "unexpected end of the archive");
+        }
+    }
+    return 0;
+}
+
+// Checks if what is at the front of the buffer is the data descriptor of the file being read, with
+// sizes of sizeFieldLength bytes. If it is, it is consumed.
+bool ZipStreamReader::IsDataDescriptor(std::size_t sizeFieldLength)
+{
+    std::size_t size = 2 * sizeof(std::uint32_t) + 2 * sizeFieldLength;
+    if (!Fill(size + sizeof(std::uint32_t)))
+    {
+        return false;
+    }
+    BufferReader reader(m_buffer.data() + m_begin, size + sizeof(std::uint32_t));
+    reader.Read<std::uint32_t>(); // signature
+    auto crc = reader.Read<std::uint32_t>();
+    std::uint64_t compressedSize = (sizeFieldLength == sizeof(std::uint64_t)) ? reader.Read<std::uint64_t>() : reader.Read<std::uint32_t>();
+    std::uint64_t uncompressedSize = (sizeFieldLength == sizeof(std::uint64_t)) ? reader.Read<std::uint64_t>() : reader.Read<std::uint32_t>();
+    auto next = reader.Read<std::uint32_t>();
+    if ((crc != m_crc.Value()) || (compressedSize != m_compressedRead) || (uncompressedSize != m_uncompressedRead) ||
+        ((next != static_cast<std::uint32_t>(Signatures::LocalFileHeader)) && (next != static_cast<std::uint32_t>(Signatures::CentralFileHeader))))
+    {
+        return false;
+    }
+    m_expectedCrc = crc;
+    m_expectedCompressedSize = compressedSize;
+    m_expectedUncompressedSize = uncompressedSize;
+    m_dataDescriptorRead = true;
+    Consume(size);
+    return true;
+}
+
+// Reads the data descriptor after a deflated file. Its signature is optional and its sizes are 64 bit
+// for zip64 entries.
+void ZipStreamReader::ReadDataDescriptor()
+{
+    ThrowErrorIfNot(Error::FileRead, Fill(sizeof(std::uint32_t)), "unexpected end of the archive");
+    if (BufferReader(m_buffer.data() + m_begin, Available()).Read<std::uint32_t>() == static_cast<std::uint32_t>(Signatures::DataDescriptor))
+    {
+        Consume(sizeof(std::uint32_t));
+    }
+    std::size_t size = sizeof(std::uint32_t) + (m_isZip64 ? 2 * sizeof(std::uint64_t) : 2 * sizeof(std::uint32_t));
+    ThrowErrorIfNot(Error::FileRead, Fill(size), "unexpected end of the archive");
+    BufferReader reader(m_buffer.data() + m_begin, size);
+    m_expectedCrc = reader.Read<std::uint32_t>();
+    m_expectedCompressedSize = m_isZip64 ? reader.Read<std::uint64_t>() : reader.Read<std::uint32_t>();
+    m_expectedUncompressedSize = m_isZip64 ? reader.Read<std::uint64_t>() : reader.Read<std::uint32_t>();
+    m_dataDescriptorRead = true;
+    Consume(size);
+}
 } // namespace MSIX
\ No newline at end of file
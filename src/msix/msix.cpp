@@ -5,8 +5,12 @@
 #include "Exceptions.hpp"
 #include "StreamBase.hpp"
 #include "FileStream.hpp"
+#ifndef WIN32
+#include "MappedFileStream.hpp"
+#endif
 #include "RangeStream.hpp"
 #include "ZipObject.hpp"
+#include "StagingObject.hpp"
 #include "DirectoryObject.hpp"
 #include "UnicodeConversion.hpp"
 #include "ComHelper.hpp"
@@ -42,6 +46,22 @@ static void finalizer(void) {
 LPVOID STDMETHODCALLTYPE InternalAllocate(SIZE_T cb)  { return std::malloc(cb); }
 void STDMETHODCALLTYPE InternalFree(LPVOID pv)        { std::free(pv); }
 
+// Reads the package front to back without seeking, staging the payload under the destination until the
+// whole package has been read and validated.
+static void UnpackForwardOnly(
+    const MSIX::ComPtr<IAppxFactory>& factory,
+    MSIX_PACKUNPACK_OPTION packUnpackOptions,
+    MSIX_VALIDATION_OPTION validationOption,
+    const MSIX::ComPtr<IStream>& stream,
+    char* utf8Destination)
+{
+    auto msixFactory = factory.As<IMsixFactory>();
+    auto staging = MSIX::ComPtr<MSIX::StagingObject>::Make<MSIX::StagingObject>(msixFactory.Get(), stream, utf8Destination);
+    auto reader = MSIX::ComPtr<IAppxPackageReader>::Make<MSIX::AppxPackageObject>(msixFactory.Get(), validationOption,
+        MSIX_APPLICABILITY_OPTIONS::MSIX_APPLICABILITY_OPTION_FULL, staging.As<IStorageObject>());
+    staging->Commit(reader, packUnpackOptions);
+}
+
 
 MSIX_API HRESULT STDMETHODCALLTYPE UnpackPackage(
     MSIX_PACKUNPACK_OPTION packUnpackOptions,
@@ -60,7 +80,18 @@ MSIX_API HRESULT STDMETHODCALLTYPE UnpackPackage(
     ThrowHrIfFailed(CoCreateAppxFactoryWithHeap(InternalAllocate, InternalFree, validationOption, &factory));
 
     MSIX::ComPtr<IStream> stream;
-    ThrowHrIfFailed(CreateStreamOnFile(utf8SourcePackage, true, &stream));
+    if (packUnpackOptions & MSIX_PACKUNPACK_OPTION_MAPFILE)
+    {   ThrowHrIfFailed(CreateMappedStreamOnFile(utf8SourcePackage, &stream));
+    }
+    else
+    {   ThrowHrIfFailed(CreateStreamOnFile(utf8SourcePackage, true, &stream));
+    }
+
+    if (packUnpackOptions & MSIX_PACKUNPACK_OPTION_FORWARDONLY)
+    {
+        UnpackForwardOnly(factory, packUnpackOptions, validationOption, stream, utf8Destination);
+        return static_cast<HRESULT>(MSIX::Error::OK);
+    }
 
     MSIX::ComPtr<IAppxPackageReader> reader;
     ThrowHrIfFailed(factory->CreatePackageReader(stream.Get(), &reader));
@@ -86,6 +117,12 @@ MSIX_API HRESULT STDMETHODCALLTYPE UnpackPackageFromStream(
     // out to the caller.  So default to new / delete[] and be done with it!
     ThrowHrIfFailed(CoCreateAppxFactoryWithHeap(InternalAllocate, InternalFree, validationOption, &factory));
 
+    if (packUnpackOptions & MSIX_PACKUNPACK_OPTION_FORWARDONLY)
+    {
+        UnpackForwardOnly(factory, packUnpackOptions, validationOption, MSIX::ComPtr<IStream>(stream), utf8Destination);
+        return static_cast<HRESULT>(MSIX::Error::OK);
+    }
+
     MSIX::ComPtr<IAppxPackageReader> reader;
     ThrowHrIfFailed(factory->CreatePackageReader(stream, &reader));
 
@@ -113,7 +150,12 @@ MSIX_API HRESULT STDMETHODCALLTYPE UnpackBundle(
     ThrowHrIfFailed(CoCreateAppxBundleFactoryWithHeap(InternalAllocate, InternalFree, validationOption, applicabilityOptions, &factory));
 
     MSIX::ComPtr<IStream> stream;
-    ThrowHrIfFailed(CreateStreamOnFile(utf8SourcePackage, true, &stream));
+    if (packUnpackOptions & MSIX_PACKUNPACK_OPTION_MAPFILE)
+    {   ThrowHrIfFailed(CreateMappedStreamOnFile(utf8SourcePackage, &stream));
+    }
+    else
+    {   ThrowHrIfFailed(CreateStreamOnFile(utf8SourcePackage, true, &stream));
+    }
 
     MSIX::ComPtr<IAppxBundleReader> reader;
     ThrowHrIfFailed(factory->CreateBundleReader(stream.Get(), &reader));
@@ -189,6 +231,23 @@ MSIX_API HRESULT STDMETHODCALLTYPE CreateStreamOnFileUTF16(
     return static_cast<HRESULT>(MSIX::Error::OK);
 } CATCH_RETURN();
 
+MSIX_API HRESULT STDMETHODCALLTYPE CreateMappedStreamOnFile(
+    char* utf8File,
+    IStream** stream) noexcept try
+{
+    ThrowErrorIf(MSIX::Error::InvalidParameter, (utf8File == nullptr || stream == nullptr), "Invalid parameters");
+    #ifndef WIN32
+    // Files that can't be mapped go through FileStream, which also reports why they can't be opened.
+    auto mapped = MSIX::MappedFileStream::Create(utf8File);
+    if (mapped)
+    {   *stream = mapped.Detach();
+        return static_cast<HRESULT>(MSIX::Error::OK);
+    }
+    #endif
+    *stream = MSIX::ComPtr<IStream>::Make<MSIX::FileStream>(utf8File, MSIX::FileStream::Mode::READ).Detach();
+    return static_cast<HRESULT>(MSIX::Error::OK);
+} CATCH_RETURN();
+
 MSIX_API HRESULT STDMETHODCALLTYPE CoCreateAppxFactoryWithHeap(
     COTASKMEMALLOC* memalloc,
     COTASKMEMFREE* memfree,
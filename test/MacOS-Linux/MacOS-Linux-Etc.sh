@@ -65,6 +65,50 @@ function RunTest {
     fi
 }
 
+function RunVerifyTest {
+    local SUCCESS="$1"
+    local PACKAGE="$2"
+    local ARGS="$3"
+    echo "------------------------------------------------------"
+    echo $BINDIR/makemsix verify -p $PACKAGE $ARGS
+    echo "------------------------------------------------------"
+    $BINDIR/makemsix verify -p $PACKAGE $ARGS
+    local RESULT=$?
+    echo "expect: "$SUCCESS", got: "$RESULT
+    if [ $RESULT -eq $SUCCESS ]
+    then
+        echo "succeeded"
+    else
+        echo "FAILED"
+        TESTFAILED=1
+    fi
+}
+
+# A directory in the way of a payload file makes a forward-only unpack fail while it moves the files into place.
+# Whatever it already put in ./../unpack has to be gone afterwards, directories aside.
+function RunBlockedCommitTest {
+    CleanupUnpackFolder
+    local SUCCESS="$1"
+    local PACKAGE="$2"
+    local BLOCKED="$3"
+    mkdir -p "./../unpack/$BLOCKED"
+    touch "./../unpack/$BLOCKED/blocker"
+    echo "------------------------------------------------------"
+    echo $BINDIR/makemsix unpack -d ./../unpack -p $PACKAGE -ss -fo, with $BLOCKED in the way
+    echo "------------------------------------------------------"
+    $BINDIR/makemsix unpack -d ./../unpack -p $PACKAGE -ss -fo
+    local RESULT=$?
+    local FILES=`find ./../unpack -type f`
+    echo "expect: "$SUCCESS", got: "$RESULT
+    if [ $RESULT -eq $SUCCESS ] && [ "$FILES" == "./../unpack/$BLOCKED/blocker" ]
+    then
+        echo "succeeded"
+    else
+        echo "FAILED, left:" $FILES
+        TESTFAILED=1
+    fi
+}
+
 function RunApiTest {
     local CURRENTLOCATION=`pwd`
     cd $BINDIR/..
@@ -83,6 +127,21 @@ function RunApiTest {
     cd $CURRENTLOCATION
 }
 
+function RunCompressionTest {
+    echo "------------------------------------------------------"
+    echo "bin/compressiontest"
+    echo "------------------------------------------------------"
+    $BINDIR/compressiontest
+    local RESULT=$?
+    if [ $RESULT -eq 0 ]
+    then
+        echo "succeeded"
+    else
+        echo "FAILED"
+        TESTFAILED=1
+    fi
+}
+
 FindBinFolder
 # return code is last two digits, but in decimal, not hex.  e.g. 0x8bad0002 == 2, 0x8bad0041 == 65, etc...
 # common codes:
@@ -90,22 +149,29 @@ FindBinFolder
 
 RunTest 2  ./../appx/Empty.appx -sv
 RunTest 0  ./../appx/HelloWorld.appx -ss
+RunTest 0  ./../appx/HelloWorld.appx "-ss -vc"
+RunTest 0  ./../appx/BadCrcDeflated.appx -ss
+RunTest 18 ./../appx/BadCrcDeflated.appx "-ss -vc"
 RunTest 0  ./../appx/NotepadPlusPlus.appx -ss
 RunTest 0  ./../appx/IntlPackage.appx -ss
 RunTest 66 ./../appx/SignatureNotLastPart-ERROR_BAD_FORMAT.appx
 RunTest 66 ./../appx/SignedTamperedBlockMap-TRUST_E_BAD_DIGEST.appx
 RunTest 65 ./../appx/SignedTamperedBlockMap-TRUST_E_BAD_DIGEST.appx -sv
 RunTest 66 ./../appx/SignedTamperedCD-TRUST_E_BAD_DIGEST.appx
+RunTest 65 ./../appx/SignedTamperedCD-TRUST_E_BAD_DIGEST.appx -sv
+RunTest 65 ./../appx/SignedTamperedCD-TRUST_E_BAD_DIGEST.appx "-sv -fo"
 RunTest 66 ./../appx/SignedTamperedCodeIntegrity-TRUST_E_BAD_DIGEST.appx
 RunTest 66 ./../appx/SignedTamperedContentTypes-TRUST_E_BAD_DIGEST.appx
 RunTest 66 ./../appx/SignedUntrustedCert-CERT_E_CHAINING.appx
 RunTest 0 ./../appx/TestAppxPackage_Win32.appx -ss
 RunTest 0 ./../appx/TestAppxPackage_x64.appx -ss
-RunTest 18 ./../appx/UnsignedZip64WithCI-APPX_E_MISSING_REQUIRED_FILE.appx
+RunTest 49 ./../appx/UnsignedZip64WithCI-APPX_E_MISSING_REQUIRED_FILE.appx
+RunTest 18 ./../appx/UnsignedZip64WithCI-APPX_E_MISSING_REQUIRED_FILE.appx -ss
 RunTest 1 ./../appx/FileDoesNotExist.appx -ss
 RunTest 81 ./../appx/BlockMap/Missing_Manifest_in_blockmap.appx -ss
 RunTest 81 ./../appx/BlockMap/ContentTypes_in_blockmap.appx -ss
 RunTest 81 ./../appx/BlockMap/Invalid_Bad_Block.msix -ss
+RunTest 65 ./../appx/BlockMap/Tampered_Payload_Block.appx -ss
 RunTest 81 ./../appx/BlockMap/Size_wrong_uncompressed.msix -ss
 RunTest 2 ./../appx/BlockMap/Extra_file_in_blockmap.msix -ss
 RunTest 81 ./../appx/BlockMap/File_missing_from_blockmap.msix -ss
@@ -118,6 +184,56 @@ RunTest 0 ./../appx/महसुस/StoreSigned_Desktop_x64_MoviesTV.appx
 RunTest 0  ./../appx/StoreSigned_Desktop_x64_MoviesTV.appx
 ValidateResult ExpectedResult/$directory/StoreSigned_Desktop_x64_MoviesTV.txt
 
+# Forward-only unpack
+RunTest 0 ./../appx/HelloWorld.appx "-ss -fo"
+RunTest 0 ./../appx/NotepadPlusPlus.appx "-ss -fo"
+RunTest 65 ./../appx/SignedTamperedBlockMap-TRUST_E_BAD_DIGEST.appx "-sv -fo"
+RunTest 81 ./../appx/BlockMap/Size_wrong_uncompressed.msix "-ss -fo"
+RunTest 81 ./../appx/BlockMap/File_missing_from_blockmap.msix "-ss -fo"
+RunTest 18 ./../appx/StagingDirectoryInPayload.appx "-ss -fo"
+RunBlockedCommitTest 3 ./../appx/HelloWorld.appx manifest.xml
+RunTest 0  ./../appx/StoreSigned_Desktop_x64_MoviesTV.appx -fo
+ValidateResult ExpectedResult/$directory/StoreSigned_Desktop_x64_MoviesTV.txt
+
+# Payload files checked when first read
+RunTest 0 ./../appx/HelloWorld.appx "-ss -dp"
+RunTest 81 ./../appx/BlockMap/Invalid_Bad_Block.msix "-ss -dp"
+RunTest 81 ./../appx/BlockMap/Size_wrong_uncompressed.msix "-ss -dp"
+RunTest 2 ./../appx/BlockMap/Extra_file_in_blockmap.msix "-ss -dp"
+RunTest 0 ./../appx/bundles/BundleWithIntlPackage.appxbundle "-ss -dp"
+
+# Package mapped into memory
+RunTest 0 ./../appx/HelloWorld.appx "-ss -mf"
+RunTest 0 ./../appx/NotepadPlusPlus.appx "-ss -mf"
+RunTest 65 ./../appx/BlockMap/Tampered_Payload_Block.appx "-ss -mf"
+
+# Every byte before the signature checked against it
+RunTest 65 ./../appx/SignedTamperedFileRecords-TRUST_E_BAD_DIGEST.appx -sv
+RunTest 65 ./../appx/SignedTamperedFileRecords-TRUST_E_BAD_DIGEST.appx "-sv -fo"
+RunTest 0 ./../appx/TestAppxPackage_x64.appx -sv
+RunTest 0 ./../appx/TestAppxPackage_x64.appx "-sv -fo"
+# Same without zip64 records
+RunTest 66 ./../appx/SignedPlainZip.appx
+RunTest 0 ./../appx/SignedPlainZip.appx -sv
+RunTest 0 ./../appx/SignedPlainZip.appx "-sv -fo"
+RunTest 65 ./../appx/SignedPlainZipTamperedFileRecords-TRUST_E_BAD_DIGEST.appx -sv
+RunTest 65 ./../appx/SignedPlainZipTamperedFileRecords-TRUST_E_BAD_DIGEST.appx "-sv -fo"
+RunTest 65 ./../appx/SignedPlainZipTamperedCD-TRUST_E_BAD_DIGEST.appx -sv
+RunTest 65 ./../appx/SignedPlainZipTamperedCD-TRUST_E_BAD_DIGEST.appx "-sv -fo"
+
+# Verify without unpacking
+RunVerifyTest 0  ./../appx/HelloWorld.appx -ss
+RunVerifyTest 0  ./../appx/NotepadPlusPlus.appx "-ss --jobs 2"
+RunVerifyTest 0  ./../appx/CentennialCoffee.appx "-ss --jobs 1"
+RunVerifyTest 0  ./../appx/HelloWorld.appx "-ss -mf"
+RunVerifyTest 65 ./../appx/SignedTamperedBlockMap-TRUST_E_BAD_DIGEST.appx -sv
+RunVerifyTest 65 ./../appx/SignedTamperedFileRecords-TRUST_E_BAD_DIGEST.appx -sv
+RunVerifyTest 65 ./../appx/SignedPlainZipTamperedCD-TRUST_E_BAD_DIGEST.appx -sv
+RunVerifyTest 81 ./../appx/BlockMap/Invalid_Bad_Block.msix -ss
+RunVerifyTest 65 ./../appx/BlockMap/Tampered_Payload_Block.appx -ss
+RunVerifyTest 81 ./../appx/BlockMap/Size_wrong_uncompressed.msix "-ss -dp"
+RunVerifyTest 0  ./../appx/bundles/BundleWithIntlPackage.appxbundle -ss
+
 # IMPORTANT! For Linux we expect English. For MacOs, English (US) and Spanish (MX)
 # Bundle tests
 RunTest 81 ./../appx/bundles/BlockMapContainsPayloadPackage.appxbundle -ss
@@ -162,6 +278,7 @@ RunTest 0 ./../appx/flat/FlatBundleWithAsset.appxbundle -ss
 CleanupUnpackFolder
 
 RunApiTest test/api/input/apitest_test_1.txt
+RunCompressionTest
 
     echo "-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-="
 if [ $TESTFAILED -ne 0 ]
@@ -102,6 +102,58 @@ function RunTest([int] $SUCCESSCODE, [string] $PACKAGE, [string] $OPT) {
     }
 }
 
+# A directory in the way of a payload file makes a forward-only unpack fail while it moves the files into place.
+# Whatever it already put in .\..\unpack has to be gone afterwards, directories aside.
+function RunBlockedCommitTest([int] $SUCCESSCODE, [string] $PACKAGE, [string] $BLOCKED) {
+    CleanupUnpackFolder
+    New-Item -ItemType Directory -Force ".\..\unpack\$BLOCKED" | Out-Null
+    New-Item -ItemType File -Force ".\..\unpack\$BLOCKED\blocker" | Out-Null
+    $OPTIONS = "unpack -d .\..\unpack -p $PACKAGE -ss -fo"
+    write-host  "------------------------------------------------------"
+    write-host  "$BINDIR\makemsix.exe $OPTIONS, with $BLOCKED in the way"
+    write-host  "------------------------------------------------------"
+
+    $p = Start-Process $BINDIR\makemsix.exe -ArgumentList "$OPTIONS" -wait -NoNewWindow -PassThru
+    $ERRORCODE = $p.ExitCode
+    $FILES = @(Get-ChildItem ".\..\unpack" -File -Recurse)
+    $a = "{0:x0}" -f $SUCCESSCODE
+    $b = "{0:x0}" -f $ERRORCODE
+    write-host  "expect: $a, got: $b"
+    if (( $ERRORCODE -eq $SUCCESSCODE ) -and ( $FILES.Count -eq 1 ) -and ( $FILES[0].Name -eq "blocker" ))
+    {
+        Write-Host "Succeeded" -ForegroundColor Green
+    }
+    else
+    {
+        $global:FailedTests.Add("RunBlockedCommitTest $PACKAGE $BLOCKED")
+        Write-Host "FAILED, left: $FILES" -ForegroundColor Red
+        $global:TESTFAILED=1
+    }
+}
+
+function RunVerifyTest([int] $SUCCESSCODE, [string] $PACKAGE, [string] $OPT) {
+    $OPTIONS = "verify -p $PACKAGE $OPT"
+    write-host  "------------------------------------------------------"
+    write-host  "$BINDIR\makemsix.exe $OPTIONS"
+    write-host  "------------------------------------------------------"
+
+    $p = Start-Process $BINDIR\makemsix.exe -ArgumentList "$OPTIONS" -wait -NoNewWindow -PassThru
+    $ERRORCODE = $p.ExitCode
+    $a = "{0:x0}" -f $SUCCESSCODE
+    $b = "{0:x0}" -f $ERRORCODE
+    write-host  "expect: $a, got: $b"
+    if ( $ERRORCODE -eq $SUCCESSCODE )
+    {
+        Write-Host "Succeeded" -ForegroundColor Green
+    }
+    else
+    {
+        $global:FailedTests.Add("RunVerifyTest $PACKAGE $OPT")
+        Write-Host "FAILED" -ForegroundColor Red
+        $global:TESTFAILED=1
+    }
+}
+
 function RunApiTest([string] $FILE) {
     $CURRENTLOCATION = "$PWD"
     Set-Location $BINDIR\..\
@@ -125,11 +177,33 @@ function RunApiTest([string] $FILE) {
     Set-Location $CURRENTLOCATION
 }
 
+function RunCompressionTest {
+    write-host  "------------------------------------------------------"
+    write-host  "compressiontest.exe"
+    write-host  "------------------------------------------------------"
+
+    $p = Start-Process $BINDIR\compressiontest.exe -wait -NoNewWindow -PassThru
+    $ERRORCODE = $p.ExitCode
+    if ( $ERRORCODE -eq 0 )
+    {
+        Write-Host "Succeeded" -ForegroundColor Green
+    }
+    else
+    {
+        $global:FailedTests.Add("RunCompressionTest")
+        Write-Host "FAILED" -ForegroundColor Red
+        $global:TESTFAILED=1
+    }
+}
+
 FindBinFolder
 
 # Normal package
 RunTest 0x8bad0002 .\..\appx\Empty.appx "-sv"
 RunTest 0x00000000 .\..\appx\HelloWorld.appx "-ss"
+RunTest 0x00000000 .\..\appx\HelloWorld.appx "-ss -vc"
+RunTest 0x00000000 .\..\appx\BadCrcDeflated.appx "-ss"
+RunTest 0x8bad0012 .\..\appx\BadCrcDeflated.appx "-ss -vc"
 RunTest 0x00000000 .\..\appx\NotepadPlusPlus.appx "-ss"
 RunTest 0x00000000 .\..\appx\IntlPackage.appx "-ss"
 RunTest 0x8bad0042 .\..\appx\SignatureNotLastPart-ERROR_BAD_FORMAT.appx
@@ -137,16 +211,20 @@ RunTest 0x8bad0042 .\..\appx\SignatureNotLastPart-ERROR_BAD_FORMAT.appx
 RunTest 0x8bad0042 .\..\appx\SignedTamperedBlockMap-TRUST_E_BAD_DIGEST.appx
 RunTest 0x8bad0041 .\..\appx\SignedTamperedBlockMap-TRUST_E_BAD_DIGEST.appx "-sv"
 RunTest 0x8bad0042 .\..\appx\SignedTamperedCD-TRUST_E_BAD_DIGEST.appx
+RunTest 0x8bad0041 .\..\appx\SignedTamperedCD-TRUST_E_BAD_DIGEST.appx "-sv"
+RunTest 0x8bad0041 .\..\appx\SignedTamperedCD-TRUST_E_BAD_DIGEST.appx "-sv -fo"
 RunTest 0x8bad0042 .\..\appx\SignedTamperedCodeIntegrity-TRUST_E_BAD_DIGEST.appx
 RunTest 0x8bad0042 .\..\appx\SignedTamperedContentTypes-TRUST_E_BAD_DIGEST.appx
 RunTest 0x8bad0042 .\..\appx\SignedUntrustedCert-CERT_E_CHAINING.appx
 RunTest 0x00000000 .\..\appx\TestAppxPackage_Win32.appx "-ss"
 RunTest 0x00000000 .\..\appx\TestAppxPackage_x64.appx "-ss"
-RunTest 0x8bad0012 .\..\appx\UnsignedZip64WithCI-APPX_E_MISSING_REQUIRED_FILE.appx
+RunTest 0x8bad0031 .\..\appx\UnsignedZip64WithCI-APPX_E_MISSING_REQUIRED_FILE.appx
+RunTest 0x8bad0012 .\..\appx\UnsignedZip64WithCI-APPX_E_MISSING_REQUIRED_FILE.appx "-ss"
 RunTest 0x8bad0001 .\..\appx\FileDoesNotExist.appx "-ss"
 RunTest 0x8bad0051 .\..\appx\BlockMap\Missing_Manifest_in_blockmap.appx "-ss"
 RunTest 0x8bad0051 .\..\appx\BlockMap\ContentTypes_in_blockmap.appx "-ss"
 RunTest 0x8bad0051 .\..\appx\BlockMap\Invalid_Bad_Block.msix "-ss"
+RunTest 0x8bad0041 .\..\appx\BlockMap\Tampered_Payload_Block.appx "-ss"
 RunTest 0x8bad0051 .\..\appx\BlockMap\Size_wrong_uncompressed.msix "-ss"
 RunTest 0x80070002 .\..\appx\BlockMap\Extra_file_in_blockmap.msix "-ss"
 RunTest 0x8bad0051 .\..\appx\BlockMap\File_missing_from_blockmap.msix "-ss"
@@ -157,6 +235,54 @@ RunTest 0x8bad0051 .\..\appx\BlockMap\Duplicate_file_in_blockmap.appx "-ss"
 RunTest 0x00000000 .\..\appx\StoreSigned_Desktop_x64_MoviesTV.appx
 ValidateResult ExpectedResults\StoreSigned_Desktop_x64_MoviesTV.txt
 
+# Forward-only unpack
+RunTest 0x00000000 .\..\appx\HelloWorld.appx "-ss -fo"
+RunTest 0x00000000 .\..\appx\NotepadPlusPlus.appx "-ss -fo"
+RunTest 0x8bad0041 .\..\appx\SignedTamperedBlockMap-TRUST_E_BAD_DIGEST.appx "-sv -fo"
+RunTest 0x8bad0051 .\..\appx\BlockMap\Size_wrong_uncompressed.msix "-ss -fo"
+RunTest 0x8bad0051 .\..\appx\BlockMap\File_missing_from_blockmap.msix "-ss -fo"
+RunTest 0x8bad0012 .\..\appx\StagingDirectoryInPayload.appx "-ss -fo"
+RunBlockedCommitTest 0x80070005 .\..\appx\HelloWorld.appx manifest.xml
+RunTest 0x00000000 .\..\appx\StoreSigned_Desktop_x64_MoviesTV.appx "-fo"
+ValidateResult ExpectedResults\StoreSigned_Desktop_x64_MoviesTV.txt
+
+# Payload files checked when first read
+RunTest 0x00000000 .\..\appx\HelloWorld.appx "-ss -dp"
+RunTest 0x8bad0051 .\..\appx\BlockMap\Invalid_Bad_Block.msix "-ss -dp"
+RunTest 0x8bad0051 .\..\appx\BlockMap\Size_wrong_uncompressed.msix "-ss -dp"
+RunTest 0x80070002 .\..\appx\BlockMap\Extra_file_in_blockmap.msix "-ss -dp"
+
+# Package mapped into memory, read as usual on Windows
+RunTest 0x00000000 .\..\appx\HelloWorld.appx "-ss -mf"
+RunTest 0x8bad0041 .\..\appx\BlockMap\Tampered_Payload_Block.appx "-ss -mf"
+
+# Every byte before the signature checked against it
+RunTest 0x8bad0041 .\..\appx\SignedTamperedFileRecords-TRUST_E_BAD_DIGEST.appx "-sv"
+RunTest 0x8bad0041 .\..\appx\SignedTamperedFileRecords-TRUST_E_BAD_DIGEST.appx "-sv -fo"
+RunTest 0x00000000 .\..\appx\TestAppxPackage_x64.appx "-sv"
+RunTest 0x00000000 .\..\appx\TestAppxPackage_x64.appx "-sv -fo"
+# Same without zip64 records
+RunTest 0x8bad0042 .\..\appx\SignedPlainZip.appx
+RunTest 0x00000000 .\..\appx\SignedPlainZip.appx "-sv"
+RunTest 0x00000000 .\..\appx\SignedPlainZip.appx "-sv -fo"
+RunTest 0x8bad0041 .\..\appx\SignedPlainZipTamperedFileRecords-TRUST_E_BAD_DIGEST.appx "-sv"
+RunTest 0x8bad0041 .\..\appx\SignedPlainZipTamperedFileRecords-TRUST_E_BAD_DIGEST.appx "-sv -fo"
+RunTest 0x8bad0041 .\..\appx\SignedPlainZipTamperedCD-TRUST_E_BAD_DIGEST.appx "-sv"
+RunTest 0x8bad0041 .\..\appx\SignedPlainZipTamperedCD-TRUST_E_BAD_DIGEST.appx "-sv -fo"
+
+# Verify without unpacking
+RunVerifyTest 0x00000000 .\..\appx\HelloWorld.appx "-ss"
+RunVerifyTest 0x00000000 .\..\appx\NotepadPlusPlus.appx "-ss --jobs 2"
+RunVerifyTest 0x00000000 .\..\appx\CentennialCoffee.appx "-ss --jobs 1"
+RunVerifyTest 0x00000000 .\..\appx\HelloWorld.appx "-ss -mf"
+RunVerifyTest 0x8bad0041 .\..\appx\SignedTamperedBlockMap-TRUST_E_BAD_DIGEST.appx "-sv"
+RunVerifyTest 0x8bad0041 .\..\appx\SignedTamperedFileRecords-TRUST_E_BAD_DIGEST.appx "-sv"
+RunVerifyTest 0x8bad0041 .\..\appx\SignedPlainZipTamperedCD-TRUST_E_BAD_DIGEST.appx "-sv"
+RunVerifyTest 0x8bad0051 .\..\appx\BlockMap\Invalid_Bad_Block.msix "-ss"
+RunVerifyTest 0x8bad0041 .\..\appx\BlockMap\Tampered_Payload_Block.appx "-ss"
+RunVerifyTest 0x8bad0051 .\..\appx\BlockMap\Size_wrong_uncompressed.msix "-ss -dp"
+RunVerifyTest 0x00000000 .\..\appx\bundles\BundleWithIntlPackage.appxbundle "-ss"
+
 # IMPORTANT! These tests assumes that English, Spanish and Simplified Chinese are in the machine.
 # Bundle tests.
 RunTest 0x8bad0051 .\..\appx\bundles\BlockMapContainsPayloadPackage.appxbundle "-ss"
@@ -202,6 +328,7 @@ RunTest 0x00000000 .\..\appx\flat\FlatBundleWithAsset.appxbundle "-ss"
 CleanupUnpackFolder
 
 RunApiTest test\api\input\apitest_test_1.txt
+RunCompressionTest
 
 write-host "-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-="
 if ( $global:TESTFAILED -eq 1 )
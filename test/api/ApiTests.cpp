@@ -15,6 +15,10 @@
 #include <string>
 #include <codecvt>
 #include <locale>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
 
 #ifndef WIN32
     #include <sys/types.h>
@@ -344,6 +348,155 @@ void InitializeBundleHelper(IAppxBundleReader** bundleReader)
     return;
 }
 
+// CRC-32 as zip computes it, so the contents of a file can be checked against the central directory of the
+// package. crc is the CRC-32 of the bytes before these, 0 if there are none.
+std::uint32_t Crc32(std::uint32_t crc, const std::uint8_t* data, std::size_t size)
+{
+    crc = ~crc;
+    for (std::size_t i = 0; i < size; i++)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+// Reads a stream from where it is to its end and returns the CRC-32 of what was read.
+std::uint32_t Crc32OfStream(IStream* stream, std::uint64_t* size)
+{
+    std::uint32_t crc = 0;
+    *size = 0;
+    std::vector<std::uint8_t> buffer(0x10000);
+    ULONG read = 0;
+    do
+    {
+        VERIFY_SUCCEEDED(stream->Read(buffer.data(), static_cast<ULONG>(buffer.size()), &read));
+        crc = Crc32(crc, buffer.data(), read);
+        *size += read;
+    } while (read != 0);
+    return crc;
+}
+
+// IMsixRangedSource over a package file. Every read is done before ReadRange returns and completes with
+// readResult, so a source whose reads fail is one given a failing HRESULT.
+class FileRangedSource final : public IMsixRangedSource
+{
+public:
+    FileRangedSource(const std::string& path, HRESULT readResult) : m_file(path, std::ios::binary), m_readResult(readResult)
+    {
+        if (m_file)
+        {
+            m_file.seekg(0, std::ios::end);
+            m_size = static_cast<std::uint64_t>(m_file.tellg());
+        }
+    }
+
+    // IUnknown
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) noexcept override
+    {
+        if (ppvObject == nullptr) { return E_INVALIDARG; }
+        *ppvObject = nullptr;
+        if (riid == UuidOfImpl<IUnknown>::iid || riid == UuidOfImpl<IMsixRangedSource>::iid)
+        {
+            AddRef();
+            *ppvObject = static_cast<IMsixRangedSource*>(this);
+            return S_OK;
+        }
+        return E_NOINTERFACE;
+    }
+    ULONG STDMETHODCALLTYPE AddRef() noexcept override { return ++m_refs; }
+    ULONG STDMETHODCALLTYPE Release() noexcept override
+    {
+        auto refs = --m_refs;
+        if (refs == 0) { delete this; }
+        return refs;
+    }
+
+    // IMsixRangedSource
+    HRESULT STDMETHODCALLTYPE GetSize(UINT64* size) noexcept override
+    {
+        if (size == nullptr) { return E_INVALIDARG; }
+        *size = m_size;
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE ReadRange(UINT64 offset, UINT32 size, BYTE* buffer, IMsixRangedReadCallback* callback) noexcept override
+    {
+        if (buffer == nullptr || callback == nullptr) { return E_INVALIDARG; }
+        UINT32 bytesRead = 0;
+        if (SUCCEEDED(m_readResult) && offset < m_size)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            bytesRead = static_cast<UINT32>(std::min<std::uint64_t>(size, m_size - offset));
+            m_file.seekg(static_cast<std::streamoff>(offset));
+            m_file.read(reinterpret_cast<char*>(buffer), bytesRead);
+        }
+        callback->ReadCompleted(m_readResult, bytesRead);
+        return S_OK;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::ifstream m_file;
+    std::uint64_t m_size = 0;
+    HRESULT m_readResult;
+    ULONG m_refs = 0;
+};
+
+// Settings for MSIX_FACTORY_EXTENSION_BLOCK_CACHE.
+class BlockCacheSettings final : public IMsixBlockCacheSettings
+{
+public:
+    BlockCacheSettings(std::uint64_t capacity) : m_capacity(capacity) {}
+
+    // IUnknown
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) noexcept override
+    {
+        if (ppvObject == nullptr) { return E_INVALIDARG; }
+        *ppvObject = nullptr;
+        if (riid == UuidOfImpl<IUnknown>::iid || riid == UuidOfImpl<IMsixBlockCacheSettings>::iid)
+        {
+            AddRef();
+            *ppvObject = static_cast<IMsixBlockCacheSettings*>(this);
+            return S_OK;
+        }
+        return E_NOINTERFACE;
+    }
+    ULONG STDMETHODCALLTYPE AddRef() noexcept override { return ++m_refs; }
+    ULONG STDMETHODCALLTYPE Release() noexcept override
+    {
+        auto refs = --m_refs;
+        if (refs == 0) { delete this; }
+        return refs;
+    }
+
+    // IMsixBlockCacheSettings
+    HRESULT STDMETHODCALLTYPE GetCapacity(UINT64* bytes) noexcept override
+    {
+        if (bytes == nullptr) { return E_INVALIDARG; }
+        *bytes = m_capacity;
+        return S_OK;
+    }
+
+private:
+    std::uint64_t m_capacity;
+    ULONG m_refs = 0;
+};
+
+// Creates a package reader that reads the package from source instead of from a stream.
+HRESULT CreatePackageReaderOnRangedSource(IMsixRangedSource* source, IAppxPackageReader** packageReader)
+{
+    ComPtr<IAppxFactory> factory;
+    ComPtr<IMsixFactoryOverrides> overrides;
+    VERIFY_SUCCEEDED(CoCreateAppxFactoryWithHeap(MyAllocate, MyFree, MSIX_VALIDATION_OPTION_SKIPSIGNATURE, &factory));
+    VERIFY_SUCCEEDED(factory->QueryInterface(UuidOfImpl<IMsixFactoryOverrides>::iid, reinterpret_cast<void**>(&overrides)));
+    VERIFY_SUCCEEDED(overrides->SpecifyExtension(MSIX_FACTORY_EXTENSION_RANGED_SOURCE, source));
+    return factory->CreatePackageReader(nullptr, packageReader);
+}
+
 void StartTestPackage(void*)
 {
     std::cout << "Starting test: TestPackage" << std::endl;
@@ -444,6 +597,28 @@ void StartTestPackage(void*)
                 VERIFY_IS_NULL(appxFile.Get());
             }
         )},
+        { "Package.PayloadFile.ReadAll", Test<IAppxPackageReader>("Verifies a payload file read whole with IMsixFileReader",
+            [](IAppxPackageReader* packageReader)
+            {
+                auto file = utf8_to_utf16(GetInput<std::string>());
+                auto expectedSize = GetInput<std::uint64_t>();
+                auto expectedCrc = static_cast<std::uint32_t>(std::stoul(GetInput<std::string>(), nullptr, 16));
+
+                ComPtr<IAppxFile> appxFile;
+                VERIFY_SUCCEEDED(packageReader->GetPayloadFile(file.c_str(), &appxFile));
+                ComPtr<IMsixFileReader> fileReader;
+                VERIFY_SUCCEEDED(appxFile->QueryInterface(UuidOfImpl<IMsixFileReader>::iid, reinterpret_cast<void**>(&fileReader)));
+
+                std::vector<std::uint8_t> buffer(static_cast<std::size_t>(expectedSize));
+                UINT64 bytesRead = 0;
+                VERIFY_HR(static_cast<HRESULT>(MSIX::Error::InvalidParameter), fileReader->ReadAll(expectedSize - 1, buffer.data(), &bytesRead));
+                VERIFY_HR(static_cast<HRESULT>(MSIX::Error::InvalidParameter), fileReader->ReadAll(expectedSize, nullptr, &bytesRead));
+
+                VERIFY_SUCCEEDED(fileReader->ReadAll(expectedSize, buffer.data(), &bytesRead));
+                VERIFY_ARE_EQUAL(expectedSize, static_cast<std::uint64_t>(bytesRead));
+                VERIFY_ARE_EQUAL(expectedCrc, Crc32(0, buffer.data(), buffer.size()));
+            }
+        )},
         { "Package.FootprintFile", Test<IAppxPackageReader>("Validates a footprint file information",
             [](IAppxPackageReader* packageReader)
             {
@@ -1226,6 +1401,301 @@ void StartTestBundleManifest(void*)
     return;
 }
 
+void StartTestPackageVerifier(void*)
+{
+    std::cout << "Starting test: TestPackageVerifier" << std::endl;
+    ComPtr<IAppxPackageReader> packageReader;
+    InitializePackageHelper(&packageReader);
+
+    ComPtr<IMsixPackageVerifier> packageVerifier;
+    VERIFY_SUCCEEDED(packageReader->QueryInterface(UuidOfImpl<IMsixPackageVerifier>::iid, reinterpret_cast<void**>(&packageVerifier)));
+    VERIFY_NOT_NULL(packageVerifier.Get());
+
+    std::map<std::string, Test<IMsixPackageVerifier>> verifierTests =
+    {
+        { "Verifier.Results", Test<IMsixPackageVerifier>("Verifies the result of checking every payload file against the block map",
+            [](IMsixPackageVerifier* packageVerifier)
+            {
+                auto threadCount = GetInput<UINT32>();
+                ComPtr<IMsixVerificationResults> results;
+                VERIFY_SUCCEEDED(packageVerifier->VerifyPackage(threadCount, &results));
+
+                auto expectedCount = GetInput<UINT32>();
+                UINT32 count = 0;
+                VERIFY_SUCCEEDED(results->GetCount(&count));
+                VERIFY_ARE_EQUAL(expectedCount, count);
+                for (UINT32 i = 0; i < count; i++)
+                {
+                    auto expectedName = GetInput<std::string>();
+                    auto expectedResult = static_cast<HRESULT>(std::stoul(GetInput<std::string>(), nullptr, 16));
+                    Text<char> fileName;
+                    VERIFY_SUCCEEDED(results->GetFileName(i, &fileName));
+                    VERIFY_ARE_EQUAL(expectedName, fileName.ToString());
+                    HRESULT result = S_OK;
+                    VERIFY_SUCCEEDED(results->GetResult(i, &result));
+                    VERIFY_ARE_EQUAL(expectedResult, result);
+                }
+
+                Text<char> fileName;
+                HRESULT result = S_OK;
+                VERIFY_HR(static_cast<HRESULT>(MSIX::Error::InvalidParameter), results->GetFileName(count, &fileName));
+                VERIFY_HR(static_cast<HRESULT>(MSIX::Error::InvalidParameter), results->GetResult(count, &result));
+            })
+        },
+        { "Verifier.InvalidParameter", Test<IMsixPackageVerifier>("Validates VerifyPackage fails without a place for its results",
+            [](IMsixPackageVerifier* packageVerifier)
+            {
+                VERIFY_HR(static_cast<HRESULT>(MSIX::Error::InvalidParameter), packageVerifier->VerifyPackage(0, nullptr));
+            })
+        },
+    };
+    ParseAndRun(verifierTests, "Finish.TestPackageVerifier", packageVerifier.Get());
+    return;
+}
+
+void StartTestBlockCache(void*)
+{
+    std::cout << "Starting test: TestBlockCache" << std::endl;
+    auto packageName = GetInput<std::string>();
+    if (!g_packageRootPath.empty())
+    {
+        packageName = g_packageRootPath + packageName;
+    }
+    auto capacity = GetInput<std::uint64_t>();
+
+    ComPtr<IAppxFactory> factory;
+    ComPtr<IMsixFactoryOverrides> overrides;
+    ComPtr<IMsixBlockCacheSettings> settings(new BlockCacheSettings(capacity));
+    VERIFY_SUCCEEDED(CoCreateAppxFactoryWithHeap(MyAllocate, MyFree, MSIX_VALIDATION_OPTION_SKIPSIGNATURE, &factory));
+    VERIFY_SUCCEEDED(factory->QueryInterface(UuidOfImpl<IMsixFactoryOverrides>::iid, reinterpret_cast<void**>(&overrides)));
+    VERIFY_SUCCEEDED(overrides->SpecifyExtension(MSIX_FACTORY_EXTENSION_BLOCK_CACHE, settings.Get()));
+
+    ComPtr<IStream> inputStream;
+    ComPtr<IAppxPackageReader> packageReader;
+    VERIFY_SUCCEEDED(CreateStreamOnFile(const_cast<char*>(packageName.c_str()), true, &inputStream));
+    VERIFY_SUCCEEDED(factory->CreatePackageReader(inputStream.Get(), &packageReader));
+    VERIFY_NOT_NULL(packageReader.Get());
+
+    std::map<std::string, Test<IAppxPackageReader>> blockCacheTests =
+    {
+        { "BlockCache.Read", Test<IAppxPackageReader>("Reads a payload file front to back in small reads, a number of times, on a new stream",
+            [](IAppxPackageReader* packageReader)
+            {
+                auto file = utf8_to_utf16(GetInput<std::string>());
+                auto readSize = GetInput<ULONG>();
+                auto passes = GetInput<int>();
+
+                ComPtr<IAppxFile> appxFile;
+                VERIFY_SUCCEEDED(packageReader->GetPayloadFile(file.c_str(), &appxFile));
+                UINT64 expectedSize = 0;
+                VERIFY_SUCCEEDED(appxFile->GetSize(&expectedSize));
+                ComPtr<IStream> stream;
+                VERIFY_SUCCEEDED(appxFile->GetStream(&stream));
+
+                std::vector<std::uint8_t> buffer(readSize);
+                for (int pass = 0; pass < passes; pass++)
+                {
+                    LARGE_INTEGER start = { 0 };
+                    VERIFY_SUCCEEDED(stream->Seek(start, STREAM_SEEK_SET, nullptr));
+                    std::uint64_t size = 0;
+                    ULONG read = 0;
+                    do
+                    {
+                        VERIFY_SUCCEEDED(stream->Read(buffer.data(), readSize, &read));
+                        size += read;
+                    } while (read != 0);
+                    VERIFY_ARE_EQUAL(static_cast<std::uint64_t>(expectedSize), size);
+                }
+            })
+        },
+        { "BlockCache.Statistics", Test<IAppxPackageReader>("Verifies how many reads found their block in the cache and how many didn't",
+            [](IAppxPackageReader* packageReader)
+            {
+                auto expectedHits = GetInput<std::uint64_t>();
+                auto expectedMisses = GetInput<std::uint64_t>();
+
+                ComPtr<IMsixBlockCacheStatistics> statistics;
+                VERIFY_SUCCEEDED(packageReader->QueryInterface(UuidOfImpl<IMsixBlockCacheStatistics>::iid, reinterpret_cast<void**>(&statistics)));
+                UINT64 hits = 0;
+                UINT64 misses = 0;
+                VERIFY_SUCCEEDED(statistics->GetBlockCacheStatistics(&hits, &misses));
+                VERIFY_ARE_EQUAL(expectedHits, static_cast<std::uint64_t>(hits));
+                VERIFY_ARE_EQUAL(expectedMisses, static_cast<std::uint64_t>(misses));
+
+                VERIFY_HR(static_cast<HRESULT>(MSIX::Error::InvalidParameter), statistics->GetBlockCacheStatistics(nullptr, &misses));
+                VERIFY_HR(static_cast<HRESULT>(MSIX::Error::InvalidParameter), statistics->GetBlockCacheStatistics(&hits, nullptr));
+            })
+        },
+    };
+    ParseAndRun(blockCacheTests, "Finish.TestBlockCache", packageReader.Get());
+    return;
+}
+
+void StartTestRangedSource(void*)
+{
+    std::cout << "Starting test: TestRangedSource" << std::endl;
+    auto packageName = GetInput<std::string>();
+    if (!g_packageRootPath.empty())
+    {
+        packageName = g_packageRootPath + packageName;
+    }
+
+    ComPtr<IMsixRangedSource> source(new FileRangedSource(packageName, S_OK));
+    ComPtr<IAppxPackageReader> packageReader;
+    VERIFY_SUCCEEDED(CreatePackageReaderOnRangedSource(source.Get(), &packageReader));
+    VERIFY_NOT_NULL(packageReader.Get());
+
+    std::map<std::string, Test<IAppxPackageReader>> rangedSourceTests =
+    {
+        { "RangedSource.PayloadFiles", Test<IAppxPackageReader>("Verifies the payload files of a package read from a ranged source",
+            [](IAppxPackageReader* packageReader)
+            {
+                auto expectedNumOfFiles = GetInput<int>();
+                ComPtr<IAppxFilesEnumerator> files;
+                VERIFY_SUCCEEDED(packageReader->GetPayloadFiles(&files));
+
+                BOOL hasCurrent = FALSE;
+                VERIFY_SUCCEEDED(files->GetHasCurrent(&hasCurrent));
+                int nFiles = 0;
+                while (hasCurrent)
+                {
+                    auto expectedName = GetInput<std::string>();
+                    ComPtr<IAppxFile> file;
+                    VERIFY_SUCCEEDED(files->GetCurrent(&file));
+                    Text<wchar_t> fileName;
+                    VERIFY_SUCCEEDED(file->GetName(&fileName));
+                    VERIFY_ARE_EQUAL(expectedName, fileName.ToString());
+
+                    VERIFY_SUCCEEDED(files->MoveNext(&hasCurrent));
+                    nFiles++;
+                }
+                VERIFY_ARE_EQUAL(expectedNumOfFiles, nFiles);
+            })
+        },
+        { "RangedSource.PayloadFile.Contents", Test<IAppxPackageReader>("Verifies the size and CRC-32 of a payload file read from a ranged source",
+            [](IAppxPackageReader* packageReader)
+            {
+                auto file = utf8_to_utf16(GetInput<std::string>());
+                auto expectedSize = GetInput<std::uint64_t>();
+                auto expectedCrc = static_cast<std::uint32_t>(std::stoul(GetInput<std::string>(), nullptr, 16));
+
+                ComPtr<IAppxFile> appxFile;
+                VERIFY_SUCCEEDED(packageReader->GetPayloadFile(file.c_str(), &appxFile));
+                ComPtr<IStream> stream;
+                VERIFY_SUCCEEDED(appxFile->GetStream(&stream));
+                std::uint64_t size = 0;
+                auto crc = Crc32OfStream(stream.Get(), &size);
+                VERIFY_ARE_EQUAL(expectedSize, size);
+                VERIFY_ARE_EQUAL(expectedCrc, crc);
+            })
+        },
+        { "RangedSource.ReadFails", Test<IAppxPackageReader>("Validates the package reader fails with the error of a failed ranged read",
+            [](IAppxPackageReader*)
+            {
+                auto packageName = GetInput<std::string>();
+                if (!g_packageRootPath.empty())
+                {
+                    packageName = g_packageRootPath + packageName;
+                }
+                auto expectedHr = static_cast<HRESULT>(std::stoul(GetInput<std::string>(), nullptr, 16));
+
+                ComPtr<IMsixRangedSource> failingSource(new FileRangedSource(packageName, expectedHr));
+                ComPtr<IAppxPackageReader> failedReader;
+                VERIFY_HR(expectedHr, CreatePackageReaderOnRangedSource(failingSource.Get(), &failedReader));
+                VERIFY_IS_NULL(failedReader.Get());
+            })
+        },
+    };
+    ParseAndRun(rangedSourceTests, "Finish.TestRangedSource", packageReader.Get());
+    return;
+}
+
+void StartTestFileStream(void*)
+{
+    std::cout << "Starting test: TestFileStream" << std::endl;
+    auto packageName = GetInput<std::string>();
+    if (!g_packageRootPath.empty())
+    {
+        packageName = g_packageRootPath + packageName;
+    }
+
+    std::map<std::string, Test<std::string>> fileStreamTests =
+    {
+        { "FileStream.Mapped.Contents", Test<std::string>("Verifies the size and CRC-32 of a payload file of a package opened mapped into memory",
+            [](std::string* packageName)
+            {
+                auto file = utf8_to_utf16(GetInput<std::string>());
+                auto expectedSize = GetInput<std::uint64_t>();
+                auto expectedCrc = static_cast<std::uint32_t>(std::stoul(GetInput<std::string>(), nullptr, 16));
+
+                ComPtr<IAppxFactory> factory;
+                ComPtr<IStream> inputStream;
+                ComPtr<IAppxPackageReader> packageReader;
+                VERIFY_SUCCEEDED(CoCreateAppxFactoryWithHeap(MyAllocate, MyFree, MSIX_VALIDATION_OPTION_SKIPSIGNATURE, &factory));
+                VERIFY_SUCCEEDED(CreateMappedStreamOnFile(const_cast<char*>(packageName->c_str()), &inputStream));
+                VERIFY_SUCCEEDED(factory->CreatePackageReader(inputStream.Get(), &packageReader));
+
+                ComPtr<IAppxFile> appxFile;
+                VERIFY_SUCCEEDED(packageReader->GetPayloadFile(file.c_str(), &appxFile));
+                ComPtr<IStream> stream;
+                VERIFY_SUCCEEDED(appxFile->GetStream(&stream));
+                std::uint64_t size = 0;
+                auto crc = Crc32OfStream(stream.Get(), &size);
+                VERIFY_ARE_EQUAL(expectedSize, size);
+                VERIFY_ARE_EQUAL(expectedCrc, crc);
+            })
+        },
+        { "FileStream.Truncated", Test<std::string>("Validates reading a payload file fails, instead of crashing, when the package is truncated while it is read",
+            [](std::string* packageName)
+            {
+                auto copyName = GetInput<std::string>();
+                auto file = utf8_to_utf16(GetInput<std::string>());
+                auto readBefore = GetInput<ULONG>();
+                auto expectedHr = static_cast<HRESULT>(std::stoul(GetInput<std::string>(), nullptr, 16));
+
+                {
+                    std::ifstream from(*packageName, std::ios::binary);
+                    std::ofstream to(copyName, std::ios::binary | std::ios::trunc);
+                    to << from.rdbuf();
+                    VERIFY_IS_TRUE(static_cast<bool>(to));
+                }
+
+                HRESULT hr = S_OK;
+                {
+                    ComPtr<IAppxFactory> factory;
+                    ComPtr<IStream> inputStream;
+                    ComPtr<IAppxPackageReader> packageReader;
+                    VERIFY_SUCCEEDED(CoCreateAppxFactoryWithHeap(MyAllocate, MyFree,
+                        static_cast<MSIX_VALIDATION_OPTION>(MSIX_VALIDATION_OPTION_SKIPSIGNATURE | MSIX_VALIDATION_OPTION_DEFERPAYLOADCHECKS), &factory));
+                    VERIFY_SUCCEEDED(CreateStreamOnFile(const_cast<char*>(copyName.c_str()), true, &inputStream));
+                    VERIFY_SUCCEEDED(factory->CreatePackageReader(inputStream.Get(), &packageReader));
+
+                    ComPtr<IAppxFile> appxFile;
+                    VERIFY_SUCCEEDED(packageReader->GetPayloadFile(file.c_str(), &appxFile));
+                    ComPtr<IStream> stream;
+                    VERIFY_SUCCEEDED(appxFile->GetStream(&stream));
+                    std::vector<std::uint8_t> buffer(readBefore);
+                    ULONG read = 0;
+                    VERIFY_SUCCEEDED(stream->Read(buffer.data(), readBefore, &read));
+                    VERIFY_ARE_EQUAL(readBefore, read);
+
+                    // Truncate the package under the open stream.
+                    std::ofstream(copyName, std::ios::binary | std::ios::trunc).close();
+
+                    do
+                    {
+                        hr = stream->Read(buffer.data(), readBefore, &read);
+                    } while (SUCCEEDED(hr) && (read != 0));
+                }
+                std::remove(copyName.c_str());
+                VERIFY_HR(expectedHr, hr);
+            })
+        },
+    };
+    ParseAndRun(fileStreamTests, "Finish.TestFileStream", &packageName);
+    return;
+}
+
 int RunApiTestInternal(char* input, char* target, char* packageRootPath)
 {
     // This is only used by the mobile tests
@@ -1243,6 +1713,10 @@ int RunApiTestInternal(char* input, char* target, char* packageRootPath)
         { "Start.TestPackageBlockMap", Test<void>("Test IAppxBlockMapReader", StartTestPackageBlockMap) },
         { "Start.TestBundle", Test<void>("Test IAppxBundleReader", StartTestBundle) },
         { "Start.TestBundleManifest", Test<void>("Test IAppxBundleManifestReader", StartTestBundleManifest) },
+        { "Start.TestRangedSource", Test<void>("Test IMsixRangedSource", StartTestRangedSource) },
+        { "Start.TestPackageVerifier", Test<void>("Test IMsixPackageVerifier", StartTestPackageVerifier) },
+        { "Start.TestBlockCache", Test<void>("Test IMsixBlockCacheSettings and IMsixBlockCacheStatistics", StartTestBlockCache) },
+        { "Start.TestFileStream", Test<void>("Test CreateStreamOnFile and CreateMappedStreamOnFile", StartTestFileStream) },
     };
     ParseAndRun(tests, "Finish");
 
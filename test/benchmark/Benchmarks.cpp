@@ -0,0 +1,1241 @@
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+#include "MSIXWindows.hpp"
+#include "AppxPackaging.hpp"
+
+#include "Benchmarks.hpp"
+#include "PackageWriter.hpp"
+#include "SimulatedLatencySource.hpp"
+#include "SHA256Hardware.hpp"
+#include "SHA256MultiBuffer.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <map>
+#include <functional>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <thread>
+
+namespace MsixBenchmark {
+
+LPVOID STDMETHODCALLTYPE MyAllocate(SIZE_T cb)  { return std::malloc(cb); }
+void   STDMETHODCALLTYPE MyFree(LPVOID pv)      { return std::free(pv);   }
+
+// Stripped down ComPtr provided for those platforms that do not already have a ComPtr class.
+template <class T>
+class ComPtr
+{
+public:
+    // default ctor
+    ComPtr() = default;
+    ComPtr(T* ptr) : m_ptr(ptr) { InternalAddRef(); }
+
+    ~ComPtr() { InternalRelease(); }
+    inline T* operator->() const { return m_ptr; }
+    inline T* Get() const { return m_ptr; }
+
+    inline T** operator&()
+    {   InternalRelease();
+        return &m_ptr;
+    }
+
+protected:
+    T* m_ptr = nullptr;
+
+    inline void InternalAddRef() { if (m_ptr) { m_ptr->AddRef(); } }
+    inline void InternalRelease()
+    {
+        T* temp = m_ptr;
+        if (temp)
+        {   m_ptr = nullptr;
+            temp->Release();
+        }
+    }
+};
+
+class BenchmarkException : public std::exception
+{
+public:
+    BenchmarkException(HRESULT hr, int line)
+    {
+        std::ostringstream builder;
+        builder << "call failed with 0x" << std::hex << hr << " on line " << std::dec << line;
+        m_message = builder.str();
+    }
+    const char* what() const noexcept override { return m_message.c_str(); }
+private:
+    std::string m_message;
+};
+
+#define ThrowIfFailed(a) { HRESULT __hr = a; if (FAILED(__hr)) { throw BenchmarkException(__hr, __LINE__); } }
+
+// Counts the reads that go back from where the previous one ended, or skip ahead more than read-ahead
+// would cover. Each of them is a seek on a spinning disk, or a new request on a network block device.
+class SeekCountingStream final : public IStream
+{
+public:
+    SeekCountingStream(IStream* stream) : m_stream(stream) {}
+
+    std::uint64_t GetSeeks() const { return m_seeks; }
+
+    // IUnknown
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) noexcept override
+    {
+        if (ppvObject == nullptr) { return E_INVALIDARG; }
+        *ppvObject = nullptr;
+        if (riid == UuidOfImpl<IUnknown>::iid || riid == UuidOfImpl<IStream>::iid)
+        {
+            AddRef();
+            *ppvObject = static_cast<IStream*>(this);
+            return S_OK;
+        }
+        return E_NOINTERFACE;
+    }
+    ULONG STDMETHODCALLTYPE AddRef() noexcept override { return ++m_refs; }
+    ULONG STDMETHODCALLTYPE Release() noexcept override
+    {
+        auto refs = --m_refs;
+        if (refs == 0) { delete this; }
+        return refs;
+    }
+
+    // IStream
+    HRESULT STDMETHODCALLTYPE Read(void* buffer, ULONG countBytes, ULONG* bytesRead) noexcept override
+    {
+        ULONG read = 0;
+        HRESULT hr = m_stream->Read(buffer, countBytes, &read);
+        if (SUCCEEDED(hr) && read != 0)
+        {
+            if ((m_position < m_lastReadEnd) || (m_position - m_lastReadEnd > ReadAheadSize)) { m_seeks++; }
+            m_position += read;
+            m_lastReadEnd = m_position;
+        }
+        if (bytesRead) { *bytesRead = read; }
+        return hr;
+    }
+    HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER* newPosition) noexcept override
+    {
+        ULARGE_INTEGER position = { 0 };
+        HRESULT hr = m_stream->Seek(move, origin, &position);
+        if (SUCCEEDED(hr)) { m_position = position.QuadPart; }
+        if (newPosition) { *newPosition = position; }
+        return hr;
+    }
+    HRESULT STDMETHODCALLTYPE Write(const void*, ULONG, ULONG*) noexcept override { return E_NOTIMPL; }
+    HRESULT STDMETHODCALLTYPE SetSize(ULARGE_INTEGER) noexcept override { return E_NOTIMPL; }
+    HRESULT STDMETHODCALLTYPE CopyTo(IStream*, ULARGE_INTEGER, ULARGE_INTEGER*, ULARGE_INTEGER*) noexcept override { return E_NOTIMPL; }
+    HRESULT STDMETHODCALLTYPE Commit(DWORD) noexcept override { return E_NOTIMPL; }
+    HRESULT STDMETHODCALLTYPE Revert() noexcept override { return E_NOTIMPL; }
+    HRESULT STDMETHODCALLTYPE LockRegion(ULARGE_INTEGER, ULARGE_INTEGER, DWORD) noexcept override { return E_NOTIMPL; }
+    HRESULT STDMETHODCALLTYPE UnlockRegion(ULARGE_INTEGER, ULARGE_INTEGER, DWORD) noexcept override { return E_NOTIMPL; }
+    HRESULT STDMETHODCALLTYPE Stat(STATSTG*, DWORD) noexcept override { return E_NOTIMPL; }
+    HRESULT STDMETHODCALLTYPE Clone(IStream**) noexcept override { return E_NOTIMPL; }
+
+private:
+    static const std::uint64_t ReadAheadSize = 65536;
+
+    ComPtr<IStream> m_stream;
+    ULONG m_refs = 0;
+    std::uint64_t m_position = 0;
+    std::uint64_t m_lastReadEnd = 0;
+    std::uint64_t m_seeks = 0;
+};
+
+// Settings for MSIX_FACTORY_EXTENSION_BLOCK_CACHE.
+class BlockCacheSettings final : public IMsixBlockCacheSettings
+{
+public:
+    BlockCacheSettings(std::uint64_t capacity) : m_capacity(capacity) {}
+
+    // IUnknown
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) noexcept override
+    {
+        if (ppvObject == nullptr) { return E_INVALIDARG; }
+        *ppvObject = nullptr;
+        if (riid == UuidOfImpl<IUnknown>::iid || riid == UuidOfImpl<IMsixBlockCacheSettings>::iid)
+        {
+            AddRef();
+            *ppvObject = static_cast<IMsixBlockCacheSettings*>(this);
+            return S_OK;
+        }
+        return E_NOINTERFACE;
+    }
+    ULONG STDMETHODCALLTYPE AddRef() noexcept override { return ++m_refs; }
+    ULONG STDMETHODCALLTYPE Release() noexcept override
+    {
+        auto refs = --m_refs;
+        if (refs == 0) { delete this; }
+        return refs;
+    }
+
+    // IMsixBlockCacheSettings
+    HRESULT STDMETHODCALLTYPE GetCapacity(UINT64* bytes) noexcept override
+    {
+        if (bytes == nullptr) { return E_INVALIDARG; }
+        *bytes = m_capacity;
+        return S_OK;
+    }
+
+private:
+    ULONG m_refs = 0;
+    std::uint64_t m_capacity;
+};
+
+// Settings for MSIX_FACTORY_EXTENSION_VERIFICATION_CACHE.
+class VerificationCacheSettings final : public IMsixVerificationCacheSettings
+{
+public:
+    VerificationCacheSettings(std::string directory, std::vector<BYTE> key) : m_directory(std::move(directory)), m_key(std::move(key)) {}
+
+    // IUnknown
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) noexcept override
+    {
+        if (ppvObject == nullptr) { return E_INVALIDARG; }
+        *ppvObject = nullptr;
+        if (riid == UuidOfImpl<IUnknown>::iid || riid == UuidOfImpl<IMsixVerificationCacheSettings>::iid)
+        {
+            AddRef();
+            *ppvObject = static_cast<IMsixVerificationCacheSettings*>(this);
+            return S_OK;
+        }
+        return E_NOINTERFACE;
+    }
+    ULONG STDMETHODCALLTYPE AddRef() noexcept override { return ++m_refs; }
+    ULONG STDMETHODCALLTYPE Release() noexcept override
+    {
+        auto refs = --m_refs;
+        if (refs == 0) { delete this; }
+        return refs;
+    }
+
+    // IMsixVerificationCacheSettings
+    HRESULT STDMETHODCALLTYPE GetDirectory(LPCSTR* directory) noexcept override
+    {
+        if (directory == nullptr) { return E_INVALIDARG; }
+        *directory = m_directory.c_str();
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE GetKey(UINT32* keySize, const BYTE** key) noexcept override
+    {
+        if (keySize == nullptr || key == nullptr) { return E_INVALIDARG; }
+        *keySize = static_cast<UINT32>(m_key.size());
+        *key = m_key.data();
+        return S_OK;
+    }
+
+private:
+    ULONG m_refs = 0;
+    std::string m_directory;
+    std::vector<BYTE> m_key;
+};
+
+struct Context
+{
+    std::string directory;
+    int iterations;
+};
+
+// Measures how long the callback takes in milliseconds, repeated context.iterations times.
+std::vector<double> Measure(const Context& context, const std::function<void()>& callback)
+{
+    std::vector<double> samples;
+    for (int i = 0; i < context.iterations; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        callback();
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples;
+}
+
+void Report(const std::string& measurement, const std::string& parameter, const std::vector<double>& samples)
+{
+    std::cout << "\t" << std::left << std::setw(28) << measurement << std::setw(20) << parameter
+              << " min " << std::right << std::fixed << std::setprecision(3) << std::setw(10) << samples.front() << " ms"
+              << "   median " << std::setw(10) << samples[samples.size() / 2] << " ms" << std::endl;
+}
+
+void OpenPackage(const std::string& path, IAppxPackageReader** reader,
+    MSIX_VALIDATION_OPTION validationOptions = MSIX_VALIDATION_OPTION_SKIPSIGNATURE)
+{
+    ComPtr<IAppxFactory> factory;
+    ComPtr<IStream> inputStream;
+    ThrowIfFailed(CreateMappedStreamOnFile(const_cast<char*>(path.c_str()), &inputStream));
+    ThrowIfFailed(CoCreateAppxFactoryWithHeap(MyAllocate, MyFree, validationOptions, &factory));
+    ThrowIfFailed(factory->CreatePackageReader(inputStream.Get(), reader));
+}
+
+// Reads the whole payload file, passing every chunk read to onRead. Returns the number of bytes read.
+std::uint64_t ReadPayloadFile(IAppxPackageReader* reader, const std::string& name,
+    const std::function<void(std::uint64_t offset, const std::uint8_t* data, ULONG count)>& onRead = nullptr)
+{
+    ComPtr<IAppxPackageReaderUtf8> readerUtf8;
+    ThrowIfFailed(reader->QueryInterface(UuidOfImpl<IAppxPackageReaderUtf8>::iid, reinterpret_cast<void**>(&readerUtf8)));
+    ComPtr<IAppxFile> file;
+    ThrowIfFailed(readerUtf8->GetPayloadFile(name.c_str(), &file));
+    ComPtr<IStream> stream;
+    ThrowIfFailed(file->GetStream(&stream));
+    std::vector<std::uint8_t> buffer(65536);
+    std::uint64_t total = 0;
+    ULONG bytesRead = 0;
+    do
+    {
+        ThrowIfFailed(stream->Read(buffer.data(), static_cast<ULONG>(buffer.size()), &bytesRead));
+        if (onRead && bytesRead != 0) { onRead(total, buffer.data(), bytesRead); }
+        total += bytesRead;
+    } while (bytesRead != 0);
+    return total;
+}
+
+// Reads every payload file in the order the payload enumerator returns them, which is archive order. Every
+// chunk read is passed to onRead with the index of the file. Returns the number of bytes read.
+std::uint64_t ReadPayloadFiles(IAppxPackageReader* reader,
+    const std::function<void(std::size_t file, std::uint64_t offset, const std::uint8_t* data, ULONG count)>& onRead = nullptr)
+{
+    ComPtr<IAppxFilesEnumerator> files;
+    ThrowIfFailed(reader->GetPayloadFiles(&files));
+    BOOL hasCurrent = FALSE;
+    ThrowIfFailed(files->GetHasCurrent(&hasCurrent));
+    std::vector<std::uint8_t> buffer(65536);
+    std::uint64_t total = 0;
+    for (std::size_t index = 0; hasCurrent; index++)
+    {
+        ComPtr<IAppxFile> file;
+        ThrowIfFailed(files->GetCurrent(&file));
+        ComPtr<IStream> fileStream;
+        ThrowIfFailed(file->GetStream(&fileStream));
+        std::uint64_t offset = 0;
+        ULONG bytesRead = 0;
+        do
+        {
+            ThrowIfFailed(fileStream->Read(buffer.data(), static_cast<ULONG>(buffer.size()), &bytesRead));
+            if (onRead && bytesRead != 0) { onRead(index, offset, buffer.data(), bytesRead); }
+            offset += bytesRead;
+        } while (bytesRead != 0);
+        total += offset;
+        ThrowIfFailed(files->MoveNext(&hasCurrent));
+    }
+    return total;
+}
+
+// Open latency as the number of entries in the package grows, with payload files checked against the block map
+// when the package is opened and when each is first used.
+void BenchmarkOpen(const Context& context)
+{
+    for (std::size_t entries : { 16, 256, 4096, 16384 })
+    {
+        auto path = context.directory + "open_" + std::to_string(entries) + ".appx";
+        PackageWriter writer(path);
+        for (std::size_t i = 0; i < entries; i++)
+        {
+            std::string content = "payload " + std::to_string(i);
+            writer.AddPayloadFile("files/file" + std::to_string(i) + ".bin", std::vector<std::uint8_t>(content.begin(), content.end()));
+        }
+        writer.Close();
+
+        for (bool defer : { false, true })
+        {
+            auto parameter = std::to_string(entries) + " entries" + (defer ? ", deferred checks" : "");
+            auto options = static_cast<MSIX_VALIDATION_OPTION>(MSIX_VALIDATION_OPTION_SKIPSIGNATURE | (defer ? MSIX_VALIDATION_OPTION_DEFERPAYLOADCHECKS : 0));
+            Report("open", parameter, Measure(context, [&]()
+            {
+                ComPtr<IAppxPackageReader> reader;
+                OpenPackage(path, &reader, options);
+            }));
+
+            Report("open + read one file", parameter, Measure(context, [&]()
+            {
+                ComPtr<IAppxPackageReader> reader;
+                OpenPackage(path, &reader, options);
+                ReadPayloadFile(reader.Get(), "files\\file" + std::to_string(entries / 2) + ".bin");
+            }));
+        }
+    }
+}
+
+// Cost of looking up payload files by name, as asset servers do over and over on a package they keep open.
+// No file is read, only found.
+void BenchmarkLookup(const Context& context)
+{
+    const std::size_t entries = 16384;
+    auto path = context.directory + "lookup.appx";
+    std::vector<std::string> names;
+    {
+        PackageWriter writer(path);
+        for (std::size_t i = 0; i < entries; i++)
+        {
+            auto name = "files/directory" + std::to_string(i % 64) + "/file" + std::to_string(i) + ".bin";
+            writer.AddPayloadFile(name, std::vector<std::uint8_t>(1, static_cast<std::uint8_t>(i)));
+            std::replace(name.begin(), name.end(), '/', '\\');
+            names.push_back(name);
+        }
+        writer.Close();
+    }
+
+    ComPtr<IAppxPackageReader> reader;
+    OpenPackage(path, &reader);
+    ComPtr<IAppxPackageReaderUtf8> readerUtf8;
+    ThrowIfFailed(reader->QueryInterface(UuidOfImpl<IAppxPackageReaderUtf8>::iid, reinterpret_cast<void**>(&readerUtf8)));
+
+    auto parameter = std::to_string(entries) + " entries";
+    auto samples = Measure(context, [&]()
+    {
+        for (const auto& name : names)
+        {
+            ComPtr<IAppxFile> file;
+            ThrowIfFailed(readerUtf8->GetPayloadFile(name.c_str(), &file));
+        }
+    });
+    Report("find every file", parameter, samples);
+    std::cout << "\t" << std::left << std::setw(48) << "" << " best " << std::right << std::setw(10)
+              << samples.front() * 1000000 / entries << " ns per lookup" << std::endl;
+}
+
+// Zip64 package with a payload file bigger than 4 GB followed by a file stored past the 4 GB mark.
+// The content read back is checked against what was written, so this doubles as a test of the
+// 64 bit paths.
+void BenchmarkZip64(const Context& context)
+{
+    const std::uint64_t largeSize = (4ull << 30) + (512ull << 20);
+    auto generator = [](std::uint64_t offset, std::uint8_t* buffer, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; i++)
+        {
+            auto position = offset + i;
+            buffer[i] = static_cast<std::uint8_t>((position >> 16) ^ (position * 31));
+        }
+    };
+    std::string small = "stored past 4 GB";
+
+    auto path = context.directory + "zip64.appx";
+    {
+        PackageWriter writer(path);
+        writer.AddPayloadFile("files/large.bin", largeSize, generator);
+        writer.AddPayloadFile("files/small.bin", std::vector<std::uint8_t>(small.begin(), small.end()));
+        writer.Close();
+    }
+
+    auto parameter = std::to_string(largeSize >> 20) + " MB";
+    Report("open", parameter, Measure(context, [&]()
+    {
+        ComPtr<IAppxPackageReader> reader;
+        OpenPackage(path, &reader);
+    }));
+
+    Report("read file past 4 GB", parameter, Measure(context, [&]()
+    {
+        ComPtr<IAppxPackageReader> reader;
+        OpenPackage(path, &reader);
+        std::string content;
+        ReadPayloadFile(reader.Get(), "files\\small.bin", [&](std::uint64_t, const std::uint8_t* data, ULONG count)
+        {
+            content.append(reinterpret_cast<const char*>(data), count);
+        });
+        if (content != small) { throw std::runtime_error("files\\small.bin doesn't match"); }
+    }));
+
+    Report("read 4 GB+ file", parameter, Measure(context, [&]()
+    {
+        ComPtr<IAppxPackageReader> reader;
+        OpenPackage(path, &reader);
+        std::vector<std::uint8_t> expected;
+        auto size = ReadPayloadFile(reader.Get(), "files\\large.bin", [&](std::uint64_t offset, const std::uint8_t* data, ULONG count)
+        {
+            expected.resize(count);
+            generator(offset, expected.data(), count);
+            if (std::memcmp(expected.data(), data, count) != 0) { throw std::runtime_error("files\\large.bin doesn't match"); }
+        });
+        if (size != largeSize) { throw std::runtime_error("files\\large.bin has the wrong size"); }
+    }));
+}
+
+// Reading the payload files in archive order, as the payload enumerator and unpack do, against looking them
+// up in name order. File names are shuffled with respect to where the files are in the archive.
+void BenchmarkOrder(const Context& context)
+{
+    const std::size_t entries = 2048;
+    auto path = context.directory + "order.appx";
+    std::vector<std::string> names;
+    {
+        PackageWriter writer(path);
+        for (std::size_t i = 0; i < entries; i++)
+        {
+            auto name = "files/file" + std::to_string((i * 7919) % entries) + ".bin";
+            writer.AddPayloadFile(name, std::vector<std::uint8_t>(16384, static_cast<std::uint8_t>(i)));
+            std::replace(name.begin(), name.end(), '/', '\\');
+            names.push_back(name);
+        }
+        writer.Close();
+    }
+    std::sort(names.begin(), names.end());
+
+    // Opens the package through a SeekCountingStream, runs callback and returns the number of seeks.
+    auto countSeeks = [&](const std::function<void(IStream*)>& callback)
+    {
+        ComPtr<IStream> fileStream;
+        ThrowIfFailed(CreateStreamOnFile(const_cast<char*>(path.c_str()), true, &fileStream));
+        auto counting = new SeekCountingStream(fileStream.Get());
+        ComPtr<IStream> stream(counting);
+        callback(stream.Get());
+        return counting->GetSeeks();
+    };
+    auto openPackage = [&](IStream* stream, IAppxPackageReader** reader)
+    {
+        ComPtr<IAppxFactory> factory;
+        ThrowIfFailed(CoCreateAppxFactoryWithHeap(MyAllocate, MyFree, MSIX_VALIDATION_OPTION_SKIPSIGNATURE, &factory));
+        ThrowIfFailed(factory->CreatePackageReader(stream, reader));
+    };
+
+    auto parameter = std::to_string(entries) + " entries";
+    std::uint64_t nameOrderSeeks = 0;
+    Report("read in name order", parameter, Measure(context, [&]()
+    {
+        nameOrderSeeks = countSeeks([&](IStream* stream)
+        {
+            ComPtr<IAppxPackageReader> reader;
+            openPackage(stream, &reader);
+            for (const auto& name : names)
+            {
+                ReadPayloadFile(reader.Get(), name);
+            }
+        });
+    }));
+
+    std::uint64_t archiveOrderSeeks = 0;
+    Report("read in archive order", parameter, Measure(context, [&]()
+    {
+        archiveOrderSeeks = countSeeks([&](IStream* stream)
+        {
+            ComPtr<IAppxPackageReader> reader;
+            openPackage(stream, &reader);
+            ReadPayloadFiles(reader.Get());
+        });
+    }));
+
+    std::uint64_t unpackSeeks = 0;
+    auto unpackDirectory = context.directory + "order_unpack";
+    Report("unpack", parameter, Measure(context, [&]()
+    {
+        unpackSeeks = countSeeks([&](IStream* stream)
+        {
+            ThrowIfFailed(UnpackPackageFromStream(MSIX_PACKUNPACK_OPTION_NONE, MSIX_VALIDATION_OPTION_SKIPSIGNATURE, stream,
+                const_cast<char*>(unpackDirectory.c_str())));
+        });
+    }));
+
+    std::cout << "\tseeks: " << nameOrderSeeks << " in name order, " << archiveOrderSeeks << " in archive order, "
+              << unpackSeeks << " to unpack. Avoided " << (nameOrderSeeks - std::min(nameOrderSeeks, archiveOrderSeeks)) << std::endl;
+}
+
+// Cost of checking the crc-32 of a file while it is read, on top of the block map hashes that are always checked.
+void BenchmarkCrc(const Context& context)
+{
+    const std::uint64_t size = 256ull << 20;
+    auto generator = [](std::uint64_t offset, std::uint8_t* buffer, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; i++)
+        {
+            auto position = offset + i;
+            buffer[i] = static_cast<std::uint8_t>((position >> 12) ^ (position * 131));
+        }
+    };
+
+    auto path = context.directory + "crc.appx";
+    {
+        PackageWriter writer(path);
+        writer.AddPayloadFile("files/payload.bin", size, generator);
+        writer.Close();
+    }
+
+    auto megabytes = static_cast<double>(size >> 20);
+    auto parameter = std::to_string(size >> 20) + " MB";
+    for (auto verify : { false, true })
+    {
+        auto options = static_cast<MSIX_VALIDATION_OPTION>(MSIX_VALIDATION_OPTION_SKIPSIGNATURE | (verify ? MSIX_VALIDATION_OPTION_VERIFYCRC : 0));
+        auto samples = Measure(context, [&]()
+        {
+            ComPtr<IAppxPackageReader> reader;
+            OpenPackage(path, &reader, options);
+            ReadPayloadFile(reader.Get(), "files\\payload.bin");
+        });
+        Report(verify ? "read, verify crc" : "read", parameter, samples);
+        std::cout << "\t" << std::left << std::setw(48) << "" << " best " << std::right << std::setw(10)
+                  << megabytes * 1000 / samples.front() << " MB/s" << std::endl;
+    }
+}
+
+// Throughput of reading a deflated payload file, with reads smaller and bigger than the inflate window, all of it at
+// once, where its blocks are inflated on every core, and the cost of reading it at random. The content read back is
+// checked against what was written.
+void BenchmarkInflate(const Context& context)
+{
+    const std::uint64_t size = 64ull << 20;
+    // Words picked by a hash of the position, with one in four replaced by noise, so it compresses about as well
+    // as typical package content.
+    auto generator = [](std::uint64_t offset, std::uint8_t* buffer, std::size_t count)
+    {
+        static const char words[] = "alpha   bravo   charlie delta   echo    foxtrot golf    hotel   "
+                                    "india   juliet  kilo    lima    mike    november oscar  papa    ";
+        for (std::size_t i = 0; i < count; i++)
+        {
+            auto position = offset + i;
+            auto hash = (position >> 3) * 0x9E3779B97F4A7C15ull;
+            buffer[i] = ((hash >> 56) & 3) ? static_cast<std::uint8_t>(words[((hash >> 60) << 3) | (position & 7)])
+                                           : static_cast<std::uint8_t>((position * 0xD6E8FEB86659FD93ull) >> 56);
+        }
+    };
+
+    auto path = context.directory + "inflate.appx";
+    {
+        PackageWriter writer(path);
+        writer.AddPayloadFile("files/payload.bin", size, generator, true);
+        writer.Close();
+    }
+
+    auto megabytes = static_cast<double>(size >> 20);
+    for (ULONG bufferSize : { 4096, 65536, 1 << 20 })
+    {
+        auto parameter = std::to_string(size >> 20) + " MB, " + std::to_string(bufferSize >> 10) + " KB reads";
+        std::vector<std::uint8_t> buffer(bufferSize);
+        std::vector<std::uint8_t> expected(bufferSize);
+        auto samples = Measure(context, [&]()
+        {
+            ComPtr<IAppxPackageReader> reader;
+            OpenPackage(path, &reader);
+            ComPtr<IAppxPackageReaderUtf8> readerUtf8;
+            ThrowIfFailed(reader->QueryInterface(UuidOfImpl<IAppxPackageReaderUtf8>::iid, reinterpret_cast<void**>(&readerUtf8)));
+            ComPtr<IAppxFile> file;
+            ThrowIfFailed(readerUtf8->GetPayloadFile("files\\payload.bin", &file));
+            ComPtr<IStream> stream;
+            ThrowIfFailed(file->GetStream(&stream));
+            std::uint64_t offset = 0;
+            ULONG bytesRead = 0;
+            do
+            {
+                ThrowIfFailed(stream->Read(buffer.data(), bufferSize, &bytesRead));
+                generator(offset, expected.data(), bytesRead);
+                if (std::memcmp(expected.data(), buffer.data(), bytesRead) != 0) { throw std::runtime_error("files\\payload.bin doesn't match"); }
+                offset += bytesRead;
+            } while (bytesRead != 0);
+            if (offset != size) { throw std::runtime_error("files\\payload.bin has the wrong size"); }
+        });
+        Report("read", parameter, samples);
+        std::cout << "\t" << std::left << std::setw(48) << "" << " best " << std::right << std::setw(10)
+                  << megabytes * 1000 / samples.front() << " MB/s" << std::endl;
+    }
+
+    {
+        std::vector<std::uint8_t> buffer(static_cast<std::size_t>(size));
+        auto samples = Measure(context, [&]()
+        {
+            ComPtr<IAppxPackageReader> reader;
+            OpenPackage(path, &reader);
+            ComPtr<IAppxPackageReaderUtf8> readerUtf8;
+            ThrowIfFailed(reader->QueryInterface(UuidOfImpl<IAppxPackageReaderUtf8>::iid, reinterpret_cast<void**>(&readerUtf8)));
+            ComPtr<IAppxFile> file;
+            ThrowIfFailed(readerUtf8->GetPayloadFile("files\\payload.bin", &file));
+            ComPtr<IMsixFileReader> fileReader;
+            ThrowIfFailed(file->QueryInterface(UuidOfImpl<IMsixFileReader>::iid, reinterpret_cast<void**>(&fileReader)));
+            UINT64 bytesRead = 0;
+            ThrowIfFailed(fileReader->ReadAll(size, buffer.data(), &bytesRead));
+            if (bytesRead != size) { throw std::runtime_error("files\\payload.bin has the wrong size"); }
+        });
+        std::vector<std::uint8_t> expected(static_cast<std::size_t>(size));
+        generator(0, expected.data(), expected.size());
+        if (expected != buffer) { throw std::runtime_error("files\\payload.bin doesn't match"); }
+        Report("read all", std::to_string(size >> 20) + " MB, " + std::to_string(std::thread::hardware_concurrency()) + " threads", samples);
+        std::cout << "\t" << std::left << std::setw(48) << "" << " best " << std::right << std::setw(10)
+                  << megabytes * 1000 / samples.front() << " MB/s" << std::endl;
+    }
+
+    // Reads at random places, each one going back or skipping ahead.
+    const int reads = 64;
+    const ULONG readSize = 4096;
+    Report("random 4 KB reads", std::to_string(reads) + " reads", Measure(context, [&]()
+    {
+        ComPtr<IAppxPackageReader> reader;
+        OpenPackage(path, &reader);
+        ComPtr<IAppxPackageReaderUtf8> readerUtf8;
+        ThrowIfFailed(reader->QueryInterface(UuidOfImpl<IAppxPackageReaderUtf8>::iid, reinterpret_cast<void**>(&readerUtf8)));
+        ComPtr<IAppxFile> file;
+        ThrowIfFailed(readerUtf8->GetPayloadFile("files\\payload.bin", &file));
+        ComPtr<IStream> stream;
+        ThrowIfFailed(file->GetStream(&stream));
+        std::vector<std::uint8_t> buffer(readSize);
+        std::vector<std::uint8_t> expected(readSize);
+        for (int i = 0; i < reads; i++)
+        {
+            LARGE_INTEGER move = { 0 };
+            move.QuadPart = static_cast<LONGLONG>(((i + 1) * 0x9E3779B97F4A7C15ull) % (size - readSize));
+            ThrowIfFailed(stream->Seek(move, STREAM_SEEK_SET, nullptr));
+            ULONG bytesRead = 0;
+            ThrowIfFailed(stream->Read(buffer.data(), readSize, &bytesRead));
+            generator(move.QuadPart, expected.data(), readSize);
+            if ((bytesRead != readSize) || (std::memcmp(expected.data(), buffer.data(), readSize) != 0)) { throw std::runtime_error("files\\payload.bin doesn't match"); }
+        }
+    }));
+}
+
+// Package on storage with high latency, read through a plain IStream that waits for every read against read
+// through an IMsixRangedSource, which coalesces neighbouring reads and keeps several of them in flight. The
+// content of every file is checked, so this also tests reading through a ranged source.
+void BenchmarkRanged(const Context& context)
+{
+    const std::size_t entries = 64;
+    const std::size_t fileSize = 40000;
+    auto path = context.directory + "ranged.appx";
+    {
+        PackageWriter writer(path);
+        for (std::size_t i = 0; i < entries; i++)
+        {
+            writer.AddPayloadFile("files/file" + std::to_string(i) + ".bin", std::vector<std::uint8_t>(fileSize, static_cast<std::uint8_t>(i)));
+        }
+        writer.Close();
+    }
+
+    auto openPackage = [](SimulatedLatencySource& source, bool ranged, IAppxPackageReader** reader)
+    {
+        ComPtr<IAppxFactory> factory;
+        ThrowIfFailed(CoCreateAppxFactoryWithHeap(MyAllocate, MyFree, MSIX_VALIDATION_OPTION_SKIPSIGNATURE, &factory));
+        if (ranged)
+        {
+            ComPtr<IMsixFactoryOverrides> overrides;
+            ThrowIfFailed(factory->QueryInterface(UuidOfImpl<IMsixFactoryOverrides>::iid, reinterpret_cast<void**>(&overrides)));
+            ThrowIfFailed(overrides->SpecifyExtension(MSIX_FACTORY_EXTENSION_RANGED_SOURCE, static_cast<IMsixRangedSource*>(&source)));
+            ThrowIfFailed(factory->CreatePackageReader(nullptr, reader));
+        }
+        else
+        {
+            ComPtr<IStream> stream(new LatencyStream(source));
+            ThrowIfFailed(factory->CreatePackageReader(stream.Get(), reader));
+        }
+    };
+    auto checkContent = [](std::size_t file, std::uint64_t, const std::uint8_t* data, ULONG count)
+    {
+        for (ULONG i = 0; i < count; i++)
+        {
+            if (data[i] != static_cast<std::uint8_t>(file)) { throw std::runtime_error("files\\file" + std::to_string(file) + ".bin doesn't match"); }
+        }
+    };
+
+    // The plain stream does a round trip for every small read the xml parser does, at 50 ms that takes most
+    // of a minute. It is measured only once.
+    Context once = context;
+    once.iterations = 1;
+    for (int latency : { 1, 10, 50 })
+    {
+        auto parameter = std::to_string(latency) + " ms latency";
+        for (auto ranged : { false, true })
+        {
+            std::uint64_t requests = 0;
+            Report(ranged ? "first file, ranged source" : "first file, stream", parameter, Measure(ranged ? context : once, [&]()
+            {
+                SimulatedLatencySource source(path, std::chrono::milliseconds(latency));
+                {
+                    ComPtr<IAppxPackageReader> reader;
+                    openPackage(source, ranged, &reader);
+                    ReadPayloadFile(reader.Get(), "files\\file0.bin");
+                }
+                requests = source.GetRequests();
+            }));
+            std::cout << "\t" << std::left << std::setw(48) << "" << " reads " << std::right << std::setw(10) << requests << std::endl;
+
+            Report(ranged ? "all files, ranged source" : "all files, stream", parameter, Measure(ranged ? context : once, [&]()
+            {
+                SimulatedLatencySource source(path, std::chrono::milliseconds(latency));
+                {
+                    ComPtr<IAppxPackageReader> reader;
+                    openPackage(source, ranged, &reader);
+                    if (ReadPayloadFiles(reader.Get(), checkContent) != entries * fileSize) { throw std::runtime_error("payload has the wrong size"); }
+                }
+                requests = source.GetRequests();
+            }));
+            std::cout << "\t" << std::left << std::setw(48) << "" << " reads " << std::right << std::setw(10) << requests << std::endl;
+        }
+    }
+}
+
+// Reads the compressed payload files of packages the tests use, which hold real content compressed by the
+// packaging tools. 4 KB reads go through the streaming inflate, whole blocks are each decompressed in one go.
+// Both check every block against the block map, which takes a good part of the time.
+void BenchmarkBlocks(const Context& context)
+{
+    for (const char* name : { "CentennialCoffee", "HelloWorld", "NotepadPlusPlus" })
+    {
+        auto path = std::string(MSIX_BENCHMARK_TEST_PACKAGES) + name + ".appx";
+        for (ULONG readSize : { 4096, 65536 })
+        {
+            std::uint64_t total = 0;
+            std::vector<std::uint8_t> buffer(readSize);
+            auto samples = Measure(context, [&]()
+            {
+                ComPtr<IAppxPackageReader> reader;
+                OpenPackage(path, &reader);
+                ComPtr<IAppxFilesEnumerator> files;
+                ThrowIfFailed(reader->GetPayloadFiles(&files));
+                BOOL hasCurrent = FALSE;
+                ThrowIfFailed(files->GetHasCurrent(&hasCurrent));
+                total = 0;
+                while (hasCurrent)
+                {
+                    ComPtr<IAppxFile> file;
+                    ThrowIfFailed(files->GetCurrent(&file));
+                    APPX_COMPRESSION_OPTION compression = APPX_COMPRESSION_OPTION_NONE;
+                    ThrowIfFailed(file->GetCompressionOption(&compression));
+                    if (compression != APPX_COMPRESSION_OPTION_NONE)
+                    {
+                        ComPtr<IStream> stream;
+                        ThrowIfFailed(file->GetStream(&stream));
+                        ULONG bytesRead = 0;
+                        do
+                        {
+                            ThrowIfFailed(stream->Read(buffer.data(), readSize, &bytesRead));
+                            total += bytesRead;
+                        } while (bytesRead != 0);
+                    }
+                    ThrowIfFailed(files->MoveNext(&hasCurrent));
+                }
+            });
+            Report(readSize == 4096 ? "4 KB reads" : "whole blocks", name, samples);
+            std::cout << "\t" << std::left << std::setw(48) << "" << " best " << std::right << std::setw(10)
+                      << static_cast<double>(total) / (1 << 20) * 1000 / samples.front() << " MB/s" << std::endl;
+        }
+    }
+}
+
+// Hashes the 64 KB blocks of the payload files of packages the tests use, the way verifying them against the block
+// map does: one block at a time with the SHA instructions, and 16 blocks at a time side by side in the lanes of
+// the vector registers. Each is measured only if the processor can do it.
+void BenchmarkHash(const Context& context)
+{
+    const std::size_t blockSize = 65536;
+    const std::size_t group = 16;
+    for (const char* name : { "CentennialCoffee", "HelloWorld", "NotepadPlusPlus" })
+    {
+        std::vector<std::uint8_t> content;
+        {
+            ComPtr<IAppxPackageReader> reader;
+            OpenPackage(std::string(MSIX_BENCHMARK_TEST_PACKAGES) + name + ".appx", &reader);
+            ReadPayloadFiles(reader.Get(), [&](std::size_t, std::uint64_t, const std::uint8_t* data, ULONG count)
+            {
+                content.insert(content.end(), data, data + count);
+            });
+        }
+        std::vector<MSIX::SHA256::Buffer> blocks;
+        for (std::size_t offset = 0; offset < content.size(); offset += blockSize)
+        {
+            blocks.push_back({ content.data() + offset, std::min(blockSize, content.size() - offset) });
+        }
+        auto megabytes = static_cast<double>(content.size()) / (1 << 20);
+
+        std::vector<std::vector<std::uint8_t>> single(blocks.size());
+        if (MSIX::SHA256Hardware::IsAvailable())
+        {
+            auto samples = Measure(context, [&]()
+            {
+                MSIX::SHA256Hardware hasher;
+                for (std::size_t i = 0; i < blocks.size(); i++)
+                {
+                    single[i].resize(MSIX::SHA256Hardware::HashSize);
+                    hasher.Update(blocks[i].data, blocks[i].size);
+                    hasher.Final(single[i].data());
+                }
+            });
+            Report("one block at a time", name, samples);
+            std::cout << "\t" << std::left << std::setw(48) << "" << " best " << std::right << std::setw(10)
+                      << megabytes * 1000 / samples.front() << " MB/s" << std::endl;
+        }
+
+        auto lanes = MSIX::SHA256MultiBuffer::GetLanes();
+        if (lanes != 0)
+        {
+            std::vector<std::vector<std::uint8_t>> multiple(blocks.size());
+            auto samples = Measure(context, [&]()
+            {
+                for (std::size_t i = 0; i < blocks.size(); i += group)
+                {
+                    MSIX::SHA256MultiBuffer::ComputeHashes(blocks.data() + i, std::min(group, blocks.size() - i), multiple.data() + i);
+                }
+            });
+            Report(std::to_string(group) + " blocks, " + std::to_string(lanes) + " lanes", name, samples);
+            std::cout << "\t" << std::left << std::setw(48) << "" << " best " << std::right << std::setw(10)
+                      << megabytes * 1000 / samples.front() << " MB/s" << std::endl;
+            if (MSIX::SHA256Hardware::IsAvailable() && single != multiple)
+            {
+                throw std::runtime_error(std::string("hashes of ") + name + " don't match");
+            }
+        }
+    }
+}
+
+// Checking every block of a package with many payload files, compressed and stored, by reading every file through
+// its stream against IMsixPackageVerifier, which shares the blocks of all of them out to a pool of threads.
+void BenchmarkVerify(const Context& context)
+{
+    const std::size_t entries = 64;
+    const std::uint64_t fileSize = 4ull << 20;
+    auto generator = [](std::uint64_t offset, std::uint8_t* buffer, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; i++)
+        {
+            auto position = offset + i;
+            auto hash = (position >> 4) * 0x9E3779B97F4A7C15ull;
+            buffer[i] = ((hash >> 60) & 1) ? static_cast<std::uint8_t>((position * 0xD6E8FEB86659FD93ull) >> 56)
+                                           : static_cast<std::uint8_t>('a' + ((hash >> 56) & 15));
+        }
+    };
+
+    auto path = context.directory + "verify.appx";
+    {
+        PackageWriter writer(path);
+        for (std::size_t i = 0; i < entries; i++)
+        {
+            writer.AddPayloadFile("files/file" + std::to_string(i) + ".bin", fileSize, generator, (i % 2) == 0);
+        }
+        writer.Close();
+    }
+
+    auto megabytes = static_cast<double>((entries * fileSize) >> 20);
+    auto parameter = std::to_string(entries) + " x " + std::to_string(fileSize >> 20) + " MB";
+    auto samples = Measure(context, [&]()
+    {
+        ComPtr<IAppxPackageReader> reader;
+        OpenPackage(path, &reader);
+        if (ReadPayloadFiles(reader.Get()) != entries * fileSize) { throw std::runtime_error("payload files have the wrong size"); }
+    });
+    Report("read every file", parameter, samples);
+    std::cout << "\t" << std::left << std::setw(48) << "" << " best " << std::right << std::setw(10)
+              << megabytes * 1000 / samples.front() << " MB/s" << std::endl;
+
+    for (UINT32 threads : { 1u, std::max(1u, std::thread::hardware_concurrency()) })
+    {
+        samples = Measure(context, [&]()
+        {
+            ComPtr<IAppxPackageReader> reader;
+            OpenPackage(path, &reader);
+            ComPtr<IMsixPackageVerifier> verifier;
+            ThrowIfFailed(reader->QueryInterface(UuidOfImpl<IMsixPackageVerifier>::iid, reinterpret_cast<void**>(&verifier)));
+            ComPtr<IMsixVerificationResults> results;
+            ThrowIfFailed(verifier->VerifyPackage(threads, &results));
+            UINT32 count = 0;
+            ThrowIfFailed(results->GetCount(&count));
+            if (count != entries) { throw std::runtime_error("not every payload file was verified"); }
+            for (UINT32 i = 0; i < count; i++)
+            {
+                HRESULT result = S_OK;
+                ThrowIfFailed(results->GetResult(i, &result));
+                ThrowIfFailed(result);
+            }
+        });
+        Report("verify package", parameter + ", " + std::to_string(threads) + (threads == 1 ? " thread" : " threads"), samples);
+        std::cout << "\t" << std::left << std::setw(48) << "" << " best " << std::right << std::setw(10)
+                  << megabytes * 1000 / samples.front() << " MB/s" << std::endl;
+    }
+}
+
+// Setting up a payload file's stream and reading it at random places as its number of blocks grows. A clone of
+// the stream is set up the same way as the stream the package makes, without parsing the block map, which takes
+// most of the time to open the package. Neither should cost more for a bigger file. Every read is checked
+// against its block.
+void BenchmarkSeek(const Context& context)
+{
+    auto generator = [](std::uint64_t offset, std::uint8_t* buffer, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; i++)
+        {
+            buffer[i] = static_cast<std::uint8_t>(((offset + i) * 0x9E3779B97F4A7C15ull) >> 56);
+        }
+    };
+
+    const int clones = 16;
+    const int reads = 256;
+    const ULONG readSize = 4096;
+    for (std::uint64_t size : { 4ull << 20, 256ull << 20, 2048ull << 20 })
+    {
+        auto path = context.directory + "seek_" + std::to_string(size >> 20) + ".appx";
+        {
+            PackageWriter writer(path);
+            writer.AddPayloadFile("files/payload.bin", size, generator);
+            writer.Close();
+        }
+
+        auto parameter = std::to_string(size >> 16) + " blocks";
+        ComPtr<IAppxPackageReader> reader;
+        Report("open package", parameter, Measure(context, [&]()
+        {
+            OpenPackage(path, &reader);
+        }));
+        ComPtr<IAppxPackageReaderUtf8> readerUtf8;
+        ThrowIfFailed(reader->QueryInterface(UuidOfImpl<IAppxPackageReaderUtf8>::iid, reinterpret_cast<void**>(&readerUtf8)));
+        ComPtr<IAppxFile> file;
+        ThrowIfFailed(readerUtf8->GetPayloadFile("files\\payload.bin", &file));
+        ComPtr<IStream> stream;
+        ThrowIfFailed(file->GetStream(&stream));
+
+        Report("clone stream", parameter + ", " + std::to_string(clones) + " clones", Measure(context, [&]()
+        {
+            for (int i = 0; i < clones; i++)
+            {
+                ComPtr<IStream> clone;
+                ThrowIfFailed(stream->Clone(&clone));
+            }
+        }));
+
+        // A new clone every time, so no block is held from the run before.
+        Report("clone, random 4 KB reads", parameter + ", " + std::to_string(reads) + " reads", Measure(context, [&]()
+        {
+            ComPtr<IStream> clone;
+            ThrowIfFailed(stream->Clone(&clone));
+            std::vector<std::uint8_t> buffer(readSize);
+            std::vector<std::uint8_t> expected(readSize);
+            for (int i = 0; i < reads; i++)
+            {
+                LARGE_INTEGER move = { 0 };
+                move.QuadPart = static_cast<LONGLONG>(((i + 1) * 0x9E3779B97F4A7C15ull) % (size - readSize));
+                ThrowIfFailed(clone->Seek(move, STREAM_SEEK_SET, nullptr));
+                ULONG bytesRead = 0;
+                ThrowIfFailed(clone->Read(buffer.data(), readSize, &bytesRead));
+                generator(move.QuadPart, expected.data(), readSize);
+                if ((bytesRead != readSize) || (std::memcmp(expected.data(), buffer.data(), readSize) != 0)) { throw std::runtime_error("files\\payload.bin doesn't match"); }
+            }
+        }));
+    }
+}
+
+// Small reads at random places in the hot part of a compressed payload file, by several streams at once, each a
+// clone of the file's stream on a thread of its own. Without the block cache every read that moves to another
+// block inflates it again, with the cache that is a copy once the hot blocks are in it.
+void BenchmarkCache(const Context& context)
+{
+    const std::uint64_t size = 64ull << 20;
+    const std::uint64_t hotSize = 4ull << 20;
+    auto generator = [](std::uint64_t offset, std::uint8_t* buffer, std::size_t count)
+    {
+        for (std::size_t i = 0; i < count; i++)
+        {
+            auto position = offset + i;
+            auto hash = (position >> 4) * 0x9E3779B97F4A7C15ull;
+            buffer[i] = ((hash >> 60) & 1) ? static_cast<std::uint8_t>((position * 0xD6E8FEB86659FD93ull) >> 56)
+                                           : static_cast<std::uint8_t>('a' + ((hash >> 56) & 15));
+        }
+    };
+
+    auto path = context.directory + "cache.appx";
+    {
+        PackageWriter writer(path);
+        writer.AddPayloadFile("files/payload.bin", size, generator, true);
+        writer.Close();
+    }
+
+    const std::size_t threadCount = 4;
+    const int reads = 1024;
+    const ULONG readSize = 4096;
+    for (std::uint64_t capacity : { 0ull, 8ull << 20 })
+    {
+        ComPtr<IAppxFactory> factory;
+        ThrowIfFailed(CoCreateAppxFactoryWithHeap(MyAllocate, MyFree, MSIX_VALIDATION_OPTION_SKIPSIGNATURE, &factory));
+        ComPtr<IMsixFactoryOverrides> overrides;
+        ThrowIfFailed(factory->QueryInterface(UuidOfImpl<IMsixFactoryOverrides>::iid, reinterpret_cast<void**>(&overrides)));
+        ComPtr<IMsixBlockCacheSettings> settings(new BlockCacheSettings(capacity));
+        ThrowIfFailed(overrides->SpecifyExtension(MSIX_FACTORY_EXTENSION_BLOCK_CACHE, settings.Get()));
+        ComPtr<IStream> input;
+        ThrowIfFailed(CreateMappedStreamOnFile(const_cast<char*>(path.c_str()), &input));
+        ComPtr<IAppxPackageReader> reader;
+        ThrowIfFailed(factory->CreatePackageReader(input.Get(), &reader));
+        ComPtr<IAppxPackageReaderUtf8> readerUtf8;
+        ThrowIfFailed(reader->QueryInterface(UuidOfImpl<IAppxPackageReaderUtf8>::iid, reinterpret_cast<void**>(&readerUtf8)));
+        ComPtr<IAppxFile> file;
+        ThrowIfFailed(readerUtf8->GetPayloadFile("files\\payload.bin", &file));
+        ComPtr<IStream> stream;
+        ThrowIfFailed(file->GetStream(&stream));
+
+        auto parameter = (capacity == 0) ? std::string("no cache") : std::to_string(capacity >> 20) + " MB cache";
+        Report("random 4 KB reads", parameter + ", " + std::to_string(threadCount) + " x " + std::to_string(reads), Measure(context, [&]()
+        {
+            std::vector<std::thread> threads;
+            std::vector<std::string> errors(threadCount);
+            for (std::size_t t = 0; t < threadCount; t++)
+            {
+                threads.emplace_back([&, t]()
+                {
+                    try
+                    {
+                        ComPtr<IStream> clone;
+                        ThrowIfFailed(stream->Clone(&clone));
+                        std::vector<std::uint8_t> buffer(readSize);
+                        std::vector<std::uint8_t> expected(readSize);
+                        for (int i = 0; i < reads; i++)
+                        {
+                            LARGE_INTEGER move = { 0 };
+                            move.QuadPart = static_cast<LONGLONG>(((t * reads + i + 1) * 0x9E3779B97F4A7C15ull) % (hotSize - readSize));
+                            ThrowIfFailed(clone->Seek(move, STREAM_SEEK_SET, nullptr));
+                            ULONG bytesRead = 0;
+                            ThrowIfFailed(clone->Read(buffer.data(), readSize, &bytesRead));
+                            generator(move.QuadPart, expected.data(), readSize);
+                            if ((bytesRead != readSize) || (std::memcmp(expected.data(), buffer.data(), readSize) != 0)) { throw std::runtime_error("files\\payload.bin doesn't match"); }
+                        }
+                    }
+                    catch (const std::exception& e)
+                    {
+                        errors[t] = e.what();
+                    }
+                });
+            }
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+            for (const auto& error : errors)
+            {
+                if (!error.empty()) { throw std::runtime_error(error); }
+            }
+        }));
+
+        ComPtr<IMsixBlockCacheStatistics> statistics;
+        ThrowIfFailed(reader->QueryInterface(UuidOfImpl<IMsixBlockCacheStatistics>::iid, reinterpret_cast<void**>(&statistics)));
+        UINT64 hits = 0;
+        UINT64 misses = 0;
+        ThrowIfFailed(statistics->GetBlockCacheStatistics(&hits, &misses));
+        std::cout << "\t" << std::left << std::setw(48) << "" << " hits " << std::right << std::setw(10) << hits
+                  << "   misses " << std::setw(10) << misses << std::endl;
+    }
+}
+
+// Opens signed packages the tests use, checking their signature, with and without a verification cache. The first
+// open with the cache checks the signature and keeps what it found, the ones measured find it there.
+void BenchmarkSignature(const Context& context)
+{
+    auto directory = context.directory.empty() ? std::string(".") : context.directory;
+    std::vector<BYTE> key(32);
+    for (std::size_t i = 0; i < key.size(); i++) { key[i] = static_cast<BYTE>(i * 37 + 11); }
+
+    for (const char* name : { "CentennialCoffee", "NotepadPlusPlus" })
+    {
+        auto path = std::string(MSIX_BENCHMARK_TEST_PACKAGES) + name + ".appx";
+        auto open = [&](IMsixVerificationCacheSettings* settings)
+        {
+            ComPtr<IAppxFactory> factory;
+            ThrowIfFailed(CoCreateAppxFactoryWithHeap(MyAllocate, MyFree, MSIX_VALIDATION_OPTION_ALLOWSIGNATUREORIGINUNKNOWN, &factory));
+            if (settings != nullptr)
+            {
+                ComPtr<IMsixFactoryOverrides> overrides;
+                ThrowIfFailed(factory->QueryInterface(UuidOfImpl<IMsixFactoryOverrides>::iid, reinterpret_cast<void**>(&overrides)));
+                ThrowIfFailed(overrides->SpecifyExtension(MSIX_FACTORY_EXTENSION_VERIFICATION_CACHE, settings));
+            }
+            ComPtr<IStream> input;
+            ThrowIfFailed(CreateMappedStreamOnFile(const_cast<char*>(path.c_str()), &input));
+            ComPtr<IAppxPackageReader> reader;
+            ThrowIfFailed(factory->CreatePackageReader(input.Get(), &reader));
+        };
+
+        Report("open package", std::string(name) + ", no cache", Measure(context, [&]() { open(nullptr); }));
+
+        ComPtr<IMsixVerificationCacheSettings> settings(new VerificationCacheSettings(directory, key));
+        open(settings.Get());
+        Report("open package", std::string(name) + ", cached", Measure(context, [&]() { open(settings.Get()); }));
+    }
+}
+
+// Opens signed packages the tests use, with the signature skipped and with it checked along with its digests of
+// every byte before it and of the central directory, then checks every block of them too.
+void BenchmarkDigests(const Context& context)
+{
+    for (const char* name : { "CentennialCoffee", "NotepadPlusPlus" })
+    {
+        auto path = std::string(MSIX_BENCHMARK_TEST_PACKAGES) + name + ".appx";
+        for (bool signature : { false, true })
+        {
+            auto options = signature ? MSIX_VALIDATION_OPTION_ALLOWSIGNATUREORIGINUNKNOWN : MSIX_VALIDATION_OPTION_SKIPSIGNATURE;
+            auto parameter = std::string(name) + (signature ? ", signature" : ", no signature");
+            Report("open package", parameter, Measure(context, [&]()
+            {
+                ComPtr<IAppxPackageReader> reader;
+                OpenPackage(path, &reader, options);
+            }));
+            Report("open and verify package", parameter, Measure(context, [&]()
+            {
+                ComPtr<IAppxPackageReader> reader;
+                OpenPackage(path, &reader, options);
+                ComPtr<IMsixPackageVerifier> verifier;
+                ThrowIfFailed(reader->QueryInterface(UuidOfImpl<IMsixPackageVerifier>::iid, reinterpret_cast<void**>(&verifier)));
+                ComPtr<IMsixVerificationResults> results;
+                ThrowIfFailed(verifier->VerifyPackage(0, &results));
+                UINT32 count = 0;
+                ThrowIfFailed(results->GetCount(&count));
+                for (UINT32 i = 0; i < count; i++)
+                {
+                    HRESULT result = S_OK;
+                    ThrowIfFailed(results->GetResult(i, &result));
+                    ThrowIfFailed(result);
+                }
+            }));
+        }
+    }
+}
+
+int RunBenchmarksInternal(char* name, char* directory, int iterations)
+{
+    Context context;
+    context.directory = (directory == nullptr) ? "" : std::string(directory) + "/";
+    context.iterations = std::max(iterations, 1);
+
+    std::map<std::string, std::function<void(const Context&)>> benchmarks =
+    {
+        { "blocks", BenchmarkBlocks },
+        { "cache", BenchmarkCache },
+        { "crc", BenchmarkCrc },
+        { "digests", BenchmarkDigests },
+        { "hash", BenchmarkHash },
+        { "inflate", BenchmarkInflate },
+        { "lookup", BenchmarkLookup },
+        { "open", BenchmarkOpen },
+        { "order", BenchmarkOrder },
+        { "ranged", BenchmarkRanged },
+        { "seek", BenchmarkSeek },
+        { "signature", BenchmarkSignature },
+        { "verify", BenchmarkVerify },
+        { "zip64", BenchmarkZip64 },
+    };
+
+    int result = 0;
+    for (const auto& benchmark : benchmarks)
+    {
+        if (name != nullptr && benchmark.first != name)
+        {
+            continue;
+        }
+        std::cout << "Benchmark: " << benchmark.first << std::endl;
+        try
+        {
+            benchmark.second(context);
+        }
+        catch(const std::exception& e)
+        {
+            std::cout << "ERROR: " << e.what() << std::endl;
+            char* logs = nullptr;
+            if (SUCCEEDED(GetLogTextUTF8(MyAllocate, &logs)) && logs != nullptr)
+            {
+                std::cout << "LOG:" << std::endl << logs << std::endl;
+                MyFree(logs);
+            }
+            result = -1;
+        }
+    }
+    return result;
+}
+
+} // MsixBenchmark
+
+int RunBenchmarks(char* name, char* directory, int iterations)
+{
+    return MsixBenchmark::RunBenchmarksInternal(name, directory, iterations);
+}
@@ -0,0 +1,7 @@
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+#pragma once
+
+// Runs the benchmark with the given name, or all of them if name is null. Synthetic packages are
+// written to directory. Returns 0 on success.
+int RunBenchmarks(char* name, char* directory, int iterations);
@@ -0,0 +1,503 @@
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+
+// Writes synthetic unsigned packages used as input for the benchmarks. The packages contain a
+// minimal manifest, a valid AppxBlockMap.xml and [Content_Types].xml, so they can be opened with
+// MSIX_VALIDATION_OPTION_SKIPSIGNATURE.
+namespace MsixBenchmark {
+
+class Sha256
+{
+public:
+    static std::vector<std::uint8_t> Compute(const std::uint8_t* data, std::size_t size)
+    {
+        std::uint32_t state[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+        std::size_t full = size / 64;
+        for (std::size_t i = 0; i < full; i++)
+        {
+            Transform(state, data + (i * 64));
+        }
+        std::uint8_t tail[128] = { 0 };
+        std::size_t remaining = size - (full * 64);
+        std::memcpy(tail, data + (full * 64), remaining);
+        tail[remaining] = 0x80;
+        std::size_t tailSize = (remaining < 56) ? 64 : 128;
+        std::uint64_t bits = static_cast<std::uint64_t>(size) * 8;
+        for (int i = 0; i < 8; i++)
+        {
+            tail[tailSize - 1 - i] = static_cast<std::uint8_t>(bits >> (i * 8));
+        }
+        for (std::size_t i = 0; i < tailSize; i += 64)
+        {
+            Transform(state, tail + i);
+        }
+        std::vector<std::uint8_t> result(32);
+        for (int i = 0; i < 8; i++)
+        {
+            result[i * 4]     = static_cast<std::uint8_t>(state[i] >> 24);
+            result[i * 4 + 1] = static_cast<std::uint8_t>(state[i] >> 16);
+            result[i * 4 + 2] = static_cast<std::uint8_t>(state[i] >> 8);
+            result[i * 4 + 3] = static_cast<std::uint8_t>(state[i]);
+        }
+        return result;
+    }
+
+private:
+    static inline std::uint32_t Rotr(std::uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    static void Transform(std::uint32_t* state, const std::uint8_t* block)
+    {
+        static const std::uint32_t k[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2 };
+
+        std::uint32_t w[64];
+        for (int i = 0; i < 16; i++)
+        {
+            w[i] = (static_cast<std::uint32_t>(block[i * 4]) << 24) | (static_cast<std::uint32_t>(block[i * 4 + 1]) << 16) |
+                   (static_cast<std::uint32_t>(block[i * 4 + 2]) << 8) | static_cast<std::uint32_t>(block[i * 4 + 3]);
+        }
+        for (int i = 16; i < 64; i++)
+        {
+            std::uint32_t s0 = Rotr(w[i - 15], 7) ^ Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            std::uint32_t s1 = Rotr(w[i - 2], 17) ^ Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        std::uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; i++)
+        {
+            std::uint32_t t1 = h + (Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+            std::uint32_t t2 = (Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+};
+
+inline std::string Base64Encode(const std::vector<std::uint8_t>& data)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string result;
+    for (std::size_t i = 0; i < data.size(); i += 3)
+    {
+        std::uint32_t value = static_cast<std::uint32_t>(data[i]) << 16;
+        if (i + 1 < data.size()) { value |= static_cast<std::uint32_t>(data[i + 1]) << 8; }
+        if (i + 2 < data.size()) { value |= static_cast<std::uint32_t>(data[i + 2]); }
+        result.push_back(alphabet[(value >> 18) & 0x3F]);
+        result.push_back(alphabet[(value >> 12) & 0x3F]);
+        result.push_back((i + 1 < data.size()) ? alphabet[(value >> 6) & 0x3F] : '=');
+        result.push_back((i + 2 < data.size()) ? alphabet[value & 0x3F] : '=');
+    }
+    return result;
+}
+
+inline std::uint32_t Crc32(std::uint32_t crc, const std::uint8_t* data, std::size_t size)
+{
+    static std::uint32_t table[256] = { 0 };
+    if (table[1] == 0)
+    {
+        for (std::uint32_t i = 0; i < 256; i++)
+        {
+            std::uint32_t c = i;
+            for (int j = 0; j < 8; j++) { c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1); }
+            table[i] = c;
+        }
+    }
+    crc = ~crc;
+    for (std::size_t i = 0; i < size; i++)
+    {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// Compresses a block on its own, the way makeappx does with Z_FULL_FLUSH: matches don't reach into
+// previous blocks and the block ends on a byte boundary with an empty stored block. Uses greedy LZ77
+// with the fixed Huffman codes, which is plenty to give inflate real work.
+class FixedHuffmanDeflater
+{
+public:
+    static std::vector<std::uint8_t> Compress(const std::uint8_t* data, std::size_t size)
+    {
+        FixedHuffmanDeflater deflater;
+        deflater.WriteBits(0, 1);   // BFINAL
+        deflater.WriteBits(1, 2);   // fixed Huffman codes
+        std::vector<std::int32_t> head(HashSize, -1);
+        std::vector<std::int32_t> previous(size, -1);
+        std::size_t position = 0;
+        while (position < size)
+        {
+            std::size_t bestLength = 0;
+            std::size_t bestDistance = 0;
+            if (position + 3 <= size)
+            {
+                auto hash = Hash(data + position);
+                int chain = 0;
+                for (auto candidate = head[hash]; (candidate >= 0) && (position - candidate <= WindowSize) && (chain < MaxChain);
+                     candidate = previous[candidate], chain++)
+                {
+                    std::size_t length = 0;
+                    std::size_t maxLength = std::min<std::size_t>(MaxMatch, size - position);
+                    while ((length < maxLength) && (data[candidate + length] == data[position + length])) { length++; }
+                    if (length > bestLength)
+                    {
+                        bestLength = length;
+                        bestDistance = position - candidate;
+                        if (length == maxLength) { break; }
+                    }
+                }
+            }
+            std::size_t advance = 1;
+            if (bestLength >= 3)
+            {
+                deflater.WriteMatch(bestLength, bestDistance);
+                advance = bestLength;
+            }
+            else
+            {
+                deflater.WriteSymbol(data[position]);
+            }
+            for (std::size_t end = position + advance; position < end; position++)
+            {
+                if (position + 3 <= size)
+                {
+                    auto hash = Hash(data + position);
+                    previous[position] = head[hash];
+                    head[hash] = static_cast<std::int32_t>(position);
+                }
+            }
+        }
+        deflater.WriteSymbol(256);  // end of block
+        // Empty stored block, what zlib writes for a flush.
+        deflater.WriteBits(0, 3);
+        deflater.FlushBits();
+        deflater.m_output.insert(deflater.m_output.end(), { 0x00, 0x00, 0xFF, 0xFF });
+        return deflater.m_output;
+    }
+
+    // Final empty block with fixed Huffman codes. Goes after the last block.
+    static std::vector<std::uint8_t> End() { return { 0x03, 0x00 }; }
+
+private:
+    enum : std::size_t { HashSize = 1 << 15, WindowSize = 32768, MaxMatch = 258 };
+    enum : int { MaxChain = 16 };
+
+    static std::size_t Hash(const std::uint8_t* data)
+    {
+        return ((static_cast<std::size_t>(data[0]) << 10) ^ (static_cast<std::size_t>(data[1]) << 5) ^ data[2]) & (HashSize - 1);
+    }
+
+    void WriteBits(std::uint32_t value, int count)
+    {
+        m_bits |= static_cast<std::uint64_t>(value) << m_bitCount;
+        m_bitCount += count;
+        while (m_bitCount >= 8)
+        {
+            m_output.push_back(static_cast<std::uint8_t>(m_bits));
+            m_bits >>= 8;
+            m_bitCount -= 8;
+        }
+    }
+
+    void FlushBits()
+    {
+        if (m_bitCount > 0) { WriteBits(0, 8 - m_bitCount); }
+    }
+
+    // Huffman codes are written starting from their most significant bit.
+    void WriteCode(std::uint32_t code, int length)
+    {
+        std::uint32_t reversed = 0;
+        for (int i = 0; i < length; i++) { reversed |= ((code >> i) & 1) << (length - 1 - i); }
+        WriteBits(reversed, length);
+    }
+
+    void WriteSymbol(std::uint32_t symbol)
+    {
+        if (symbol < 144)      { WriteCode(0x30 + symbol, 8); }
+        else if (symbol < 256) { WriteCode(0x190 + symbol - 144, 9); }
+        else if (symbol < 280) { WriteCode(symbol - 256, 7); }
+        else                   { WriteCode(0xC0 + symbol - 280, 8); }
+    }
+
+    void WriteMatch(std::size_t length, std::size_t distance)
+    {
+        static const std::uint16_t lengthBase[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        static const std::uint8_t lengthExtra[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        static const std::uint16_t distanceBase[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+        static const std::uint8_t distanceExtra[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+        std::size_t code = 28;
+        while (lengthBase[code] > length) { code--; }
+        WriteSymbol(static_cast<std::uint32_t>(257 + code));
+        WriteBits(static_cast<std::uint32_t>(length - lengthBase[code]), lengthExtra[code]);
+
+        code = 29;
+        while (distanceBase[code] > distance) { code--; }
+        WriteCode(static_cast<std::uint32_t>(code), 5);
+        WriteBits(static_cast<std::uint32_t>(distance - distanceBase[code]), distanceExtra[code]);
+    }
+
+    std::vector<std::uint8_t> m_output;
+    std::uint64_t m_bits = 0;
+    int m_bitCount = 0;
+};
+
+class PackageWriter
+{
+public:
+    enum : std::size_t { BlockSize = 65536 };
+
+    PackageWriter(const std::string& path) : m_file(path, std::ios::binary | std::ios::trunc) {}
+
+    // Fills count bytes of a payload file starting at offset.
+    typedef std::function<void(std::uint64_t offset, std::uint8_t* buffer, std::size_t count)> Generator;
+
+    // Adds a payload file stored without compression. name uses '/' as separator.
+    void AddPayloadFile(const std::string& name, const std::vector<std::uint8_t>& content)
+    {
+        AddPayloadFile(name, content.size(), [&](std::uint64_t offset, std::uint8_t* buffer, std::size_t count)
+        {
+            std::memcpy(buffer, content.data() + offset, count);
+        });
+    }
+
+    // Same, but the content is generated a block at a time so files can be bigger than memory. If compress
+    // is set, the file is deflated a block at a time, as makeappx does.
+    void AddPayloadFile(const std::string& name, std::uint64_t size, const Generator& generator, bool compress = false)
+    {
+        std::string blockMapName = name;
+        std::replace(blockMapName.begin(), blockMapName.end(), '/', '\\');
+        std::string blocks;
+        std::uint64_t lfhSize = AddEntry(name, size, generator, [&](const std::uint8_t* block, std::size_t count, std::size_t compressedCount)
+        {
+            blocks += "<Block Hash=\"" + Base64Encode(Sha256::Compute(block, count)) + "\"" +
+                (compress ? " Size=\"" + std::to_string(compressedCount) + "\"" : std::string()) + "/>";
+        }, compress);
+        m_blockMap += "<File Name=\"" + blockMapName + "\" Size=\"" + std::to_string(size) +
+            "\" LfhSize=\"" + std::to_string(lfhSize) + "\">" + blocks + "</File>";
+    }
+
+    // Writes the footprint files and the central directory.
+    void Close()
+    {
+        std::string manifest =
+            "<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+            "<Package xmlns=\"http://schemas.microsoft.com/appx/manifest/foundation/windows10\">"
+            "<Identity Name=\"MsixSdk.Benchmark\" Publisher=\"CN=MsixSdkBenchmark\" Version=\"1.0.0.0\" ProcessorArchitecture=\"x64\"/>"
+            "<Properties><DisplayName>Benchmark</DisplayName><PublisherDisplayName>Benchmark</PublisherDisplayName><Logo>logo.png</Logo></Properties>"
+            "<Dependencies><TargetDeviceFamily Name=\"Windows.Desktop\" MinVersion=\"10.0.0.0\" MaxVersionTested=\"10.0.0.0\"/></Dependencies>"
+            "<Resources><Resource Language=\"en-us\"/></Resources>"
+            "</Package>";
+        AddPayloadFile("AppxManifest.xml", std::vector<std::uint8_t>(manifest.begin(), manifest.end()));
+
+        std::string blockMap =
+            "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>"
+            "<BlockMap xmlns=\"http://schemas.microsoft.com/appx/2010/blockmap\" HashMethod=\"http://www.w3.org/2001/04/xmlenc#sha256\">" +
+            m_blockMap + "</BlockMap>";
+        AddEntry("AppxBlockMap.xml", std::vector<std::uint8_t>(blockMap.begin(), blockMap.end()));
+
+        std::string contentTypes =
+            "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+            "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
+            "<Default Extension=\"bin\" ContentType=\"application/octet-stream\"/>"
+            "<Override PartName=\"/AppxManifest.xml\" ContentType=\"application/vnd.ms-appx.manifest+xml\"/>"
+            "<Override PartName=\"/AppxBlockMap.xml\" ContentType=\"application/vnd.ms-appx.blockmap+xml\"/>"
+            "</Types>";
+        AddEntry("[Content_Types].xml", std::vector<std::uint8_t>(contentTypes.begin(), contentTypes.end()));
+
+        std::uint64_t startOfCentralDirectory = m_offset;
+        for (const auto& entry : m_entries)
+        {
+            Write<std::uint32_t>(0x02014b50);
+            Write<std::uint16_t>(45);  // version made by
+            Write<std::uint16_t>(45);  // version needed to extract
+            Write<std::uint16_t>(0);   // general purpose bit flag
+            Write<std::uint16_t>(entry.compressed ? 8 : 0);   // compression method
+            Write<std::uint16_t>(0x6B60);
+            Write<std::uint16_t>(0xA2B1);
+            Write<std::uint32_t>(entry.crc);
+            Write<std::uint32_t>(0xFFFFFFFF);
+            Write<std::uint32_t>(0xFFFFFFFF);
+            Write<std::uint16_t>(static_cast<std::uint16_t>(entry.name.size()));
+            Write<std::uint16_t>(28);  // extra field length
+            Write<std::uint16_t>(0);   // file comment length
+            Write<std::uint16_t>(0);   // disk number start
+            Write<std::uint16_t>(0);   // internal file attributes
+            Write<std::uint32_t>(0);   // external file attributes
+            Write<std::uint32_t>(0xFFFFFFFF);
+            WriteBytes(reinterpret_cast<const std::uint8_t*>(entry.name.data()), entry.name.size());
+            // zip64 extended information
+            Write<std::uint16_t>(0x0001);
+            Write<std::uint16_t>(24);
+            Write<std::uint64_t>(entry.size);
+            Write<std::uint64_t>(entry.compressedSize);
+            Write<std::uint64_t>(entry.offset);
+        }
+        std::uint64_t sizeOfCentralDirectory = m_offset - startOfCentralDirectory;
+
+        // Always write the zip64 end of central directory records, same as the defaults of EndCentralDirectoryRecord.
+        std::uint64_t startOfZip64EndOfCD = m_offset;
+        Write<std::uint32_t>(0x06064b50);
+        Write<std::uint64_t>(44);
+        Write<std::uint16_t>(45);
+        Write<std::uint16_t>(45);
+        Write<std::uint32_t>(0);
+        Write<std::uint32_t>(0);
+        Write<std::uint64_t>(m_entries.size());
+        Write<std::uint64_t>(m_entries.size());
+        Write<std::uint64_t>(sizeOfCentralDirectory);
+        Write<std::uint64_t>(startOfCentralDirectory);
+
+        Write<std::uint32_t>(0x07064b50);
+        Write<std::uint32_t>(0);
+        Write<std::uint64_t>(startOfZip64EndOfCD);
+        Write<std::uint32_t>(1);
+
+        Write<std::uint32_t>(0x06054b50);
+        Write<std::uint16_t>(0xFFFF);
+        Write<std::uint16_t>(0xFFFF);
+        Write<std::uint16_t>(0xFFFF);
+        Write<std::uint16_t>(0xFFFF);
+        Write<std::uint32_t>(0xFFFFFFFF);
+        Write<std::uint32_t>(0xFFFFFFFF);
+        Write<std::uint16_t>(0);
+        m_file.close();
+    }
+
+protected:
+    struct Entry
+    {
+        std::string   name;
+        std::uint64_t offset;
+        std::uint64_t size;
+        std::uint64_t compressedSize;
+        std::uint32_t crc;
+        bool          compressed;
+    };
+
+    void AddEntry(const std::string& name, const std::vector<std::uint8_t>& content)
+    {
+        AddEntry(name, content.size(), [&](std::uint64_t offset, std::uint8_t* buffer, std::size_t count)
+        {
+            std::memcpy(buffer, content.data() + offset, count);
+        }, [](const std::uint8_t*, std::size_t, std::size_t) {});
+    }
+
+    // Writes the entry a block at a time, calling onBlock for each one with its size in the archive. Returns
+    // the size of the local file header. Entries of 4 GB and more get a zip64 local file header.
+    std::uint64_t AddEntry(const std::string& name, std::uint64_t size, const Generator& generator,
+        const std::function<void(const std::uint8_t*, std::size_t, std::size_t)>& onBlock, bool compress = false)
+    {
+        Entry entry = { name, m_offset, size, size, 0, compress };
+        bool isZip64 = (size >= 0xFFFFFFFF);
+        Write<std::uint32_t>(0x04034b50);
+        Write<std::uint16_t>(isZip64 ? 45 : 20);  // version needed to extract
+        Write<std::uint16_t>(0);   // general purpose bit flag
+        Write<std::uint16_t>(compress ? 8 : 0);   // compression method
+        Write<std::uint16_t>(0x6B60);
+        Write<std::uint16_t>(0xA2B1);
+        auto crcPosition = m_file.tellp();
+        Write<std::uint32_t>(0);   // crc, filled in once the content is written
+        Write<std::uint32_t>(isZip64 ? 0xFFFFFFFF : static_cast<std::uint32_t>(size));  // compressed size, same
+        Write<std::uint32_t>(isZip64 ? 0xFFFFFFFF : static_cast<std::uint32_t>(size));
+        Write<std::uint16_t>(static_cast<std::uint16_t>(name.size()));
+        Write<std::uint16_t>(isZip64 ? 20 : 0);   // extra field length
+        WriteBytes(reinterpret_cast<const std::uint8_t*>(name.data()), name.size());
+        auto zip64CompressedSizePosition = m_file.tellp() + std::streamoff(12);
+        if (isZip64)
+        {
+            Write<std::uint16_t>(0x0001);
+            Write<std::uint16_t>(16);
+            Write<std::uint64_t>(size);
+            Write<std::uint64_t>(size);
+        }
+        std::uint64_t lfhSize = m_offset - entry.offset;
+
+        std::vector<std::uint8_t> block(BlockSize);
+        std::uint64_t dataStart = m_offset;
+        for (std::uint64_t offset = 0; offset < size; offset += BlockSize)
+        {
+            auto count = static_cast<std::size_t>(std::min(static_cast<std::uint64_t>(BlockSize), size - offset));
+            generator(offset, block.data(), count);
+            entry.crc = Crc32(entry.crc, block.data(), count);
+            if (compress)
+            {
+                auto compressed = FixedHuffmanDeflater::Compress(block.data(), count);
+                onBlock(block.data(), count, compressed.size());
+                WriteBytes(compressed.data(), compressed.size());
+            }
+            else
+            {
+                onBlock(block.data(), count, count);
+                WriteBytes(block.data(), count);
+            }
+        }
+        if (compress)
+        {
+            auto end = FixedHuffmanDeflater::End();
+            WriteBytes(end.data(), end.size());
+            entry.compressedSize = m_offset - dataStart;
+        }
+
+        auto endPosition = m_file.tellp();
+        m_file.seekp(crcPosition);
+        for (std::size_t i = 0; i < 4; i++)
+        {
+            m_file.put(static_cast<char>(entry.crc >> (i * 8)));
+        }
+        if (compress)
+        {
+            if (isZip64) { m_file.seekp(zip64CompressedSizePosition); }
+            for (std::size_t i = 0; i < (isZip64 ? 8 : 4); i++)
+            {
+                m_file.put(static_cast<char>(entry.compressedSize >> (i * 8)));
+            }
+        }
+        m_file.seekp(endPosition);
+        m_entries.push_back(entry);
+        return lfhSize;
+    }
+
+    template<typename T>
+    void Write(T value)
+    {
+        std::uint8_t bytes[sizeof(T)];
+        for (std::size_t i = 0; i < sizeof(T); i++)
+        {
+            bytes[i] = static_cast<std::uint8_t>(static_cast<std::uint64_t>(value) >> (i * 8));
+        }
+        WriteBytes(bytes, sizeof(T));
+    }
+
+    void WriteBytes(const std::uint8_t* data, std::size_t size)
+    {
+        m_file.write(reinterpret_cast<const char*>(data), size);
+        m_offset += size;
+    }
+
+    std::ofstream      m_file;
+    std::uint64_t      m_offset = 0;
+    std::vector<Entry> m_entries;
+    std::string        m_blockMap;
+};
+
+} // MsixBenchmark
@@ -0,0 +1,214 @@
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+#pragma once
+
+#include "MSIXWindows.hpp"
+#include "AppxPackaging.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace MsixBenchmark {
+
+// IMsixRangedSource over a package held in memory that completes every read a fixed time after it was
+// asked for, like block storage far away. Up to concurrency reads are served at the same time. The
+// source is owned by whoever creates it; its reference count is only there to satisfy COM, and the
+// destructor waits for the reads in flight.
+class SimulatedLatencySource final : public IMsixRangedSource
+{
+public:
+    SimulatedLatencySource(const std::string& path, std::chrono::microseconds latency, std::size_t concurrency = 16) :
+        m_latency(latency)
+    {
+        std::ifstream file(path, std::ios::binary);
+        m_content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        for (std::size_t i = 0; i < concurrency; i++)
+        {
+            m_workers.emplace_back([this]() { Work(); });
+        }
+    }
+
+    ~SimulatedLatencySource()
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_changed.wait(lock, [this]() { return m_queue.empty() && (m_busy == 0); });
+            m_stop = true;
+        }
+        m_changed.notify_all();
+        for (auto& worker : m_workers) { worker.join(); }
+    }
+
+    // Number of reads asked for, ranged or blocking.
+    std::uint64_t GetRequests() const { return m_requests; }
+
+    // Reads like a plain IStream over the same storage would, waiting for each read.
+    void ReadBlocking(std::uint64_t offset, void* buffer, std::size_t size)
+    {
+        m_requests++;
+        std::this_thread::sleep_for(m_latency);
+        std::memcpy(buffer, m_content.data() + offset, size);
+    }
+
+    // IUnknown
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) noexcept override
+    {
+        if (ppvObject == nullptr) { return E_INVALIDARG; }
+        *ppvObject = nullptr;
+        if (riid == UuidOfImpl<IUnknown>::iid || riid == UuidOfImpl<IMsixRangedSource>::iid)
+        {
+            AddRef();
+            *ppvObject = static_cast<IMsixRangedSource*>(this);
+            return S_OK;
+        }
+        return E_NOINTERFACE;
+    }
+    ULONG STDMETHODCALLTYPE AddRef() noexcept override { return ++m_refs; }
+    ULONG STDMETHODCALLTYPE Release() noexcept override { return --m_refs; }
+
+    // IMsixRangedSource
+    HRESULT STDMETHODCALLTYPE GetSize(UINT64* size) noexcept override
+    {
+        if (size == nullptr) { return E_INVALIDARG; }
+        *size = m_content.size();
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE ReadRange(UINT64 offset, UINT32 size, BYTE* buffer, IMsixRangedReadCallback* callback) noexcept override
+    {
+        if (buffer == nullptr || callback == nullptr || offset > m_content.size()) { return E_INVALIDARG; }
+        m_requests++;
+        callback->AddRef();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back({ std::chrono::steady_clock::now() + m_latency, offset, size, buffer, callback });
+        }
+        m_changed.notify_all();
+        return S_OK;
+    }
+
+private:
+    struct PendingRead
+    {
+        std::chrono::steady_clock::time_point due;
+        std::uint64_t offset;
+        std::uint32_t size;
+        BYTE* buffer;
+        IMsixRangedReadCallback* callback;
+    };
+
+    void Work()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true)
+        {
+            m_changed.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+            if (m_queue.empty()) { return; }
+            auto read = m_queue.front();
+            m_queue.pop_front();
+            m_busy++;
+            lock.unlock();
+
+            std::this_thread::sleep_until(read.due);
+            auto count = static_cast<std::uint32_t>(std::min<std::uint64_t>(read.size, m_content.size() - read.offset));
+            std::memcpy(read.buffer, m_content.data() + read.offset, count);
+            read.callback->ReadCompleted(S_OK, count);
+            read.callback->Release();
+
+            lock.lock();
+            m_busy--;
+            m_changed.notify_all();
+        }
+    }
+
+    std::vector<std::uint8_t> m_content;
+    std::chrono::microseconds m_latency;
+    std::atomic<ULONG> m_refs { 0 };
+    std::atomic<std::uint64_t> m_requests { 0 };
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::deque<PendingRead> m_queue;
+    std::size_t m_busy = 0;
+    bool m_stop = false;
+    std::vector<std::thread> m_workers;
+};
+
+// IStream that reads a SimulatedLatencySource with blocking reads, one round trip per Read.
+class LatencyStream final : public IStream
+{
+public:
+    LatencyStream(SimulatedLatencySource& source) : m_source(source)
+    {
+        UINT64 size = 0;
+        source.GetSize(&size);
+        m_size = size;
+    }
+
+    // IUnknown
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) noexcept override
+    {
+        if (ppvObject == nullptr) { return E_INVALIDARG; }
+        *ppvObject = nullptr;
+        if (riid == UuidOfImpl<IUnknown>::iid || riid == UuidOfImpl<IStream>::iid)
+        {
+            AddRef();
+            *ppvObject = static_cast<IStream*>(this);
+            return S_OK;
+        }
+        return E_NOINTERFACE;
+    }
+    ULONG STDMETHODCALLTYPE AddRef() noexcept override { return ++m_refs; }
+    ULONG STDMETHODCALLTYPE Release() noexcept override
+    {
+        auto refs = --m_refs;
+        if (refs == 0) { delete this; }
+        return refs;
+    }
+
+    // IStream
+    HRESULT STDMETHODCALLTYPE Read(void* buffer, ULONG countBytes, ULONG* bytesRead) noexcept override
+    {
+        auto count = static_cast<ULONG>(std::min<std::uint64_t>(countBytes, m_size - std::min(m_position, m_size)));
+        if (count != 0) { m_source.ReadBlocking(m_position, buffer, count); }
+        m_position += count;
+        if (bytesRead) { *bytesRead = count; }
+        return S_OK;
+    }
+    HRESULT STDMETHODCALLTYPE Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER* newPosition) noexcept override
+    {
+        std::int64_t base = (origin == SEEK_SET) ? 0 : (origin == SEEK_CUR) ? static_cast<std::int64_t>(m_position) : static_cast<std::int64_t>(m_size);
+        if (base + move.QuadPart < 0) { return E_INVALIDARG; }
+        m_position = static_cast<std::uint64_t>(base + move.QuadPart);
+        if (newPosition) { newPosition->QuadPart = m_position; }
+        return S_OK;
+    }
+    HRESULT STDMETHODCALLTYPE Write(const void*, ULONG, ULONG*) noexcept override { return E_NOTIMPL; }
+    HRESULT STDMETHODCALLTYPE SetSize(ULARGE_INTEGER) noexcept override { return E_NOTIMPL; }
+    HRESULT STDMETHODCALLTYPE CopyTo(IStream*, ULARGE_INTEGER, ULARGE_INTEGER*, ULARGE_INTEGER*) noexcept override { return E_NOTIMPL; }
+    HRESULT STDMETHODCALLTYPE Commit(DWORD) noexcept override { return E_NOTIMPL; }
+    HRESULT STDMETHODCALLTYPE Revert() noexcept override { return E_NOTIMPL; }
+    HRESULT STDMETHODCALLTYPE LockRegion(ULARGE_INTEGER, ULARGE_INTEGER, DWORD) noexcept override { return E_NOTIMPL; }
+    HRESULT STDMETHODCALLTYPE UnlockRegion(ULARGE_INTEGER, ULARGE_INTEGER, DWORD) noexcept override { return E_NOTIMPL; }
+    HRESULT STDMETHODCALLTYPE Stat(STATSTG*, DWORD) noexcept override { return E_NOTIMPL; }
+    HRESULT STDMETHODCALLTYPE Clone(IStream**) noexcept override { return E_NOTIMPL; }
+
+private:
+    SimulatedLatencySource& m_source;
+    ULONG m_refs = 0;
+    std::uint64_t m_size = 0;
+    std::uint64_t m_position = 0;
+};
+
+} // MsixBenchmark
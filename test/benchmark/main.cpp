@@ -0,0 +1,58 @@
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+#include "Benchmarks.hpp"
+
+#include <string>
+#include <iostream>
+
+void Help()
+{
+    std::cout << std::endl;
+    std::cout << "Usage:" << std::endl;
+    std::cout << "------" << std::endl;
+    std::cout << "\tbenchmark [-b <benchmark>] [-d <directory>] [-i <iterations>]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Description:" << std::endl;
+    std::cout << "------------" << std::endl;
+    std::cout << "\tMeasures MSIX SDK performance over synthetic packages" << std::endl;
+    std::cout << "\t\t-b <benchmark> : runs only the specified benchmark. By default, runs all of them" << std::endl;
+    std::cout << "\t\t-d <directory> : directory where the synthetic packages are created. By default, the current directory" << std::endl;
+    std::cout << "\t\t-i <iterations>: number of times each measurement is repeated. By default, 5" << std::endl;
+    std::cout << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    char* name = nullptr;
+    char* directory = nullptr;
+    int iterations = 5;
+
+    for (int i = 1; i < argc; i++)
+    {
+        auto option = std::string(argv[i]);
+        if (++i == argc)
+        {
+            Help();
+            return 1;
+        }
+        if (option == "-b")
+        {
+            name = argv[i];
+        }
+        else if (option == "-d")
+        {
+            directory = argv[i];
+        }
+        else if (option == "-i")
+        {
+            iterations = std::stoi(argv[i]);
+        }
+        else
+        {
+            Help();
+            return 1;
+        }
+    }
+
+    return RunBenchmarks(name, directory, iterations);
+}
@@ -0,0 +1,394 @@
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+#include "CompressionTests.hpp"
+#include "BlockDeflater.hpp"
+#include "BlockDecoder.hpp"
+
+#ifdef WIN32
+#include "zlib.h"
+#else
+#include <zlib.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+    const std::size_t BlockSize = 65536;
+
+    // Something that compresses about as well as a payload file: words from a small vocabulary, with runs of
+    // random bytes in between. Always the same for the same size.
+    std::vector<std::uint8_t> MakeData(std::size_t size)
+    {
+        static const char* words[] = { "package", "manifest", "block", "deflate", " ", " ", "\r\n", "<Identity/>", "0123456789" };
+        std::vector<std::uint8_t> data;
+        data.reserve(size);
+        std::uint32_t state = 0x12345678;
+        auto next = [&state]() { state = state * 1103515245 + 12345; return state >> 8; };
+        while (data.size() < size)
+        {
+            if (next() % 16 == 0)
+            {
+                for (auto count = next() % 64; count > 0 && data.size() < size; count--)
+                {
+                    data.push_back(static_cast<std::uint8_t>(next()));
+                }
+            }
+            else
+            {
+                const char* word = words[next() % (sizeof(words) / sizeof(words[0]))];
+                for (; *word != '\0' && data.size() < size; word++)
+                {
+                    data.push_back(static_cast<std::uint8_t>(*word));
+                }
+            }
+        }
+        return data;
+    }
+
+    // Inflates raw deflate data with zlib. Returns false if zlib doesn't take it, or it doesn't inflate to
+    // exactly expectedSize bytes. With end, the data has to finish the deflate stream.
+    bool Inflate(const std::uint8_t* source, std::size_t sourceSize, std::size_t expectedSize, bool end, std::vector<std::uint8_t>& output)
+    {
+        z_stream stream = {};
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) { return false; }
+        output.assign(expectedSize + 1, 0);
+        stream.next_in = const_cast<std::uint8_t*>(source);
+        stream.avail_in = static_cast<uInt>(sourceSize);
+        stream.next_out = output.data();
+        stream.avail_out = static_cast<uInt>(output.size());
+        auto result = inflate(&stream, Z_SYNC_FLUSH);
+        auto produced = stream.total_out;
+        auto left = stream.avail_in;
+        inflateEnd(&stream);
+        output.resize(produced);
+        return (result == (end ? Z_STREAM_END : Z_OK)) && (left == 0) && (produced == expectedSize);
+    }
+
+    const std::size_t Sizes[] = { 0, 1, BlockSize - 1, BlockSize, BlockSize + 1, 10 * BlockSize + 123 };
+
+    bool DeflateSameForAnyThreadCount()
+    {
+        for (auto size : Sizes)
+        {
+            auto data = MakeData(size);
+            std::vector<std::uint8_t> expected;
+            std::vector<std::uint32_t> expectedSizes;
+            MSIX::BlockDeflater(1).Deflate(data.data(), size, expected, expectedSizes);
+            for (std::size_t threads : { 2, 3, 8, 0 })
+            {
+                std::vector<std::uint8_t> compressed;
+                std::vector<std::uint32_t> blockSizes;
+                MSIX::BlockDeflater(threads).Deflate(data.data(), size, compressed, blockSizes);
+                if ((compressed != expected) || (blockSizes != expectedSizes))
+                {
+                    std::cout << "\t" << size << " bytes on " << threads << " threads differ from one thread" << std::endl;
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool DeflateInflatesWithZlib()
+    {
+        for (auto size : Sizes)
+        {
+            auto data = MakeData(size);
+            std::vector<std::uint8_t> compressed;
+            std::vector<std::uint32_t> blockSizes;
+            MSIX::BlockDeflater(4).Deflate(data.data(), size, compressed, blockSizes);
+
+            std::vector<std::uint8_t> output;
+            if (!Inflate(compressed.data(), compressed.size(), size, true, output) || (output != data))
+            {
+                std::cout << "\t" << size << " bytes don't inflate back" << std::endl;
+                return false;
+            }
+            // The stream ends with the final empty block AppxPackageObject::VerifyFile allows after the blocks.
+            std::size_t total = 0;
+            for (auto blockSize : blockSizes) { total += blockSize; }
+            if ((blockSizes.size() != (size + BlockSize - 1) / BlockSize) || (compressed.size() != total + 2) ||
+                (compressed[total] != 0x03) || (compressed[total + 1] != 0x00))
+            {
+                std::cout << "\t" << size << " bytes don't end with 03 00 after the blocks" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool DeflateBlocksInflateAlone()
+    {
+        auto size = Sizes[sizeof(Sizes) / sizeof(Sizes[0]) - 1];
+        auto data = MakeData(size);
+        std::vector<std::uint8_t> compressed;
+        std::vector<std::uint32_t> blockSizes;
+        MSIX::BlockDeflater(4).Deflate(data.data(), size, compressed, blockSizes);
+
+        std::size_t offset = 0;
+        for (std::size_t i = 0; i < blockSizes.size(); i++)
+        {
+            auto expectedSize = std::min(BlockSize, size - i * BlockSize);
+            std::vector<std::uint8_t> output;
+            if (!Inflate(compressed.data() + offset, blockSizes[i], expectedSize, false, output) ||
+                (std::memcmp(output.data(), data.data() + i * BlockSize, expectedSize) != 0))
+            {
+                std::cout << "\tblock " << i << " doesn't inflate by itself" << std::endl;
+                return false;
+            }
+            offset += blockSizes[i];
+        }
+        return true;
+    }
+
+    // Deflates data with zlib the way another packaging tool could have. With flushes, the data is split in a few
+    // deflate blocks, with an empty stored block after each of them.
+    std::vector<std::uint8_t> ZlibDeflate(const std::vector<std::uint8_t>& data, int level, int strategy, bool flushes)
+    {
+        z_stream stream = {};
+        if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, strategy) != Z_OK) { throw std::runtime_error("deflateInit2 failed"); }
+        std::vector<std::uint8_t> compressed(deflateBound(&stream, static_cast<uLong>(data.size())) + 64 * 5);
+        stream.next_out = compressed.data();
+        stream.avail_out = static_cast<uInt>(compressed.size());
+        std::size_t pieces = flushes ? 4 : 1;
+        std::size_t offset = 0;
+        for (std::size_t i = 1; i <= pieces; i++)
+        {
+            auto end = data.size() * i / pieces;
+            stream.next_in = const_cast<std::uint8_t*>(data.data() + offset);
+            stream.avail_in = static_cast<uInt>(end - offset);
+            offset = end;
+            if (deflate(&stream, (i == pieces) ? Z_FINISH : Z_FULL_FLUSH) == Z_STREAM_ERROR) { throw std::runtime_error("deflate failed"); }
+        }
+        compressed.resize(stream.total_out);
+        deflateEnd(&stream);
+        return compressed;
+    }
+
+    // DecodeBlock has to fill destination exactly when zlib gets that many bytes out of the same data, and with the
+    // same bytes. What zlib does with the data after that doesn't matter, DecodeBlock stops there.
+    bool DecodeLikeZlib(const std::uint8_t* source, std::size_t sourceSize, std::size_t destinationSize, const char* what)
+    {
+        std::vector<std::uint8_t> expected(destinationSize + 1, 0);
+        z_stream stream = {};
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) { return false; }
+        stream.next_in = const_cast<std::uint8_t*>(source);
+        stream.avail_in = static_cast<uInt>(sourceSize);
+        stream.next_out = expected.data();
+        stream.avail_out = static_cast<uInt>(destinationSize);
+        inflate(&stream, Z_SYNC_FLUSH);
+        bool full = (stream.total_out == destinationSize);
+        inflateEnd(&stream);
+
+        std::vector<std::uint8_t> output(destinationSize + 1, 0);
+        auto status = MSIX::DecodeBlock(source, sourceSize, output.data(), destinationSize);
+        if ((status == MSIX::CompressionStatus::Ok) != full)
+        {
+            std::cout << "	" << what << ": " << sourceSize << " bytes into " << destinationSize << (full ? " failed, zlib inflates them" : " succeeded, zlib doesn't inflate them") << std::endl;
+            return false;
+        }
+        if (full && (output != expected))
+        {
+            std::cout << "	" << what << ": " << sourceSize << " bytes into " << destinationSize << " inflate to something else than with zlib" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    struct Encoding
+    {
+        const char* name;
+        int level;
+        int strategy;
+        bool flushes;
+    };
+
+    // Stored, fixed and dynamic Huffman blocks, alone and mixed.
+    const Encoding Encodings[] = {
+        { "stored",       0, Z_DEFAULT_STRATEGY, false },
+        { "fixed",        6, Z_FIXED,            false },
+        { "fast",         1, Z_DEFAULT_STRATEGY, false },
+        { "default",      6, Z_DEFAULT_STRATEGY, false },
+        { "best",         9, Z_DEFAULT_STRATEGY, false },
+        { "huffman only", 6, Z_HUFFMAN_ONLY,     false },
+        { "rle",          6, Z_RLE,              false },
+        { "flushed",      6, Z_DEFAULT_STRATEGY, true },
+        { "stored flushed", 0, Z_DEFAULT_STRATEGY, true },
+    };
+
+    const std::size_t DecodeSizes[] = { 1, 100, 4000, BlockSize };
+
+    bool DecodeValid()
+    {
+        for (auto size : DecodeSizes)
+        {
+            auto data = MakeData(size);
+            for (const auto& encoding : Encodings)
+            {
+                auto compressed = ZlibDeflate(data, encoding.level, encoding.strategy, encoding.flushes);
+                std::vector<std::uint8_t> output(size);
+                if ((MSIX::DecodeBlock(compressed.data(), compressed.size(), output.data(), size) != MSIX::CompressionStatus::Ok) || (output != data))
+                {
+                    std::cout << "	" << size << " bytes " << encoding.name << " don't decode" << std::endl;
+                    return false;
+                }
+            }
+        }
+        // What BlockDeflater makes, block by block as the block map has them.
+        auto size = Sizes[sizeof(Sizes) / sizeof(Sizes[0]) - 1];
+        auto data = MakeData(size);
+        std::vector<std::uint8_t> compressed;
+        std::vector<std::uint32_t> blockSizes;
+        MSIX::BlockDeflater(1).Deflate(data.data(), size, compressed, blockSizes);
+        std::size_t offset = 0;
+        for (std::size_t i = 0; i < blockSizes.size(); i++)
+        {
+            auto expectedSize = std::min(BlockSize, size - i * BlockSize);
+            std::vector<std::uint8_t> output(expectedSize);
+            if ((MSIX::DecodeBlock(compressed.data() + offset, blockSizes[i], output.data(), expectedSize) != MSIX::CompressionStatus::Ok) ||
+                (std::memcmp(output.data(), data.data() + i * BlockSize, expectedSize) != 0))
+            {
+                std::cout << "	block " << i << " doesn't decode" << std::endl;
+                return false;
+            }
+            offset += blockSizes[i];
+        }
+        // Nothing to fill is done before looking at the data.
+        return MSIX::DecodeBlock(nullptr, 0, nullptr, 0) == MSIX::CompressionStatus::Ok;
+    }
+
+    bool DecodeTruncated()
+    {
+        for (auto size : DecodeSizes)
+        {
+            auto data = MakeData(size);
+            for (const auto& encoding : Encodings)
+            {
+                auto compressed = ZlibDeflate(data, encoding.level, encoding.strategy, encoding.flushes);
+                // Every length for short data, some hundreds of them for longer data, and the last few bytes.
+                std::size_t step = std::max(static_cast<std::size_t>(1), compressed.size() / 300);
+                for (std::size_t length = 0; length < compressed.size(); length += (compressed.size() - length <= 16) ? 1 : step)
+                {
+                    // Copied, so reading past length would be past the end of the buffer.
+                    std::vector<std::uint8_t> prefix(compressed.begin(), compressed.begin() + length);
+                    if (!DecodeLikeZlib(prefix.data(), prefix.size(), size, encoding.name)) { return false; }
+                }
+            }
+        }
+        return true;
+    }
+
+    bool DecodeCorrupt()
+    {
+        for (auto size : DecodeSizes)
+        {
+            auto data = MakeData(size);
+            for (const auto& encoding : Encodings)
+            {
+                auto compressed = ZlibDeflate(data, encoding.level, encoding.strategy, encoding.flushes);
+                // Single bits flipped, every one of them in the first bytes, where the block headers and code
+                // lengths are, then a few hundred spread over the rest. Then whole bytes set to 0 and 0xFF.
+                std::size_t bits = compressed.size() * 8;
+                std::size_t step = std::max(static_cast<std::size_t>(1), bits / 500);
+                for (std::size_t bit = 0; bit < bits; bit += (bit < 512) ? 1 : step)
+                {
+                    auto corrupt = compressed;
+                    corrupt[bit / 8] ^= static_cast<std::uint8_t>(1 << (bit % 8));
+                    if (!DecodeLikeZlib(corrupt.data(), corrupt.size(), size, encoding.name)) { return false; }
+                }
+                for (std::size_t byte = 0; byte < compressed.size(); byte += std::max(static_cast<std::size_t>(1), compressed.size() / 100))
+                {
+                    for (std::uint8_t value : { 0x00, 0xFF })
+                    {
+                        auto corrupt = compressed;
+                        corrupt[byte] = value;
+                        if (!DecodeLikeZlib(corrupt.data(), corrupt.size(), size, encoding.name)) { return false; }
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    bool DecodeOverLong()
+    {
+        for (auto size : DecodeSizes)
+        {
+            auto data = MakeData(size);
+            for (const auto& encoding : Encodings)
+            {
+                auto compressed = ZlibDeflate(data, encoding.level, encoding.strategy, encoding.flushes);
+                // More data than the destination holds: it is filled with the start of it.
+                for (auto destinationSize : { size - 1, size / 2, static_cast<std::size_t>(1) })
+                {
+                    if (destinationSize == 0) { continue; }
+                    std::vector<std::uint8_t> output(destinationSize);
+                    if ((MSIX::DecodeBlock(compressed.data(), compressed.size(), output.data(), destinationSize) != MSIX::CompressionStatus::Ok) ||
+                        (std::memcmp(output.data(), data.data(), destinationSize) != 0) ||
+                        !DecodeLikeZlib(compressed.data(), compressed.size(), destinationSize, encoding.name))
+                    {
+                        std::cout << "	" << size << " bytes " << encoding.name << " don't decode into " << destinationSize << std::endl;
+                        return false;
+                    }
+                }
+                // Bytes after the end of the deflate data are ignored.
+                auto longer = compressed;
+                longer.insert(longer.end(), { 0x00, 0xFF, 0x03, 0x00, 0x5A });
+                if (!DecodeLikeZlib(longer.data(), longer.size(), size, encoding.name)) { return false; }
+                // A destination bigger than the data never fills.
+                if (!DecodeLikeZlib(compressed.data(), compressed.size(), size + 1, encoding.name) ||
+                    !DecodeLikeZlib(compressed.data(), compressed.size(), size + BlockSize, encoding.name))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    struct Test
+    {
+        const char* name;
+        std::function<bool()> run;
+    };
+
+    const Test Tests[] = {
+        { "Deflate.SameForAnyThreadCount", DeflateSameForAnyThreadCount },
+        { "Deflate.InflatesWithZlib",      DeflateInflatesWithZlib },
+        { "Deflate.BlocksInflateAlone",    DeflateBlocksInflateAlone },
+        { "Decode.Valid",                  DecodeValid },
+        { "Decode.Truncated",              DecodeTruncated },
+        { "Decode.Corrupt",                DecodeCorrupt },
+        { "Decode.OverLong",               DecodeOverLong },
+    };
+}
+
+int RunCompressionTests(char* name)
+{
+    int failed = 0;
+    for (const auto& test : Tests)
+    {
+        if ((name != nullptr) && (std::string(name) != test.name)) { continue; }
+        bool passed = false;
+        try
+        {
+            passed = test.run();
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "\t" << e.what() << std::endl;
+        }
+        std::cout << "\tTest " << test.name << (passed ? " [PASSED]" : " [FAILED]") << std::endl;
+        if (!passed) { failed++; }
+    }
+    return failed;
+}
@@ -0,0 +1,7 @@
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+#pragma once
+
+// Runs the compression test with the given name, or all of them if name is null. Returns the number
+// of tests that failed.
+int RunCompressionTests(char* name);
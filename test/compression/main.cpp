@@ -0,0 +1,41 @@
+//  Copyright (C) 2019 Microsoft.  All rights reserved.
+//  See LICENSE file in the project root for full license information.
+#include "CompressionTests.hpp"
+
+#include <string>
+#include <iostream>
+
+void Help()
+{
+    std::cout << std::endl;
+    std::cout << "Usage:" << std::endl;
+    std::cout << "------" << std::endl;
+    std::cout << "\tcompressiontest [-t <test>]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Description:" << std::endl;
+    std::cout << "------------" << std::endl;
+    std::cout << "\tChecks the compression code of the MSIX SDK against zlib" << std::endl;
+    std::cout << "\t\t-t <test> : runs only the specified test. By default, runs all of them" << std::endl;
+    std::cout << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    char* name = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        auto option = std::string(argv[i]);
+        if ((option == "-t") && (i + 1 < argc))
+        {
+            name = argv[++i];
+        }
+        else
+        {
+            Help();
+            return 1;
+        }
+    }
+
+    return (RunCompressionTests(name) == 0) ? 0 : 1;
+}